@@ -1,6 +1,14 @@
 #version 120
 
-uniform sampler2D uTexture;     // Diffuse texture
+// One fragment program for all of the animals (see animal.vert)
+
+#ifdef TEXTURE_ARRAY
+#extension GL_EXT_texture_array : enable
+uniform sampler2DArray uTextures;   // Diffuse textures, one layer per species
+#else
+uniform sampler2D uTexture;     // Diffuse texture of the species being drawn
+#endif
+uniform int uSpecies;           // Which species is being drawn
 uniform float uKa, uKd, uKs;    // Lighting coefficients
 uniform float uShininess;       // Shininess for specular highlights
 
@@ -11,9 +19,16 @@ varying vec3 vE;                // Vector to eye
 
 const vec3 SPECULARCOLOR = vec3(0.925, 0.813, 0.582); // Specular highlight color
 
+uniform float uClusteredLights;     // Add the clustered lights (0.0 = off, 1.0 = on)
+vec3 ClusteredLights(vec3 ecPos, vec3 Normal, vec3 Eye, vec3 color, float kd, float ks, float shininess, vec3 specularColor);
+
 void main() {
     // Sample the diffuse texture
+#ifdef TEXTURE_ARRAY
+    vec3 textureColor = texture2DArray(uTextures, vec3(vST, float(uSpecies))).rgb;
+#else
     vec3 textureColor = texture2D(uTexture, vST).rgb;
+#endif
 
     // Normalize vectors
     vec3 Normal = normalize(vN);
@@ -38,6 +53,11 @@ void main() {
     }
     vec3 specular = uKs * s * SPECULARCOLOR;
 
+    // Point and spot lights from the clusters (vE is the negated eye-space position)
+    vec3 clustered = vec3(0.0);
+    if (uClusteredLights > 0.0)
+        clustered = ClusteredLights(-vE, Normal, Eye, textureColor, uKd, uKs, uShininess, SPECULARCOLOR);
+
     // Final color
-    gl_FragColor = vec4(ambient + diffuse + specular, 1.0);
+    gl_FragColor = vec4(ambient + diffuse + specular + clustered, 1.0);
 }
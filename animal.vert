@@ -0,0 +1,123 @@
+#version 120
+
+// One vertex program for all of the animals.
+// Each species' animation constants are a row in the tables below (filled in once by
+// SetAnimalSpecies( ) in forest.cpp), and uSpecies picks the row for each draw.
+
+// Permutations (GLSLProgram::Variant( ) adds these as #defines):
+//   TURN          -- turning animation
+//   BEND          -- bending animation (the deer grazing, the cats running)
+//   TEXTURE_ARRAY -- the diffuse maps are layers of one texture array (see animal.frag)
+//   BAKED         -- play back a clip baked into a vertex animation texture instead of
+//                    evaluating TURN or BEND (see vertexanimation.h)
+
+const int NUM_SPECIES = 4;              // must match NUM_SPECIES in forest.cpp
+
+uniform float uTime;                    // Control for animation timing
+uniform int   uSpecies;                 // Row of the species tables
+
+// Turning: vertices on one side of a threshold along uTurnAlong get pushed along uTurnPush
+uniform vec3 uTurnAlong[NUM_SPECIES];   // Axis the turn is measured along
+uniform vec3 uTurnPush[NUM_SPECIES];    // Axis the vertices are pushed along
+uniform vec4 uTurnCycle[NUM_SPECIES];   // Intensity, turn duration, pause duration, 1 = symmetric turn
+uniform vec2 uTurnRegion[NUM_SPECIES];  // Threshold, side of it that turns (+1 above, -1 below)
+
+// Bending: vertices get pushed back along uBendPush, more the further they are along uBendAlong
+uniform vec3 uBendAlong[NUM_SPECIES];   // Axis the bend is measured along
+uniform vec3 uBendPush[NUM_SPECIES];    // Axis the vertices are pushed along
+uniform vec4 uBendCycle[NUM_SPECIES];   // Intensity, cycle time, waves per cycle, stretch when bending backward
+uniform vec3 uBendRegion[NUM_SPECIES];  // Threshold, side of it that bends (0 = all), falloff offset (0 = none)
+
+#ifdef BAKED
+// Baked clips: one texel of offsets per vertex per sample, the vertex's index is gl_MultiTexCoord1.s
+uniform sampler2D uVAT;
+uniform vec4  uVATClip;                 // First row, samples, cycle length, rows per sample
+uniform float uVATWidth;
+uniform float uVATHeight;
+
+vec3 BakedOffset(float index, float frame) {
+    float row = floor((index + 0.5) / uVATWidth);
+    float column = index - row * uVATWidth;
+    vec2 st = vec2((column + 0.5) / uVATWidth,
+                   (uVATClip.x + frame * uVATClip.w + row + 0.5) / uVATHeight);
+    return texture2DLod(uVAT, st, 0.0).xyz;
+}
+#endif
+
+varying vec2 vST;                       // Texture coordinates
+varying vec3 vN;                        // Normal vector
+varying vec3 vL;                        // Vector to light
+varying vec3 vE;                        // Vector to eye
+
+const vec3 LIGHTPOS = vec3(20.0, 60.0, 25.0); // Position of the light source
+
+void main() {
+    vST = gl_MultiTexCoord0.st;
+    vec3 vert = gl_Vertex.xyz;
+
+#ifdef BAKED
+    {
+        // Mix the two samples on either side of this point in the cycle
+        float frame = mod(uTime, uVATClip.z) / uVATClip.z * uVATClip.y;
+        float s0 = min(floor(frame), uVATClip.y - 1.0);
+        float s1 = mod(s0 + 1.0, uVATClip.y);
+        float index = gl_MultiTexCoord1.s;
+        vert += mix(BakedOffset(index, s0), BakedOffset(index, s1), frame - s0);
+    }
+#else
+
+#ifdef TURN
+    {
+        vec4 cycle = uTurnCycle[uSpecies];
+
+        // Determine the current phase in the turn-and-pause cycle
+        float phaseTime = mod(uTime, cycle.y + cycle.z);
+
+        if (phaseTime < cycle.y) {
+            float cyclePhase = phaseTime / cycle.y;
+            float turnFactor = sin(cyclePhase * 3.14159 * 2.0); // Sinusoidal oscillation
+
+            // Symmetric motion adjustment
+            if (cycle.w > 0.0)
+                turnFactor = abs(turnFactor) * 2.0 - 1.0;
+
+            float along = dot(vert, uTurnAlong[uSpecies]);
+            vec2 region = uTurnRegion[uSpecies];
+            if ((along - region.x) * region.y > 0.0) {
+                // Parabolic influence based on the vertex position along the axis
+                vert += uTurnPush[uSpecies] * (turnFactor * cycle.x * along * along);
+            }
+        }
+    }
+#endif
+
+#ifdef BEND
+    {
+        vec4 cycle = uBendCycle[uSpecies];
+        float cyclePhase = mod(uTime, cycle.y) / cycle.y;
+        float bendFactor = sin(cyclePhase * 3.14159 * 2.0 * cycle.z) * cycle.x;
+
+        float along = dot(vert, uBendAlong[uSpecies]);
+        vec3 region = uBendRegion[uSpecies];
+        if ((along - region.x) * region.y >= 0.0) {
+            if (region.z > 0.0)
+                bendFactor /= (along + region.z);
+
+            // Bend forward (narrow), or stretch backward (wide)
+            float amount = bendFactor * (along * along);
+            if (bendFactor < 0.0)
+                amount *= -cycle.w;
+            vert -= uBendPush[uSpecies] * amount;
+        }
+    }
+#endif
+
+#endif
+
+    vec4 ECposition = gl_ModelViewMatrix * vec4(vert, 1.0);
+    vN = normalize(gl_NormalMatrix * gl_Normal);
+    vL = LIGHTPOS - ECposition.xyz;
+    vE = vec3(0.0, 0.0, 0.0) - ECposition.xyz;
+
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(vert, 1.0);
+}
@@ -0,0 +1,75 @@
+#version 120
+
+// Clustered forward lighting -- linked into each animal's fragment program.
+// The light lists are built on the CPU each frame by LightClusters (lightclusters.cpp).
+
+uniform sampler2D uLightData;       // MaxLights x 3: eye position+radius, color+type, spot direction+cos(cutoff)
+uniform sampler2D uClusterData;     // (X*Y) x Z: offset into the index list, number of lights
+uniform sampler2D uLightIndices;    // the per-cluster light index lists
+uniform vec4  uClusterViewport;     // x, y, width, height
+uniform vec3  uClusterDims;         // clusters in x, y, z
+uniform float uClusterScale;        // slice = log(depth)*uClusterScale + uClusterBias
+uniform float uClusterBias;
+uniform float uMaxLights;
+uniform float uIndexWidth;
+uniform float uIndexRows;
+
+const int MAX_CLUSTER_LIGHTS = 64;  // must match CLUSTER_MAX_LIGHTS in lightclusters.h
+
+vec3 ClusteredLights(vec3 ecPos, vec3 Normal, vec3 Eye, vec3 color, float kd, float ks, float shininess, vec3 specularColor) {
+    // Find this fragment's cluster
+    vec2 tile = floor((gl_FragCoord.xy - uClusterViewport.xy) * uClusterDims.xy / uClusterViewport.zw);
+    tile = clamp(tile, vec2(0.0), uClusterDims.xy - 1.0);
+    float slice = floor(log(max(-ecPos.z, 0.0001)) * uClusterScale + uClusterBias);
+    slice = clamp(slice, 0.0, uClusterDims.z - 1.0);
+
+    vec2 clusterST = vec2((tile.x + tile.y * uClusterDims.x + 0.5) / (uClusterDims.x * uClusterDims.y),
+                          (slice + 0.5) / uClusterDims.z);
+    vec2 cluster = texture2D(uClusterData, clusterST).ra;
+    int offset = int(cluster.x);
+    int count = int(cluster.y);
+
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < MAX_CLUSTER_LIGHTS; i++) {
+        if (i >= count)
+            break;
+
+        // Look up the light's index, then its data
+        float index = float(offset + i);
+        vec2 indexST = vec2((mod(index, uIndexWidth) + 0.5) / uIndexWidth,
+                            (floor(index / uIndexWidth) + 0.5) / uIndexRows);
+        float light = texture2D(uLightIndices, indexST).r;
+        float s = (light + 0.5) / uMaxLights;
+        vec4 posRadius = texture2D(uLightData, vec2(s, 0.5 / 3.0));
+        vec4 colorType = texture2D(uLightData, vec2(s, 1.5 / 3.0));
+        vec4 spot      = texture2D(uLightData, vec2(s, 2.5 / 3.0));
+
+        vec3 toLight = posRadius.xyz - ecPos;
+        float dist = length(toLight);
+        if (dist >= posRadius.w)
+            continue;
+        vec3 L = toLight / dist;
+
+        // Smooth falloff to zero at the radius of influence
+        float falloff = 1.0 - dist / posRadius.w;
+        falloff *= falloff;
+
+        // Spot lights are cut off outside their cone
+        if (colorType.w > 0.5) {
+            float cosAngle = dot(-L, spot.xyz);
+            if (cosAngle < spot.w)
+                continue;
+            falloff *= smoothstep(spot.w, mix(spot.w, 1.0, 0.2), cosAngle);
+        }
+
+        float d = max(dot(Normal, L), 0.0);
+        float sp = 0.0;
+        if (d > 0.0) {
+            float cosphi = dot(Eye, normalize(reflect(-L, Normal)));
+            if (cosphi > 0.0)
+                sp = pow(cosphi, shininess);
+        }
+        result += falloff * colorType.rgb * (kd * d * color + ks * sp * specularColor);
+    }
+    return result;
+}
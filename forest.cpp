@@ -179,6 +179,59 @@ const float	WHITE[ ] = { 1.,1.,1.,1. };
 // for animation:
 
 const int MS_PER_CYCLE = 40000;		// 10000 milliseconds = 10 seconds
+const float CYCLE_SECONDS = (float)MS_PER_CYCLE / 1000.f;
+
+// for a headless run -- how many frames to draw unless told otherwise,
+// and what it exits with when it cannot finish:
+
+const int HEADLESS_FRAMES = 240;
+const int HEADLESS_BAD_ARGUMENTS = 1;
+const int HEADLESS_NO_CONTEXT = 2;
+const int HEADLESS_GL_ERRORS = 3;
+const int HEADLESS_NO_OUTPUT = 4;
+
+// for a benchmark run -- where the timings go (.json and .csv are added),
+// and the bush seed, so every run places the bushes the same way:
+
+const char *BENCH_OUTPUT = "bench";
+const unsigned int BUSH_SEED = 450;
+
+// where the 'c' key captures frames to, unless --capture said somewhere else:
+
+const char *CAPTURE_OUTPUT = "capture";
+
+// where --trace writes the trace if it isn't given a file name:
+
+const char *TRACE_OUTPUT = "trace.json";
+
+// how many frames --record records unless --record-frames says otherwise (0 = until quitting):
+
+const int RECORD_FRAMES = 1;
+
+// the HUD's frame-time percentiles are over this many seconds:
+
+const int HUD_METRICS_SECONDS = 10;
+
+// radius of the keytimed camera orbit around the origin:
+
+const float CAMERA_RADIUS = 24.f;
+
+// for shadows:
+
+const float SUNPOS[ ] = { 20.f, 60.f, 25.f };	// where SetPointLight( ) puts the sun
+const int SHADOW_STATIC_SIZE  = 2048;		// resolution of each cached static cascade
+const int SHADOW_DYNAMIC_SIZE = 1024;		// resolution of the per-frame animal map
+const int SHADOW_CASCADES     = 2;
+
+// for the clustered fireflies and lanterns:
+
+const int MAX_CLUSTERED_LIGHTS = 256;
+const int NUM_FIREFLIES        = 200;
+const int NUM_LANTERNS         = 4;
+const float FIREFLY_RADIUS     = 3.f;		// distance a firefly's light reaches
+const float LANTERN_RADIUS     = 30.f;
+const float CLUSTER_NEAR       = 1.f;		// depth range that gets sliced into clusters
+const float CLUSTER_FAR        = 100.f;
 
 // what options should we compile-in?
 // in general, you don't need to worry about these
@@ -192,16 +245,25 @@ const int MS_PER_CYCLE = 40000;		// 10000 milliseconds = 10 seconds
 int		ActiveButton;			// current button that is down
 GLuint	AxesList;				// list to hold the axes
 int		AxesOn;					// != 0 means to draw the axes
+int		BakedAnimationOn;		// != 0 means to play the animals' baked clips instead of evaluating them
 int		DebugOn;				// != 0 means to print debugging info
+int		Bench;					// != 0 means to time every pass of a fixed run of frames, then quit
+int		Headless;				// != 0 means to draw offscreen, with no window
 int		DepthCueOn;				// != 0 means to use intensity depth cueing
 int		DepthBufferOn;			// != 0 means to use the z-buffer
 int		DepthFightingOn;		// != 0 means to force the creation of z-fighting
+int		DepthPrePassOn;			// != 0 means to lay down depth first, then shade with GL_EQUAL
+int		HudOn;					// != 0 means to draw the performance HUD
+int		LightsOn;				// != 0 means to turn the fireflies and lanterns on
 int		MainWindow;				// window id for main graphics window
 int		NowColor;				// index into Colors[ ]
 int		NowProjection;			// ORTHO or PERSP
 float	Scale;					// scaling factor
 int		ShadowsOn;				// != 0 means to turn shadows on
+int		UniformWritesRequested;	// shader uniform writes last frame
+int		UniformWritesIssued;	// ... and how many of them reached the driver
 float	Time;					// used for animation, this has a value between 0. and 1.
+int		WindowVisible;			// != 0 means the window can be seen
 int		Xmouse, Ymouse;			// mouse values
 float	Xrot, Yrot;				// rotation angles in degrees
 
@@ -210,24 +272,38 @@ float	Xrot, Yrot;				// rotation angles in degrees
 
 void	Animate( );
 void	Display( );
+void	DoAnimationMenu( int );
 void	DoAxesMenu( int );
 void	DoColorMenu( int );
 void	DoDepthBufferMenu( int );
 void	DoDepthFightingMenu( int );
 void	DoDepthMenu( int );
+void	DoDepthPrePassMenu( int );
+void	DoFrameRateMenu( int );
+void	DoHudMenu( int );
 void	DoDebugMenu( int );
+void	DoLightsMenu( int );
 void	DoMainMenu( int );
 void	DoProjectMenu( int );
+void	DoShadowsMenu( int );
 void	DoRasterString( float, float, float, char * );
 void	DoStrokeString( float, float, float, float, char * );
 float	ElapsedSeconds( );
 void	InitGraphics( );
+void	InitWindow( );
 void	InitLists( );
 void	InitMenus( );
 void	Keyboard( unsigned char, int, int );
 void	MouseButton( int, int, int, int );
 void	MouseMotion( int, int );
 void	Reset( );
+int		RunHeadless( int, int, int, const char * );
+void	StartBench( int );
+void	SetHud( int );
+bool	StartCapture( int );
+bool	StopCapture( );
+void	BenchFrameDone( );
+bool	FinishBench( );
 void	Resize( int, int );
 void	Visibility( int );
 
@@ -261,21 +337,24 @@ GLuint GridDL; 						// Declare display list for grid
 GLuint BushDL, RockDL, DeerDL, BearDL, OrangeCatDL, BlackCatDL;
 
 // Forest textures
-GLuint TreeTexture, FloorTexture, BushDiffuseTexture, BushSpecularTexture, RockTexture, DeerTexture, PanelTexture, BearTexture, OrangeCatTexture, BlackCatTexture;
+GLuint TreeTexture, FloorTexture, BushDiffuseTexture, BushSpecularTexture, RockTexture, PanelTexture;
 
 // Tree vertex buffer
-GLuint treeVBO, treeEBO;
+GLuint treeVBO, treeEBO, treeDepthVBO;
 std::vector<float> treeVertices;
+std::vector<float> treeDepthVertices;		// positions only, for depth passes
 std::vector<unsigned int> treeIndices;
 
 // Bush vertex buffer
-GLuint bushVBO, bushEBO;
+GLuint bushVBO, bushEBO, bushDepthVBO;
 std::vector<float> bushVertices;
+std::vector<float> bushDepthVertices;		// positions only, for depth passes
 std::vector<unsigned int> bushIndices;
 
 // Rock vertex buffer
-GLuint rockVBO, rockEBO;
+GLuint rockVBO, rockEBO, rockDepthVBO;
 std::vector<float> rockVertices;
+std::vector<float> rockDepthVertices;		// positions only, for depth passes
 std::vector<unsigned int> rockIndices;
 
 // Structure to hold tree positions
@@ -401,6 +480,8 @@ MulArray3(float factor, float a, float b, float c )
 
 // these are here for when you need them -- just uncomment the ones you need:
 
+#include "glstats.cpp"			// first, so that every module after it has its OpenGL calls counted
+#include "glrecord.cpp"			// ... and can have them recorded
 #include "setmaterial.cpp"
 #include "setlight.cpp"
 //#include "osusphere.cpp"
@@ -409,14 +490,180 @@ MulArray3(float factor, float a, float b, float c )
 #include "bmptotexture.cpp"
 #include "loadobjfile.cpp"
 #include "keytime.cpp"
+#include "trace.cpp"
 #include "glslprogram.cpp"
+#include "shadowmap.cpp"
+#include "lightclusters.cpp"
+#include "vertexanimation.cpp"
+#include "frameclock.cpp"
+#include "framepacer.cpp"
+#include "headless.cpp"
+#include "passtimers.cpp"
+#include "hud.cpp"
+#include "framecapture.cpp"
+#include "framehistogram.cpp"
+#include "framemetrics.cpp"
 
 // Shaders
-GLSLProgram Deer, Bear, OrangeCat, BlackCat;
+GLSLProgram Animal;		// one program for every species of animal
+
+// Shader permutation bits -- each one becomes a #define in its GLSLProgram::Variant( )
+#define ANIMAL_TURN		1
+#define ANIMAL_BEND		2
+#define ANIMAL_TEXTURE_ARRAY	4
+#define ANIMAL_BAKED		8
+
+// Rows of the animal shader's species tables (and layers of its texture array)
+#define SPECIES_DEER		0
+#define SPECIES_BEAR		1
+#define SPECIES_ORANGE_CAT	2
+#define SPECIES_BLACK_CAT	3
+#define NUM_SPECIES		4	// must match NUM_SPECIES in animal.vert
+
+// Per-species animation constants, handed to the animal shader as uniform arrays
+struct AnimalSpecies {
+	float turnAlong[3], turnPush[3];	// axis the turn is measured along, axis the vertices get pushed along
+	float turnIntensity, turnDuration, pauseDuration;
+	float turnSymmetric;			// 1 = the cats' symmetric turn
+	float turnThreshold, turnSide;		// the vertices above (+1) or below (-1) the threshold turn
+	float bendAlong[3], bendPush[3];
+	float bendIntensity, bendCycleTime;
+	float bendWaves;			// sine waves per cycle
+	float bendStretch;			// extra stretch when bending backward
+	float bendThreshold, bendSide;		// 0 = the whole body bends
+	float bendFalloff;			// bend by 1/(along+falloff) (0 = no falloff)
+};
+
+AnimalSpecies Species[NUM_SPECIES] = {
+	// Deer: turn their heads, and graze
+	{ { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f },  0.018f, 0.15f, 0.05f,  0.f,  0.f, 1.f,
+	  { 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f },  0.45f, 0.2f,  0.5f,  1.f,  1.f, 1.f,  0.1f },
+	// Bear: turns its head (and never bends)
+	{ { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f },  0.007f, 0.15f, 0.005f,  0.f,  2.f, -1.f,
+	  { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f },  0.f, 1.f,  1.f,  1.f,  0.f, 0.f,  0.f },
+	// Orange cats: turn, and run
+	{ { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f },  0.01f, 0.4f, 0.05f,  1.f,  0.f, -1.f,
+	  { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f },  0.03f, 0.05f,  1.f,  1.5f,  0.f, 0.f,  0.f },
+	// Black cats: turn, and run
+	{ { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f },  0.01f, 0.5f, 0.07f,  1.f,  0.f, -1.f,
+	  { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f },  0.03f, 0.05f,  1.f,  1.5f,  0.f, 0.f,  0.f },
+};
+
+// Animal diffuse textures -- one texture array layer per species when GL_EXT_texture_array is there,
+// otherwise one 2D texture per species
+GLuint AnimalTextureArray;
+GLuint AnimalTextures[NUM_SPECIES];
+
+// Each species' turning and bending, baked into a vertex animation texture
+// (clip numbers are -1 for the motions a species does not have)
+#define ANIMAL_BAKE_SAMPLES	32	// samples per cycle
+VertexAnimation AnimalBakes[NUM_SPECIES];
+int AnimalClips[NUM_SPECIES][2];	// turning, bending
+
+// Animation level of detail, from how tall an animal is on the screen
+#define ANIMAL_LOD_FULL		0	// animated every frame
+#define ANIMAL_LOD_REDUCED	1	// animated, but the animation only steps reducedHz times a second
+#define ANIMAL_LOD_STATIC	2	// rest pose, drawn with no deformation at all
+#define NUM_ANIMAL_LODS		3
+
+// Per-species LOD policy (heights are of the bounding sphere, in pixels)
+struct AnimalLOD {
+	float fullPixels;			// at least this tall: full animation
+	float staticPixels;			// not this tall: static pose
+	float reducedHz;			// animation steps per second in between
+};
+
+AnimalLOD SpeciesLOD[NUM_SPECIES] = {
+	{ 60.f, 15.f, 12.f },			// deer
+	{ 60.f, 15.f, 10.f },			// bear (turns slowly)
+	{ 40.f, 10.f, 15.f },			// orange cats (small and quick)
+	{ 40.f, 10.f, 15.f },			// black cats
+};
+
+float AnimalRadius[NUM_SPECIES];		// bounding sphere radius as drawn, from the models
+std::vector<int> AnimalTiers[NUM_SPECIES];	// each animal's LOD (see UpdateAnimalLOD( ))
+int AnimalTierCounts[NUM_ANIMAL_LODS];		// how many animals are in each LOD this frame
+
+// One animal shader variant, with the uniforms it sets every draw looked up once
+struct AnimalPass {
+	GLSLProgram *program;
+	unsigned int motion;			// ANIMAL_TURN, ANIMAL_BEND, or 0 for the static animals
+	int tier;				// the LOD being drawn
+	GLSLUniform<float> time;
+	GLSLUniform<int> species;
+
+	AnimalPass() : program(NULL), motion(0), tier(ANIMAL_LOD_FULL) {}
+};
+AnimalPass AnimalPasses[3];		// turning, bending, static
+
+// Cached static and per-frame dynamic shadow maps
+ShadowMap Shadows;
+
+// Fireflies and lanterns, binned into clusters for the animal shaders
+LightClusters Lights;
 
 // Keytime variables
 Keytimes CameraX, CameraZ, OrangeCatX, BlackCat1X, BlackCat1Z, BlackCat2X, BlackCat2Z, BearScale, DeerScale, CatScale;
 
+// The one clock everything animates from
+FrameClock Clock;
+
+// Holds the frame rate down, and measures how the frames are paced
+FramePacer Pacer;
+
+// What gets drawn into when there is no window (see RunHeadless( ))
+HeadlessContext Offscreen;
+
+// The passes a benchmark run times (see StartBench( ))
+enum BenchPasses {
+	PASS_SHADOWS, PASS_LIGHTS, PASS_PREPASS, PASS_GRID, PASS_TREES, PASS_BUSHES, PASS_ROCKS,
+	PASS_DEER, PASS_BEAR, PASS_ORANGE_CATS, PASS_BLACK_CATS, PASS_PANELS, PASS_FIREFLIES,
+	NUM_BENCH_PASSES
+};
+const char *BenchPassNames[NUM_BENCH_PASSES] = {
+	"shadows", "lights", "prepass", "grid", "trees", "bushes", "rocks",
+	"deer", "bear", "orange_cats", "black_cats", "panels", "fireflies"
+};
+PassTimers Timers;
+int BenchFrames;				// how many frames to time
+int BenchFrame;					// ... and how many have been, -1 until timing starts
+const char *BenchOutput = BENCH_OUTPUT;
+
+// The on-screen performance display (see DrawHud( ))
+Hud Overlay;
+
+// Frame capture (see StartCapture( ))
+FrameCapture Capture;
+int CaptureFormat = CAPTURE_PPM;
+const char *CaptureTarget;		// file name prefix, or the command to pipe to
+int CaptureFrames;				// how many frames to capture, 0 = until stopped
+int CaptureWanted;				// != 0 means to start capturing once the animals are ready
+
+// Tracing (see trace.h), NULL = don't write a trace
+const char *TraceOutput;
+
+// Recording the OpenGL calls (see glrecord.h), NULL = don't record
+const char *RecordOutput;
+int RecordFrames = RECORD_FRAMES;	// how many frames to record, 0 = until quitting
+int RecordedFrames;
+
+// Frame-time percentiles (see framemetrics.h) -- kept while the HUD is on, or if they are asked for:
+FrameMetrics Metrics;
+const char *MetricsCsv;			// where to write them when the program quits, NULL = nowhere
+int MetricsPort = -1;			// where to serve them for Prometheus, -1 = don't
+
+// Everything the keytimes decide, sampled once per simulation step
+struct SceneState {
+	float time;					// seconds into the animation cycle
+	float cameraX, cameraZ;
+	float orangeCatX;
+	float blackCat1X, blackCat1Z;
+	float blackCat2X, blackCat2Z;
+	float bearScale, deerScale, catScale;
+};
+SceneState PrevScene, NextScene;	// the last two simulation steps
+SceneState Scene;					// ... and the blend of them that gets drawn
+
 // main program:
 int
 main( int argc, char *argv[ ] )
@@ -425,6 +672,109 @@ main( int argc, char *argv[ ] )
 	// (do this before checking argc and argv since glutInit might
 	// pull some command line arguments out)
 
+	// look for our own arguments first --
+	// a headless run has no window, so it must not go near glutInit( ):
+
+	int frames = -1;
+	int width = INIT_WINDOW_SIZE;
+	int height = INIT_WINDOW_SIZE;
+	const char *output = NULL;
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "--headless" ) == 0 )
+			Headless = 1;
+		else if( strcmp( argv[i], "--bench" ) == 0 )
+			Bench = 1;
+		else if( strcmp( argv[i], "--bench-output" ) == 0  &&  i+1 < argc )
+			BenchOutput = argv[++i];
+		else if( strcmp( argv[i], "--hud" ) == 0 )
+			HudOn = 1;
+		else if( strcmp( argv[i], "--capture" ) == 0  &&  i+1 < argc )
+		{
+			CaptureTarget = argv[++i];
+			if( CaptureFormat == CAPTURE_PIPE )
+				CaptureFormat = CAPTURE_PPM;
+		}
+		else if( strcmp( argv[i], "--capture-format" ) == 0  &&  i+1 < argc )
+		{
+			i++;
+			if( strcmp( argv[i], "png" ) == 0 )
+				CaptureFormat = CAPTURE_PNG;
+			else if( strcmp( argv[i], "ppm" ) == 0 )
+				CaptureFormat = CAPTURE_PPM;
+			else
+				CaptureFormat = -1;
+		}
+		else if( strcmp( argv[i], "--capture-pipe" ) == 0  &&  i+1 < argc )
+		{
+			CaptureTarget = argv[++i];
+			CaptureFormat = CAPTURE_PIPE;
+		}
+		else if( strcmp( argv[i], "--trace" ) == 0 )
+		{
+			TraceOutput = TRACE_OUTPUT;
+			if( i+1 < argc  &&  argv[i+1][0] != '-' )
+				TraceOutput = argv[++i];
+		}
+		else if( strcmp( argv[i], "--record" ) == 0  &&  i+1 < argc )
+			RecordOutput = argv[++i];
+		else if( strcmp( argv[i], "--record-frames" ) == 0  &&  i+1 < argc )
+			RecordFrames = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--metrics-csv" ) == 0  &&  i+1 < argc )
+			MetricsCsv = argv[++i];
+		else if( strcmp( argv[i], "--metrics-port" ) == 0  &&  i+1 < argc )
+		{
+			// anything that isn't all a number is as bad as a number out of range:
+			char *end;
+			long port = strtol( argv[++i], &end, 10 );
+			MetricsPort = end != argv[i]  &&  *end == '\0'  &&  port >= 0  &&  port <= 65535 ? (int)port : 65536;
+		}
+		else if( strcmp( argv[i], "--frames" ) == 0  &&  i+1 < argc )
+			frames = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--size" ) == 0  &&  i+1 < argc )
+		{
+			if( sscanf( argv[++i], "%dx%d", &width, &height ) != 2 )
+				width = height = 0;
+		}
+		else if( strcmp( argv[i], "--output" ) == 0  &&  i+1 < argc )
+			output = argv[++i];
+	}
+
+	// a benchmark or a capture plays one whole animation cycle unless told otherwise:
+
+	if( frames == -1 )
+		frames = Bench != 0 || CaptureTarget != NULL ? (int)( CYCLE_SECONDS / FRAMECLOCK_STEP + 0.5 ) : HEADLESS_FRAMES;
+
+#ifndef TRACE
+	if( TraceOutput != NULL )
+	{
+		fprintf( stderr, "This build has no tracing -- build it with -DTRACE (make forest_trace)\n" );
+		TraceOutput = NULL;
+	}
+#endif
+
+	if( CaptureFormat < 0 )
+	{
+		fprintf( stderr, "The capture format can be ppm or png\n" );
+		return HEADLESS_BAD_ARGUMENTS;
+	}
+
+	if( MetricsPort > 65535 )
+	{
+		fprintf( stderr, "The metrics port can be 0 to 65535 (0 = any free port)\n" );
+		return HEADLESS_BAD_ARGUMENTS;
+	}
+
+	if( Headless != 0 )
+	{
+		if( frames <= 0  ||  width <= 0  ||  height <= 0  ||  RecordFrames < 0 )
+		{
+			fprintf( stderr, "Usage: %s --headless [--bench] [--bench-output prefix] [--hud] [--capture prefix] [--capture-format ppm|png] [--capture-pipe command] [--trace [file.json]] [--record file.glrec] [--record-frames n] [--metrics-csv file.csv] [--metrics-port n] [--frames n] [--size WIDTHxHEIGHT] [--output file.ppm]\n", argv[0] );
+			return HEADLESS_BAD_ARGUMENTS;
+		}
+		return RunHeadless( frames, width, height, output );
+	}
+
 	glutInit( &argc, argv );
 
 	// setup all the graphics stuff:
@@ -439,6 +789,16 @@ main( int argc, char *argv[ ] )
 	// this will also post a redisplay
 
 	Reset( );
+	if( Bench != 0 )
+		StartBench( frames > 0 ? frames : 1 );
+	SetHud( HudOn );
+	if( MetricsPort >= 0 )
+		Metrics.StartServer( MetricsPort );
+	if( CaptureTarget != NULL )
+	{
+		CaptureFrames = frames > 0 ? frames : 0;
+		CaptureWanted = 1;
+	}
 
 	// setup all the user interface stuff:
 
@@ -457,6 +817,81 @@ main( int argc, char *argv[ ] )
 }
 
 
+// Sample the keytimes at simulation time t (in seconds, any number of cycles in)
+SceneState SampleScene(double t) {
+	SceneState s;
+	s.time = (float)fmod(t, (double)CYCLE_SECONDS);
+	s.cameraX = CameraX.GetValue(s.time);
+	s.cameraZ = CameraZ.GetValue(s.time);
+	s.orangeCatX = OrangeCatX.GetValue(s.time);
+	s.blackCat1X = BlackCat1X.GetValue(s.time);
+	s.blackCat1Z = BlackCat1Z.GetValue(s.time);
+	s.blackCat2X = BlackCat2X.GetValue(s.time);
+	s.blackCat2Z = BlackCat2Z.GetValue(s.time);
+	s.bearScale = BearScale.GetValue(s.time);
+	s.deerScale = DeerScale.GetValue(s.time);
+	s.catScale = CatScale.GetValue(s.time);
+	return s;
+}
+
+// One fixed simulation step
+void UpdateSimulation() {
+	PrevScene = NextScene;
+	NextScene = SampleScene(Clock.GetTime());
+}
+
+// Start the simulation over at time t, with nothing to blend from
+void RestartSimulation(double t) {
+	Clock.Seek(t);
+	NextScene = SampleScene(t);
+	PrevScene = NextScene;
+	Scene = NextScene;
+	Time = Scene.time / CYCLE_SECONDS;
+}
+
+// Animate continuously only while the animation is running and the window can be seen --
+// when frozen, draw only when an event asks for it, and when hidden, don't draw at all
+// (the clock is paused in both, so the animation picks up where it left off)
+void UpdateFramePacing() {
+	int mode = FRAMEPACE_CONTINUOUS;
+	if (WindowVisible == 0)
+		mode = FRAMEPACE_HIDDEN;
+	else if (Frozen)
+		mode = FRAMEPACE_ON_DEMAND;
+
+	Pacer.SetMode(mode);
+	Clock.Pause(mode != FRAMEPACE_CONTINUOUS);
+	if (Headless == 0)
+		glutIdleFunc(mode == FRAMEPACE_CONTINUOUS ? Animate : NULL);
+}
+
+static float Lerp(float a, float b, float alpha) {
+	return a + alpha * (b - a);
+}
+
+// Blend the last two simulation steps for drawing
+// (time is blended the short way around the end of the cycle)
+void InterpolateScene(float alpha) {
+	float nextTime = NextScene.time;
+	if (nextTime < PrevScene.time)
+		nextTime += CYCLE_SECONDS;
+	Scene.time = Lerp(PrevScene.time, nextTime, alpha);
+	if (Scene.time >= CYCLE_SECONDS)
+		Scene.time -= CYCLE_SECONDS;
+
+	Scene.cameraX = Lerp(PrevScene.cameraX, NextScene.cameraX, alpha);
+	Scene.cameraZ = Lerp(PrevScene.cameraZ, NextScene.cameraZ, alpha);
+	Scene.orangeCatX = Lerp(PrevScene.orangeCatX, NextScene.orangeCatX, alpha);
+	Scene.blackCat1X = Lerp(PrevScene.blackCat1X, NextScene.blackCat1X, alpha);
+	Scene.blackCat1Z = Lerp(PrevScene.blackCat1Z, NextScene.blackCat1Z, alpha);
+	Scene.blackCat2X = Lerp(PrevScene.blackCat2X, NextScene.blackCat2X, alpha);
+	Scene.blackCat2Z = Lerp(PrevScene.blackCat2Z, NextScene.blackCat2Z, alpha);
+	Scene.bearScale = Lerp(PrevScene.bearScale, NextScene.bearScale, alpha);
+	Scene.deerScale = Lerp(PrevScene.deerScale, NextScene.deerScale, alpha);
+	Scene.catScale = Lerp(PrevScene.catScale, NextScene.catScale, alpha);
+}
+
+
 // this is where one would put code that is to be called
 // everytime the glut main loop has nothing to do
 //
@@ -466,16 +901,26 @@ main( int argc, char *argv[ ] )
 void
 Animate( )
 {
+	TRACE_FUNCTION( );
 	// put animation stuff in here -- change some global variables for Display( ) to find:
 
-	int ms = glutGet(GLUT_ELAPSED_TIME);
-	ms %= MS_PER_CYCLE;							// makes the value of ms between 0 and MS_PER_CYCLE-1
-	Time = (float)ms / (float)MS_PER_CYCLE;		// makes the value of Time between 0. and slightly less than 1.
+	// wait until the next frame is due,
+	// run the simulation in fixed steps up to now, then blend the last two steps for Display( ) to draw:
+
+	TRACED( "WaitForFrame", Pacer.WaitForFrame( ) );
+	Clock.Tick( );
+	while( Clock.Step( ) )
+		UpdateSimulation( );
+	InterpolateScene( (float)Clock.GetAlpha( ) );
+	Time = Scene.time / CYCLE_SECONDS;			// makes the value of Time between 0. and slightly less than 1.
 
 	// for example, if you wanted to spin an object in Display( ), you might call: glRotatef( 360.f*Time,   0., 1., 0. );
 
-	// force a call to Display( ) next time it is convenient:
+	// force a call to Display( ) next time it is convenient
+	// (a headless run calls it itself):
 
+	if( Headless != 0 )
+		return;
 	glutSetWindow( MainWindow );
 	glutPostRedisplay( );
 }
@@ -534,7 +979,11 @@ void InitializeTreePositions() {
 
 // Create hard coded and random bush positions 
 void InitializeBushPositions() {
-    srand(static_cast<unsigned int>(time(0)));
+    // (a benchmark or headless run always places them the same way)
+    if (Bench != 0 || Headless != 0)
+        srand(BUSH_SEED);
+    else
+        srand(static_cast<unsigned int>(time(0)));
 
     // Number of bushes to generate
     int numBushes = 130;
@@ -645,8 +1094,83 @@ void InitializePanelPositions() {
 	panelPositions.push_back(PanelPosition(-XSIDE / 2, 0.0f, -ZSIDE / 2, XSIDE, 0.1f, ZSIDE));  // Top panel
 }
 
+// Draw every tree from the vertex arrays that are already set up
+void DrawTreeInstances() {
+	TRACE_FUNCTION();
+	for (int i = 0; i < treePositions.size(); i++) {
+		const TreePosition& pos = treePositions[i];
+		glPushMatrix();
+			glTranslatef(pos.x, 0.18f, pos.z);
+			glScalef(1.5f, 1.6f, 1.5f);
+			glDrawElements(GL_TRIANGLES, treeIndices.size(), GL_UNSIGNED_INT, 0); // Indexed drawing
+		glPopMatrix();
+	}
+}
+
+// Draw every bush from the vertex arrays that are already set up
+void DrawBushInstances() {
+	TRACE_FUNCTION();
+	for (int i = 0; i < bushPositions.size(); i++) {
+		const BushPosition &pos = bushPositions[i];
+
+		// Choose scale from scale factors array
+		float scaleFactor = bushScaleFactors[i % 5];
+
+		glPushMatrix();
+			glScalef(scaleFactor, scaleFactor, scaleFactor); // Apply scale factor
+			glTranslatef(pos.x, 0.0f, pos.z);
+			glDrawElements(GL_TRIANGLES, bushIndices.size(), GL_UNSIGNED_INT, 0); // Indexed drawing
+		glPopMatrix();
+	}
+}
+
+// Draw every rock from the vertex arrays that are already set up
+void DrawRockInstances() {
+	TRACE_FUNCTION();
+	for (int i = 0; i < rockPositions.size(); i++) {
+		const RockPosition& pos = rockPositions[i];
+		// Choose scale from scale factors array
+		float scaleFactor = rockScaleFactors[i % 5];
+
+		glPushMatrix();
+			glTranslatef(pos.x, 0.4f, pos.z);
+			glScalef(scaleFactor, scaleFactor, scaleFactor); // Apply scale factor
+			glDrawElements(GL_TRIANGLES, rockIndices.size(), GL_UNSIGNED_INT, 0); // Indexed drawing
+		glPopMatrix();
+	}
+}
+
+// Draw the trees, bushes, and rocks from their position-only streams
+// (12 bytes per vertex instead of 32 -- for the depth pre-pass and the shadow maps)
+void DrawStaticDepth() {
+	TRACE_FUNCTION();
+	glEnableClientState(GL_VERTEX_ARRAY);
+
+	glBindBuffer(GL_ARRAY_BUFFER, treeDepthVBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, treeEBO);
+	glVertexPointer(3, GL_FLOAT, 0, (void*)0);
+	DrawTreeInstances();
+
+	glBindBuffer(GL_ARRAY_BUFFER, bushDepthVBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bushEBO);
+	glVertexPointer(3, GL_FLOAT, 0, (void*)0);
+	DrawBushInstances();
+
+	glBindBuffer(GL_ARRAY_BUFFER, rockDepthVBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rockEBO);
+	glVertexPointer(3, GL_FLOAT, 0, (void*)0);
+	DrawRockInstances();
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+    // Unbind buffers
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
 // Draw the trees using vertex buffer
 void DrawTrees() {
+	TRACE_FUNCTION();
     // Apply material properties
 	SetMaterial(0.5f, 0.45f, 0.4f, 30.0f);
 
@@ -675,14 +1199,7 @@ void DrawTrees() {
     glTexCoordPointer(2, GL_FLOAT, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 
     // Draw trees
-	for (int i = 0; i < treePositions.size(); i++) {
-		const TreePosition& pos = treePositions[i];
-		glPushMatrix();
-			glTranslatef(pos.x, 0.18f, pos.z);
-			glScalef(1.5f, 1.6f, 1.5f);
-			glDrawElements(GL_TRIANGLES, treeIndices.size(), GL_UNSIGNED_INT, 0); // Indexed drawing
-		glPopMatrix();
-	}
+	DrawTreeInstances();
 
     // Disable client state
     glDisableClientState(GL_VERTEX_ARRAY);
@@ -701,6 +1218,7 @@ void DrawTrees() {
 
 // Draw bushes using vertex buffer
 void DrawBushes() {
+	TRACE_FUNCTION();
     // Apply material properties
 	SetMaterial(0.85f, 0.8f, 0.55f, 50.0f);
 
@@ -733,18 +1251,7 @@ void DrawBushes() {
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
     glTexCoordPointer(2, GL_FLOAT, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 
-	for (int i = 0; i < bushPositions.size(); i++) {
-		const BushPosition &pos = bushPositions[i];
-
-		// Choose scale from scale factors array
-		float scaleFactor = bushScaleFactors[i % 5];
-
-		glPushMatrix();
-			glScalef(scaleFactor, scaleFactor, scaleFactor); // Apply scale factor
-			glTranslatef(pos.x, 0.0f, pos.z);
-			glDrawElements(GL_TRIANGLES, bushIndices.size(), GL_UNSIGNED_INT, 0); // Indexed drawing
-		glPopMatrix();
-	}
+	DrawBushInstances();
 
 	// Reset active texture to default
 	glActiveTexture(GL_TEXTURE0);
@@ -766,6 +1273,7 @@ void DrawBushes() {
 
 // Draw rocks using vertex buffer
 void DrawRocks() {
+	TRACE_FUNCTION();
     // Apply material properties
 	SetMaterial(0.4f, 0.35f, 0.3f, 10.0f);
 
@@ -793,17 +1301,7 @@ void DrawRocks() {
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
     glTexCoordPointer(2, GL_FLOAT, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 
-	for (int i = 0; i < rockPositions.size(); i++) {
-		const RockPosition& pos = rockPositions[i];
-		// Choose scale from scale factors array
-		float scaleFactor = rockScaleFactors[i % 5];
-
-		glPushMatrix();
-			glTranslatef(pos.x, 0.4f, pos.z);
-			glScalef(scaleFactor, scaleFactor, scaleFactor); // Apply scale factor
-			glDrawElements(GL_TRIANGLES, rockIndices.size(), GL_UNSIGNED_INT, 0); // Indexed drawing
-		glPopMatrix();
-	}
+	DrawRockInstances();
 
     // Disable client state
     glDisableClientState(GL_VERTEX_ARRAY);
@@ -820,216 +1318,478 @@ void DrawRocks() {
     }
 }
 
-// draw the complete scene:
-void
-Display( )
-{
-	if (DebugOn != 0)
-		fprintf(stderr, "Starting Display.\n");
+// Where firefly i is at nowTime:
+// they are spread over the grid in a golden-angle spiral and drift around it
+void GetFireflyPosition(int i, float nowTime, float pos[3]) {
+	float angle = (float)i * 2.39996f + 0.05f * nowTime;
+	float radius = 3.f + 19.f * sqrtf(((float)i + 0.5f) / (float)NUM_FIREFLIES);
+	pos[0] = radius * cosf(angle) + 0.5f * sinf(1.3f * nowTime + (float)i);
+	pos[1] = 1.5f + sinf(0.7f * nowTime + 2.f * (float)i);
+	pos[2] = radius * sinf(angle) + 0.5f * cosf(1.1f * nowTime + (float)i);
+}
 
-	// set which window we want to do the graphics into:
-	glutSetWindow( MainWindow );
+// Fill the light clusters with the fireflies and lanterns
+void SetClusteredLights(float nowTime) {
+	Lights.Clear();
 
-	// erase the background:
-	glDrawBuffer( GL_BACK );
-	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	// Fireflies, colored from the light color table
+	for (int i = 0; i < NUM_FIREFLIES; i++) {
+		float pos[3];
+		GetFireflyPosition(i, nowTime, pos);
+		float *color = lightColors[i % 6];
+		Lights.AddPointLight(pos[0], pos[1], pos[2], FIREFLY_RADIUS, 0.6f * color[0], 0.6f * color[1], 0.6f * color[2]);
+	}
 
-	glEnable( GL_DEPTH_TEST );
-#ifdef DEMO_DEPTH_BUFFER
-	if( DepthBufferOn == 0 )
-		glDisable( GL_DEPTH_TEST );
+	// Lanterns in the corners, shining in toward the middle (same cone as SetSpotLight)
+	for (int i = 0; i < NUM_LANTERNS; i++) {
+		float angle = (float)i * 2.f * (float)M_PI / (float)NUM_LANTERNS + (float)M_PI / 4.f;
+		float x = 18.f * cosf(angle);
+		float z = 18.f * sinf(angle);
+		Lights.AddSpotLight(x, 6.f, z, -x, -6.f, -z, 30.f, LANTERN_RADIUS, 1.f, 0.8f, 0.5f);
+	}
+}
+
+// Draw the fireflies themselves as points
+void DrawFireflies(float nowTime) {
+	TRACE_FUNCTION();
+	glPointSize(3.f);
+	glBegin(GL_POINTS);
+		for (int i = 0; i < NUM_FIREFLIES; i++) {
+			float pos[3];
+			GetFireflyPosition(i, nowTime, pos);
+			glColor3fv(lightColors[i % 6]);
+			glVertex3fv(pos);
+		}
+	glEnd();
+	glPointSize(1.f);
+}
+
+// Hand the clustered lights to an animal shader
+void SetClusterUniforms(GLSLProgram &program) {
+	if (LightsOn != 0 && Lights.IsValid()) {
+		program.SetUniformVariable("uClusteredLights", 1.f);
+		Lights.SetUniforms(program);
+	} else {
+		program.SetUniformVariable("uClusteredLights", 0.f);
+	}
+}
+
+// Load the diffuse textures of all of the animals -- into the layers of one texture array
+// when GL_EXT_texture_array is there (so one bound texture covers every species),
+// otherwise into one 2D texture each
+bool LoadAnimalTextures() {
+	TRACE_FUNCTION();
+	const char *files[NUM_SPECIES] = {
+		"./obj/White-TailedDeer_V1_L2.123c4f372813-f2b8-4711-8c23-8d6c4953de32/12961_White-TailedDeer_diffuse.bmp",
+		"./obj/Tibetan_Blue_Bear_v1_L3.123c942e6fa9-d7c1-4f52-ac2a-5aa1f6bc9dce/Tibetan_bear_diffuse.bmp",
+		"./obj/Cat_v1_L3.123cb1b1943a-2f48-4e44-8f71-6bbe19a3ab64/Cat_diffuse_orange.bmp",
+		"./obj/Cat_v1_L3.123cc81ac858-7d2c-4c7e-bf80-81982996d26d/Cat_diffuse.bmp"
+	};
+	const char *names[NUM_SPECIES] = { "deer", "bear", "orange cat", "black cat" };
+
+	unsigned char *texels[NUM_SPECIES];
+	int widths[NUM_SPECIES], heights[NUM_SPECIES];
+	for (int s = 0; s < NUM_SPECIES; s++) {
+		texels[s] = TRACED("BmpToTexture animal", BmpToTexture((char *)files[s], &widths[s], &heights[s]));
+		if (texels[s] == NULL) {
+			fprintf(stderr, "Cannot open texture for %s\n", names[s]);
+			for (int t = 0; t < s; t++)
+				free(texels[t]);
+			return false;
+		}
+	}
+
+	AnimalTextureArray = 0;
+#ifdef GL_TEXTURE_2D_ARRAY_EXT
+	if (Animal.IsExtensionSupported("GL_EXT_texture_array")) {
+		// Every layer has to be the same size -- use the deer's, and rescale any that differ
+		int width = widths[0];
+		int height = heights[0];
+
+		glGenTextures(1, &AnimalTextureArray);
+		glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, AnimalTextureArray);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY_EXT, 0, GL_RGB, width, height, NUM_SPECIES, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+		for (int s = 0; s < NUM_SPECIES; s++) {
+			unsigned char *layer = texels[s];
+			if (widths[s] != width || heights[s] != height) {
+				layer = (unsigned char *)malloc(3 * width * height);
+				gluScaleImage(GL_RGB, widths[s], heights[s], GL_UNSIGNED_BYTE, texels[s], width, height, GL_UNSIGNED_BYTE, layer);
+			}
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY_EXT, 0, 0, 0, s, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, layer);
+			if (layer != texels[s])
+				free(layer);
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+	}
 #endif
 
-	// Set the total cycle time to 40 seconds (40,000 milliseconds)
-	int cycleTime = 40000;
+	if (AnimalTextureArray == 0) {
+		glGenTextures(NUM_SPECIES, AnimalTextures);
+		for (int s = 0; s < NUM_SPECIES; s++) {
+			glBindTexture(GL_TEXTURE_2D, AnimalTextures[s]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-	// Get the elapsed time in milliseconds and wrap it within the cycle time
-	int msec = glutGet(GLUT_ELAPSED_TIME) % cycleTime;
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, widths[s], heights[s], 0, GL_RGB, GL_UNSIGNED_BYTE, texels[s]);
+		}
+	}
 
-	// Convert the time into a value between 0 and 40 seconds
-	float nowTime = (float)msec / 1000.0f;
+	for (int s = 0; s < NUM_SPECIES; s++)
+		free(texels[s]);
+	return true;
+}
 
-	// specify shading to be flat:
+// Hand the species table to the animal shader
+void SetAnimalSpecies(GLSLProgram &program) {
+	float turnAlong[NUM_SPECIES][3], turnPush[NUM_SPECIES][3], turnCycle[NUM_SPECIES][4], turnRegion[NUM_SPECIES][2];
+	float bendAlong[NUM_SPECIES][3], bendPush[NUM_SPECIES][3], bendCycle[NUM_SPECIES][4], bendRegion[NUM_SPECIES][3];
+	for (int s = 0; s < NUM_SPECIES; s++) {
+		const AnimalSpecies &sp = Species[s];
+		for (int i = 0; i < 3; i++) {
+			turnAlong[s][i] = sp.turnAlong[i];
+			turnPush[s][i] = sp.turnPush[i];
+			bendAlong[s][i] = sp.bendAlong[i];
+			bendPush[s][i] = sp.bendPush[i];
+		}
+		turnCycle[s][0] = sp.turnIntensity;
+		turnCycle[s][1] = sp.turnDuration;
+		turnCycle[s][2] = sp.pauseDuration;
+		turnCycle[s][3] = sp.turnSymmetric;
+		turnRegion[s][0] = sp.turnThreshold;
+		turnRegion[s][1] = sp.turnSide;
+		bendCycle[s][0] = sp.bendIntensity;
+		bendCycle[s][1] = sp.bendCycleTime;
+		bendCycle[s][2] = sp.bendWaves;
+		bendCycle[s][3] = sp.bendStretch;
+		bendRegion[s][0] = sp.bendThreshold;
+		bendRegion[s][1] = sp.bendSide;
+		bendRegion[s][2] = sp.bendFalloff;
+	}
 
-	glShadeModel( GL_FLAT );
+	program.SetUniformArray("uTurnAlong", NUM_SPECIES, &turnAlong[0][0]);
+	program.SetUniformArray("uTurnPush", NUM_SPECIES, &turnPush[0][0]);
+	program.SetUniformArray("uTurnCycle", NUM_SPECIES, &turnCycle[0][0]);
+	program.SetUniformArray("uTurnRegion", NUM_SPECIES, &turnRegion[0][0]);
+	program.SetUniformArray("uBendAlong", NUM_SPECIES, &bendAlong[0][0]);
+	program.SetUniformArray("uBendPush", NUM_SPECIES, &bendPush[0][0]);
+	program.SetUniformArray("uBendCycle", NUM_SPECIES, &bendCycle[0][0]);
+	program.SetUniformArray("uBendRegion", NUM_SPECIES, &bendRegion[0][0]);
+}
 
-	// set the viewport to be a square centered in the window:
+// What a species' turning and/or bending does to one vertex, for baking
+struct AnimalMotion {
+	const AnimalSpecies *species;
+	unsigned int features;			// ANIMAL_TURN and/or ANIMAL_BEND
+};
 
-	GLsizei vx = glutGet( GLUT_WINDOW_WIDTH );
-	GLsizei vy = glutGet( GLUT_WINDOW_HEIGHT );
-	GLsizei v = vx < vy ? vx : vy;			// minimum dimension
-	GLint xl = ( vx - v ) / 2;
-	GLint yb = ( vy - v ) / 2;
-	glViewport( xl, yb,  v, v );
+// The CPU copy of animal.vert's TURN and BEND: where one rest-pose vertex is at time t
+// (keep this in step with the shader, or the baked clips will not match it)
+void DeformAnimal(float t, const float in[3], float out[3], const void *data) {
+	const AnimalMotion *motion = (const AnimalMotion *)data;
+	const AnimalSpecies &sp = *motion->species;
+	float vert[3] = { in[0], in[1], in[2] };
+
+	if (motion->features & ANIMAL_TURN) {
+		float phaseTime = fmodf(t, sp.turnDuration + sp.pauseDuration);
+		if (phaseTime < sp.turnDuration) {
+			float turnFactor = sinf(phaseTime / sp.turnDuration * 3.14159f * 2.f);
+			if (sp.turnSymmetric > 0.f)
+				turnFactor = fabsf(turnFactor) * 2.f - 1.f;
+
+			float along = vert[0] * sp.turnAlong[0] + vert[1] * sp.turnAlong[1] + vert[2] * sp.turnAlong[2];
+			if ((along - sp.turnThreshold) * sp.turnSide > 0.f) {
+				float amount = turnFactor * sp.turnIntensity * along * along;
+				for (int i = 0; i < 3; i++)
+					vert[i] += sp.turnPush[i] * amount;
+			}
+		}
+	}
 
-	// set the viewing volume:
-	// remember that the Z clipping  values are given as DISTANCES IN FRONT OF THE EYE
-	// USE gluOrtho2D( ) IF YOU ARE DOING 2D !
+	if (motion->features & ANIMAL_BEND) {
+		float cyclePhase = fmodf(t, sp.bendCycleTime) / sp.bendCycleTime;
+		float bendFactor = sinf(cyclePhase * 3.14159f * 2.f * sp.bendWaves) * sp.bendIntensity;
 
-	glMatrixMode( GL_PROJECTION );
-	glLoadIdentity( );
-	if( NowProjection == ORTHO )
-		glOrtho( -2.f, 2.f,     -2.f, 2.f,     0.1f, 1000.f );
-	else
-		gluPerspective( 70.f, 1.f,	0.1f, 1000.f );
+		float along = vert[0] * sp.bendAlong[0] + vert[1] * sp.bendAlong[1] + vert[2] * sp.bendAlong[2];
+		if ((along - sp.bendThreshold) * sp.bendSide >= 0.f) {
+			if (sp.bendFalloff > 0.f)
+				bendFactor /= (along + sp.bendFalloff);
 
-	// place the objects into the scene:
+			float amount = bendFactor * (along * along);
+			if (bendFactor < 0.f)
+				amount *= -sp.bendStretch;
+			for (int i = 0; i < 3; i++)
+				vert[i] -= sp.bendPush[i] * amount;
+		}
+	}
 
-	glMatrixMode( GL_MODELVIEW );
-	glLoadIdentity( );
+	out[0] = vert[0];
+	out[1] = vert[1];
+	out[2] = vert[2];
+}
 
-	// Get eye positions
-	float eyePosX = CameraX.GetValue(nowTime);
-	float eyePosZ = CameraZ.GetValue(nowTime);
+// Bake a species' turning and bending over one cycle each into its vertex animation texture
+// (positions is the rest pose from LoadObjFile( ), in the order of the vertex indices it handed out)
+void BakeAnimal(int species, const std::vector<float> &positions) {
+	TRACE_FUNCTION();
+	VertexAnimation &bake = AnimalBakes[species];
+	const AnimalSpecies &sp = Species[species];
 
-    // Set the eye
-    gluLookAt(eyePosX, 5.0f, eyePosZ, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f); // Animated eye
-	//gluLookAt(24.0f, 5.0f, 0.0f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f); // Static eye
+	bake.Init();
+	AnimalClips[species][0] = AnimalClips[species][1] = -1;
+	if (!Animal.IsExtensionSupported("GL_ARB_texture_float"))
+		return;
 
-    // Rotate the scene:
-    glRotatef((GLfloat)Yrot, 0.f, 1.f, 0.f);
-    glRotatef((GLfloat)Xrot, 1.f, 0.f, 0.f);
-        
-    // Uniformly scale the scene:
-    if (Scale < MINSCALE)
-        Scale = MINSCALE;
-    glScalef((GLfloat)Scale, (GLfloat)Scale, (GLfloat)Scale);
-    
+	bake.SetPositions(positions);
+	AnimalMotion turn = { &sp, ANIMAL_TURN };
+	AnimalMotion bend = { &sp, ANIMAL_BEND };
+	if (sp.turnIntensity != 0.f)
+		AnimalClips[species][0] = bake.AddClip(sp.turnDuration + sp.pauseDuration, ANIMAL_BAKE_SAMPLES, DeformAnimal, &turn);
+	if (sp.bendIntensity != 0.f)
+		AnimalClips[species][1] = bake.AddClip(sp.bendCycleTime, ANIMAL_BAKE_SAMPLES, DeformAnimal, &bend);
 
-	// set the fog parameters:
+	if (bake.Create())
+		fprintf(stderr, "Baked %d animation clips of %d vertices for species %d\n", bake.GetNumClips(), bake.GetNumVertices(), species);
+}
 
-	if( DepthCueOn != 0 )
-	{
-		glFogi( GL_FOG_MODE, FOGMODE );
-		glFogfv( GL_FOG_COLOR, FOGCOLOR );
-		glFogf( GL_FOG_DENSITY, FOGDENSITY );
-		glFogf( GL_FOG_START, FOGSTART );
-		glFogf( GL_FOG_END, FOGEND );
-		glEnable( GL_FOG );
+// The baked clips are played when they are turned on and every species has them
+bool UseBakedAnimation() {
+	if (BakedAnimationOn == 0)
+		return false;
+	for (int s = 0; s < NUM_SPECIES; s++) {
+		if (!AnimalBakes[s].IsValid())
+			return false;
 	}
-	else
-	{
-		glDisable( GL_FOG );
+	return true;
+}
+
+// Bounding sphere radius of a model's rest pose (x, y, z per vertex) once it is scaled by scale
+float GetAnimalRadius(const std::vector<float> &positions, float scale) {
+	if (positions.size() < 3)
+		return 0.f;
+
+	float lo[3] = { positions[0], positions[1], positions[2] };
+	float hi[3] = { lo[0], lo[1], lo[2] };
+	for (size_t v = 3; v + 2 < positions.size(); v += 3) {
+		for (int i = 0; i < 3; i++) {
+			lo[i] = fminf(lo[i], positions[v + i]);
+			hi[i] = fmaxf(hi[i], positions[v + i]);
+		}
 	}
+	float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+	return 0.5f * scale * sqrtf(dx * dx + dy * dy + dz * dz);
+}
 
-	// possibly draw the axes:
+// Where (x, 0, z) ends up after glRotatef(degrees, 0., 1., 0.)
+void RotateY(float degrees, float x, float z, float *rx, float *rz) {
+	float a = degrees * (float)M_PI / 180.f;
+	*rx = cosf(a) * x + sinf(a) * z;
+	*rz = -sinf(a) * x + cosf(a) * z;
+}
 
-	if( AxesOn != 0 )
-	{
-		glColor3fv( &Colors[NowColor][0] );
-		glCallList( AxesList );
+// The LOD of one animal of a species standing at (x, 0, z), from its projected height
+// (mv and proj are the view's matrices, pixelsPerUnit how many pixels one unit is at w = 1)
+int GetAnimalTier(int species, float x, float z, const float mv[16], const float proj[16], float pixelsPerUnit) {
+	float ex = mv[0] * x + mv[8] * z + mv[12];
+	float ey = mv[1] * x + mv[9] * z + mv[13];
+	float ez = mv[2] * x + mv[10] * z + mv[14];
+	float w = proj[3] * ex + proj[7] * ey + proj[11] * ez + proj[15];
+	if (w <= 0.f)
+		return ANIMAL_LOD_STATIC;		// behind the eye
+
+	float scale = sqrtf(mv[0] * mv[0] + mv[1] * mv[1] + mv[2] * mv[2]);
+	float pixels = 2.f * AnimalRadius[species] * scale * pixelsPerUnit / w;
+
+	const AnimalLOD &lod = SpeciesLOD[species];
+	if (pixels >= lod.fullPixels)
+		return ANIMAL_LOD_FULL;
+	if (pixels >= lod.staticPixels)
+		return ANIMAL_LOD_REDUCED;
+	return ANIMAL_LOD_STATIC;
+}
+
+// Put every animal in an LOD for this frame's view, and count how many are in each.
+// Call this once the view is set up: the depth pre-pass and color pass use these tiers,
+// and so does the next frame's shadow pass, which comes before its view is.
+void UpdateAnimalLOD() {
+	float mv[16], proj[16];
+	GLint viewport[4];
+	glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+	glGetFloatv(GL_PROJECTION_MATRIX, proj);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float pixelsPerUnit = proj[5] * (float)viewport[3] / 2.f;
+
+	float x, z;
+
+	// Deer, then the bear, then the static cats followed by the running ones
+	int numDeer = (int)deerPositions.size();
+	AnimalTiers[SPECIES_DEER].resize(numDeer);
+	for (int i = 0; i < numDeer; i++) {
+		RotateY(deerPositions[i].rotationY, deerPositions[i].x, deerPositions[i].z, &x, &z);
+		AnimalTiers[SPECIES_DEER][i] = GetAnimalTier(SPECIES_DEER, x, z, mv, proj, pixelsPerUnit);
 	}
 
-	// since we are using glScalef( ), be sure the normals get unitized:
+	AnimalTiers[SPECIES_BEAR].resize(1);
+	AnimalTiers[SPECIES_BEAR][0] = GetAnimalTier(SPECIES_BEAR, 1.f, -5.f, mv, proj, pixelsPerUnit);
 
-	glEnable( GL_NORMALIZE );
+	int numOrange = (int)orangeCats.size();
+	AnimalTiers[SPECIES_ORANGE_CAT].resize(numOrange + 1);
+	for (int i = 0; i < numOrange; i++) {
+		RotateY(orangeCats[i].rotationY, orangeCats[i].x, orangeCats[i].z, &x, &z);
+		AnimalTiers[SPECIES_ORANGE_CAT][i] = GetAnimalTier(SPECIES_ORANGE_CAT, x, z, mv, proj, pixelsPerUnit);
+	}
+	AnimalTiers[SPECIES_ORANGE_CAT][numOrange] = GetAnimalTier(SPECIES_ORANGE_CAT, Scene.orangeCatX, 0.f, mv, proj, pixelsPerUnit);
 
-	SetPointLight(GL_LIGHT0, 20.0f, 60.0f, 25.0f, 0.6f, 0.5f, 0.2f);  // A warm golden light
+	int numBlack = (int)blackCats.size();
+	AnimalTiers[SPECIES_BLACK_CAT].resize(numBlack + 2);
+	for (int i = 0; i < numBlack; i++) {
+		RotateY(blackCats[i].rotationY, blackCats[i].x, blackCats[i].z, &x, &z);
+		AnimalTiers[SPECIES_BLACK_CAT][i] = GetAnimalTier(SPECIES_BLACK_CAT, x, z, mv, proj, pixelsPerUnit);
+	}
+	AnimalTiers[SPECIES_BLACK_CAT][numBlack + 0] = GetAnimalTier(SPECIES_BLACK_CAT, Scene.blackCat1X, Scene.blackCat1Z, mv, proj, pixelsPerUnit);
+	AnimalTiers[SPECIES_BLACK_CAT][numBlack + 1] = GetAnimalTier(SPECIES_BLACK_CAT, Scene.blackCat2X, Scene.blackCat2Z, mv, proj, pixelsPerUnit);
+
+	for (int t = 0; t < NUM_ANIMAL_LODS; t++)
+		AnimalTierCounts[t] = 0;
+	for (int s = 0; s < NUM_SPECIES; s++) {
+		int n = (int)AnimalTiers[s].size();
+		for (int i = 0; i < n; i++)
+			AnimalTierCounts[AnimalTiers[s][i]]++;
+	}
+}
 
-	// Enable textures and lighting
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-    glEnable(GL_TEXTURE_2D);
+// The animation time a species is drawn at in an LOD:
+// the reduced LOD holds each pose for 1/reducedHz seconds
+float GetAnimalTime(int species, int tier) {
+	if (tier != ANIMAL_LOD_REDUCED)
+		return Time;
 
-	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	float steps = SpeciesLOD[species].reducedHz * (float)MS_PER_CYCLE / 1000.f;	// per cycle of Time
+	return floorf(Time * steps) / steps;
+}
 
-	// Draw the grid
-	SetMaterial(0.2f, 0.2f, 0.2f, 5.0f);
-	glBindTexture(GL_TEXTURE_2D, FloorTexture); 
-	glCallList(GridDL);
-	
-	// Draw the trees
-	DrawTrees();
+// Whether a pass draws animal i of a species, which turns or bends (motion):
+// the static pass draws every static animal, the others their own motion in their own LOD
+bool PassDrawsAnimal(const AnimalPass &pass, int species, int i, unsigned int motion) {
+	int n = (int)AnimalTiers[species].size();
+	int tier = i < n ? AnimalTiers[species][i] : ANIMAL_LOD_FULL;
+	if (tier != pass.tier)
+		return false;
+	return pass.motion == 0 || pass.motion == motion;
+}
 
-	// Draw the bushes
-	DrawBushes();
+// Check on the animal shader program while it is still compiling:
+// once the driver is done, finish it off and set its shader uniform variables
+bool AnimalShaderReady() {
+	if (Animal.IsPending()) {
+		if (!Animal.IsReady())
+			return false;
 
-	// Draw the rocks
-	DrawRocks();
+		if (!Animal.Finish()) {
+			fprintf(stderr, "Yuch! The Animal shader did not compile.\n");
+		} else {
+			fprintf(stderr, "Woo-Hoo! The Animal shader compiled.\n");
+
+			// Set the shader uniform variables
+			Animal.SetUniformVariable("uKa", 0.5f);
+			Animal.SetUniformVariable("uKd", 0.4f);
+			Animal.SetUniformVariable("uKs", 0.1f);
+			Animal.SetUniformVariable("uShininess", 20.0f);
+			SetAnimalSpecies(Animal);
+
+			// List the shader's uniforms and attributes when debugging
+			if (DebugOn != 0)
+				Animal.PrintInterface(stderr);
+		}
+	}
+	return Animal.IsValid();
+}
+
+// Turn on the animal shader variant for one pass (the handles of the uniforms it sets
+// every frame are looked up the first time the variant is used).
+// With the baked clips, both passes share the one BAKED variant and only the clips differ.
+AnimalPass &UseAnimalVariant(int p, unsigned int variant) {
+	AnimalPass &pass = AnimalPasses[p];
+	pass.motion = variant;
+	if (variant != 0 && UseBakedAnimation())
+		variant = ANIMAL_BAKED;
+	if (AnimalTextureArray != 0)
+		variant |= ANIMAL_TEXTURE_ARRAY;
+
+	GLSLProgram *animal = Animal.Variant(variant);
+	if (pass.program != animal) {
+		pass.program = animal;
+		pass.time = animal->Uniform<float>("uTime");
+		pass.species = animal->Uniform<int>("uSpecies");
+
+		// Pass texture to shader (it is always on unit 0)
+		animal->Uniform<int>(AnimalTextureArray != 0 ? "uTextures" : "uTexture").Set(0);
+	}
+
+	animal->Use();
+	SetClusterUniforms(*animal);
 
-	// Turn on deer shader
-	Deer.Use();
-
-	// Pass uniform variables to control the animation
-	float deerEnableTurn;    					// Enable turning animation
-	float deerEnableGrazing;         			// Enable grazing animation
-	float deerTurnDuration = 0.15f;  		// Time spent turning
-	float deerPauseDuration = 0.05;			// Time for pause in turning
-	float deerTurnIntensity = 0.018f; 			// Degree of turning
-	float deerGrazingIntensity = 0.45f; 	// Intensity of turning (adjust for more/less turning)
-	float deerGrazingCycleTime = 0.2f;  	// Time for one complete grazing cycle
-
-	Deer.SetUniformVariable("uTime", Time);
-	Deer.SetUniformVariable("uTurnIntensity", deerTurnIntensity);
-	Deer.SetUniformVariable("uGrazingCycleTime", deerGrazingCycleTime);
-	Deer.SetUniformVariable("uGrazingIntensity", deerGrazingIntensity);
-	Deer.SetUniformVariable("uTurnDuration", deerTurnDuration);
-	Deer.SetUniformVariable("uPauseDuration", deerPauseDuration);
-
-	// Bind the deer texture
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, DeerTexture);
+#ifdef GL_TEXTURE_2D_ARRAY_EXT
+	if (AnimalTextureArray != 0)
+		glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, AnimalTextureArray);
+#endif
+	return pass;
+}
 
-	// Pass texture to shader
-	Deer.SetUniformVariable("uTexture", 0);
+// Pick the row of the species table (and, without a texture array, the texture) and the
+// animation time for the next draws, and send whatever uniforms have changed since the last species
+void SetSpecies(const AnimalPass &pass, int species) {
+	pass.species.Set(species);
+	pass.time.Set(GetAnimalTime(species, pass.tier));
+	if (pass.motion != 0 && UseBakedAnimation()) {
+		AnimalBakes[species].SetUniforms(*pass.program, AnimalClips[species][pass.motion == ANIMAL_TURN ? 0 : 1]);
+		AnimalBakes[species].Bind();
+	}
+	pass.program->Flush();
+	if (AnimalTextureArray == 0)
+		glBindTexture(GL_TEXTURE_2D, AnimalTextures[species]);
+}
 
-	// Loop through and draw each deer at its position
-    for (int i = 0; i < deerPositions.size(); i++) {
-        const DeerPosition& pos = deerPositions[i];
+// Draw the deer -- half of them turn and the other half graze
+void DrawDeer(const AnimalPass &pass) {
+	TRACE_FUNCTION();
+	SetSpecies(pass, SPECIES_DEER);
 
-		// Enable turning animation for half the deer
-		// and enable grazing animtion for other half
-		if (i % 2 == 0) {
-			deerEnableTurn = 1.0f;
-			deerEnableGrazing = 0.0f;
-		} else {
-			deerEnableTurn = 0.0f;
-			deerEnableGrazing = 1.0f;
-		}
+	// Apply keytimed scaling
+	float deerScale = Scene.deerScale;
 
-		// Pass enable animation variables to shader
-		Deer.SetUniformVariable("uEnableTurn", deerEnableTurn);
-		Deer.SetUniformVariable("uEnableGrazing", deerEnableGrazing);
+	// Loop through and draw each deer of this pass at its position
+	for (int i = 0; i < deerPositions.size(); i++) {
+		if (!PassDrawsAnimal(pass, SPECIES_DEER, i, (i % 2 == 0) ? ANIMAL_TURN : ANIMAL_BEND))
+			continue;
+		const DeerPosition& pos = deerPositions[i];
 
-        glPushMatrix();
+		glPushMatrix();
 			glRotatef(pos.rotationY, 0.0f, 1.0f, 0.0f);
 			glTranslatef(pos.x, 0.0f, pos.z);
 			glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
 			glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-
-			// Apply keytimed scaling
-			float deerScale = DeerScale.GetValue(nowTime);
 			glScalef(0.1f, 0.1f, deerScale);
 
 			glCallList(DeerDL);
-        glPopMatrix();
-    }
-
-	// Turn off deer shader
-	Deer.UnUse();
-
-	// Turn on bear shader
-	Bear.Use();
-
-	// Pass uniform variables to control the animation
-	float bearTurnIntensity = 0.007f; 	// Amount of turning
-	float bearEnableTurn = 1.0f;    	// Enable turning
-	float bearTurnDuration = 0.15f;		// Time spent turning
-	float bearPauseDuration = 0.005f;	// Time of pause in turning
-
-	Bear.SetUniformVariable("uTime", Time);
-	Bear.SetUniformVariable("uTurnIntensity", bearTurnIntensity);
-	Bear.SetUniformVariable("uEnableTurn", bearEnableTurn);
-	Bear.SetUniformVariable("uTurnDuration", bearTurnDuration);
-	Bear.SetUniformVariable("uPauseDuration", bearPauseDuration);
+		glPopMatrix();
+	}
+}
 
-	// Bind the bear texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, BearTexture);
+// Draw the bear (the bear is always turning)
+void DrawBear(const AnimalPass &pass) {
+	TRACE_FUNCTION();
+	if (!PassDrawsAnimal(pass, SPECIES_BEAR, 0, ANIMAL_TURN))
+		return;
+	SetSpecies(pass, SPECIES_BEAR);
 
-	// Pass texture to shader
-	Bear.SetUniformVariable("uTexture", 0);
-	
 	// Draw bear
 	glPushMatrix();
 		glTranslatef(1.0f, .0f, -5.0f); 
@@ -1037,49 +1797,45 @@ Display( )
 		glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
 
 		// Apply keytimed scaling
-		float bearScale = BearScale.GetValue(nowTime);  // Get the position based on the current time for X
+		float bearScale = Scene.bearScale;
 		glScalef(0.1f, 0.1f, bearScale);
 
 		glCallList(BearDL);            
 	glPopMatrix();
+}
 
-	// Turn off bear shader
-	Bear.UnUse();
+// Draw the static orange cats (turning) and the running orange cat
+void DrawOrangeCats(const AnimalPass &pass, float nowTime) {
+	TRACE_FUNCTION();
+	SetSpecies(pass, SPECIES_ORANGE_CAT);
 
-	// Turn on orange cat shader
-	OrangeCat.Use();
-	
-	// Pass uniform variables to control the animation
-	float orangeCatRunCycleTime = 0.05f;  	// Time for one complete cycle (narrow to wide to narrow)
-	float orangeCatMaxBend = 0.03f;  		// Maximum bend for running
-	float orangeCatTurnIntensity = 0.01f;	// Turning amount
-	float orangeCatEnableTurn = 0.0f;		// Enable turning
-	float orangeCatEnableRun = 1.0f;		// Enable running
-	float orangeCatTurnDuration = 0.4f;		// Time for turning
-	float orangeCatPauseDuration = 0.05f;	// Time for pause in turning
-
-	OrangeCat.SetUniformVariable("uTime", Time);
-	OrangeCat.SetUniformVariable("uRunCycleTime", orangeCatRunCycleTime);
-	OrangeCat.SetUniformVariable("uMaxBend", orangeCatMaxBend);
-	OrangeCat.SetUniformVariable("uTurnIntensity", orangeCatTurnIntensity);
-	OrangeCat.SetUniformVariable("uEnableTurn", orangeCatEnableTurn);
-	OrangeCat.SetUniformVariable("uEnableRun", orangeCatEnableRun);
-	OrangeCat.SetUniformVariable("uTurnDuration", orangeCatTurnDuration);
-	OrangeCat.SetUniformVariable("uPauseDuration", orangeCatPauseDuration);
-
-	// Bind the cat texture 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, OrangeCatTexture);
+	float catScale = Scene.catScale;
+
+	for (int i = 0; i < orangeCats.size(); i++) {
+		if (!PassDrawsAnimal(pass, SPECIES_ORANGE_CAT, i, ANIMAL_TURN))
+			continue;
+		const OrangeCatPos& cat = orangeCats[i];
+
+		glPushMatrix();
+			glRotatef(cat.rotationY, 0.0f, 1.0f, 0.0f);
+			glTranslatef(cat.x, 0.0f, cat.z);
+			glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
+
+			// Apply keytimed scaling
+			glScalef(0.1f, 0.1f, catScale);
 
-	// Pass texture to shader
-	OrangeCat.SetUniformVariable("uTexture", 0);
+			// Draw cat
+			glCallList(OrangeCatDL);
+		glPopMatrix();
+	}
 
-	float catScale = CatScale.GetValue(nowTime);
+	if (!PassDrawsAnimal(pass, SPECIES_ORANGE_CAT, orangeCats.size(), ANIMAL_BEND))
+		return;
 
 	// Orange cat running along x axis
 	glPushMatrix();
 		// Apply keytimed positioning
-		float orangeCatPosX = OrangeCatX.GetValue(nowTime);
+		float orangeCatPosX = Scene.orangeCatX;
 		glTranslatef(orangeCatPosX, 0.0f, 0.0f);
 
 		// Orientation animation
@@ -1103,65 +1859,18 @@ Display( )
 		// Draw cat
 		glCallList(OrangeCatDL);            
 	glPopMatrix();
+}
 
-	// Static orange cats
-	for (int i = 0; i < orangeCats.size(); i++) {
-		const OrangeCatPos& cat = orangeCats[i];
-
-		// Enable turning animation
-		orangeCatEnableTurn = 1.0f;
-		orangeCatEnableRun = 0.0f;
-
-		// Pass new enable animation variables to shader
-		OrangeCat.SetUniformVariable("uEnableTurn", orangeCatEnableTurn);
-		OrangeCat.SetUniformVariable("uEnableRun", orangeCatEnableRun);
-
-		glPushMatrix();
-			glRotatef(cat.rotationY, 0.0f, 1.0f, 0.0f);
-			glTranslatef(cat.x, 0.0f, cat.z);
-			glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-
-			// Apply keytimed scaling
-			glScalef(0.1f, 0.1f, catScale);
-
-			// Draw cat
-			glCallList(OrangeCatDL);
-		glPopMatrix();
-	}
-
-	// Turn off orange cat shader
-	OrangeCat.UnUse();
-
-	// Turn on black cat shader
-	BlackCat.Use();
-
-	// Pass uniform variables to control the animation
-	float blackCatRunCycleTime = 0.05f;  	// Time for one complete cycle (narrow to wide to narrow)
-	float blackCatMaxBend = 0.03f;  		// Maximum bend for running
-	float blackCatTurnIntensity = 0.01f;	// Turning amount
-	float blackCatEnableTurn = 1.0f;		// Enable turning
-	float blackCatEnableRun = 0.0f;			// Enable running
-	float blackCatTurnDuration = 0.5f;		// Time for turning
-	float blackCatPauseDuration = 0.07f;	// Time for pause in turning
-
-	BlackCat.SetUniformVariable("uTime", Time);
-	BlackCat.SetUniformVariable("uRunCycleTime", blackCatRunCycleTime);
-	BlackCat.SetUniformVariable("uMaxBend", blackCatMaxBend);
-	BlackCat.SetUniformVariable("uTurnIntensity", blackCatTurnIntensity);
-	BlackCat.SetUniformVariable("uEnableTurn", blackCatEnableTurn);
-	BlackCat.SetUniformVariable("uEnableRun", blackCatEnableRun);
-	BlackCat.SetUniformVariable("uTurnDuration", blackCatTurnDuration);
-	BlackCat.SetUniformVariable("uPauseDuration", blackCatPauseDuration);
+// Draw the static black cats (turning) and the running black cats
+void DrawBlackCats(const AnimalPass &pass, float nowTime) {
+	TRACE_FUNCTION();
+	SetSpecies(pass, SPECIES_BLACK_CAT);
 
-	// Bind the cat texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, BlackCatTexture);
+	float catScale = Scene.catScale;
 
-	// Pass texture to shader
-	BlackCat.SetUniformVariable("uTexture", 0);
-
-	// Static black cats
 	for (int i = 0; i < blackCats.size(); i++) {
+		if (!PassDrawsAnimal(pass, SPECIES_BLACK_CAT, i, ANIMAL_TURN))
+			continue;
 		const BlackCatPos& cat = blackCats[i];
 
 		glPushMatrix();
@@ -1177,14 +1886,6 @@ Display( )
 		glPopMatrix();
 	}
 
-	// Enable running animation
-	blackCatEnableTurn = 0.0f;
-	blackCatEnableRun = 1.0f;
-
-	// Pass new enable animation variables to shader
-	BlackCat.SetUniformVariable("uEnableRun", blackCatEnableRun);
-	BlackCat.SetUniformVariable("uEnableTurn", blackCatEnableTurn);
-
 	// Set time offset for first running black cat
 	timeOffset = 4.0f;
 
@@ -1194,34 +1895,39 @@ Display( )
 		blackCat1Time += 40.0f;
 	}
 
-	// Black cat running diagnoally (pos x pos z to neg x neg z)
-	glPushMatrix();
-		// Apply keytimed positioning
-		float blackCat1PosX = BlackCat1X.GetValue(nowTime);
-		float blackCat1PosZ = BlackCat1Z.GetValue(nowTime);
-		glTranslatef(blackCat1PosX, 0.0f, blackCat1PosZ);
+	if (PassDrawsAnimal(pass, SPECIES_BLACK_CAT, blackCats.size() + 0, ANIMAL_BEND)) {
+		// Black cat running diagnoally (pos x pos z to neg x neg z)
+		glPushMatrix();
+			// Apply keytimed positioning
+			float blackCat1PosX = Scene.blackCat1X;
+			float blackCat1PosZ = Scene.blackCat1Z;
+			glTranslatef(blackCat1PosX, 0.0f, blackCat1PosZ);
+
+			// Orientation animation
+			float blackCat1Rot;
+			if (blackCat1Time < 10.0) {
+				blackCat1Rot = -135.0;
+			} else if (blackCat1Time < 20.0) {
+				blackCat1Rot = 45.0;
+			} else if (blackCat1Time < 30.0) {
+				blackCat1Rot = -135.0;
+			} else if (blackCat1Time < 40.0) {
+				blackCat1Rot = 45.0;
+			}
+			glRotatef(blackCat1Rot, 0.0f, 1.0f, 0.0f);
 
-		// Orientation animation
-		float blackCat1Rot;
-		if (blackCat1Time < 10.0) {
-			blackCat1Rot = -135.0;
-		} else if (blackCat1Time < 20.0) {
-			blackCat1Rot = 45.0;
-		} else if (blackCat1Time < 30.0) {
-			blackCat1Rot = -135.0;
-		} else if (blackCat1Time < 40.0) {
-			blackCat1Rot = 45.0;
-		}
-		glRotatef(blackCat1Rot, 0.0f, 1.0f, 0.0f);
+			glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
 
-		glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
+			// Apply keytimed scaling
+			glScalef(catScale, catScale, catScale);
 
-		// Apply keytimed scaling
-		glScalef(catScale, catScale, catScale);
+			// Draw cat
+			glCallList(BlackCatDL);            
+		glPopMatrix();
+	}
 
-		// Draw cat
-		glCallList(BlackCatDL);            
-	glPopMatrix();
+	if (!PassDrawsAnimal(pass, SPECIES_BLACK_CAT, blackCats.size() + 1, ANIMAL_BEND))
+		return;
 
 	// Set time offset for second running black cat
 	timeOffset = 7.0f;
@@ -1235,8 +1941,8 @@ Display( )
 	// Black cat running diagnoally (neg x pos z to pos x neg z)
 	glPushMatrix();
 		// Apply keytimed positioning
-		float blackCat2PosX = BlackCat2X.GetValue(nowTime);
-		float blackCat2PosZ = BlackCat2Z.GetValue(nowTime);
+		float blackCat2PosX = Scene.blackCat2X;
+		float blackCat2PosZ = Scene.blackCat2Z;
 		glTranslatef(blackCat2PosX, 0.0f, blackCat2PosZ);
 
 		// Orientation animation
@@ -1261,9 +1967,51 @@ Display( )
 		glCallList(BlackCatDL);            
 	glPopMatrix();
 
-	// Turn off black cat shader
-	BlackCat.UnUse();
+}
+
+// Draw all of the keytimed animals with the one animal shader:
+// everything that turns, then everything that bends, then everything too small to animate,
+// each pass under one bound program, and each animated pass in its full and reduced LODs
+// (nothing is drawn until the program has finished compiling)
+void DrawAnimals(float nowTime) {
+	TRACE_FUNCTION();
+	if (!AnimalShaderReady())
+		return;
+
+	unsigned int passes[3] = { ANIMAL_TURN, ANIMAL_BEND, 0 };
+	for (int p = 0; p < 3; p++) {
+		int firstTier = passes[p] != 0 ? ANIMAL_LOD_FULL : ANIMAL_LOD_STATIC;
+		int lastTier = passes[p] != 0 ? ANIMAL_LOD_REDUCED : ANIMAL_LOD_STATIC;
+		if (passes[p] == 0 && AnimalTierCounts[ANIMAL_LOD_STATIC] == 0)
+			continue;
+
+		AnimalPass &pass = UseAnimalVariant(p, passes[p]);
+		for (int tier = firstTier; tier <= lastTier; tier++) {
+			if (AnimalTierCounts[tier] == 0)
+				continue;
+			pass.tier = tier;
+			Timers.Begin(PASS_DEER);
+			DrawDeer(pass);
+			Timers.End(PASS_DEER);
+			Timers.Begin(PASS_BEAR);
+			DrawBear(pass);
+			Timers.End(PASS_BEAR);
+			Timers.Begin(PASS_ORANGE_CATS);
+			DrawOrangeCats(pass, nowTime);
+			Timers.End(PASS_ORANGE_CATS);
+			Timers.Begin(PASS_BLACK_CATS);
+			DrawBlackCats(pass, nowTime);
+			Timers.End(PASS_BLACK_CATS);
+		}
+	}
+
+	// Turn off animal shader
+	Animal.UnUse();
+}
 
+// Draw the side panels (walls around the edge of the grid)
+void DrawPanels() {
+	TRACE_FUNCTION();
 	// Panels (walls around the edge of the grid)
 	SetMaterial(1.0f, 1.0f, 1.0f, 10.0f);
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
@@ -1291,29 +2039,399 @@ Display( )
 		glEnd();
     glPopMatrix();
 
-    // Right panel: (25, 0, -25), (25, 25, -25), (25, 25, 25), (25, 0, 25)
-    glPushMatrix();
-		glBegin(GL_QUADS);
-			glTexCoord2f(0.0f, 0.0f); glVertex3f(25.0f, 0.0f, -25.0f); // Bottom-left
-			glTexCoord2f(0.0f, 1.0f); glVertex3f(25.0f, 25.0f, -25.0f); // Top-left
-			glTexCoord2f(1.0f, 1.0f); glVertex3f(25.0f, 25.0f, 25.0f);  // Top-right
-			glTexCoord2f(1.0f, 0.0f); glVertex3f(25.0f, 0.0f, 25.0f);  // Bottom-right
-		glEnd();
-    glPopMatrix();
+    // Right panel: (25, 0, -25), (25, 25, -25), (25, 25, 25), (25, 0, 25)
+    glPushMatrix();
+		glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 0.0f); glVertex3f(25.0f, 0.0f, -25.0f); // Bottom-left
+			glTexCoord2f(0.0f, 1.0f); glVertex3f(25.0f, 25.0f, -25.0f); // Top-left
+			glTexCoord2f(1.0f, 1.0f); glVertex3f(25.0f, 25.0f, 25.0f);  // Top-right
+			glTexCoord2f(1.0f, 0.0f); glVertex3f(25.0f, 0.0f, 25.0f);  // Bottom-right
+		glEnd();
+    glPopMatrix();
+
+    // Front panel: (-25, 0, 25), (-25, 25, 25), (25, 25, -25), (25, 0, -25)
+    glPushMatrix();
+		glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 0.0f); glVertex3f(-25.0f, 0.0f, 25.0f); // Bottom-left
+			glTexCoord2f(0.0f, 1.0f); glVertex3f(-25.0f, 25.0f, 25.0f); // Top-left
+			glTexCoord2f(1.0f, 1.0f); glVertex3f(25.0f, 25.0f, 25.0f); // Top-right
+			glTexCoord2f(1.0f, 0.0f); glVertex3f(25.0f, 0.0f, 25.0f); // Bottom-right
+		glEnd();
+    glPopMatrix();
+}
+
+// Give the pass timers the passes of Display( ), once
+// (they only keep every sample while a benchmark is being timed)
+void SetupPassTimers() {
+	if (Timers.GetNumPasses() > 0)
+		return;
+	Timers.Create();
+	for (int p = 0; p < NUM_BENCH_PASSES; p++)
+		Timers.AddPass(BenchPassNames[p]);
+	Timers.SetKeepSamples(false);
+}
+
+// Turn the performance HUD on or off -- the pass timers run while it is on
+void SetHud(int on) {
+	HudOn = on;
+	if (HudOn != 0) {
+		Overlay.Create();
+		SetupPassTimers();
+	}
+
+	bool benchTiming = Bench != 0 && BenchFrame >= 0 && BenchFrame < BenchFrames;
+	Timers.SetEnabled(HudOn != 0 || benchTiming);
+	Metrics.SetEnabled(HudOn != 0 || MetricsCsv != NULL || MetricsPort >= 0);
+}
+
+// Draw the performance HUD over the top-left corner of a width x height window:
+// the frame time graph, then what the last frame cost
+void DrawHud(int width, int height) {
+	TRACE_FUNCTION();
+	static const float white[4] = { 1.f, 1.f, 1.f, 1.f };
+	static const float grey[4] = { 0.7f, 0.7f, 0.7f, 1.f };
+	static const float background[4] = { 0.f, 0.f, 0.f, 0.45f };
+	const float line = HUD_CHAR_HEIGHT + 4.f;
+	const float graphWidth = 2.f * HUD_GRAPH_SAMPLES, graphHeight = 60.f;
+
+	// the backing panel goes first, so it has to know how many passes ran:
+	int passLines = 0;
+	for (int p = 0; p < Timers.GetNumPasses(); p++) {
+		float cpu, gpu;
+		Timers.GetLastTimes(p, &cpu, &gpu);
+		if (cpu >= 0.f)
+			passLines++;
+	}
+	float x = 12.f, y = 12.f;
+	float panelHeight = line * (10 + passLines) + graphHeight + 6.f;
+	Overlay.Rect(x - 6.f, y - 6.f, x + 30.f * HUD_CHAR_WIDTH, y + panelHeight, background);
+
+	float ms = Overlay.GetAverageFrameTime();
+	Overlay.Text(x, y, white, "FPS %5.1f  %6.2f MS", ms > 0.f ? 1000.f / ms : 0.f, ms);
+	y += line;
+	Overlay.Graph(x, y, graphWidth, graphHeight, 50.f);
+	y += graphHeight + 6.f;
+
+	// what the last whole frame asked OpenGL to do:
+	const GlCounts &gl = GlStats::GetLastFrame();
+	Overlay.Text(x, y, white, "DRAWS %d  PRIMS %lld", gl.drawCalls, gl.primitives);
+	y += line;
+	Overlay.Text(x, y, white, "INDICES %lld", gl.indices);
+	y += line;
+	Overlay.Text(x, y, white, "BINDS %d BUFFER  %d TEXTURE", gl.bufferBinds, gl.textureBinds);
+	y += line;
+	Overlay.Text(x, y, white, "PROGRAMS %d  UNIFORMS %d/%d", gl.programSwitches, gl.uniformUploads, UniformWritesRequested);
+	y += line;
+	Overlay.Text(x, y, white, "CLIENT %d  UPLOAD %.1f KB", gl.clientStateToggles, gl.bytesUploaded / 1024.);
+	y += line;
+	Overlay.Text(x, y, white, "TEX %.1f MB  VBO %.1f MB",
+		GlStats::GetTextureBytes() / (1024. * 1024.), GlStats::GetBufferBytes() / (1024. * 1024.));
+	y += line;
+
+	// the median and the stutter, over the last few seconds:
+	long long count;
+	double mean, p[2][NUM_FRAMEMETRICS], p90, max;
+	bool haveGpu = Metrics.GetWindow(FRAMEMETRIC_GPU, HUD_METRICS_SECONDS, &count, &mean, &p[0][FRAMEMETRIC_GPU], &p90, &p[1][FRAMEMETRIC_GPU], &max);
+	Metrics.GetWindow(FRAMEMETRIC_CPU, HUD_METRICS_SECONDS, &count, &mean, &p[0][FRAMEMETRIC_CPU], &p90, &p[1][FRAMEMETRIC_CPU], &max);
+	for (int i = 0; i < 2; i++) {
+		const char *which = i == 0 ? "P50" : "P99";
+		if (haveGpu)
+			Overlay.Text(x, y, white, "%dS %s CPU %6.2f GPU %6.2f", HUD_METRICS_SECONDS, which, p[i][FRAMEMETRIC_CPU], p[i][FRAMEMETRIC_GPU]);
+		else
+			Overlay.Text(x, y, white, "%dS %s CPU %6.2f GPU      -", HUD_METRICS_SECONDS, which, p[i][FRAMEMETRIC_CPU]);
+		y += line;
+	}
+
+	Overlay.Text(x, y, grey, "PASS          CPU    GPU");
+	y += line;
+	for (int p = 0; p < Timers.GetNumPasses(); p++) {
+		float cpu, gpu;
+		Timers.GetLastTimes(p, &cpu, &gpu);
+		if (cpu < 0.f)
+			continue;
+		if (gpu >= 0.f)
+			Overlay.Text(x, y, white, "%-11s %6.2f %6.2f", Timers.GetPassName(p), cpu, gpu);
+		else
+			Overlay.Text(x, y, white, "%-11s %6.2f      -", Timers.GetPassName(p), cpu);
+		y += line;
+	}
+
+	Overlay.Draw(width, height);
+}
+
+// Capture the frames that follow to CaptureTarget (0 frames means until StopCapture( )):
+// each one is a fixed simulation step, so the recording plays back at exactly 60 fps
+bool StartCapture(int frames) {
+	if (!Capture.Start(CaptureFormat, CaptureTarget))
+		return false;
+	CaptureFrames = frames;
+	Clock.SetFixedFrames(true);
+	return true;
+}
+
+// Write out what is left of the capture, and go back to the usual clock
+bool StopCapture() {
+	bool ok = Capture.Finish();
+	Clock.SetFixedFrames(Bench != 0 || Headless != 0);
+	return ok;
+}
+
+// Called at the end of every Display( ), before the buffers are swapped:
+// captures the width x height frame that was just drawn, if there is a capture running
+void CaptureFrameDone(int width, int height) {
+	// a capture asked for on the command line starts the cycle over once the animals are ready:
+	if (CaptureWanted != 0 && !Animal.IsPending()) {
+		CaptureWanted = 0;
+		RestartSimulation(0.);
+		StartCapture(CaptureFrames);
+		return;
+	}
+
+	if (!Capture.IsRunning())
+		return;
+	if (Headless == 0)
+		glReadBuffer(GL_BACK);
+	Capture.CaptureFrame(width, height);
+
+	// (a headless run stops it itself, after its last frame)
+	if (Headless == 0 && CaptureFrames > 0 && Capture.GetFrame() >= CaptureFrames)
+		StopCapture();
+}
+
+// draw the complete scene:
+void
+Display( )
+{
+	TRACE_FUNCTION( );
+	if (DebugOn != 0)
+		fprintf(stderr, "Starting Display.\n");
+
+	// the recorded frames start once the animals are drawn -- what comes before is setup:
+
+	bool recordingFrame = GlRecorder::IsRecording( )  &&  ! Animal.IsPending( );
+	if( recordingFrame )
+		GlRecorder::Frame( );
+
+	// set which window we want to do the graphics into:
+	if( Headless != 0 )
+		Offscreen.Bind( );
+	else
+	{
+		glutSetWindow( MainWindow );
+		glDrawBuffer( GL_BACK );
+	}
+	Timers.BeginFrame( );
+	Metrics.BeginFrame( );
+
+	// erase the background:
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+	glEnable( GL_DEPTH_TEST );
+#ifdef DEMO_DEPTH_BUFFER
+	if( DepthBufferOn == 0 )
+		glDisable( GL_DEPTH_TEST );
+#endif
+
+	// the time being drawn, between 0 and 40 seconds
+	// (Animate( ) has blended it from the frame clock's last two simulation steps)
+	float nowTime = Scene.time;
+
+	// render the shadow maps:
+	// the static casters only need this when the cached maps are out of date,
+	// the animals need it every frame
+
+	if( ShadowsOn != 0  &&  Shadows.IsValid( ) )
+	{
+		Timers.Begin( PASS_SHADOWS );
+		Shadows.SetLight( SUNPOS[0], SUNPOS[1], SUNPOS[2] );
+		Shadows.SetCascades( CAMERA_RADIUS / Scale );
+
+		if( Shadows.NeedsStaticUpdate( ) )
+		{
+			for( int c = 0; c < Shadows.GetNumCascades( ); c++ )
+			{
+				Shadows.BeginStatic( c );
+					DrawStaticDepth( );
+				Shadows.EndPass( );
+			}
+		}
+
+		Shadows.BeginDynamic( );
+			DrawAnimals( nowTime );
+		Shadows.EndPass( );
+		Timers.End( PASS_SHADOWS );
+	}
+
+	// specify shading to be flat:
+
+	glShadeModel( GL_FLAT );
+
+	// set the viewport to be a square centered in the window:
+
+	GLsizei vx = Headless != 0 ? Offscreen.GetWidth( )  : glutGet( GLUT_WINDOW_WIDTH );
+	GLsizei vy = Headless != 0 ? Offscreen.GetHeight( ) : glutGet( GLUT_WINDOW_HEIGHT );
+	GLsizei v = vx < vy ? vx : vy;			// minimum dimension
+	GLint xl = ( vx - v ) / 2;
+	GLint yb = ( vy - v ) / 2;
+	glViewport( xl, yb,  v, v );
+
+	// set the viewing volume:
+	// remember that the Z clipping  values are given as DISTANCES IN FRONT OF THE EYE
+	// USE gluOrtho2D( ) IF YOU ARE DOING 2D !
+
+	glMatrixMode( GL_PROJECTION );
+	glLoadIdentity( );
+	if( NowProjection == ORTHO )
+		glOrtho( -2.f, 2.f,     -2.f, 2.f,     0.1f, 1000.f );
+	else
+		gluPerspective( 70.f, 1.f,	0.1f, 1000.f );
+
+	// place the objects into the scene:
+
+	glMatrixMode( GL_MODELVIEW );
+	glLoadIdentity( );
+
+	// Get eye positions
+	float eyePosX = Scene.cameraX;
+	float eyePosZ = Scene.cameraZ;
+
+    // Set the eye
+    gluLookAt(eyePosX, 5.0f, eyePosZ, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f); // Animated eye
+	//gluLookAt(24.0f, 5.0f, 0.0f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f); // Static eye
+
+    // Rotate the scene:
+    glRotatef((GLfloat)Yrot, 0.f, 1.f, 0.f);
+    glRotatef((GLfloat)Xrot, 1.f, 0.f, 0.f);
+        
+    // Uniformly scale the scene:
+    if (Scale < MINSCALE)
+        Scale = MINSCALE;
+    glScalef((GLfloat)Scale, (GLfloat)Scale, (GLfloat)Scale);
+    
+	// bin the fireflies and lanterns into the light clusters for this view:
+
+	if( LightsOn != 0  &&  Lights.IsValid( ) )
+	{
+		Timers.Begin( PASS_LIGHTS );
+		Lights.SetProjection( NowProjection == ORTHO, NowProjection == ORTHO ? 2.f : 70.f, CLUSTER_NEAR, CLUSTER_FAR );
+		SetClusteredLights( nowTime );
+		Lights.Update( xl, yb, v, v );
+		Lights.Bind( );
+		Timers.End( PASS_LIGHTS );
+	}
+
+	// pick each animal's animation detail from how big it is in this view:
+
+	UpdateAnimalLOD( );
+
+	// set the fog parameters:
+
+	if( DepthCueOn != 0 )
+	{
+		glFogi( GL_FOG_MODE, FOGMODE );
+		glFogfv( GL_FOG_COLOR, FOGCOLOR );
+		glFogf( GL_FOG_DENSITY, FOGDENSITY );
+		glFogf( GL_FOG_START, FOGSTART );
+		glFogf( GL_FOG_END, FOGEND );
+		glEnable( GL_FOG );
+	}
+	else
+	{
+		glDisable( GL_FOG );
+	}
+
+	// possibly draw the axes:
+
+	if( AxesOn != 0 )
+	{
+		glColor3fv( &Colors[NowColor][0] );
+		glCallList( AxesList );
+	}
+
+	// since we are using glScalef( ), be sure the normals get unitized:
+
+	glEnable( GL_NORMALIZE );
+
+	// Depth pre-pass: lay down the nearest depth of everything first, so that the
+	// textured and shaded color pass below only runs once per pixel (GL_EQUAL)
+
+	if( DepthPrePassOn != 0 )
+	{
+		Timers.Begin( PASS_PREPASS );
+		glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+		glCallList( GridDL );
+		DrawStaticDepth( );
+		DrawAnimals( nowTime );		// the shaders move the vertices, so these need the full draw
+		DrawPanels( );
+		glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+		Timers.End( PASS_PREPASS );
+
+		glDepthFunc( GL_EQUAL );
+		glDepthMask( GL_FALSE );
+	}
+
+	SetPointLight(GL_LIGHT0, SUNPOS[0], SUNPOS[1], SUNPOS[2], 0.6f, 0.5f, 0.2f);  // A warm golden light
+
+	// Enable textures and lighting
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+    glEnable(GL_TEXTURE_2D);
+
+	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+	// Look up the shadow maps for everything drawn without a shader
+	if (ShadowsOn != 0)
+		Shadows.Enable();
+
+	// Draw the grid
+	Timers.Begin(PASS_GRID);
+	SetMaterial(0.2f, 0.2f, 0.2f, 5.0f);
+	glBindTexture(GL_TEXTURE_2D, FloorTexture); 
+	glCallList(GridDL);
+	Timers.End(PASS_GRID);
+	
+	// Draw the trees
+	Timers.Begin(PASS_TREES);
+	DrawTrees();
+	Timers.End(PASS_TREES);
+
+	// Draw the bushes
+	Timers.Begin(PASS_BUSHES);
+	DrawBushes();
+	Timers.End(PASS_BUSHES);
+
+	// Draw the rocks
+	Timers.Begin(PASS_ROCKS);
+	DrawRocks();
+	Timers.End(PASS_ROCKS);
+
+	// Draw the animals (timed per species in DrawAnimals( ))
+	DrawAnimals(nowTime);
 
-    // Front panel: (-25, 0, 25), (-25, 25, 25), (25, 25, -25), (25, 0, -25)
-    glPushMatrix();
-		glBegin(GL_QUADS);
-			glTexCoord2f(0.0f, 0.0f); glVertex3f(-25.0f, 0.0f, 25.0f); // Bottom-left
-			glTexCoord2f(0.0f, 1.0f); glVertex3f(-25.0f, 25.0f, 25.0f); // Top-left
-			glTexCoord2f(1.0f, 1.0f); glVertex3f(25.0f, 25.0f, 25.0f); // Top-right
-			glTexCoord2f(1.0f, 0.0f); glVertex3f(25.0f, 0.0f, 25.0f); // Bottom-right
-		glEnd();
-    glPopMatrix();
+	// Draw the panels
+	Timers.Begin(PASS_PANELS);
+	DrawPanels();
+	Timers.End(PASS_PANELS);
+
+	if (ShadowsOn != 0)
+		Shadows.Disable();
+
+	// Back to the usual depth test for anything that was not in the pre-pass
+	if (DepthPrePassOn != 0) {
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
 
 	// Disable textures and lighting
 	glDisable(GL_TEXTURE_2D);
     glDisable(GL_LIGHTING);
+
+	// Draw the fireflies
+	if (LightsOn != 0) {
+		Timers.Begin(PASS_FIREFLIES);
+		DrawFireflies(nowTime);
+		Timers.End(PASS_FIREFLIES);
+	}
 	
 
 #ifdef DEMO_Z_FIGHTING
@@ -1356,16 +2474,59 @@ Display( )
 	glColor3f( 1.f, 1.f, 1.f );
 	//DoRasterString( 5.f, 5.f, 0.f, (char *)"Text That Doesn't" );
 
+	// the performance HUD goes on top of everything:
+
+	if( HudOn != 0 )
+		DrawHud( vx, vy );
+
+	CaptureFrameDone( vx, vy );
+	Metrics.EndFrame( );
+
 	// swap the double-buffered framebuffers:
 
-	glutSwapBuffers( );
+	if( Headless == 0 )
+		TRACED( "glutSwapBuffers", glutSwapBuffers( ) );
 
 	// be sure the graphics buffer has been sent:
 	// note: be sure to use glFlush( ) here, not glFinish( ) !
 
 	glFlush( );
+	Metrics.Presented( );
+	Pacer.FrameDone( );
+	Overlay.FrameDone( );
+	GlStats::FrameDone( );
+	Timers.EndFrame( );
+	if( recordingFrame  &&  ++RecordedFrames == RecordFrames )
+		GlRecorder::Stop( );
+	if( Bench != 0 )
+		BenchFrameDone( );
+
+	// uniform writes this frame -- asked for, and actually sent to the driver after the shadow copies --
+	// and how many animals were in each animation LOD:
+
+	GLSLProgram::GetUniformWriteCounts( &UniformWritesRequested, &UniformWritesIssued );
+	GLSLProgram::ResetUniformWriteCounts( );
+	if( DebugOn != 0 )
+	{
+		const GlCounts &gl = GlStats::GetLastFrame( );
+		fprintf( stderr, "GL calls: %d draws, %lld primitives, %d buffer and %d texture binds, %d programs, %d uniforms, %lld bytes uploaded\n",
+			gl.drawCalls, gl.primitives, gl.bufferBinds, gl.textureBinds, gl.programSwitches, gl.uniformUploads, gl.bytesUploaded );
+		fprintf( stderr, "Uniform writes: %d requested, %d issued\n", UniformWritesRequested, UniformWritesIssued );
+		fprintf( stderr, "Animal LODs: %d full, %d reduced, %d static\n",
+			AnimalTierCounts[ANIMAL_LOD_FULL], AnimalTierCounts[ANIMAL_LOD_REDUCED], AnimalTierCounts[ANIMAL_LOD_STATIC] );
+	}
+}
+
+void
+DoAnimationMenu( int id )
+{
+	BakedAnimationOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
 }
 
+
 void
 DoAxesMenu( int id )
 {
@@ -1440,6 +2601,16 @@ DoMainMenu( int id )
 			// gracefully close out the graphics:
 			// gracefully close the graphics window:
 			// gracefully exit the program:
+			if( DebugOn != 0 )
+				Pacer.PrintReport( stderr );
+			if( Capture.IsRunning( ) )
+				StopCapture( );
+			if( TraceOutput != NULL )
+				TRACE_WRITE( TraceOutput );
+			GlRecorder::Stop( );
+			if( MetricsCsv != NULL )
+				Metrics.WriteCSV( MetricsCsv );
+			Metrics.StopServer( );
 			glutSetWindow( MainWindow );
 			glFinish( );
 			glutDestroyWindow( MainWindow );
@@ -1465,6 +2636,56 @@ DoProjectMenu( int id )
 }
 
 
+void
+DoDepthPrePassMenu( int id )
+{
+	DepthPrePassOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoFrameRateMenu( int id )
+{
+	Pacer.SetTargetFPS( (double)id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoHudMenu( int id )
+{
+	SetHud( id );
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoShadowsMenu( int id )
+{
+	ShadowsOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
+void
+DoLightsMenu( int id )
+{
+	LightsOn = id;
+
+	glutSetWindow( MainWindow );
+	glutPostRedisplay( );
+}
+
+
 // use glut to display a string of characters using a raster font:
 
 void
@@ -1546,6 +2767,24 @@ InitMenus( )
 	glutAddMenuEntry( "Off",  0 );
 	glutAddMenuEntry( "On",   1 );
 
+	int depthprepassmenu = glutCreateMenu( DoDepthPrePassMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
+	int animationmenu = glutCreateMenu( DoAnimationMenu );
+	glutAddMenuEntry( "Procedural",  0 );
+	glutAddMenuEntry( "Baked",       1 );
+
+	int frameratemenu = glutCreateMenu( DoFrameRateMenu );
+	glutAddMenuEntry( "Unlimited",  0 );
+	glutAddMenuEntry( "30 fps",    30 );
+	glutAddMenuEntry( "60 fps",    60 );
+	glutAddMenuEntry( "120 fps",  120 );
+
+	int hudmenu = glutCreateMenu( DoHudMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
 	int debugmenu = glutCreateMenu( DoDebugMenu );
 	glutAddMenuEntry( "Off",  0 );
 	glutAddMenuEntry( "On",   1 );
@@ -1554,7 +2793,16 @@ InitMenus( )
 	glutAddMenuEntry( "Orthographic",  ORTHO );
 	glutAddMenuEntry( "Perspective",   PERSP );
 
+	int shadowsmenu = glutCreateMenu( DoShadowsMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
+	int lightsmenu = glutCreateMenu( DoLightsMenu );
+	glutAddMenuEntry( "Off",  0 );
+	glutAddMenuEntry( "On",   1 );
+
 	int mainmenu = glutCreateMenu( DoMainMenu );
+	glutAddSubMenu(   "Animation",     animationmenu);
 	glutAddSubMenu(   "Axes",          axesmenu);
 	glutAddSubMenu(   "Axis Colors",   colormenu);
 
@@ -1567,7 +2815,12 @@ InitMenus( )
 #endif
 
 	glutAddSubMenu(   "Depth Cue",     depthcuemenu);
+	glutAddSubMenu(   "Depth Pre-Pass",depthprepassmenu);
+	glutAddSubMenu(   "Fireflies",     lightsmenu );
+	glutAddSubMenu(   "Frame Rate",    frameratemenu );
+	glutAddSubMenu(   "HUD",           hudmenu );
 	glutAddSubMenu(   "Projection",    projmenu );
+	glutAddSubMenu(   "Shadows",       shadowsmenu );
 	glutAddMenuEntry( "Reset",         RESET );
 	glutAddSubMenu(   "Debug",         debugmenu);
 	glutAddMenuEntry( "Quit",          QUIT );
@@ -1583,11 +2836,8 @@ InitMenus( )
 //	also setup callback functions
 
 void
-InitGraphics( )
+InitWindow( )
 {
-	if (DebugOn != 0)
-		fprintf(stderr, "Starting InitGraphics.\n");
-
 	// request the display modes:
 	// ask for red-green-blue-alpha color, double-buffering, and z-buffering:
 
@@ -1603,10 +2853,6 @@ InitGraphics( )
 	MainWindow = glutCreateWindow( WINDOWTITLE );
 	glutSetWindowTitle( WINDOWTITLE );
 
-	// set the framebuffer clear values:
-
-	glClearColor( BACKCOLOR[0], BACKCOLOR[1], BACKCOLOR[2], BACKCOLOR[3] );
-
 	// setup the callback functions:
 	// DisplayFunc -- redraw the window
 	// ReshapeFunc -- handle the user resizing the window
@@ -1648,6 +2894,39 @@ InitGraphics( )
 	glutTabletButtonFunc( NULL );
 	glutMenuStateFunc( NULL );
 	glutTimerFunc( -1, NULL, 0 );
+}
+
+
+void
+InitGraphics( )
+{
+	TRACE_FUNCTION( );
+	if (DebugOn != 0)
+		fprintf(stderr, "Starting InitGraphics.\n");
+
+	// open the window and hook up its callbacks -- unless there is no window,
+	// in which case the offscreen context is already current:
+
+	if( Headless == 0 )
+		InitWindow( );
+
+	// record the OpenGL calls from here on, so every upload is in the recording:
+
+	if( RecordOutput != NULL )
+	{
+		if( Headless != 0 )
+			GlRecorder::Start( RecordOutput, Offscreen.GetWidth( ), Offscreen.GetHeight( ), Offscreen.GetFramebuffer( ) );
+		else
+			GlRecorder::Start( RecordOutput, glutGet( GLUT_WINDOW_WIDTH ), glutGet( GLUT_WINDOW_HEIGHT ), 0 );
+	}
+
+	// see if the GPU can be timed for the frame-time metrics:
+
+	Metrics.Create( );
+
+	// set the framebuffer clear values:
+
+	glClearColor( BACKCOLOR[0], BACKCOLOR[1], BACKCOLOR[2], BACKCOLOR[3] );
 
 	InitializeTreePositions();
 	InitializeBushPositions();
@@ -1658,19 +2937,22 @@ InitGraphics( )
 	InitializePanelPositions();
 
 	// Camera/eye keytime animation
-	float radius = 24.0f;
+	float radius = CAMERA_RADIUS;
 	float angleSpeed = 2.0f * 3.14159f / 40.0f; // Full rotation in 40 seconds
 
-	CameraX.Init();
-	CameraZ.Init();
-
-	// Calculate the X and Z positions based on time for a continuous circle
+	// Calculate the X and Z positions based on time for a continuous circle,
+	// then build each track from them in one go
+	std::vector<TimeValue> cameraX, cameraZ;
 	for (float time = 0.0f; time <= 40.0f; time += 0.5f) {
 		float angle = angleSpeed * time;
 
-		CameraX.AddTimeValue(time, radius * cos(angle));
-		CameraZ.AddTimeValue(time, radius * sin(angle));
+		TimeValue x = { time, radius * cosf(angle) };
+		TimeValue z = { time, radius * sinf(angle) };
+		cameraX.push_back(x);
+		cameraZ.push_back(z);
 	}
+	CameraX.Build(&cameraX[0], (int)cameraX.size());
+	CameraZ.Build(&cameraZ[0], (int)cameraZ.size());
 
 	// Orange cat positioning keytime aimation (running along x axis)
 	OrangeCatX.Init();
@@ -1744,10 +3026,30 @@ InitGraphics( )
 	CatScale.AddTimeValue(39.0, 0.115);
 	CatScale.AddTimeValue(39.5, 0.065); 
 
+	// Start the frame clock, with the keytimes sampled at the beginning of the cycle
+	Clock.Init(FRAMECLOCK_STEP);
+	RestartSimulation(0.);
+
     int width, height;
 
+	// Start compiling and linking the animal shader up front -- the driver works on it
+	// while the textures and models below load, and the animals are drawn once it is done
+	// (see AnimalShaderReady( )).
+	// Every species shares this one program; their differences are uniform tables (see Species[ ]).
+	// Linked programs are kept on disk so later launches can skip compiling.
+	GLSLProgram::SetCacheDir((char *)"shadercache");
+
+	Animal.Init();
+	TRACED("create animal shader", Animal.CreateAsync("animal.vert", "animal.frag", "clusteredlights.frag"));
+
+	// Name the animation permutations (the variants get compiled the first time they are drawn)
+	Animal.DefineFeature(ANIMAL_TURN, "TURN");
+	Animal.DefineFeature(ANIMAL_BEND, "BEND");
+	Animal.DefineFeature(ANIMAL_TEXTURE_ARRAY, "TEXTURE_ARRAY");
+	Animal.DefineFeature(ANIMAL_BAKED, "BAKED");
+
 	// Load the texture for the floor
-	unsigned char* floorTexture = BmpToTexture("./obj/ground.bmp", &width, &height);
+	unsigned char* floorTexture = TRACED("BmpToTexture floor", BmpToTexture("./obj/ground.bmp", &width, &height));
 	if (floorTexture == NULL) {
 		fprintf(stderr, "Cannot open texture for floor\n");
 		return;
@@ -1764,7 +3066,7 @@ InitGraphics( )
 	free(floorTexture); // Free the texture data after loading
 
 	// Load the texture for the tree
-    unsigned char* treeTexture = BmpToTexture("./obj/22-trees_9_obj/Texture/Bark___0_edit.bmp", &width, &height);
+    unsigned char* treeTexture = TRACED("BmpToTexture tree", BmpToTexture("./obj/22-trees_9_obj/Texture/Bark___0_edit.bmp", &width, &height));
     if (treeTexture == NULL) {
         fprintf(stderr, "Cannot open texture for tree\n");
         return;
@@ -1781,7 +3083,7 @@ InitGraphics( )
 	free(treeTexture); // Free the texture data after loading
 
 	// Load the diffuse texture for the bush
-	unsigned char* bushDiffuseTexture = BmpToTexture("./obj/Matteuccia_Struthiopteris_OBJ/maps/matteuccia_struthiopteris_leaf_1_01_diffuse.bmp", &width, &height);
+	unsigned char* bushDiffuseTexture = TRACED("BmpToTexture bushDiffuse", BmpToTexture("./obj/Matteuccia_Struthiopteris_OBJ/maps/matteuccia_struthiopteris_leaf_1_01_diffuse.bmp", &width, &height));
 	if (bushDiffuseTexture == NULL) {
 		fprintf(stderr, "Cannot open diffuse texture for bush\n");
 		return;
@@ -1801,7 +3103,7 @@ InitGraphics( )
 	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 	// Load the specular texture for the bush
-	unsigned char* bushSpecularTexture = BmpToTexture("./obj/Matteuccia_Struthiopteris_OBJ/maps/matteuccia_struthiopteris_leaf_1_02_specular.bmp", &width, &height);
+	unsigned char* bushSpecularTexture = TRACED("BmpToTexture bushSpecular", BmpToTexture("./obj/Matteuccia_Struthiopteris_OBJ/maps/matteuccia_struthiopteris_leaf_1_02_specular.bmp", &width, &height));
 	if (bushSpecularTexture == NULL) {
 		fprintf(stderr, "Cannot open specular texture for bush\n");
 		return;
@@ -1821,7 +3123,7 @@ InitGraphics( )
 	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 	// Load the texture for the rock
-	unsigned char* rockTexture = BmpToTexture("./obj/moss rock 13 sketchfab/moss rock 13 (4096).bmp", &width, &height);
+	unsigned char* rockTexture = TRACED("BmpToTexture rock", BmpToTexture("./obj/moss rock 13 sketchfab/moss rock 13 (4096).bmp", &width, &height));
 	if (rockTexture == NULL) {
 		fprintf(stderr, "Cannot open texture for rock\n");
 		return;
@@ -1837,136 +3139,12 @@ InitGraphics( )
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, rockTexture);
 	free(rockTexture); // Free the texture data after loading
 
-	// Create deer shader program
-	Deer.Init();
-	bool deerValid = Deer.Create("deer.vert", "deer.frag");
-	if (!deerValid) {
-		fprintf(stderr, "Yuch! The Deer shader did not compile.\n");
-	} else {
-		fprintf(stderr, "Woo-Hoo! The Deer shader compiled.\n");
-	}
-
-	// Set the shader uniform variables
-	Deer.SetUniformVariable("uKa", 0.5f);
-	Deer.SetUniformVariable("uKd", 0.4f);
-	Deer.SetUniformVariable("uKs", 0.1f);
-	Deer.SetUniformVariable("uShininess", 20.0f);
-
-	// Load the texture for the deer
-	unsigned char* deerTexture = BmpToTexture("./obj/White-TailedDeer_V1_L2.123c4f372813-f2b8-4711-8c23-8d6c4953de32/12961_White-TailedDeer_diffuse.bmp", &width, &height);
-	if (deerTexture == NULL) {
-		fprintf(stderr, "Cannot open texture for deer\n");
+	// Load the animal textures
+	if (!LoadAnimalTextures())
 		return;
-	}
-
-	glGenTextures(1, &DeerTexture);
-	glBindTexture(GL_TEXTURE_2D, DeerTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, deerTexture);
-	free(deerTexture); 
-
-	// Create bear shader program
-	Bear.Init();
-	bool bearValid = Bear.Create("bear.vert", "bear.frag");
-	if (!bearValid) {
-		fprintf(stderr, "Yuch! The Bear shader did not compile.\n");
-	} else {
-		fprintf(stderr, "Woo-Hoo! The Bear shader compiled.\n");
-	}
-
-	// Set the shader uniform variables
-	Bear.SetUniformVariable("uKa", 0.5f);
-	Bear.SetUniformVariable("uKd", 0.4f);
-	Bear.SetUniformVariable("uKs", 0.1f);
-	Bear.SetUniformVariable("uShininess", 20.0f);
-
-	// Load the texture for the bear
-	unsigned char* bearTexture = BmpToTexture("./obj/Tibetan_Blue_Bear_v1_L3.123c942e6fa9-d7c1-4f52-ac2a-5aa1f6bc9dce/Tibetan_bear_diffuse.bmp", &width, &height);
-	if (bearTexture == NULL) {
-		fprintf(stderr, "Cannot open texture for bear\n");
-		return;
-	}
-
-	glGenTextures(1, &BearTexture);
-	glBindTexture(GL_TEXTURE_2D, BearTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, bearTexture);
-	free(bearTexture); 
-
-	// Create orange cat shader program
-	OrangeCat.Init();
-	bool orangeCatValid = OrangeCat.Create("orangeCat.vert", "orangeCat.frag");
-	if (!orangeCatValid) {
-		fprintf(stderr, "Yuch! The Orange Cat shader did not compile.\n");
-	} else {
-		fprintf(stderr, "Woo-Hoo! The Orange Cat shader compiled.\n");
-	}
-
-	// Set the shader uniform variables
-	OrangeCat.SetUniformVariable("uKa", 0.5f);
-	OrangeCat.SetUniformVariable("uKd", 0.4f);
-	OrangeCat.SetUniformVariable("uKs", 0.1f);
-	OrangeCat.SetUniformVariable("uShininess", 20.0f);
-
-	// Load the texture for the orange cat
-	unsigned char* orangeCatTexture = BmpToTexture("./obj/Cat_v1_L3.123cb1b1943a-2f48-4e44-8f71-6bbe19a3ab64/Cat_diffuse_orange.bmp", &width, &height);
-	if (orangeCatTexture == NULL) {
-		fprintf(stderr, "Cannot open texture for orange cat\n");
-		return;
-	}
-
-	glGenTextures(1, &OrangeCatTexture);
-	glBindTexture(GL_TEXTURE_2D, OrangeCatTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, orangeCatTexture);
-	free(orangeCatTexture); 
-
-	// Create black cat shader program
-	BlackCat.Init();
-	bool blackCatValid = BlackCat.Create("blackCat.vert", "blackCat.frag");
-	if (!blackCatValid) {
-		fprintf(stderr, "Yuch! The Black Cat shader did not compile.\n");
-	} else {
-		fprintf(stderr, "Woo-Hoo! The Black Cat shader compiled.\n");
-	}
-
-	// Set the shader uniform variables
-	BlackCat.SetUniformVariable("uKa", 0.5f);
-	BlackCat.SetUniformVariable("uKd", 0.4f);
-	BlackCat.SetUniformVariable("uKs", 0.1f);
-	BlackCat.SetUniformVariable("uShininess", 20.0f);
-
-	// Load the texture for the black cat
-	unsigned char* blackCatTexture = BmpToTexture("./obj/Cat_v1_L3.123cc81ac858-7d2c-4c7e-bf80-81982996d26d/Cat_diffuse.bmp", &width, &height);
-	if (blackCatTexture == NULL) {
-		fprintf(stderr, "Cannot open texture for black cat\n");
-		return;
-	}
-
-	glGenTextures(1, &BlackCatTexture);
-	glBindTexture(GL_TEXTURE_2D, BlackCatTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, blackCatTexture);
-	free(blackCatTexture); 
 
 	// Load the texture for the floor
-	unsigned char* wallTexture = BmpToTexture("./obj/forest_view.bmp", &width, &height);
+	unsigned char* wallTexture = TRACED("BmpToTexture wall", BmpToTexture("./obj/forest_view.bmp", &width, &height));
 	if (wallTexture == NULL) {
 		fprintf(stderr, "Cannot open texture for floor\n");
 		return;
@@ -1987,7 +3165,9 @@ InitGraphics( )
 	// we don't need to do this for this program, and really should set the argument to NULL
 	// but, this sets us up nicely for doing animation
 
-	glutIdleFunc( Animate );
+	WindowVisible = 1;
+	if( Headless == 0 )
+		glutIdleFunc( Animate );
 
 	// init the glew package (a window must be open to do this):
 
@@ -2004,6 +3184,15 @@ InitGraphics( )
 
 	// all other setups go here, such as GLSLProgram and KeyTime setups:
 
+	// create the shadow maps (they get rendered the first time shadows are turned on):
+	Shadows.Init( );
+	if( ! TRACED( "create shadow maps", Shadows.Create( SHADOW_STATIC_SIZE, SHADOW_DYNAMIC_SIZE, SHADOW_CASCADES ) ) )
+		fprintf( stderr, "Shadows are not available\n" );
+
+	// create the light cluster textures:
+	Lights.Init( );
+	if( ! TRACED( "create light clusters", Lights.Create( MAX_CLUSTERED_LIGHTS ) ) )
+		fprintf( stderr, "Clustered lights are not available\n" );
 }
 
 // initialize the display lists that will not change:
@@ -2014,13 +3203,15 @@ InitGraphics( )
 void
 InitLists( )
 {
+	TRACE_FUNCTION( );
 	if (DebugOn != 0)
 		fprintf(stderr, "Starting InitLists.\n");
 
 	float dx = BOXSIZE / 2.f;
 	float dy = BOXSIZE / 2.f;
 	float dz = BOXSIZE / 2.f;
-	glutSetWindow( MainWindow );
+	if( Headless == 0 )
+		glutSetWindow( MainWindow );
 
 	// create the objects:
 
@@ -2051,17 +3242,22 @@ InitLists( )
 	glEndList();
 
 	// Load tree obj file for use with vertex buffer
-	LoadTreeGeometry("./obj/22-trees_9_obj/trees9.obj", "Bark___0", treeVertices, treeIndices);
+	TRACED("LoadTreeGeometry tree", LoadTreeGeometry("./obj/22-trees_9_obj/trees9.obj", "Bark___0", treeVertices, treeIndices, &treeDepthVertices));
 
     // Generate and bind a Vertex Buffer Object (VBO) for the tree
     glGenBuffers(1, &treeVBO);
     glBindBuffer(GL_ARRAY_BUFFER, treeVBO);
-    glBufferData(GL_ARRAY_BUFFER, treeVertices.size() * sizeof(float), treeVertices.data(), GL_STATIC_DRAW);
+    TRACED("upload treeVBO", glBufferData(GL_ARRAY_BUFFER, treeVertices.size() * sizeof(float), treeVertices.data(), GL_STATIC_DRAW));
+
+    // And one with just the positions for the depth passes
+    glGenBuffers(1, &treeDepthVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, treeDepthVBO);
+    TRACED("upload treeDepthVBO", glBufferData(GL_ARRAY_BUFFER, treeDepthVertices.size() * sizeof(float), treeDepthVertices.data(), GL_STATIC_DRAW));
 
     // Generate and bind an Element Buffer Object (EBO) for the tree
     glGenBuffers(1, &treeEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, treeEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, treeIndices.size() * sizeof(unsigned int), treeIndices.data(), GL_STATIC_DRAW);
+    TRACED("upload treeEBO", glBufferData(GL_ELEMENT_ARRAY_BUFFER, treeIndices.size() * sizeof(unsigned int), treeIndices.data(), GL_STATIC_DRAW));
 
 	printf("Tree Vertices Count: %zu\n", treeVertices.size());
 	printf("Tree Indices Count: %zu\n", treeIndices.size());
@@ -2071,17 +3267,22 @@ InitLists( )
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	// Load bush obj file for use with vertex buffer
-	LoadGeometry("./obj/Matteuccia_Struthiopteris_OBJ/matteucia_struthiopteris_2.obj", bushVertices, bushIndices);
+	TRACED("LoadGeometry bush", LoadGeometry("./obj/Matteuccia_Struthiopteris_OBJ/matteucia_struthiopteris_2.obj", bushVertices, bushIndices, &bushDepthVertices));
 
 	// Generate and bind a Vertex Buffer Object (VBO) for the bush
     glGenBuffers(1, &bushVBO);
     glBindBuffer(GL_ARRAY_BUFFER, bushVBO);
-    glBufferData(GL_ARRAY_BUFFER, bushVertices.size() * sizeof(float), bushVertices.data(), GL_STATIC_DRAW);
+    TRACED("upload bushVBO", glBufferData(GL_ARRAY_BUFFER, bushVertices.size() * sizeof(float), bushVertices.data(), GL_STATIC_DRAW));
+
+    // And one with just the positions for the depth passes
+    glGenBuffers(1, &bushDepthVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, bushDepthVBO);
+    TRACED("upload bushDepthVBO", glBufferData(GL_ARRAY_BUFFER, bushDepthVertices.size() * sizeof(float), bushDepthVertices.data(), GL_STATIC_DRAW));
 
     // Generate and bind an Element Buffer Object (EBO) for the bush
     glGenBuffers(1, &bushEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bushEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bushIndices.size() * sizeof(unsigned int), bushIndices.data(), GL_STATIC_DRAW);
+    TRACED("upload bushEBO", glBufferData(GL_ELEMENT_ARRAY_BUFFER, bushIndices.size() * sizeof(unsigned int), bushIndices.data(), GL_STATIC_DRAW));
 
 	printf("Bush Vertices Count: %zu\n", bushVertices.size());
 	printf("Bush Indices Count: %zu\n", bushIndices.size());
@@ -2091,17 +3292,22 @@ InitLists( )
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	// Load rock obj file for use with vertex buffer
-	LoadGeometry("./obj/moss rock 13 sketchfab/moss rock 13.obj", rockVertices, rockIndices);
+	TRACED("LoadGeometry rock", LoadGeometry("./obj/moss rock 13 sketchfab/moss rock 13.obj", rockVertices, rockIndices, &rockDepthVertices));
 
 	// Generate and bind a Vertex Buffer Object (VBO) for the rock
     glGenBuffers(1, &rockVBO);
     glBindBuffer(GL_ARRAY_BUFFER, rockVBO);
-    glBufferData(GL_ARRAY_BUFFER, rockVertices.size() * sizeof(float), rockVertices.data(), GL_STATIC_DRAW);
+    TRACED("upload rockVBO", glBufferData(GL_ARRAY_BUFFER, rockVertices.size() * sizeof(float), rockVertices.data(), GL_STATIC_DRAW));
+
+    // And one with just the positions for the depth passes
+    glGenBuffers(1, &rockDepthVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, rockDepthVBO);
+    TRACED("upload rockDepthVBO", glBufferData(GL_ARRAY_BUFFER, rockDepthVertices.size() * sizeof(float), rockDepthVertices.data(), GL_STATIC_DRAW));
 
     // Generate and bind an Element Buffer Object (EBO) for the rock
     glGenBuffers(1, &rockEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rockEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, rockIndices.size() * sizeof(unsigned int), rockIndices.data(), GL_STATIC_DRAW);
+    TRACED("upload rockEBO", glBufferData(GL_ELEMENT_ARRAY_BUFFER, rockIndices.size() * sizeof(unsigned int), rockIndices.data(), GL_STATIC_DRAW));
 
 	printf("Rock Vertices Count: %zu\n", rockVertices.size());
 	printf("Rock Indices Count: %zu\n", rockIndices.size());
@@ -2110,29 +3316,44 @@ InitLists( )
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+	// The animals' display lists also hand each vertex its index, and their rest poses
+	// get their animation clips baked (see BakeAnimal( )) and give their sizes for the LODs
+	std::vector<float> animalPositions;
+
 	// Create deer display list
 	DeerDL = glGenLists(1);
 	glNewList(DeerDL, GL_COMPILE);
-		LoadObjFile((char*)"./obj/White-TailedDeer_V1_L2.123c4f372813-f2b8-4711-8c23-8d6c4953de32/12961_White-Tailed_Deer_v1_l2.obj");
+		TRACED("LoadObjFile deer", LoadObjFile((char*)"./obj/White-TailedDeer_V1_L2.123c4f372813-f2b8-4711-8c23-8d6c4953de32/12961_White-Tailed_Deer_v1_l2.obj", &animalPositions));
 	glEndList();
+	BakeAnimal(SPECIES_DEER, animalPositions);
+	AnimalRadius[SPECIES_DEER] = GetAnimalRadius(animalPositions, 0.1f);
 
 	// Create bear display list
+	animalPositions.clear();
 	BearDL = glGenLists(1);
 	glNewList(BearDL, GL_COMPILE);
-		LoadObjFile((char*)"./obj/Tibetan_Blue_Bear_v1_L3.123c942e6fa9-d7c1-4f52-ac2a-5aa1f6bc9dce/13576_Tibetan_Bear_v1_l3.obj"); 
+		TRACED("LoadObjFile bear", LoadObjFile((char*)"./obj/Tibetan_Blue_Bear_v1_L3.123c942e6fa9-d7c1-4f52-ac2a-5aa1f6bc9dce/13576_Tibetan_Bear_v1_l3.obj", &animalPositions));
 	glEndList();
+	BakeAnimal(SPECIES_BEAR, animalPositions);
+	AnimalRadius[SPECIES_BEAR] = GetAnimalRadius(animalPositions, 0.1f);
 
 	// Create orange cat display list
+	animalPositions.clear();
 	OrangeCatDL = glGenLists(1);
 	glNewList(OrangeCatDL, GL_COMPILE);
-		LoadObjFile((char*)"./obj/Cat_v1_L3.123cb1b1943a-2f48-4e44-8f71-6bbe19a3ab64/12221_Cat_v1_l3.obj"); 
+		TRACED("LoadObjFile orange cat", LoadObjFile((char*)"./obj/Cat_v1_L3.123cb1b1943a-2f48-4e44-8f71-6bbe19a3ab64/12221_Cat_v1_l3.obj", &animalPositions));
 	glEndList();
+	BakeAnimal(SPECIES_ORANGE_CAT, animalPositions);
+	AnimalRadius[SPECIES_ORANGE_CAT] = GetAnimalRadius(animalPositions, 0.1f);
 
 	// Create black cat display list
+	animalPositions.clear();
 	BlackCatDL = glGenLists(1);
 	glNewList(BlackCatDL, GL_COMPILE);
-		LoadObjFile((char*)"./obj/Cat_v1_L3.123cc81ac858-7d2c-4c7e-bf80-81982996d26d/12222_Cat_v1_l3.obj"); 
+		TRACED("LoadObjFile black cat", LoadObjFile((char*)"./obj/Cat_v1_L3.123cc81ac858-7d2c-4c7e-bf80-81982996d26d/12222_Cat_v1_l3.obj", &animalPositions));
 	glEndList();
+	BakeAnimal(SPECIES_BLACK_CAT, animalPositions);
+	AnimalRadius[SPECIES_BLACK_CAT] = GetAnimalRadius(animalPositions, 0.1f);
 
 	// create the axes:
 	AxesList = glGenLists( 1 );
@@ -2163,11 +3384,57 @@ Keyboard( unsigned char c, int x, int y )
 		case 'f':
 		case 'F':
 			Frozen = ! Frozen;
-			if ( Frozen )
-				glutIdleFunc(NULL);
-			else
-				glutIdleFunc(Animate);
+			UpdateFramePacing();
+			break;
+		// Handle slowing down, speeding up, and restarting the animation
+		case ',':
+		case '<':
+			Clock.SetScale(Clock.GetScale() * 0.5);
+			break;
+		case '.':
+		case '>':
+			Clock.SetScale(Clock.GetScale() * 2.0);
+			break;
+		case '0':
+			RestartSimulation(0.);
+			break;
+		// Handle toggling the shadows
+		case 's':
+		case 'S':
+			ShadowsOn = ! ShadowsOn;
+			break;
+		// Handle toggling the fireflies and lanterns
+		case 'l':
+		case 'L':
+			LightsOn = ! LightsOn;
+			break;
+		// Handle toggling the depth pre-pass
+		case 'z':
+		case 'Z':
+			DepthPrePassOn = ! DepthPrePassOn;
+			break;
+		// Handle starting and stopping a frame capture
+		case 'c':
+		case 'C':
+			if (Capture.IsRunning())
+				StopCapture();
+			else {
+				if (CaptureTarget == NULL)
+					CaptureTarget = CAPTURE_OUTPUT;
+				StartCapture(0);
+			}
+			break;
+		// Handle toggling the performance HUD
+		case 'h':
+		case 'H':
+			SetHud(! HudOn);
+			break;
+		// Handle switching the animals between baked and procedural animation
+		case 'b':
+		case 'B':
+			BakedAnimationOn = ! BakedAnimationOn;
 			break;
+
 		case '+':  // For zooming in (keyboard + key)
 			Scale += SCLFACT * SCROLL_WHEEL_CLICK_FACTOR;
 			// Keep object from turning inside-out or disappearing:
@@ -2302,16 +3569,175 @@ Reset( )
 {
 	ActiveButton = 0;
 	AxesOn = 0;
+	BakedAnimationOn = 1;
 	DebugOn = 0;
 	DepthBufferOn = 1;
 	DepthFightingOn = 0;
+	DepthPrePassOn = 0;
 	DepthCueOn = 1;
 	Scale  = 1.0;
 	ShadowsOn = 0;
+	LightsOn = 0;
 	NowColor = YELLOW;
 	NowProjection = PERSP;
 	Xrot = Yrot = 0.;
 	Frozen = false;
+	Clock.SetScale(1.);
+	Pacer.SetTargetFPS(60.);
+	UpdateFramePacing();
+}
+
+
+// Time every pass of the next frames (a windowed or headless --bench run):
+// the simulation starts over once the animal shader is ready, one fixed step
+// per frame, drawn as fast as possible, and the timings are written at the end
+void
+StartBench( int frames )
+{
+	Pacer.SetTargetFPS( 0. );
+	Clock.SetFixedFrames( true );
+
+	SetupPassTimers( );
+
+	BenchFrames = frames;
+	BenchFrame = -1;
+}
+
+
+// Called at the end of every Display( ) of a benchmark run
+void
+BenchFrameDone( )
+{
+	if( BenchFrame < 0 )
+	{
+		// start timing once every frame will have its animals:
+		if( Animal.IsPending( ) )
+			return;
+		RestartSimulation( 0. );
+		Timers.SetKeepSamples( true );
+		Timers.SetEnabled( true );
+		GlStats::ResetTotals( );
+		BenchFrame = 0;
+		return;
+	}
+
+	BenchFrame++;
+	if( BenchFrame == BenchFrames  &&  Headless == 0 )
+	{
+		FinishBench( );
+		DoMainMenu( QUIT );
+	}
+}
+
+
+// Write the benchmark's timings to BenchOutput.json and BenchOutput.csv
+bool
+FinishBench( )
+{
+	Timers.Finish( );
+	Timers.SetKeepSamples( false );
+	Timers.SetEnabled( HudOn != 0 );
+
+	std::string json = std::string( BenchOutput ) + ".json";
+	std::string csv  = std::string( BenchOutput ) + ".csv";
+	std::string gl = "\"gl_per_frame\": " + GlStats::FormatTotalsJSON( );
+	if( ! Timers.WriteJSON( json.c_str( ), (const char *)glGetString( GL_RENDERER ), gl.c_str( ) )  ||  ! Timers.WriteCSV( csv.c_str( ) ) )
+		return false;
+
+	fprintf( stderr, "Wrote the timings of %d frames to %s and %s\n", BenchFrame, json.c_str( ), csv.c_str( ) );
+	return true;
+}
+
+
+// Draw a number of frames offscreen, exactly one simulation step apart, then quit:
+// this is how the forest gets rendered on machines with no display.
+// If output is not NULL, the last frame is saved to it as a ppm.
+// Returns 0 if everything drew without an OpenGL error, or one of the HEADLESS_ codes if not.
+int
+RunHeadless( int frames, int width, int height, const char *output )
+{
+	if( ! Offscreen.Create( width, height ) )
+		return HEADLESS_NO_CONTEXT;
+
+	InitGraphics( );
+	if( RecordOutput != NULL  &&  ! GlRecorder::IsRecording( ) )
+	{
+		Offscreen.Destroy( );
+		return HEADLESS_NO_OUTPUT;
+	}
+	InitLists( );
+	Reset( );
+
+	// every frame is one fixed step, drawn as fast as possible:
+
+	Pacer.SetTargetFPS( 0. );
+	Clock.SetFixedFrames( true );
+	RestartSimulation( 0. );
+	if( Bench != 0 )
+		StartBench( frames );
+	SetHud( HudOn );
+	if( MetricsPort >= 0  &&  ! Metrics.StartServer( MetricsPort ) )
+	{
+		Offscreen.Destroy( );
+		return HEADLESS_NO_OUTPUT;
+	}
+
+	// don't start until the animal shader is done, so every run draws the same frames:
+
+	while( Animal.IsPending( )  &&  ! AnimalShaderReady( ) )
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+	if( CaptureTarget != NULL  &&  ! StartCapture( frames ) )
+	{
+		Offscreen.Destroy( );
+		return HEADLESS_NO_OUTPUT;
+	}
+
+	// a benchmark draws its warm-up frames as well, so count what was really drawn:
+
+	int status = 0;
+	int errors = 0;
+	int drawn = 0;
+	for( int f = 0; Bench != 0 ? BenchFrame < BenchFrames : f < frames; f++, drawn++ )
+	{
+		Animate( );
+		Display( );
+
+		GLenum err;
+		while( ( err = glGetError( ) ) != GL_NO_ERROR )
+		{
+			if( errors++ < 10 )
+				fprintf( stderr, "OpenGL error 0x%X in frame %d\n", err, f );
+			status = HEADLESS_GL_ERRORS;
+		}
+	}
+	glFinish( );
+	fprintf( stderr, "Drew %d frames offscreen, %d OpenGL errors\n", drawn, errors );
+
+	if( Bench != 0  &&  ! FinishBench( ) )
+		status = HEADLESS_NO_OUTPUT;
+
+	if( Capture.IsRunning( )  &&  ! StopCapture( ) )
+		status = HEADLESS_NO_OUTPUT;
+
+	if( output != NULL  &&  ! Offscreen.WritePPM( output ) )
+		status = HEADLESS_NO_OUTPUT;
+
+	if( TraceOutput != NULL  &&  ! TRACE_WRITE( TraceOutput ) )
+		status = HEADLESS_NO_OUTPUT;
+
+	if( ! GlRecorder::Stop( ) )
+		status = HEADLESS_NO_OUTPUT;
+
+	if( MetricsCsv != NULL  &&  ! Metrics.WriteCSV( MetricsCsv ) )
+		status = HEADLESS_NO_OUTPUT;
+	Metrics.StopServer( );
+
+	if( DebugOn != 0 )
+		Pacer.PrintReport( stderr );
+
+	Offscreen.Destroy( );
+	return status;
 }
 
 
@@ -2336,17 +3762,16 @@ Visibility ( int state )
 	if( DebugOn != 0 )
 		fprintf( stderr, "Visibility: %d\n", state );
 
+	// stop animating and redrawing while the window cannot be seen:
+
+	WindowVisible = ( state == GLUT_VISIBLE );
+	UpdateFramePacing( );
+
 	if( state == GLUT_VISIBLE )
 	{
 		glutSetWindow( MainWindow );
 		glutPostRedisplay( );
 	}
-	else
-	{
-		// could optimize by keeping track of the fact
-		// that the window is not visible and avoid
-		// animating or redrawing it ...
-	}
 }
 
 
@@ -0,0 +1,465 @@
+#include "framecapture.h"
+#include "trace.h"
+
+#ifdef WIN32
+#define popen	_popen
+#define pclose	_pclose
+#else
+#include <signal.h>
+#endif
+
+
+FrameCapture::FrameCapture( )
+{
+	Init( );
+}
+
+
+// read the framebuffer (whatever glReadBuffer( ) says) into the ring,
+// and hand the oldest frame in the ring to the workers:
+
+void
+FrameCapture::CaptureFrame( int width, int height )
+{
+	if( ! Running  ||  width <= 0  ||  height <= 0 )
+		return;
+
+	if( width != Width  ||  height != Height )
+	{
+		// an encoder on the other end of a pipe was told one size, and can only take that one:
+		if( Format == CAPTURE_PIPE  &&  Width != 0 )
+		{
+			if( Skipped++ == 0 )
+				fprintf( stderr, "The window is now %dx%d, but the encoder is getting %dx%d frames, so these are not being captured\n",
+					width, height, Width, Height );
+			return;
+		}
+		Resize( width, height );
+	}
+
+	int slot = Frame % CAPTURE_PBOS;
+	if( PboFrame[slot] >= 0 )
+		Drain( slot );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, Pbos[slot] );
+	glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+	glReadPixels( 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, (void *)0 );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	PboFrame[slot] = Frame;
+	Frame++;
+}
+
+
+// map one buffer of the ring, copy its frame onto the queue, and let a worker have it:
+
+void
+FrameCapture::Drain( int slot )
+{
+	TRACE_SCOPE( "FrameCapture::Drain" );
+	struct CaptureJob job;
+	job.frame = PboFrame[slot];
+	job.width = Width;
+	job.height = Height;
+	job.rgba.resize( 4 * Width * Height );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, Pbos[slot] );
+	void *pixels = glMapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY );
+	if( pixels != NULL )
+	{
+		memcpy( &job.rgba[0], pixels, job.rgba.size( ) );
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	PboFrame[slot] = -1;
+
+	if( pixels == NULL )
+	{
+		fprintf( stderr, "Cannot map the pixel buffer of captured frame %d\n", job.frame );
+		std::lock_guard<std::mutex> lock( Lock );
+		Failed++;
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock( Lock );
+	if( (int)Queue.size( ) >= CAPTURE_MAX_QUEUED )
+	{
+		Stalls++;
+		Room.wait( lock, [this] { return (int)Queue.size( ) < CAPTURE_MAX_QUEUED; } );
+	}
+	Queue.push_back( std::move( job ) );
+	if( (int)Queue.size( ) > MostQueued )
+		MostQueued = (int)Queue.size( );
+	Available.notify_one( );
+}
+
+
+// read back the frames still in the ring, wait for the workers to write everything,
+// and stop -- returns false if any frame could not be captured:
+
+bool
+FrameCapture::Finish( )
+{
+	if( ! Running )
+		return true;
+
+	for( int k = 0; k < CAPTURE_PBOS; k++ )
+	{
+		int slot = ( Frame + k ) % CAPTURE_PBOS;
+		if( PboFrame[slot] >= 0 )
+			Drain( slot );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( Lock );
+		Quit = true;
+	}
+	Available.notify_all( );
+	for( int t = 0; t < (int)Workers.size( ); t++ )
+		Workers[t].join( );
+	Workers.clear( );
+
+	if( Pipe != NULL )
+	{
+		if( pclose( Pipe ) != 0 )
+		{
+			fprintf( stderr, "The capture command '%s' did not finish cleanly\n", Command.c_str( ) );
+			Failed++;
+		}
+		Pipe = NULL;
+	}
+
+	glDeleteBuffers( CAPTURE_PBOS, Pbos );
+	for( int k = 0; k < CAPTURE_PBOS; k++ )
+		Pbos[k] = 0;
+
+	fprintf( stderr, "Captured %d frames at %dx%d (%d could not be, the workers fell behind %d times, at most %d frames were queued)\n",
+		Written, Width, Height, Failed + Skipped, Stalls, MostQueued );
+
+	bool ok = Failed == 0  &&  Skipped == 0;
+	Init( );
+	return ok;
+}
+
+
+int
+FrameCapture::GetFrame( )
+{
+	return Frame;
+}
+
+
+void
+FrameCapture::Init( )
+{
+	Command.clear( );
+	Failed = 0;
+	Format = CAPTURE_PPM;
+	Frame = 0;
+	Height = 0;
+	MostQueued = 0;
+	Pipe = NULL;
+	for( int k = 0; k < CAPTURE_PBOS; k++ )
+	{
+		Pbos[k] = 0;
+		PboFrame[k] = -1;
+	}
+	Prefix.clear( );
+	Queue.clear( );
+	Quit = false;
+	Running = false;
+	Skipped = 0;
+	Stalls = 0;
+	Width = 0;
+	Workers.clear( );
+	Written = 0;
+}
+
+
+bool
+FrameCapture::IsRunning( )
+{
+	return Running;
+}
+
+
+// (re)size the pixel buffers -- anything still in them is handed off first:
+
+void
+FrameCapture::Resize( int width, int height )
+{
+	for( int k = 0; k < CAPTURE_PBOS; k++ )
+	{
+		int slot = ( Frame + k ) % CAPTURE_PBOS;
+		if( PboFrame[slot] >= 0 )
+			Drain( slot );
+	}
+
+	Width = width;
+	Height = height;
+	if( Pbos[0] == 0 )
+		glGenBuffers( CAPTURE_PBOS, Pbos );
+	for( int k = 0; k < CAPTURE_PBOS; k++ )
+	{
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, Pbos[k] );
+		glBufferData( GL_PIXEL_PACK_BUFFER, 4 * Width * Height, NULL, GL_STREAM_READ );
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+}
+
+
+// start capturing -- the format's file name prefix or, for CAPTURE_PIPE,
+// the command to write the raw frames to (it is told nothing about their size,
+// so the command line has to say it, e.g. "ffmpeg -f rawvideo -pix_fmt rgb24 -s 1920x1080 -r 60 -i - out.mp4"):
+
+bool
+FrameCapture::Start( int format, const char *target )
+{
+	if( Running )
+		Finish( );
+
+	if( format < 0  ||  format >= NUM_CAPTURE_FORMATS  ||  target == NULL  ||  *target == '\0' )
+	{
+		fprintf( stderr, "Don't know how to capture to format %d, '%s'\n", format, target != NULL ? target : "" );
+		return false;
+	}
+	Format = format;
+
+	// the frames must reach a pipe in order, so that gets one worker:
+
+	int numWorkers = 1;
+	if( Format == CAPTURE_PIPE )
+	{
+		Command = target;
+#ifndef WIN32
+		// if the command quits early, the write fails instead of killing the program:
+		signal( SIGPIPE, SIG_IGN );
+#endif
+		Pipe = popen( target, "w" );
+		if( Pipe == NULL )
+		{
+			fprintf( stderr, "Cannot run the capture command '%s'\n", target );
+			Init( );
+			return false;
+		}
+	}
+	else
+	{
+		Prefix = target;
+		numWorkers = (int)std::thread::hardware_concurrency( ) - 1;
+		if( numWorkers < 1 )
+			numWorkers = 1;
+		if( numWorkers > CAPTURE_MAX_WORKERS )
+			numWorkers = CAPTURE_MAX_WORKERS;
+	}
+
+	Quit = false;
+	for( int t = 0; t < numWorkers; t++ )
+		Workers.push_back( std::thread( &FrameCapture::Work, this ) );
+
+	Running = true;
+	return true;
+}
+
+
+// a worker thread: write frames off the queue until told to quit and the queue is empty
+
+void
+FrameCapture::Work( )
+{
+	TRACE_THREAD_NAME( "capture" );
+	for( ; ; )
+	{
+		struct CaptureJob job;
+		{
+			std::unique_lock<std::mutex> lock( Lock );
+			Available.wait( lock, [this] { return Quit  ||  ! Queue.empty( ); } );
+			if( Queue.empty( ) )
+				return;
+			job = std::move( Queue.front( ) );
+			Queue.pop_front( );
+		}
+		Room.notify_one( );
+
+		bool ok = WriteFrame( job );
+
+		std::lock_guard<std::mutex> lock( Lock );
+		if( ok )
+			Written++;
+		else
+			Failed++;
+	}
+}
+
+
+// turn one frame into RGB, top row first, and send it where it goes:
+
+bool
+FrameCapture::WriteFrame( struct CaptureJob &job )
+{
+	TRACE_SCOPE( "FrameCapture::WriteFrame" );
+	int w = job.width;
+	int h = job.height;
+	std::vector<unsigned char> rgb( 3 * w * h );
+	for( int y = 0; y < h; y++ )
+	{
+		const unsigned char *src = &job.rgba[ 4 * w * ( h - 1 - y ) ];
+		unsigned char *dst = &rgb[ 3 * w * y ];
+		for( int x = 0; x < w; x++, src += 4, dst += 3 )
+		{
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+	}
+
+	if( Format == CAPTURE_PIPE )
+		return fwrite( &rgb[0], 1, rgb.size( ), Pipe ) == rgb.size( );
+
+	char filename[1024];
+	snprintf( filename, sizeof( filename ), "%s_%05d.%s", Prefix.c_str( ), job.frame, Format == CAPTURE_PNG ? "png" : "ppm" );
+	if( Format == CAPTURE_PNG )
+		return WritePNG( filename, w, h, &rgb[0] );
+	return WritePPM( filename, w, h, &rgb[0] );
+}
+
+
+// the crc-32 the png chunks end with:
+
+static unsigned int
+CaptureCrc( unsigned int crc, const unsigned char *bytes, size_t n )
+{
+	static unsigned int table[256];
+	static std::once_flag once;
+	std::call_once( once, [ ] {
+		for( unsigned int i = 0; i < 256; i++ )
+		{
+			unsigned int c = i;
+			for( int k = 0; k < 8; k++ )
+				c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+			table[i] = c;
+		}
+	} );
+
+	crc = ~crc;
+	for( size_t i = 0; i < n; i++ )
+		crc = table[ ( crc ^ bytes[i] ) & 0xFF ] ^ ( crc >> 8 );
+	return ~crc;
+}
+
+
+// write one png chunk -- length, type, data, crc:
+
+static bool
+CaptureChunk( FILE *fp, const char *type, const unsigned char *data, size_t n )
+{
+	unsigned char header[8] =
+	{
+		(unsigned char)( n >> 24 ), (unsigned char)( n >> 16 ), (unsigned char)( n >> 8 ), (unsigned char)n,
+		(unsigned char)type[0], (unsigned char)type[1], (unsigned char)type[2], (unsigned char)type[3]
+	};
+	unsigned int crc = CaptureCrc( 0, &header[4], 4 );
+	if( n > 0 )
+		crc = CaptureCrc( crc, data, n );
+	unsigned char trailer[4] = { (unsigned char)( crc >> 24 ), (unsigned char)( crc >> 16 ), (unsigned char)( crc >> 8 ), (unsigned char)crc };
+
+	return fwrite( header, 1, 8, fp ) == 8
+		&&  ( n == 0  ||  fwrite( data, 1, n, fp ) == n )
+		&&  fwrite( trailer, 1, 4, fp ) == 4;
+}
+
+
+// an 8-bit RGB png, its zlib stream made of stored (uncompressed) deflate blocks:
+
+bool
+FrameCapture::WritePNG( const char *filename, int width, int height, const unsigned char *rgb )
+{
+	// every row starts with its filter type, 0 = none:
+
+	size_t rowBytes = 1 + 3 * (size_t)width;
+	std::vector<unsigned char> raw( rowBytes * height );
+	for( int y = 0; y < height; y++ )
+	{
+		raw[ rowBytes * y ] = 0;
+		memcpy( &raw[ rowBytes * y + 1 ], &rgb[ 3 * (size_t)width * y ], 3 * (size_t)width );
+	}
+
+	const size_t BLOCK = 65535;
+	size_t numBlocks = ( raw.size( ) + BLOCK - 1 ) / BLOCK;
+	std::vector<unsigned char> z;
+	z.reserve( 2 + raw.size( ) + 5 * numBlocks + 4 );
+	z.push_back( 0x78 );
+	z.push_back( 0x01 );
+	unsigned int a = 1, b = 0;
+	for( size_t start = 0; start < raw.size( ); start += BLOCK )
+	{
+		size_t n = raw.size( ) - start < BLOCK ? raw.size( ) - start : BLOCK;
+		bool last = start + n == raw.size( );
+		z.push_back( last ? 1 : 0 );
+		z.push_back( (unsigned char)( n & 0xFF ) );
+		z.push_back( (unsigned char)( n >> 8 ) );
+		z.push_back( (unsigned char)( ~n & 0xFF ) );
+		z.push_back( (unsigned char)( ( ~n >> 8 ) & 0xFF ) );
+		z.insert( z.end( ), raw.begin( ) + start, raw.begin( ) + start + n );
+
+		// adler-32, reduced often enough that b cannot overflow:
+		for( size_t i = start; i < start + n; i++ )
+		{
+			a += raw[i];
+			b += a;
+			if( ( i & 4095 ) == 4095 )
+			{
+				a %= 65521;
+				b %= 65521;
+			}
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	unsigned int adler = ( b << 16 ) | a;
+	z.push_back( (unsigned char)( adler >> 24 ) );
+	z.push_back( (unsigned char)( adler >> 16 ) );
+	z.push_back( (unsigned char)( adler >> 8 ) );
+	z.push_back( (unsigned char)adler );
+
+	FILE *fp = fopen( filename, "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open image file '%s'\n", filename );
+		return false;
+	}
+
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+	unsigned char ihdr[13] =
+	{
+		(unsigned char)( width >> 24 ),  (unsigned char)( width >> 16 ),  (unsigned char)( width >> 8 ),  (unsigned char)width,
+		(unsigned char)( height >> 24 ), (unsigned char)( height >> 16 ), (unsigned char)( height >> 8 ), (unsigned char)height,
+		8, 2, 0, 0, 0		// 8 bits, RGB, deflate, adaptive filtering, not interlaced
+	};
+	bool ok = fwrite( signature, 1, 8, fp ) == 8
+		&&  CaptureChunk( fp, "IHDR", ihdr, sizeof( ihdr ) )
+		&&  CaptureChunk( fp, "IDAT", &z[0], z.size( ) )
+		&&  CaptureChunk( fp, "IEND", NULL, 0 );
+	fclose( fp );
+	if( ! ok )
+		fprintf( stderr, "Cannot write image file '%s'\n", filename );
+	return ok;
+}
+
+
+bool
+FrameCapture::WritePPM( const char *filename, int width, int height, const unsigned char *rgb )
+{
+	FILE *fp = fopen( filename, "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open image file '%s'\n", filename );
+		return false;
+	}
+	fprintf( fp, "P6\n%d %d\n255\n", width, height );
+	size_t n = 3 * (size_t)width * height;
+	bool ok = fwrite( rgb, 1, n, fp ) == n;
+	fclose( fp );
+	if( ! ok )
+		fprintf( stderr, "Cannot write image file '%s'\n", filename );
+	return ok;
+}
@@ -0,0 +1,108 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// how many pixel buffers are in the ring -- a frame is mapped and handed to
+// the workers this many frames after its glReadPixels( ) was issued:
+#define CAPTURE_PBOS		3
+
+// how many frames can wait for a worker before CaptureFrame( ) has to wait too:
+#define CAPTURE_MAX_QUEUED	8
+
+// the most encoding threads:
+#define CAPTURE_MAX_WORKERS	8
+
+
+// where the captured frames go:
+enum CaptureFormats
+{
+	CAPTURE_PPM,			// prefix_00000.ppm, ...
+	CAPTURE_PNG,			// prefix_00000.png, ...
+	CAPTURE_PIPE,			// raw RGB frames, top row first, into a command's stdin
+	NUM_CAPTURE_FORMATS
+};
+
+
+// one frame on its way to a worker -- RGBA, bottom row first, as OpenGL reads it:
+struct CaptureJob
+{
+	int	frame;
+	int	width, height;
+	std::vector<unsigned char>	rgba;
+};
+
+
+// Capture every drawn frame to an image sequence, or to an external encoder,
+// without stalling the pipeline on the readback.
+//
+// CaptureFrame( ) only starts a glReadPixels( ) into the next pixel buffer object
+// of a ring; the frame in that buffer from CAPTURE_PBOS frames ago, which the GPU has
+// long since finished, is mapped and copied out at the same time. The copies go
+// onto a queue that a pool of worker threads turn into .ppm or .png files (the PNGs
+// are stored without compression, so they cost no more to write than a .ppm), or
+// that one worker writes, in order, into a pipe to a command such as ffmpeg.
+// If the workers fall CAPTURE_MAX_QUEUED frames behind, CaptureFrame( ) waits
+// for them rather than dropping frames.
+
+class FrameCapture
+{
+private:
+	std::condition_variable	Available;	// a job was queued, or the workers should stop
+	std::string	Command;
+	int	Failed;
+	int	Format;
+	int	Frame;				// frames read into the ring so far
+	int	Height;
+	std::mutex	Lock;
+	int	MostQueued;
+	FILE *	Pipe;
+	GLuint	Pbos[CAPTURE_PBOS];
+	int	PboFrame[CAPTURE_PBOS];		// the frame in each buffer, or -1
+	std::string	Prefix;
+	std::deque<struct CaptureJob>	Queue;
+	bool	Quit;
+	std::condition_variable	Room;		// a job was taken off the queue
+	bool	Running;
+	int	Skipped;			// frames of the wrong size for the pipe
+	int	Stalls;				// times CaptureFrame( ) waited for the workers
+	int	Width;
+	std::vector<std::thread>	Workers;
+	int	Written;
+
+	void	Drain( int );
+	void	Resize( int, int );
+	void	Work( );
+	bool	WriteFrame( struct CaptureJob & );
+	static bool	WritePNG( const char *, int, int, const unsigned char * );
+	static bool	WritePPM( const char *, int, int, const unsigned char * );
+
+public:
+	FrameCapture( );
+
+	void	CaptureFrame( int, int );
+	bool	Finish( );
+	int	GetFrame( );
+	void	Init( );
+	bool	IsRunning( );
+	bool	Start( int, const char * );
+};
+
+#endif	// FRAMECAPTURE_H
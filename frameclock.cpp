@@ -0,0 +1,157 @@
+#include "frameclock.h"
+
+
+FrameClock::FrameClock( )
+{
+	Init( );
+}
+
+
+// how far between the last two simulation steps the frame being drawn is, in [0,1):
+
+double
+FrameClock::GetAlpha( )
+{
+	return Accumulator / StepSize;
+}
+
+
+// the time the frame being drawn shows:
+// one step behind the simulation, since it is blended from the last two steps
+
+double
+FrameClock::GetRenderTime( )
+{
+	return SimTime - StepSize + Accumulator;
+}
+
+
+double
+FrameClock::GetScale( )
+{
+	return Scale;
+}
+
+
+double
+FrameClock::GetStepSize( )
+{
+	return StepSize;
+}
+
+
+int
+FrameClock::GetSteps( )
+{
+	return Steps;
+}
+
+
+double
+FrameClock::GetTime( )
+{
+	return SimTime;
+}
+
+
+void
+FrameClock::Init( double stepSize )
+{
+	Accumulator = 0.;
+	FixedFrames = false;
+	LastTick = std::chrono::steady_clock::now( );
+	Paused = false;
+	Scale = 1.;
+	SimTime = 0.;
+	StepSize = stepSize > 0. ? stepSize : FRAMECLOCK_STEP;
+	Steps = 0;
+}
+
+
+bool
+FrameClock::IsPaused( )
+{
+	return Paused;
+}
+
+
+// a paused clock keeps its place -- the real time that goes by while it is paused
+// is never handed to the simulation, so resuming does not jump ahead
+
+void
+FrameClock::Pause( bool paused )
+{
+	if( Paused  &&  ! paused )
+		LastTick = std::chrono::steady_clock::now( );
+	Paused = paused;
+}
+
+
+// jump the simulation to a time, with nothing banked:
+// the caller needs to re-sample its simulation state, since there is no previous step to blend from
+
+void
+FrameClock::Seek( double simTime )
+{
+	SimTime = simTime;
+	Accumulator = 0.;
+	LastTick = std::chrono::steady_clock::now( );
+}
+
+
+void
+FrameClock::SetFixedFrames( bool fixed )
+{
+	FixedFrames = fixed;
+}
+
+
+// how fast simulation time runs compared to real time (1. = real time):
+
+void
+FrameClock::SetScale( double scale )
+{
+	if( scale < 0. )
+		scale = 0.;
+	Scale = scale;
+}
+
+
+// take one simulation step if a whole step's worth of time has been banked:
+
+bool
+FrameClock::Step( )
+{
+	if( Accumulator < StepSize )
+		return false;
+
+	Accumulator -= StepSize;
+	SimTime += StepSize;
+	Steps++;
+	return true;
+}
+
+
+// read the wall clock and bank the time since the last Tick( ):
+
+void
+FrameClock::Tick( )
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	double real = std::chrono::duration<double>( now - LastTick ).count( );
+	LastTick = now;
+	Steps = 0;
+
+	if( Paused )
+		return;
+
+	if( FixedFrames )
+	{
+		Accumulator += StepSize;
+		return;
+	}
+
+	if( real > FRAMECLOCK_MAX_FRAME )
+		real = FRAMECLOCK_MAX_FRAME;
+	Accumulator += real * Scale;
+}
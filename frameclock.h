@@ -0,0 +1,66 @@
+#ifndef FRAMECLOCK_H
+#define FRAMECLOCK_H
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+
+// default simulation step, in seconds:
+#define FRAMECLOCK_STEP			( 1. / 60. )
+
+// the most real time one Tick( ) will hand to the simulation, in seconds
+// (after a stall -- a breakpoint, the window being dragged -- the simulation
+// skips ahead instead of running hundreds of steps to catch up):
+#define FRAMECLOCK_MAX_FRAME		0.25
+
+
+// The one clock the program animates from.
+//
+// Real time is read from std::chrono::steady_clock once per frame by Tick( ),
+// scaled, and banked. Step( ) then pays the bank out in fixed-size simulation
+// steps, so the simulation sees the same sequence of times no matter how fast or
+// unevenly frames are drawn:
+//
+//	Clock.Tick( );
+//	while( Clock.Step( ) )
+//		Update( Clock.GetTime( ) );
+//	Render( blend of the last two updates by Clock.GetAlpha( ) );
+//
+// Whatever is left in the bank (less than one step) is the alpha to interpolate
+// the last two simulation states by.
+// With SetFixedFrames( true ), every Tick( ) is worth exactly one step, whatever
+// the wall clock says, so a run renders the same frames every time.
+
+class FrameClock
+{
+private:
+	double	Accumulator;		// real time banked but not yet simulated, in seconds
+	bool	FixedFrames;
+	std::chrono::steady_clock::time_point	LastTick;
+	bool	Paused;
+	double	Scale;
+	double	SimTime;		// time of the latest simulation step, in seconds
+	double	StepSize;
+	int	Steps;			// steps taken since the last Tick( )
+
+public:
+	FrameClock( );
+
+	double	GetAlpha( );
+	double	GetRenderTime( );
+	double	GetScale( );
+	double	GetStepSize( );
+	int	GetSteps( );
+	double	GetTime( );
+	void	Init( double = FRAMECLOCK_STEP );
+	bool	IsPaused( );
+	void	Pause( bool );
+	void	Seek( double );
+	void	SetFixedFrames( bool );
+	void	SetScale( double );
+	bool	Step( );
+	void	Tick( );
+};
+
+#endif	// FRAMECLOCK_H
@@ -0,0 +1,139 @@
+#include "framehistogram.h"
+
+
+FrameHistogram::FrameHistogram( )
+{
+	Counts.resize( FRAMEHISTOGRAM_BUCKETS );
+	Clear( );
+}
+
+
+// add in everything that other has recorded:
+
+void
+FrameHistogram::Add( const FrameHistogram &other )
+{
+	if( other.Count == 0 )
+		return;
+
+	for( int b = 0; b < FRAMEHISTOGRAM_BUCKETS; b++ )
+		Counts[b] += other.Counts[b];
+	Count += other.Count;
+	Sum += other.Sum;
+	if( other.Max > Max )
+		Max = other.Max;
+}
+
+
+// which bucket a time of us microseconds goes in:
+// below FRAMEHISTOGRAM_SUB_BUCKETS, its own; after that, its top FRAMEHISTOGRAM_SUB_BITS bits decide
+
+int
+FrameHistogram::Bucket( long long us )
+{
+	if( us < 0 )
+		us = 0;
+	if( us >= ( 1LL << FRAMEHISTOGRAM_TOP_BIT ) )
+		us = ( 1LL << FRAMEHISTOGRAM_TOP_BIT ) - 1;
+	if( us < FRAMEHISTOGRAM_SUB_BUCKETS )
+		return (int)us;
+
+	int shift = 1;
+	while( ( us >> shift ) >= FRAMEHISTOGRAM_SUB_BUCKETS )
+		shift++;
+	const int half = FRAMEHISTOGRAM_SUB_BUCKETS / 2;
+	return FRAMEHISTOGRAM_SUB_BUCKETS + ( shift - 1 ) * half + (int)( ( us >> shift ) - half );
+}
+
+
+void
+FrameHistogram::Clear( )
+{
+	memset( &Counts[0], 0, Counts.size( ) * sizeof( Counts[0] ) );
+	Count = 0;
+	Max = 0;
+	Sum = 0.;
+}
+
+
+long long
+FrameHistogram::GetCount( ) const
+{
+	return Count;
+}
+
+
+// in milliseconds, as are the rest:
+
+double
+FrameHistogram::GetMax( ) const
+{
+	return (double)Max / 1000.;
+}
+
+
+double
+FrameHistogram::GetMean( ) const
+{
+	return Count > 0 ? Sum / (double)Count : 0.;
+}
+
+
+// the time that fraction (0.-1.) of the frames took no longer than --
+// the top of the bucket it falls in, so it never comes out shorter than it was:
+
+double
+FrameHistogram::GetPercentile( double fraction ) const
+{
+	if( Count == 0 )
+		return 0.;
+
+	long long rank = (long long)( fraction * (double)Count + 0.999999 );
+	if( rank < 1 )
+		rank = 1;
+	long long seen = 0;
+	for( int b = 0; b < FRAMEHISTOGRAM_BUCKETS; b++ )
+	{
+		seen += Counts[b];
+		if( seen >= rank )
+		{
+			long long us = HighestValue( b );
+			return (double)( us < Max ? us : Max ) / 1000.;
+		}
+	}
+	return GetMax( );
+}
+
+
+double
+FrameHistogram::GetSum( ) const
+{
+	return Sum;
+}
+
+
+// the longest time, in microseconds, that goes in bucket b:
+
+long long
+FrameHistogram::HighestValue( int b )
+{
+	if( b < FRAMEHISTOGRAM_SUB_BUCKETS )
+		return b;
+
+	const int half = FRAMEHISTOGRAM_SUB_BUCKETS / 2;
+	int shift = ( b - FRAMEHISTOGRAM_SUB_BUCKETS ) / half + 1;
+	long long top = ( b - FRAMEHISTOGRAM_SUB_BUCKETS ) % half + half;
+	return ( ( top + 1 ) << shift ) - 1;
+}
+
+
+void
+FrameHistogram::Record( double ms )
+{
+	long long us = (long long)( ms * 1000. + 0.5 );
+	Counts[ Bucket( us ) ]++;
+	Count++;
+	Sum += ms;
+	if( us > Max )
+		Max = us;
+}
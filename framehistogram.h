@@ -0,0 +1,48 @@
+#ifndef FRAMEHISTOGRAM_H
+#define FRAMEHISTOGRAM_H
+
+#include <string.h>
+#include <vector>
+
+
+// the first FRAMEHISTOGRAM_SUB_BUCKETS microseconds each get a bucket of their own, and each
+// doubling after that is split into half as many buckets -- so every bucket is within 1/64
+// (about 1.6%) of what it holds, up to 2^FRAMEHISTOGRAM_TOP_BIT microseconds (about 70 minutes):
+#define FRAMEHISTOGRAM_SUB_BITS		7
+#define FRAMEHISTOGRAM_SUB_BUCKETS	( 1 << FRAMEHISTOGRAM_SUB_BITS )
+#define FRAMEHISTOGRAM_TOP_BIT		32
+#define FRAMEHISTOGRAM_BUCKETS		( FRAMEHISTOGRAM_SUB_BUCKETS + ( FRAMEHISTOGRAM_TOP_BIT - FRAMEHISTOGRAM_SUB_BITS ) * FRAMEHISTOGRAM_SUB_BUCKETS / 2 )
+
+
+// A histogram of frame times, in the manner of an HDR histogram.
+//
+// Each Record( ) adds one to a bucket: the buckets are log-linear, so a time of any size is
+// kept to within the same small fraction of itself, recording takes no allocation and no
+// sorting, and two histograms add up bucket by bucket (which is how FrameMetrics builds its
+// sliding windows out of one-second histograms). The longest time is also kept exactly.
+
+class FrameHistogram
+{
+private:
+	long long	Count;
+	std::vector<unsigned int>	Counts;
+	long long	Max;			// microseconds
+	double	Sum;
+
+	static int	Bucket( long long );
+	static long long	HighestValue( int );
+
+public:
+	FrameHistogram( );
+
+	void	Add( const FrameHistogram & );
+	void	Clear( );
+	long long	GetCount( ) const;
+	double	GetMax( ) const;
+	double	GetMean( ) const;
+	double	GetPercentile( double ) const;
+	double	GetSum( ) const;
+	void	Record( double );
+};
+
+#endif	// FRAMEHISTOGRAM_H
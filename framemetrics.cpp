@@ -0,0 +1,502 @@
+#include "framemetrics.h"
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+static const int FrameMetricWindows[NUM_FRAMEMETRICS_WINDOWS] = FRAMEMETRICS_WINDOWS;
+
+
+FrameMetrics::FrameMetrics( )
+{
+	ServerSocket = -1;
+	Serving = false;
+	Init( );
+}
+
+
+FrameMetrics::~FrameMetrics( )
+{
+	StopServer( );
+}
+
+
+// start a frame: read back the gpu time of the frame that last used this ring slot
+
+void
+FrameMetrics::BeginFrame( )
+{
+	if( ! Enabled )
+		return;
+
+	int slot = Frame % FRAMEMETRICS_GPU_FRAMES;
+	CollectGpu( slot );
+#ifndef __APPLE__
+	if( GpuTiming )
+		glQueryCounter( GpuBegin[slot], GL_TIMESTAMP );
+#endif
+	CpuStart = std::chrono::steady_clock::now( );
+	InFrame = true;
+}
+
+
+// turn one ring slot's queries into a gpu time
+// (if they are not done yet, the time is thrown away instead)
+
+void
+FrameMetrics::CollectGpu( int slot )
+{
+	if( ! GpuPending[slot] )
+		return;
+	GpuPending[slot] = false;
+
+#ifndef __APPLE__
+	GLint available = 0;
+	glGetQueryObjectiv( GpuEnd[slot], GL_QUERY_RESULT_AVAILABLE, &available );
+	if( ! available )
+	{
+		std::lock_guard<std::mutex> lock( Lock );
+		GpuDropped++;
+		return;
+	}
+
+	GLuint64 t0 = 0, t1 = 0;
+	glGetQueryObjectui64v( GpuBegin[slot], GL_QUERY_RESULT, &t0 );
+	glGetQueryObjectui64v( GpuEnd[slot],   GL_QUERY_RESULT, &t1 );
+	Record( FRAMEMETRIC_GPU, t1 > t0 ? (double)( t1 - t0 ) * 1.e-6 : 0., std::chrono::steady_clock::now( ) );
+#endif
+}
+
+
+// see if the gpu can be timed, and make its queries (needs the OpenGL context):
+
+void
+FrameMetrics::Create( )
+{
+	GpuTiming = false;
+#ifndef __APPLE__
+	const char *extensions = (const char *)glGetString( GL_EXTENSIONS );
+	GpuTiming = extensions != NULL  &&  strstr( extensions, "GL_ARB_timer_query" ) != NULL
+		&&  glQueryCounter != NULL  &&  glGetQueryObjectui64v != NULL;
+	if( GpuTiming )
+	{
+		glGenQueries( FRAMEMETRICS_GPU_FRAMES, GpuBegin );
+		glGenQueries( FRAMEMETRICS_GPU_FRAMES, GpuEnd );
+	}
+#endif
+}
+
+
+// the drawing is done -- the frame's cpu time, and the end of its gpu time:
+
+void
+FrameMetrics::EndFrame( )
+{
+	if( ! Enabled  ||  ! InFrame )
+		return;
+
+	int slot = Frame % FRAMEMETRICS_GPU_FRAMES;
+#ifndef __APPLE__
+	if( GpuTiming )
+	{
+		glQueryCounter( GpuEnd[slot], GL_TIMESTAMP );
+		GpuPending[slot] = true;
+	}
+#endif
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	Record( FRAMEMETRIC_CPU, std::chrono::duration<double, std::milli>( now - CpuStart ).count( ), now );
+	InFrame = false;
+	Frame++;
+}
+
+
+// every timer over every window, in the Prometheus text exposition format:
+
+std::string
+FrameMetrics::FormatPrometheus( )
+{
+	std::string text;
+	char line[256];
+	std::lock_guard<std::mutex> lock( Lock );
+	FrameHistogram h;
+
+	text += "# HELP forest_frame_time_seconds How long frames took over the last window seconds -- the last window whole seconds "
+		"plus the one under way, so between window and window+1 seconds -- or since the start: "
+		"cpu is the drawing thread, gpu is the GPU, present is from one frame being presented to the next.\n";
+	text += "# TYPE forest_frame_time_seconds summary\n";
+	std::string maxes = "# HELP forest_frame_time_max_seconds The longest frame in the window.\n"
+		"# TYPE forest_frame_time_max_seconds gauge\n";
+
+	const double quantiles[3] = { 0.5, 0.9, 0.99 };
+	for( int t = 0; t < NUM_FRAMEMETRICS; t++ )
+	{
+		if( t == FRAMEMETRIC_GPU  &&  ! GpuTiming )
+			continue;
+
+		for( int w = 0; w < NUM_FRAMEMETRICS_WINDOWS; w++ )
+		{
+			GetWindowLocked( t, FrameMetricWindows[w], &h );
+			char labels[64];
+			if( FrameMetricWindows[w] > 0 )
+				snprintf( labels, sizeof( labels ), "timer=\"%s\",window=\"%ds\"", GetTimerName( t ), FrameMetricWindows[w] );
+			else
+				snprintf( labels, sizeof( labels ), "timer=\"%s\",window=\"all\"", GetTimerName( t ) );
+
+			for( int q = 0; q < 3; q++ )
+			{
+				snprintf( line, sizeof( line ), "forest_frame_time_seconds{%s,quantile=\"%g\"} %.6f\n",
+					labels, quantiles[q], h.GetPercentile( quantiles[q] ) / 1000. );
+				text += line;
+			}
+			snprintf( line, sizeof( line ), "forest_frame_time_seconds_sum{%s} %.6f\n", labels, h.GetSum( ) / 1000. );
+			text += line;
+			snprintf( line, sizeof( line ), "forest_frame_time_seconds_count{%s} %lld\n", labels, h.GetCount( ) );
+			text += line;
+			snprintf( line, sizeof( line ), "forest_frame_time_max_seconds{%s} %.6f\n", labels, h.GetMax( ) / 1000. );
+			maxes += line;
+		}
+	}
+	text += maxes;
+
+	if( GpuTiming )
+	{
+		snprintf( line, sizeof( line ), "# HELP forest_gpu_frames_dropped_total Frames whose GPU time was not ready in time, so was not counted.\n"
+			"# TYPE forest_gpu_frames_dropped_total counter\nforest_gpu_frames_dropped_total %d\n", GpuDropped );
+		text += line;
+	}
+	return text;
+}
+
+
+// the port the server is listening on, or -1 if it is not:
+
+int
+FrameMetrics::GetPort( )
+{
+	return Serving ? Port : -1;
+}
+
+
+const char *
+FrameMetrics::GetTimerName( int timer )
+{
+	static const char *names[NUM_FRAMEMETRICS] = { "cpu", "gpu", "present" };
+	return timer >= 0  &&  timer < NUM_FRAMEMETRICS ? names[timer] : "";
+}
+
+
+// one timer over the last seconds seconds (0 = since the start), in milliseconds --
+// returns false if it has no frames in that time:
+
+bool
+FrameMetrics::GetWindow( int timer, int seconds, long long *count, double *mean, double *p50, double *p90, double *p99, double *max )
+{
+	*count = 0;
+	*mean = *p50 = *p90 = *p99 = *max = 0.;
+	if( timer < 0  ||  timer >= NUM_FRAMEMETRICS )
+		return false;
+
+	FrameHistogram h;
+	{
+		std::lock_guard<std::mutex> lock( Lock );
+		GetWindowLocked( timer, seconds, &h );
+	}
+	if( h.GetCount( ) == 0 )
+		return false;
+
+	*count = h.GetCount( );
+	*mean = h.GetMean( );
+	*p50 = h.GetPercentile( 0.50 );
+	*p90 = h.GetPercentile( 0.90 );
+	*p99 = h.GetPercentile( 0.99 );
+	*max = h.GetMax( );
+	return true;
+}
+
+
+// add up the last seconds whole one-second histograms, and the one still filling up (with Lock held):
+
+void
+FrameMetrics::GetWindowLocked( int timer, int seconds, FrameHistogram *h )
+{
+	struct FrameMetricSeries &series = Series[timer];
+	h->Clear( );
+	if( seconds <= 0 )
+	{
+		h->Add( series.all );
+		return;
+	}
+
+	long long now = std::chrono::duration_cast<std::chrono::seconds>( std::chrono::steady_clock::now( ) - Start ).count( );
+	for( int s = 0; s < FRAMEMETRICS_SECONDS; s++ )
+	{
+		if( series.second[s] >= 0  &&  now - series.second[s] <= seconds )
+			h->Add( series.seconds[s] );
+	}
+}
+
+
+void
+FrameMetrics::Init( )
+{
+	Enabled = false;
+	Frame = 0;
+	GpuDropped = 0;
+	GpuTiming = false;
+	HavePresent = false;
+	InFrame = false;
+	Port = -1;
+	Start = std::chrono::steady_clock::now( );
+	for( int i = 0; i < FRAMEMETRICS_GPU_FRAMES; i++ )
+	{
+		GpuBegin[i] = GpuEnd[i] = 0;
+		GpuPending[i] = false;
+	}
+	for( int t = 0; t < NUM_FRAMEMETRICS; t++ )
+	{
+		Series[t].all.Clear( );
+		for( int s = 0; s < FRAMEMETRICS_SECONDS; s++ )
+		{
+			Series[t].seconds[s].Clear( );
+			Series[t].second[s] = -1;
+		}
+	}
+}
+
+
+bool
+FrameMetrics::IsEnabled( )
+{
+	return Enabled;
+}
+
+
+// a frame has been presented (swapped, or flushed if there is no window):
+
+void
+FrameMetrics::Presented( )
+{
+	if( ! Enabled )
+		return;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	if( HavePresent )
+		Record( FRAMEMETRIC_PRESENT, std::chrono::duration<double, std::milli>( now - LastPresent ).count( ), now );
+	LastPresent = now;
+	HavePresent = true;
+}
+
+
+// add one time, in milliseconds, to a timer's histograms -- now says which second it goes in:
+
+void
+FrameMetrics::Record( int timer, double ms, std::chrono::steady_clock::time_point now )
+{
+	long long second = std::chrono::duration_cast<std::chrono::seconds>( now - Start ).count( );
+	int s = (int)( second % FRAMEMETRICS_SECONDS );
+
+	std::lock_guard<std::mutex> lock( Lock );
+	struct FrameMetricSeries &series = Series[timer];
+	if( series.second[s] != second )
+	{
+		series.seconds[s].Clear( );
+		series.second[s] = second;
+	}
+	series.seconds[s].Record( ms );
+	series.all.Record( ms );
+}
+
+
+// the server thread: one request at a time, each answered and closed
+
+void
+FrameMetrics::Serve( )
+{
+#ifndef WIN32
+	while( Serving )
+	{
+		struct pollfd p;
+		p.fd = ServerSocket;
+		p.events = POLLIN;
+		p.revents = 0;
+		if( poll( &p, 1, FRAMEMETRICS_POLL_MS ) <= 0 )
+			continue;
+
+		int client = accept( ServerSocket, NULL, NULL );
+		if( client < 0 )
+			continue;
+
+		// a scraper that connects and says nothing doesn't get to hold the server up:
+		struct timeval timeout;
+		timeout.tv_sec = 1;
+		timeout.tv_usec = 0;
+		setsockopt( client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+
+		// only the request line matters, and it comes first:
+		char request[2048];
+		int length = 0;
+		while( length < (int)sizeof( request ) - 1 )
+		{
+			ssize_t n = recv( client, request + length, sizeof( request ) - 1 - length, 0 );
+			if( n <= 0 )
+				break;
+			length += (int)n;
+			request[length] = '\0';
+			if( strstr( request, "\r\n" ) != NULL )
+				break;
+		}
+		request[length] = '\0';
+
+		std::string body, status;
+		if( strncmp( request, "GET /metrics ", 13 ) == 0  ||  strncmp( request, "GET /metrics?", 13 ) == 0 )
+		{
+			status = "200 OK";
+			body = FormatPrometheus( );
+		}
+		else
+		{
+			status = "404 Not Found";
+			body = "The frame-time metrics are at /metrics\n";
+		}
+
+		char header[256];
+		snprintf( header, sizeof( header ), "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			"Content-Length: %d\r\nConnection: close\r\n\r\n", status.c_str( ), (int)body.size( ) );
+		std::string response = header + body;
+		size_t sent = 0;
+		while( sent < response.size( ) )
+		{
+			ssize_t n = send( client, response.data( ) + sent, response.size( ) - sent, 0 );
+			if( n <= 0 )
+				break;
+			sent += (size_t)n;
+		}
+		close( client );
+	}
+#endif
+}
+
+
+// start timing frames (the server, if there is one, keeps serving either way):
+
+void
+FrameMetrics::SetEnabled( bool enabled )
+{
+	if( enabled == Enabled )
+		return;
+
+	if( enabled  &&  ! GpuTiming )
+		fprintf( stderr, "GL_ARB_timer_query is not available, so the frame-time metrics will have no GPU times\n" );
+	Enabled = enabled;
+	HavePresent = false;
+	InFrame = false;
+}
+
+
+// serve the metrics at http://127.0.0.1:port/metrics (0 = any free port):
+
+bool
+FrameMetrics::StartServer( int port )
+{
+#ifdef WIN32
+	fprintf( stderr, "The frame-time metrics cannot be served on Windows -- use the CSV instead\n" );
+	return false;
+#else
+	if( Serving )
+		return true;
+
+	// if a scraper hangs up early, the send fails instead of killing the program:
+	signal( SIGPIPE, SIG_IGN );
+
+	int s = socket( AF_INET, SOCK_STREAM, 0 );
+	if( s < 0 )
+	{
+		fprintf( stderr, "Cannot make a socket to serve the frame-time metrics on\n" );
+		return false;
+	}
+	int on = 1;
+	setsockopt( s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+
+	// only this machine can reach it:
+	struct sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	address.sin_port = htons( (unsigned short)port );
+	socklen_t size = sizeof( address );
+	if( bind( s, (struct sockaddr *)&address, sizeof( address ) ) != 0  ||  listen( s, 8 ) != 0
+		||  getsockname( s, (struct sockaddr *)&address, &size ) != 0 )
+	{
+		fprintf( stderr, "Cannot serve the frame-time metrics on port %d\n", port );
+		close( s );
+		return false;
+	}
+
+	ServerSocket = s;
+	Port = ntohs( address.sin_port );
+	Serving = true;
+	Server = std::thread( &FrameMetrics::Serve, this );
+	fprintf( stderr, "Serving the frame-time metrics at http://127.0.0.1:%d/metrics\n", Port );
+	return true;
+#endif
+}
+
+
+void
+FrameMetrics::StopServer( )
+{
+	if( ! Serving )
+		return;
+
+	Serving = false;
+	if( Server.joinable( ) )
+		Server.join( );
+#ifndef WIN32
+	close( ServerSocket );
+#endif
+	ServerSocket = -1;
+	Port = -1;
+}
+
+
+// every timer over every window, one to a line:
+
+bool
+FrameMetrics::WriteCSV( const char *filename )
+{
+	FILE *fp = fopen( filename, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open '%s' to write the frame-time metrics\n", filename );
+		return false;
+	}
+
+	fprintf( fp, "timer,window,frames,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n" );
+	for( int t = 0; t < NUM_FRAMEMETRICS; t++ )
+	{
+		for( int w = 0; w < NUM_FRAMEMETRICS_WINDOWS; w++ )
+		{
+			long long count;
+			double mean, p50, p90, p99, max;
+			if( ! GetWindow( t, FrameMetricWindows[w], &count, &mean, &p50, &p90, &p99, &max ) )
+				continue;
+
+			char window[16];
+			if( FrameMetricWindows[w] > 0 )
+				snprintf( window, sizeof( window ), "%ds", FrameMetricWindows[w] );
+			else
+				strcpy( window, "all" );
+			fprintf( fp, "%s,%s,%lld,%.4f,%.4f,%.4f,%.4f,%.4f\n", GetTimerName( t ), window, count, mean, p50, p90, p99, max );
+		}
+	}
+
+	fclose( fp );
+	return true;
+}
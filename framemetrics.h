@@ -0,0 +1,125 @@
+#ifndef FRAMEMETRICS_H
+#define FRAMEMETRICS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+#include "framehistogram.h"
+
+
+// the windows are made of one-second histograms, this many of them --
+// the longest window, plus the second that is still filling up:
+#define FRAMEMETRICS_SECONDS		61
+
+// how many frames of gpu queries can be in flight before their results are read:
+#define FRAMEMETRICS_GPU_FRAMES		4
+
+// how long the server waits for something to happen before it looks to see if it should stop, in ms:
+#define FRAMEMETRICS_POLL_MS		100
+
+
+// what is timed:
+enum FrameMetricTimers
+{
+	FRAMEMETRIC_CPU,		// the drawing thread, from the start of Display( ) to the end of the drawing
+	FRAMEMETRIC_GPU,		// the GPU, over the same stretch (GL_TIMESTAMP queries)
+	FRAMEMETRIC_PRESENT,		// from one frame being presented to the next
+	NUM_FRAMEMETRICS
+};
+
+
+// the windows the metrics are reported over, in seconds -- 0 is since the start
+// (a window of n seconds is the last n whole seconds plus the one under way, so n to n+1 seconds):
+#define FRAMEMETRICS_WINDOWS		{ 1, 10, 60, 0 }
+#define NUM_FRAMEMETRICS_WINDOWS	4
+
+
+// one timer's histograms -- one for all time, and one for each of the last seconds:
+struct FrameMetricSeries
+{
+	FrameHistogram	all;
+	FrameHistogram	seconds[FRAMEMETRICS_SECONDS];
+	long long	second[FRAMEMETRICS_SECONDS];	// which second (since Start) each one holds
+};
+
+
+// Frame-time metrics that can be watched for stutter, not just averages.
+//
+// BeginFrame( ), EndFrame( ), and Presented( ) time each frame three ways (see
+// FrameMetricTimers) into histograms (framehistogram.h). GetWindow( ) gives the count,
+// mean, p50, p90, p99, and max of any of them over the last so many seconds, from the
+// one-second histograms that cover them (the whole seconds plus the one under way, so a
+// window is never empty just because a second has only begun); WriteCSV( ) writes those out for every window,
+// and so does FormatPrometheus( ), in the Prometheus text format.
+//
+// StartServer( port ) serves FormatPrometheus( ) at http://127.0.0.1:port/metrics from a
+// thread of its own, so a long-running forest can be scraped -- port 0 takes any free
+// port (GetPort( ) says which), and a scraper on the same machine is all that can reach it.
+// The histograms are locked only while they are being added to or read, once a frame.
+//
+// The gpu times are read back the way PassTimers reads them: the queries of the last
+// FRAMEMETRICS_GPU_FRAMES frames are kept in a ring, and a frame's time is dropped if it is
+// still not ready when its slot comes around again. Without GL_ARB_timer_query there are none.
+
+class FrameMetrics
+{
+private:
+	std::chrono::steady_clock::time_point	CpuStart;
+	bool	Enabled;
+	int	Frame;
+	GLuint	GpuBegin[FRAMEMETRICS_GPU_FRAMES];
+	int	GpuDropped;
+	GLuint	GpuEnd[FRAMEMETRICS_GPU_FRAMES];
+	bool	GpuPending[FRAMEMETRICS_GPU_FRAMES];
+	bool	GpuTiming;
+	bool	HavePresent;
+	bool	InFrame;
+	std::chrono::steady_clock::time_point	LastPresent;
+	std::mutex	Lock;			// the series, between the drawing thread and the server
+	int	Port;
+	std::thread	Server;
+	int	ServerSocket;
+	std::atomic<bool>	Serving;
+	struct FrameMetricSeries	Series[NUM_FRAMEMETRICS];
+	std::chrono::steady_clock::time_point	Start;
+
+	void	CollectGpu( int );
+	void	GetWindowLocked( int, int, FrameHistogram * );
+	void	Record( int, double, std::chrono::steady_clock::time_point );
+	void	Serve( );
+
+public:
+	FrameMetrics( );
+	~FrameMetrics( );
+
+	void	BeginFrame( );
+	void	Create( );
+	void	EndFrame( );
+	std::string	FormatPrometheus( );
+	int	GetPort( );
+	bool	GetWindow( int, int, long long *, double *, double *, double *, double *, double * );
+	static const char *	GetTimerName( int );
+	void	Init( );
+	bool	IsEnabled( );
+	void	Presented( );
+	void	SetEnabled( bool );
+	bool	StartServer( int );
+	void	StopServer( );
+	bool	WriteCSV( const char * );
+};
+
+#endif	// FRAMEMETRICS_H
@@ -0,0 +1,230 @@
+#include "framepacer.h"
+#include <thread>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+static const char *FramePaceModeNames[NUM_FRAMEPACE_MODES] =
+{
+	"continuous", "on demand", "hidden"
+};
+
+
+FramePacer::FramePacer( )
+{
+	Init( );
+}
+
+
+// add the time since the current mode was entered to that mode's totals:
+
+void
+FramePacer::CloseMode( )
+{
+	double cpu = CpuSeconds( );
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+
+	Stats[Mode].cpu  += cpu - ModeCpu;
+	Stats[Mode].wall += std::chrono::duration<double>( now - ModeStart ).count( );
+
+	ModeCpu = cpu;
+	ModeStart = now;
+}
+
+
+// cpu seconds (user + system) used by the whole process so far:
+
+double
+FramePacer::CpuSeconds( )
+{
+#ifdef WIN32
+	FILETIME created, exited, kernel, user;
+	if( ! GetProcessTimes( GetCurrentProcess( ), &created, &exited, &kernel, &user ) )
+		return 0.;
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;		u.HighPart = user.dwHighDateTime;
+	return (double)( k.QuadPart + u.QuadPart ) * 1.e-7;		// 100 ns units
+#else
+	struct rusage usage;
+	if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+		return 0.;
+	return (double)( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec )
+	     + (double)( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) * 1.e-6;
+#endif
+}
+
+
+// a frame has just been finished (call this after swapping buffers):
+
+void
+FramePacer::FrameDone( )
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	struct FramePaceStats &s = Stats[Mode];
+
+	s.frames++;
+	if( HaveLastFrame )
+	{
+		double dt = std::chrono::duration<double>( now - LastFrame ).count( );
+		s.intervals++;
+		s.sum += dt;
+		s.sumSquares += dt * dt;
+		if( dt > s.worst )
+			s.worst = dt;
+	}
+	LastFrame = now;
+	HaveLastFrame = true;
+}
+
+
+int
+FramePacer::GetMode( )
+{
+	return Mode;
+}
+
+
+double
+FramePacer::GetTargetFPS( )
+{
+	return Period > 0. ? 1. / Period : 0.;
+}
+
+
+void
+FramePacer::Init( )
+{
+	Deadline = std::chrono::steady_clock::now( );
+	HaveLastFrame = false;
+	Mode = FRAMEPACE_CONTINUOUS;
+	ModeCpu = CpuSeconds( );
+	ModeStart = Deadline;
+	Period = 0.;
+	SleepMean = SleepM2 = 0.;
+	SleepCount = 0;
+	for( int m = 0; m < NUM_FRAMEPACE_MODES; m++ )
+	{
+		struct FramePaceStats zero = { 0., 0., 0, 0, 0., 0., 0. };
+		Stats[m] = zero;
+	}
+}
+
+
+// one line per mode: frames drawn, cpu use (as a percent of one core),
+// and the mean, standard deviation ("jitter"), and worst of the frame-to-frame intervals
+
+void
+FramePacer::PrintReport( FILE *fp )
+{
+	CloseMode( );
+
+	if( Period > 0. )
+		fprintf( fp, "Frame pacing, target %.0f fps:\n", 1. / Period );
+	else
+		fprintf( fp, "Frame pacing, no frame rate limit:\n" );
+	fprintf( fp, "%-12s %8s %8s %7s %9s %10s %9s\n", "mode", "seconds", "frames", "cpu%", "mean ms", "jitter ms", "worst ms" );
+
+	for( int m = 0; m < NUM_FRAMEPACE_MODES; m++ )
+	{
+		struct FramePaceStats &s = Stats[m];
+		if( s.wall <= 0. )
+			continue;
+
+		double cpu = 100. * s.cpu / s.wall;
+		if( s.intervals > 0 )
+		{
+			double mean = s.sum / (double)s.intervals;
+			double var = s.sumSquares / (double)s.intervals - mean * mean;
+			double jitter = var > 0. ? sqrt( var ) : 0.;
+			fprintf( fp, "%-12s %8.1f %8d %7.1f %9.2f %10.2f %9.2f\n", FramePaceModeNames[m], s.wall, s.frames, cpu,
+				1000. * mean, 1000. * jitter, 1000. * s.worst );
+		}
+		else
+		{
+			fprintf( fp, "%-12s %8.1f %8d %7.1f %9s %10s %9s\n", FramePaceModeNames[m], s.wall, s.frames, cpu, "-", "-", "-" );
+		}
+	}
+}
+
+
+void
+FramePacer::SetMode( int mode )
+{
+	if( mode < 0  ||  mode >= NUM_FRAMEPACE_MODES  ||  mode == Mode )
+		return;
+
+	CloseMode( );
+	Mode = mode;
+
+	// intervals are only measured between two frames of the same mode,
+	// and the schedule starts over from now:
+	HaveLastFrame = false;
+	Deadline = std::chrono::steady_clock::now( );
+}
+
+
+// 0. means no limit
+
+void
+FramePacer::SetTargetFPS( double fps )
+{
+	Period = fps > 0. ? 1. / fps : 0.;
+	Deadline = std::chrono::steady_clock::now( );
+}
+
+
+// how long before a deadline to stop sleeping and start spinning:
+
+double
+FramePacer::SpinMargin( )
+{
+	if( SleepCount < 2 )
+		return 2. * FRAMEPACE_SLEEP_SLICE;
+	return SleepMean + sqrt( SleepM2 / (double)( SleepCount - 1 ) );
+}
+
+
+// hold the caller until the next frame is due:
+
+void
+FramePacer::WaitForFrame( )
+{
+	if( Period <= 0.  ||  Mode != FRAMEPACE_CONTINUOUS )
+		return;
+
+	std::chrono::steady_clock::duration period = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( Period ) );
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+
+	if( now > Deadline + period )
+	{
+		// more than a frame behind -- start the schedule over from here:
+		Deadline = now + period;
+		return;
+	}
+
+	// sleep in slices, learning how long each one really takes:
+	while( std::chrono::duration<double>( Deadline - now ).count( ) > SpinMargin( ) )
+	{
+		std::this_thread::sleep_for( std::chrono::duration<double>( FRAMEPACE_SLEEP_SLICE ) );
+		std::chrono::steady_clock::time_point woke = std::chrono::steady_clock::now( );
+
+		double slept = std::chrono::duration<double>( woke - now ).count( );
+		SleepCount++;
+		double delta = slept - SleepMean;
+		SleepMean += delta / (double)SleepCount;
+		SleepM2 += delta * ( slept - SleepMean );
+
+		now = woke;
+	}
+
+	// ... then spin the rest of the way:
+	while( std::chrono::steady_clock::now( ) < Deadline )
+		std::this_thread::yield( );
+
+	Deadline += period;
+}
@@ -0,0 +1,81 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+
+// how the program is drawing frames:
+enum FramePaceModes
+{
+	FRAMEPACE_CONTINUOUS,		// animating -- a new frame every period
+	FRAMEPACE_ON_DEMAND,		// frozen -- only when an event asks for one
+	FRAMEPACE_HIDDEN,		// the window cannot be seen -- not at all
+	NUM_FRAMEPACE_MODES
+};
+
+
+// how long to sleep in one go while waiting for a frame, in seconds:
+// the last stretch before the deadline is spun instead (see WaitForFrame( ))
+#define FRAMEPACE_SLEEP_SLICE		0.001
+
+
+// what was measured while in one mode:
+struct FramePaceStats
+{
+	double	cpu;			// process cpu seconds
+	double	wall;			// wall seconds
+	int	frames;
+	int	intervals;		// frame-to-frame intervals, in seconds:
+	double	sum;
+	double	sumSquares;
+	double	worst;
+};
+
+
+// Frame pacing.
+//
+// In FRAMEPACE_CONTINUOUS mode, WaitForFrame( ) holds the caller until the next
+// frame is due at the target rate. It sleeps in short slices while there is
+// plenty of time left, and spins for the last stretch, which is as long as a slice
+// has really been taking (a running mean plus one standard deviation),
+// so the wakeups land on the deadline without burning a core for the whole frame.
+// A frame that is more than one period late starts the schedule over instead of
+// trying to catch up.
+//
+// Per mode, the pacer keeps the process's cpu time, the wall time, and the
+// intervals between FrameDone( ) calls, for PrintReport( ).
+
+class FramePacer
+{
+private:
+	std::chrono::steady_clock::time_point	Deadline;	// when the next frame is due
+	std::chrono::steady_clock::time_point	LastFrame;
+	bool	HaveLastFrame;
+	int	Mode;
+	double	ModeCpu;			// cpu and wall time when the mode was entered
+	std::chrono::steady_clock::time_point	ModeStart;
+	double	Period;				// seconds per frame, 0. = no limit
+	double	SleepMean, SleepM2;		// how long the sleep slices have really taken
+	int	SleepCount;
+	struct FramePaceStats	Stats[NUM_FRAMEPACE_MODES];
+
+	void	CloseMode( );
+	double	SpinMargin( );
+
+public:
+	FramePacer( );
+
+	static double	CpuSeconds( );
+	void	FrameDone( );
+	int	GetMode( );
+	double	GetTargetFPS( );
+	void	Init( );
+	void	PrintReport( FILE * );
+	void	SetMode( int );
+	void	SetTargetFPS( double );
+	void	WaitForFrame( );
+};
+
+#endif	// FRAMEPACER_H
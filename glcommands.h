@@ -0,0 +1,308 @@
+#ifndef GLCOMMANDS_H
+#define GLCOMMANDS_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// The binary format shared by the OpenGL recorder (glrecord.h) and the replayer (glreplay.cpp).
+//
+// A recording is a header -- GLRECORD_MAGIC, then GLRECORD_VERSION, the width and the height
+// of what was drawn into, each as a 32-bit unsigned int -- followed by one command after another:
+// a one-byte opcode, then its arguments, each in its own size and in the byte order of the
+// machine that recorded it. Arrays (buffer and texture contents, shader sources, uniform values)
+// are a 32-bit byte count and then the bytes. Object names are the ones the recording program
+// got back; the replayer maps them onto its own.
+//
+// Everything up to the first GLRECORD_OP_FRAME sets things up (textures, buffers, shaders,
+// display lists, ...); each GLRECORD_OP_FRAME starts one recorded frame.
+
+#define GLRECORD_MAGIC		"FGLR"
+#define GLRECORD_VERSION	1
+
+
+// The calls whose arguments are all plain values, as CALLn( name, type1, ..., typen ):
+// the recorder and the replayer each expand this with their own CALL0 ... CALL6.
+// Besides the OpenGL types, an argument can be one of the kinds of object name (BUFFER,
+// FRAMEBUFFER, LIST, PROGRAM, RENDERBUFFER, SHADER, TEXTURE), which the replayer has to map,
+// or a COLORBUFFER, which it may have to point at its own framebuffer.
+
+#define GLRECORD_PLAIN_CALLS( CALL0, CALL1, CALL2, CALL3, CALL4, CALL5, CALL6 )	\
+	CALL0( End )								\
+	CALL0( EndList )							\
+	CALL0( Flush )								\
+	CALL0( LoadIdentity )							\
+	CALL0( PopAttrib )							\
+	CALL0( PopClientAttrib )						\
+	CALL0( PopMatrix )							\
+	CALL0( PushMatrix )							\
+	CALL1( ActiveTexture, GLenum )						\
+	CALL1( Begin, GLenum )							\
+	CALL1( CallList, LIST )							\
+	CALL1( Clear, GLbitfield )						\
+	CALL1( ClientActiveTexture, GLenum )					\
+	CALL1( CompileShader, SHADER )						\
+	CALL1( DeleteProgram, PROGRAM )						\
+	CALL1( DeleteShader, SHADER )						\
+	CALL1( DepthFunc, GLenum )						\
+	CALL1( DepthMask, GLboolean )						\
+	CALL1( Disable, GLenum )						\
+	CALL1( DisableClientState, GLenum )					\
+	CALL1( DisableVertexAttribArray, GLuint )				\
+	CALL1( DrawBuffer, COLORBUFFER )					\
+	CALL1( Enable, GLenum )							\
+	CALL1( EnableClientState, GLenum )					\
+	CALL1( EnableVertexAttribArray, GLuint )				\
+	CALL1( LineWidth, GLfloat )						\
+	CALL1( LinkProgram, PROGRAM )						\
+	CALL1( MatrixMode, GLenum )						\
+	CALL1( PointSize, GLfloat )						\
+	CALL1( PushAttrib, GLbitfield )						\
+	CALL1( PushClientAttrib, GLbitfield )					\
+	CALL1( ReadBuffer, COLORBUFFER )					\
+	CALL1( ShadeModel, GLenum )						\
+	CALL1( UseProgram, PROGRAM )						\
+	CALL1( ValidateProgram, PROGRAM )					\
+	CALL2( AttachShader, PROGRAM, SHADER )					\
+	CALL2( BindBuffer, GLenum, BUFFER )					\
+	CALL2( BindFramebuffer, GLenum, FRAMEBUFFER )				\
+	CALL2( BindRenderbuffer, GLenum, RENDERBUFFER )				\
+	CALL2( BindTexture, GLenum, TEXTURE )					\
+	CALL2( BlendFunc, GLenum, GLenum )					\
+	CALL2( Fogf, GLenum, GLfloat )						\
+	CALL2( Fogi, GLenum, GLint )						\
+	CALL2( MultiTexCoord1f, GLenum, GLfloat )				\
+	CALL2( NewList, LIST, GLenum )						\
+	CALL2( PixelStorei, GLenum, GLint )					\
+	CALL2( PolygonOffset, GLfloat, GLfloat )				\
+	CALL2( TexCoord2f, GLfloat, GLfloat )					\
+	CALL2( VertexAttrib1d, GLuint, GLdouble )				\
+	CALL2( VertexAttrib1f, GLuint, GLfloat )				\
+	CALL3( Color3f, GLfloat, GLfloat, GLfloat )				\
+	CALL3( DrawArrays, GLenum, GLint, GLsizei )				\
+	CALL3( Lightf, GLenum, GLenum, GLfloat )				\
+	CALL3( Materialf, GLenum, GLenum, GLfloat )				\
+	CALL3( Normal3f, GLfloat, GLfloat, GLfloat )				\
+	CALL3( RasterPos3f, GLfloat, GLfloat, GLfloat )				\
+	CALL3( Scalef, GLfloat, GLfloat, GLfloat )				\
+	CALL3( TexEnvf, GLenum, GLenum, GLfloat )				\
+	CALL3( TexEnvi, GLenum, GLenum, GLint )					\
+	CALL3( TexGeni, GLenum, GLenum, GLint )					\
+	CALL3( TexParameteri, GLenum, GLenum, GLint )				\
+	CALL3( Translatef, GLfloat, GLfloat, GLfloat )				\
+	CALL3( Vertex3f, GLfloat, GLfloat, GLfloat )				\
+	CALL4( ClearColor, GLfloat, GLfloat, GLfloat, GLfloat )			\
+	CALL4( ColorMask, GLboolean, GLboolean, GLboolean, GLboolean )		\
+	CALL4( DrawArraysInstanced, GLenum, GLint, GLsizei, GLsizei )		\
+	CALL4( FramebufferRenderbuffer, GLenum, GLenum, GLenum, RENDERBUFFER )	\
+	CALL4( RenderbufferStorage, GLenum, GLenum, GLsizei, GLsizei )		\
+	CALL4( Rotatef, GLfloat, GLfloat, GLfloat, GLfloat )			\
+	CALL4( VertexAttrib3f, GLuint, GLfloat, GLfloat, GLfloat )		\
+	CALL4( Viewport, GLint, GLint, GLsizei, GLsizei )			\
+	CALL5( FramebufferTexture2D, GLenum, GLenum, GLenum, TEXTURE, GLint )	\
+	CALL6( Ortho, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble )
+
+// ... and the ones macOS's OpenGL headers do not have:
+
+#define GLRECORD_PLAIN_CALLS_NOT_APPLE( CALL2, CALL3 )		\
+	CALL2( Uniform1d, GLint, GLdouble )			\
+	CALL3( DispatchCompute, GLuint, GLuint, GLuint )	\
+	CALL3( ProgramParameteri, PROGRAM, GLenum, GLint )
+
+
+// The calls that take an array of up to 4 floats whose length depends on the last enum,
+// as PARAMS1( name ) -- ( GLenum, const GLfloat * ) -- or PARAMS2( name ) -- ( GLenum, GLenum, const GLfloat * ):
+
+#define GLRECORD_PARAM_CALLS( PARAMS1, PARAMS2 )	\
+	PARAMS1( Fogfv )				\
+	PARAMS2( Lightfv )				\
+	PARAMS2( Materialfv )				\
+	PARAMS2( TexEnvfv )				\
+	PARAMS2( TexGenfv )				\
+	PARAMS2( TexParameterfv )
+
+
+// The uniform calls, as UNIFORM( name, type, components ) -- ( location, count, const type * ) --
+// and MATRIX( name, components ) -- ( location, count, transpose, const GLfloat * ) --
+// then the same with a program first:
+
+#define GLRECORD_UNIFORM_CALLS( UNIFORM, MATRIX )	\
+	UNIFORM( Uniform1fv, GLfloat, 1 )		\
+	UNIFORM( Uniform2fv, GLfloat, 2 )		\
+	UNIFORM( Uniform3fv, GLfloat, 3 )		\
+	UNIFORM( Uniform4fv, GLfloat, 4 )		\
+	UNIFORM( Uniform1iv, GLint, 1 )			\
+	UNIFORM( Uniform2iv, GLint, 2 )			\
+	UNIFORM( Uniform3iv, GLint, 3 )			\
+	UNIFORM( Uniform4iv, GLint, 4 )			\
+	MATRIX( UniformMatrix2fv, 4 )			\
+	MATRIX( UniformMatrix3fv, 9 )			\
+	MATRIX( UniformMatrix4fv, 16 )
+
+#define GLRECORD_PROGRAM_UNIFORM_CALLS( UNIFORM, MATRIX )	\
+	UNIFORM( ProgramUniform1fv, GLfloat, 1 )		\
+	UNIFORM( ProgramUniform2fv, GLfloat, 2 )		\
+	UNIFORM( ProgramUniform3fv, GLfloat, 3 )		\
+	UNIFORM( ProgramUniform4fv, GLfloat, 4 )		\
+	UNIFORM( ProgramUniform1iv, GLint, 1 )			\
+	UNIFORM( ProgramUniform2iv, GLint, 2 )			\
+	UNIFORM( ProgramUniform3iv, GLint, 3 )			\
+	UNIFORM( ProgramUniform4iv, GLint, 4 )			\
+	MATRIX( ProgramUniformMatrix2fv, 4 )			\
+	MATRIX( ProgramUniformMatrix3fv, 9 )			\
+	MATRIX( ProgramUniformMatrix4fv, 16 )
+
+
+// The C type each kind of argument is passed as:
+
+#define GLRECORD_TYPE_GLbitfield	GLbitfield
+#define GLRECORD_TYPE_GLboolean		GLboolean
+#define GLRECORD_TYPE_GLdouble		GLdouble
+#define GLRECORD_TYPE_GLenum		GLenum
+#define GLRECORD_TYPE_GLfloat		GLfloat
+#define GLRECORD_TYPE_GLint		GLint
+#define GLRECORD_TYPE_GLsizei		GLsizei
+#define GLRECORD_TYPE_GLuint		GLuint
+#define GLRECORD_TYPE_BUFFER		GLuint
+#define GLRECORD_TYPE_COLORBUFFER	GLenum
+#define GLRECORD_TYPE_FRAMEBUFFER	GLuint
+#define GLRECORD_TYPE_LIST		GLuint
+#define GLRECORD_TYPE_PROGRAM		GLuint
+#define GLRECORD_TYPE_RENDERBUFFER	GLuint
+#define GLRECORD_TYPE_SHADER		GLuint
+#define GLRECORD_TYPE_TEXTURE		GLuint
+
+
+#define GLRECORD_ENUM0( name )				GLRECORD_OP_##name,
+#define GLRECORD_ENUM1( name, a )			GLRECORD_OP_##name,
+#define GLRECORD_ENUM2( name, a, b )			GLRECORD_OP_##name,
+#define GLRECORD_ENUM3( name, a, b, c )			GLRECORD_OP_##name,
+#define GLRECORD_ENUM4( name, a, b, c, d )		GLRECORD_OP_##name,
+#define GLRECORD_ENUM5( name, a, b, c, d, e )		GLRECORD_OP_##name,
+#define GLRECORD_ENUM6( name, a, b, c, d, e, f )	GLRECORD_OP_##name,
+#define GLRECORD_ENUM_ARRAY( name, a, b )		GLRECORD_OP_##name,
+
+enum GlRecordOps
+{
+	GLRECORD_OP_FRAME,		// a recorded frame starts here
+
+	GLRECORD_PLAIN_CALLS( GLRECORD_ENUM0, GLRECORD_ENUM1, GLRECORD_ENUM2, GLRECORD_ENUM3, GLRECORD_ENUM4, GLRECORD_ENUM5, GLRECORD_ENUM6 )
+	GLRECORD_PLAIN_CALLS_NOT_APPLE( GLRECORD_ENUM2, GLRECORD_ENUM3 )
+	GLRECORD_PARAM_CALLS( GLRECORD_ENUM0, GLRECORD_ENUM0 )
+	GLRECORD_UNIFORM_CALLS( GLRECORD_ENUM_ARRAY, GLRECORD_ENUM1 )
+	GLRECORD_PROGRAM_UNIFORM_CALLS( GLRECORD_ENUM_ARRAY, GLRECORD_ENUM1 )
+
+	// the calls with arguments of their own kind:
+	GLRECORD_OP_BufferData,		// target, size (64 bits), usage, then the data or a 0 count
+	GLRECORD_OP_BufferSubData,	// target, offset (64 bits), the data
+	GLRECORD_OP_CreateProgram,	// the name
+	GLRECORD_OP_CreateShader,	// type, the name
+	GLRECORD_OP_DeleteBuffers,	// n, the names
+	GLRECORD_OP_DeleteFramebuffers,
+	GLRECORD_OP_DeleteRenderbuffers,
+	GLRECORD_OP_DrawElements,	// mode, count, type, instances (0 = not instanced), then a 64-bit offset into the element buffer
+	GLRECORD_OP_DrawElementsData,	// mode, count, type, instances, then the indices themselves
+	GLRECORD_OP_GenBuffers,		// n, the names
+	GLRECORD_OP_GenFramebuffers,
+	GLRECORD_OP_GenLists,		// range, the first name
+	GLRECORD_OP_GenRenderbuffers,
+	GLRECORD_OP_GenTextures,
+	GLRECORD_OP_gluLookAt,		// 9 doubles
+	GLRECORD_OP_gluOrtho2D,		// 4 doubles
+	GLRECORD_OP_gluPerspective,	// 4 doubles
+	GLRECORD_OP_Pointer,		// which array (one byte), attribute index, size, type, normalized, stride,
+					//   then a 64-bit offset into the array buffer
+	GLRECORD_OP_ProgramBinary,	// program, format, the binary
+	GLRECORD_OP_ShaderSource,	// shader, count, the strings
+	GLRECORD_OP_TexImage2D,		// target, level, internal format, width, height, depth, border, format, type,
+	GLRECORD_OP_TexImage3D,		//   then the pixels (a 2D image has a depth of 1)
+	GLRECORD_OP_TexSubImage2D,	// target, level, x, y, z, width, height, depth, format, type, then the pixels
+	GLRECORD_OP_TexSubImage3D,	//   (a 2D image has a z of 0 and a depth of 1)
+	NUM_GLRECORD_OPS
+};
+
+// the arrays that GLRECORD_OP_Pointer sets:
+enum GlRecordArrays
+{
+	GLRECORD_COLOR_ARRAY,
+	GLRECORD_NORMAL_ARRAY,
+	GLRECORD_TEXCOORD_ARRAY,
+	GLRECORD_VERTEX_ARRAY,
+	GLRECORD_ATTRIB_ARRAY,			// a generic attribute, glVertexAttribPointer( )
+};
+
+// what comes in place of the pixels of a glTex*Image*( ):
+enum GlRecordPixels
+{
+	GLRECORD_NO_PIXELS,			// the pointer was NULL: only allocate the texture
+	GLRECORD_PIXELS,			// the pixels themselves
+	GLRECORD_UNPACK_BUFFER,			// a 64-bit offset into the GL_PIXEL_UNPACK_BUFFER
+};
+
+
+// how many floats a glLightfv( ), glMaterialfv( ), glFogfv( ), glTexEnvfv( ), glTexGenfv( ),
+// or glTexParameterfv( ) with this pname reads:
+
+inline int
+GlRecordParamCount( GLenum pname )
+{
+	switch( pname )
+	{
+		case GL_AMBIENT:
+		case GL_AMBIENT_AND_DIFFUSE:
+		case GL_DIFFUSE:
+		case GL_EMISSION:
+		case GL_EYE_PLANE:
+		case GL_FOG_COLOR:
+		case GL_LIGHT_MODEL_AMBIENT:
+		case GL_OBJECT_PLANE:
+		case GL_POSITION:
+		case GL_SPECULAR:
+		case GL_TEXTURE_BORDER_COLOR:
+		case GL_TEXTURE_ENV_COLOR:
+			return 4;
+
+		case GL_COLOR_INDEXES:
+		case GL_SPOT_DIRECTION:
+			return 3;
+	}
+	return 1;
+}
+
+
+// the bytes in one pixel of this format and type:
+
+inline int
+GlRecordPixelSize( GLenum format, GLenum type )
+{
+	int components;
+	switch( format )
+	{
+		case GL_RGB:
+		case GL_BGR:		components = 3;		break;
+		case GL_RGBA:
+		case GL_BGRA:		components = 4;		break;
+		case GL_LUMINANCE_ALPHA:
+		case GL_RG:		components = 2;		break;
+		default:		components = 1;		break;	// alpha, luminance, red, depth, ...
+	}
+
+	switch( type )
+	{
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:	return 2 * components;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:		return 4 * components;
+	}
+	return components;			// bytes
+}
+
+#endif	// GLCOMMANDS_H
@@ -0,0 +1,214 @@
+#include "glrecord.h"
+
+
+std::vector<unsigned char>	GlRecorder::Buffer;
+long long			GlRecorder::Bytes = 0;
+GLuint				GlRecorder::DefaultFbo = 0;
+bool				GlRecorder::Failed = false;
+FILE *				GlRecorder::Fp = NULL;
+int				GlRecorder::Frames = 0;
+bool				GlRecorder::Recording = false;
+bool				GlRecorder::WarnedClientArrays = false;
+
+
+// one glDrawElements*( ) (instances is 0 if it was not instanced):
+
+void
+GlRecorder::Elements( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances )
+{
+	if( ! Recording )
+		return;
+
+	GLint elementBuffer = 0;
+	glGetIntegerv( GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer );
+	PutOp( elementBuffer != 0 ? GLRECORD_OP_DrawElements : GLRECORD_OP_DrawElementsData );
+	Put( mode );
+	Put( count );
+	Put( type );
+	Put( instances );
+	if( elementBuffer != 0 )
+		Put( (uint64_t)(uintptr_t)indices );
+	else
+		PutArray( indices, (size_t)count * ( type == GL_UNSIGNED_INT ? 4 : type == GL_UNSIGNED_SHORT ? 2 : 1 ) );
+}
+
+
+// a frame starts here:
+
+void
+GlRecorder::Frame( )
+{
+	if( ! Recording )
+		return;
+
+	PutOp( GLRECORD_OP_FRAME );
+	Frames++;
+}
+
+
+bool
+GlRecorder::IsRecording( )
+{
+	return Recording;
+}
+
+
+// the pixels of a glTex*Image*( ) -- as many bytes as OpenGL will read from them,
+// given how it has been told they are laid out (the forest never skips any):
+
+void
+GlRecorder::Pixels( GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels )
+{
+	GLint unpackBuffer = 0;
+	glGetIntegerv( GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer );
+	if( unpackBuffer != 0 )
+	{
+		Put( (unsigned char)GLRECORD_UNPACK_BUFFER );
+		Put( (uint64_t)(uintptr_t)pixels );
+		return;
+	}
+
+	if( pixels == NULL )
+	{
+		Put( (unsigned char)GLRECORD_NO_PIXELS );
+		return;
+	}
+
+	GLint alignment = 4, rowLength = 0, imageHeight = 0;
+	glGetIntegerv( GL_UNPACK_ALIGNMENT, &alignment );
+	glGetIntegerv( GL_UNPACK_ROW_LENGTH, &rowLength );
+	glGetIntegerv( GL_UNPACK_IMAGE_HEIGHT, &imageHeight );
+
+	size_t pixelSize = (size_t)GlRecordPixelSize( format, type );
+	size_t rowBytes = (size_t)( rowLength > 0 ? rowLength : width ) * pixelSize;
+	rowBytes = ( rowBytes + alignment - 1 ) / alignment * alignment;
+	size_t imageBytes = (size_t)( imageHeight > 0 ? imageHeight : height ) * rowBytes;
+
+	// the last row of the last image only goes as far as its last pixel:
+	size_t bytes = 0;
+	if( width > 0  &&  height > 0  &&  depth > 0 )
+		bytes = (size_t)( depth - 1 ) * imageBytes + (size_t)( height - 1 ) * rowBytes + (size_t)width * pixelSize;
+
+	Put( (unsigned char)GLRECORD_PIXELS );
+	PutArray( pixels, bytes );
+}
+
+
+// a gl*Pointer( ) -- which has to point into the bound GL_ARRAY_BUFFER:
+
+void
+GlRecorder::Pointer( int array, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *offset )
+{
+	if( ! Recording )
+		return;
+
+	GLint arrayBuffer = 0;
+	glGetIntegerv( GL_ARRAY_BUFFER_BINDING, &arrayBuffer );
+	if( arrayBuffer == 0 )
+	{
+		if( ! WarnedClientArrays )
+			fprintf( stderr, "A vertex array in memory, not in a buffer, cannot be recorded -- the replay will not have it\n" );
+		WarnedClientArrays = true;
+		return;
+	}
+
+	PutOp( GLRECORD_OP_Pointer );
+	Put( (unsigned char)array );
+	Put( index );
+	Put( size );
+	Put( type );
+	Put( normalized );
+	Put( stride );
+	Put( (uint64_t)(uintptr_t)offset );
+}
+
+
+// a 32-bit byte count, then the bytes:
+
+void
+GlRecorder::PutArray( const void *data, size_t bytes )
+{
+	Put( (unsigned int)bytes );
+	if( bytes > 0 )
+		PutBytes( data, bytes );
+}
+
+
+void
+GlRecorder::PutBytes( const void *data, size_t bytes )
+{
+	const unsigned char *p = (const unsigned char *)data;
+	Buffer.insert( Buffer.end( ), p, p + bytes );
+	if( Buffer.size( ) >= GLRECORD_WRITE_BYTES )
+		WriteOut( );
+}
+
+
+// start recording into filename, drawing width x height into framebuffer defaultFbo:
+
+bool
+GlRecorder::Start( const char *filename, int width, int height, GLuint defaultFbo )
+{
+	if( Recording )
+		return true;
+
+	Fp = fopen( filename, "wb" );
+	if( Fp == NULL )
+	{
+		fprintf( stderr, "Cannot open OpenGL recording '%s'\n", filename );
+		return false;
+	}
+
+	Buffer.clear( );
+	Buffer.reserve( GLRECORD_WRITE_BYTES + 65536 );
+	Bytes = 0;
+	DefaultFbo = defaultFbo;
+	Failed = false;
+	Frames = 0;
+	Recording = true;
+	WarnedClientArrays = false;
+
+	PutBytes( GLRECORD_MAGIC, 4 );
+	Put( (unsigned int)GLRECORD_VERSION );
+	Put( (unsigned int)width );
+	Put( (unsigned int)height );
+	return true;
+}
+
+
+// stop recording and close the file -- returns false if any of it could not be written:
+
+bool
+GlRecorder::Stop( )
+{
+	if( ! Recording )
+		return true;
+
+	WriteOut( );
+	Recording = false;
+	if( fclose( Fp ) != 0 )
+		Failed = true;
+	Fp = NULL;
+	std::vector<unsigned char>( ).swap( Buffer );
+
+	if( Failed )
+	{
+		fprintf( stderr, "Could not write all of the OpenGL recording\n" );
+		return false;
+	}
+	fprintf( stderr, "Recorded %d frames of OpenGL calls (%.1f MB)\n", Frames, (double)Bytes / ( 1024. * 1024. ) );
+	return true;
+}
+
+
+void
+GlRecorder::WriteOut( )
+{
+	if( Buffer.empty( ) )
+		return;
+
+	if( fwrite( &Buffer[0], 1, Buffer.size( ), Fp ) != Buffer.size( ) )
+		Failed = true;
+	Bytes += (long long)Buffer.size( );
+	Buffer.clear( );
+}
@@ -0,0 +1,822 @@
+#ifndef GLRECORD_H
+#define GLRECORD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+#include "glcommands.h"
+
+
+// the recording is written out whenever this much of it has piled up:
+#define GLRECORD_WRITE_BYTES	( 4 * 1024 * 1024 )
+
+
+// Record the OpenGL calls the forest makes, so they can be played back without it
+// (see glreplay.cpp, "make forest_replay").
+//
+// Like glstats.h, including this file puts a macro in front of each OpenGL call the
+// forest makes that changes what gets drawn. Between Start( ) and Stop( ), each one
+// is written into the recording (in the format glcommands.h describes) and then made.
+// The calls that only ask OpenGL something (glGet*( ), queries, glReadPixels( ), ...)
+// are not recorded. forest.cpp includes glrecord.cpp right after glstats.cpp, so a
+// call is recorded, then counted, then made.
+//
+// Buffer and texture contents are recorded as they are uploaded, so recording has
+// to start before anything is: right after the context is made. Vertex arrays have
+// to come from buffers -- an array in memory is not recorded (there is a warning).
+// It is all for the thread that has the context.
+
+class GlRecorder
+{
+private:
+	static std::vector<unsigned char>	Buffer;
+	static long long	Bytes;		// written out so far
+	static GLuint	DefaultFbo;		// what the program draws into when it binds framebuffer 0
+	static bool	Failed;			// a write went wrong
+	static FILE *	Fp;
+	static int	Frames;
+	static bool	Recording;
+	static bool	WarnedClientArrays;
+
+	static void	Elements( GLenum, GLsizei, GLenum, const void *, GLsizei );
+	static void	Pixels( GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void * );
+	static void	Pointer( int, GLuint, GLint, GLenum, GLboolean, GLsizei, const void * );
+	static void	PutArray( const void *, size_t );
+	static void	PutBytes( const void *, size_t );
+	static void	WriteOut( );
+
+	template<class T> static void	Put( T value )		{ PutBytes( &value, sizeof( value ) ); }
+	static void	PutOp( int op )					{ Put( (unsigned char)op ); }
+
+public:
+	static void	Frame( );
+	static bool	IsRecording( );
+	static bool	Start( const char *, int, int, GLuint );
+	static bool	Stop( );
+
+	// the recorded calls:
+#define GLRECORD_DECLARE0( name )			static void name( );
+#define GLRECORD_DECLARE1( name, a )			static void name( GLRECORD_TYPE_##a );
+#define GLRECORD_DECLARE2( name, a, b )			static void name( GLRECORD_TYPE_##a, GLRECORD_TYPE_##b );
+#define GLRECORD_DECLARE3( name, a, b, c )		static void name( GLRECORD_TYPE_##a, GLRECORD_TYPE_##b, GLRECORD_TYPE_##c );
+#define GLRECORD_DECLARE4( name, a, b, c, d )		static void name( GLRECORD_TYPE_##a, GLRECORD_TYPE_##b, GLRECORD_TYPE_##c, GLRECORD_TYPE_##d );
+#define GLRECORD_DECLARE5( name, a, b, c, d, e )	static void name( GLRECORD_TYPE_##a, GLRECORD_TYPE_##b, GLRECORD_TYPE_##c, GLRECORD_TYPE_##d, GLRECORD_TYPE_##e );
+#define GLRECORD_DECLARE6( name, a, b, c, d, e, f )	static void name( GLRECORD_TYPE_##a, GLRECORD_TYPE_##b, GLRECORD_TYPE_##c, GLRECORD_TYPE_##d, GLRECORD_TYPE_##e, GLRECORD_TYPE_##f );
+#define GLRECORD_DECLARE_PARAMS1( name )		static void name( GLenum, const GLfloat * );
+#define GLRECORD_DECLARE_PARAMS2( name )		static void name( GLenum, GLenum, const GLfloat * );
+#define GLRECORD_DECLARE_UNIFORM( name, type, n )	static void name( GLint, GLsizei, const type * );
+#define GLRECORD_DECLARE_MATRIX( name, n )		static void name( GLint, GLsizei, GLboolean, const GLfloat * );
+#define GLRECORD_DECLARE_PROGRAM_UNIFORM( name, type, n )	static void name( GLuint, GLint, GLsizei, const type * );
+#define GLRECORD_DECLARE_PROGRAM_MATRIX( name, n )	static void name( GLuint, GLint, GLsizei, GLboolean, const GLfloat * );
+
+	GLRECORD_PLAIN_CALLS( GLRECORD_DECLARE0, GLRECORD_DECLARE1, GLRECORD_DECLARE2, GLRECORD_DECLARE3, GLRECORD_DECLARE4, GLRECORD_DECLARE5, GLRECORD_DECLARE6 )
+	GLRECORD_PARAM_CALLS( GLRECORD_DECLARE_PARAMS1, GLRECORD_DECLARE_PARAMS2 )
+	GLRECORD_UNIFORM_CALLS( GLRECORD_DECLARE_UNIFORM, GLRECORD_DECLARE_MATRIX )
+#ifndef __APPLE__
+	GLRECORD_PLAIN_CALLS_NOT_APPLE( GLRECORD_DECLARE2, GLRECORD_DECLARE3 )
+	GLRECORD_PROGRAM_UNIFORM_CALLS( GLRECORD_DECLARE_PROGRAM_UNIFORM, GLRECORD_DECLARE_PROGRAM_MATRIX )
+	static void	ProgramBinary( GLuint, GLenum, const void *, GLsizei );
+#endif
+
+	static void	BufferData( GLenum, GLsizeiptr, const void *, GLenum );
+	static void	BufferSubData( GLenum, GLintptr, GLsizeiptr, const void * );
+	static void	Color3fv( const GLfloat * );
+	static void	ColorPointer( GLint, GLenum, GLsizei, const void * );
+	static GLuint	CreateProgram( );
+	static GLuint	CreateShader( GLenum );
+	static void	DeleteBuffers( GLsizei, const GLuint * );
+	static void	DeleteFramebuffers( GLsizei, const GLuint * );
+	static void	DeleteRenderbuffers( GLsizei, const GLuint * );
+	static void	DrawElements( GLenum, GLsizei, GLenum, const void * );
+	static void	DrawElementsInstanced( GLenum, GLsizei, GLenum, const void *, GLsizei );
+	static void	GenBuffers( GLsizei, GLuint * );
+	static void	GenFramebuffers( GLsizei, GLuint * );
+	static GLuint	GenLists( GLsizei );
+	static void	GenRenderbuffers( GLsizei, GLuint * );
+	static void	GenTextures( GLsizei, GLuint * );
+	static void	gluLookAt( GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble, GLdouble );
+	static void	gluOrtho2D( GLdouble, GLdouble, GLdouble, GLdouble );
+	static void	gluPerspective( GLdouble, GLdouble, GLdouble, GLdouble );
+	static void	Normal3fv( const GLfloat * );
+	static void	NormalPointer( GLenum, GLsizei, const void * );
+	static void	ShaderSource( GLuint, GLsizei, const GLchar *const *, const GLint * );
+	static void	TexCoordPointer( GLint, GLenum, GLsizei, const void * );
+	static void	TexImage2D( GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void * );
+	static void	TexImage3D( GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei, GLint, GLenum, GLenum, const void * );
+	static void	TexSubImage2D( GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void * );
+	static void	TexSubImage3D( GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void * );
+	static void	Vertex3fv( const GLfloat * );
+	static void	VertexAttrib3fv( GLuint, const GLfloat * );
+	static void	VertexAttribPointer( GLuint, GLint, GLenum, GLboolean, GLsizei, const void * );
+	static void	VertexPointer( GLint, GLenum, GLsizei, const void * );
+};
+
+
+// The recorded calls are defined here, ahead of the macros below, so the calls
+// inside them are still the ones that were there before (glstats.h's, or the real ones).
+// Framebuffer 0 is recorded for whatever the program draws into in its place.
+
+#define GLRECORD_PUT_GLbitfield( x )	Put( x )
+#define GLRECORD_PUT_GLboolean( x )	Put( x )
+#define GLRECORD_PUT_GLdouble( x )	Put( x )
+#define GLRECORD_PUT_GLenum( x )	Put( x )
+#define GLRECORD_PUT_GLfloat( x )	Put( x )
+#define GLRECORD_PUT_GLint( x )		Put( x )
+#define GLRECORD_PUT_GLsizei( x )	Put( x )
+#define GLRECORD_PUT_GLuint( x )	Put( x )
+#define GLRECORD_PUT_BUFFER( x )	Put( x )
+#define GLRECORD_PUT_COLORBUFFER( x )	Put( x )
+#define GLRECORD_PUT_FRAMEBUFFER( x )	Put( (GLuint)( ( x ) == DefaultFbo ? 0 : ( x ) ) )
+#define GLRECORD_PUT_LIST( x )		Put( x )
+#define GLRECORD_PUT_PROGRAM( x )	Put( x )
+#define GLRECORD_PUT_RENDERBUFFER( x )	Put( x )
+#define GLRECORD_PUT_SHADER( x )	Put( x )
+#define GLRECORD_PUT_TEXTURE( x )	Put( x )
+
+#define GLRECORD_DEFINE0( name )	\
+	inline void GlRecorder::name( )	\
+	{ if( Recording ) PutOp( GLRECORD_OP_##name ); gl##name( ); }
+#define GLRECORD_DEFINE1( name, a )	\
+	inline void GlRecorder::name( GLRECORD_TYPE_##a x1 )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); GLRECORD_PUT_##a( x1 ); } gl##name( x1 ); }
+#define GLRECORD_DEFINE2( name, a, b )	\
+	inline void GlRecorder::name( GLRECORD_TYPE_##a x1, GLRECORD_TYPE_##b x2 )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); GLRECORD_PUT_##a( x1 ); GLRECORD_PUT_##b( x2 ); } gl##name( x1, x2 ); }
+#define GLRECORD_DEFINE3( name, a, b, c )	\
+	inline void GlRecorder::name( GLRECORD_TYPE_##a x1, GLRECORD_TYPE_##b x2, GLRECORD_TYPE_##c x3 )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); GLRECORD_PUT_##a( x1 ); GLRECORD_PUT_##b( x2 ); GLRECORD_PUT_##c( x3 ); }	\
+	  gl##name( x1, x2, x3 ); }
+#define GLRECORD_DEFINE4( name, a, b, c, d )	\
+	inline void GlRecorder::name( GLRECORD_TYPE_##a x1, GLRECORD_TYPE_##b x2, GLRECORD_TYPE_##c x3, GLRECORD_TYPE_##d x4 )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); GLRECORD_PUT_##a( x1 ); GLRECORD_PUT_##b( x2 ); GLRECORD_PUT_##c( x3 );	\
+	  GLRECORD_PUT_##d( x4 ); } gl##name( x1, x2, x3, x4 ); }
+#define GLRECORD_DEFINE5( name, a, b, c, d, e )	\
+	inline void GlRecorder::name( GLRECORD_TYPE_##a x1, GLRECORD_TYPE_##b x2, GLRECORD_TYPE_##c x3, GLRECORD_TYPE_##d x4,	\
+		GLRECORD_TYPE_##e x5 )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); GLRECORD_PUT_##a( x1 ); GLRECORD_PUT_##b( x2 ); GLRECORD_PUT_##c( x3 );	\
+	  GLRECORD_PUT_##d( x4 ); GLRECORD_PUT_##e( x5 ); } gl##name( x1, x2, x3, x4, x5 ); }
+#define GLRECORD_DEFINE6( name, a, b, c, d, e, f )	\
+	inline void GlRecorder::name( GLRECORD_TYPE_##a x1, GLRECORD_TYPE_##b x2, GLRECORD_TYPE_##c x3, GLRECORD_TYPE_##d x4,	\
+		GLRECORD_TYPE_##e x5, GLRECORD_TYPE_##f x6 )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); GLRECORD_PUT_##a( x1 ); GLRECORD_PUT_##b( x2 ); GLRECORD_PUT_##c( x3 );	\
+	  GLRECORD_PUT_##d( x4 ); GLRECORD_PUT_##e( x5 ); GLRECORD_PUT_##f( x6 ); } gl##name( x1, x2, x3, x4, x5, x6 ); }
+
+#define GLRECORD_DEFINE_PARAMS1( name )	\
+	inline void GlRecorder::name( GLenum pname, const GLfloat *v )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); Put( pname ); PutArray( v, GlRecordParamCount( pname ) * sizeof( GLfloat ) ); }	\
+	  gl##name( pname, v ); }
+#define GLRECORD_DEFINE_PARAMS2( name )	\
+	inline void GlRecorder::name( GLenum which, GLenum pname, const GLfloat *v )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); Put( which ); Put( pname );	\
+	  PutArray( v, GlRecordParamCount( pname ) * sizeof( GLfloat ) ); } gl##name( which, pname, v ); }
+
+#define GLRECORD_DEFINE_UNIFORM( name, type, n )	\
+	inline void GlRecorder::name( GLint l, GLsizei c, const type *v )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); Put( l ); Put( c ); PutArray( v, c * n * sizeof( type ) ); }	\
+	  gl##name( l, c, v ); }
+#define GLRECORD_DEFINE_MATRIX( name, n )	\
+	inline void GlRecorder::name( GLint l, GLsizei c, GLboolean t, const GLfloat *v )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); Put( l ); Put( c ); Put( t ); PutArray( v, c * n * sizeof( GLfloat ) ); }	\
+	  gl##name( l, c, t, v ); }
+#define GLRECORD_DEFINE_PROGRAM_UNIFORM( name, type, n )	\
+	inline void GlRecorder::name( GLuint p, GLint l, GLsizei c, const type *v )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); Put( p ); Put( l ); Put( c ); PutArray( v, c * n * sizeof( type ) ); }	\
+	  gl##name( p, l, c, v ); }
+#define GLRECORD_DEFINE_PROGRAM_MATRIX( name, n )	\
+	inline void GlRecorder::name( GLuint p, GLint l, GLsizei c, GLboolean t, const GLfloat *v )	\
+	{ if( Recording ) { PutOp( GLRECORD_OP_##name ); Put( p ); Put( l ); Put( c ); Put( t );	\
+	  PutArray( v, c * n * sizeof( GLfloat ) ); } gl##name( p, l, c, t, v ); }
+
+GLRECORD_PLAIN_CALLS( GLRECORD_DEFINE0, GLRECORD_DEFINE1, GLRECORD_DEFINE2, GLRECORD_DEFINE3, GLRECORD_DEFINE4, GLRECORD_DEFINE5, GLRECORD_DEFINE6 )
+GLRECORD_PARAM_CALLS( GLRECORD_DEFINE_PARAMS1, GLRECORD_DEFINE_PARAMS2 )
+GLRECORD_UNIFORM_CALLS( GLRECORD_DEFINE_UNIFORM, GLRECORD_DEFINE_MATRIX )
+#ifndef __APPLE__
+GLRECORD_PLAIN_CALLS_NOT_APPLE( GLRECORD_DEFINE2, GLRECORD_DEFINE3 )
+GLRECORD_PROGRAM_UNIFORM_CALLS( GLRECORD_DEFINE_PROGRAM_UNIFORM, GLRECORD_DEFINE_PROGRAM_MATRIX )
+#endif
+
+
+// a buffer's contents are recorded whenever they are given:
+
+inline void
+GlRecorder::BufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_BufferData );
+		Put( target );
+		Put( (uint64_t)size );
+		Put( usage );
+		PutArray( data, data != NULL ? (size_t)size : 0 );
+	}
+	glBufferData( target, size, data, usage );
+}
+
+
+inline void
+GlRecorder::BufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void *data )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_BufferSubData );
+		Put( target );
+		Put( (uint64_t)offset );
+		PutArray( data, (size_t)size );
+	}
+	glBufferSubData( target, offset, size, data );
+}
+
+
+// the calls that take a pointer to what could have been separate arguments are
+// recorded as the calls that take the separate arguments:
+
+inline void
+GlRecorder::Color3fv( const GLfloat *v )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_Color3f );
+		Put( v[0] );	Put( v[1] );	Put( v[2] );
+	}
+	glColor3fv( v );
+}
+
+
+inline void
+GlRecorder::ColorPointer( GLint size, GLenum type, GLsizei stride, const void *offset )
+{
+	Pointer( GLRECORD_COLOR_ARRAY, 0, size, type, GL_FALSE, stride, offset );
+	glColorPointer( size, type, stride, offset );
+}
+
+
+inline GLuint
+GlRecorder::CreateProgram( )
+{
+	GLuint program = glCreateProgram( );
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_CreateProgram );
+		Put( program );
+	}
+	return program;
+}
+
+
+inline GLuint
+GlRecorder::CreateShader( GLenum type )
+{
+	GLuint shader = glCreateShader( type );
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_CreateShader );
+		Put( type );
+		Put( shader );
+	}
+	return shader;
+}
+
+
+// the objects that are made and deleted n at a time:
+
+#define GLRECORD_DEFINE_NAMES( name, op, get )	\
+	inline void GlRecorder::name( GLsizei n, get GLuint *names )	\
+	{ gl##name( n, names ); if( Recording ) { PutOp( op ); Put( n ); PutBytes( names, n * sizeof( GLuint ) ); } }
+
+GLRECORD_DEFINE_NAMES( DeleteBuffers, GLRECORD_OP_DeleteBuffers, const )
+GLRECORD_DEFINE_NAMES( DeleteFramebuffers, GLRECORD_OP_DeleteFramebuffers, const )
+GLRECORD_DEFINE_NAMES( DeleteRenderbuffers, GLRECORD_OP_DeleteRenderbuffers, const )
+GLRECORD_DEFINE_NAMES( GenBuffers, GLRECORD_OP_GenBuffers, )
+GLRECORD_DEFINE_NAMES( GenFramebuffers, GLRECORD_OP_GenFramebuffers, )
+GLRECORD_DEFINE_NAMES( GenRenderbuffers, GLRECORD_OP_GenRenderbuffers, )
+GLRECORD_DEFINE_NAMES( GenTextures, GLRECORD_OP_GenTextures, )
+
+
+// the indices come from the element buffer if there is one bound, and are recorded if not:
+
+inline void
+GlRecorder::DrawElements( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+	Elements( mode, count, type, indices, 0 );
+	glDrawElements( mode, count, type, indices );
+}
+
+
+inline void
+GlRecorder::DrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances )
+{
+	if( instances > 0 )
+		Elements( mode, count, type, indices, instances );
+	glDrawElementsInstanced( mode, count, type, indices, instances );
+}
+
+
+inline GLuint
+GlRecorder::GenLists( GLsizei range )
+{
+	GLuint first = glGenLists( range );
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_GenLists );
+		Put( range );
+		Put( first );
+	}
+	return first;
+}
+
+
+inline void
+GlRecorder::gluLookAt( GLdouble ex, GLdouble ey, GLdouble ez, GLdouble lx, GLdouble ly, GLdouble lz, GLdouble ux, GLdouble uy, GLdouble uz )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_gluLookAt );
+		Put( ex );	Put( ey );	Put( ez );
+		Put( lx );	Put( ly );	Put( lz );
+		Put( ux );	Put( uy );	Put( uz );
+	}
+	::gluLookAt( ex, ey, ez, lx, ly, lz, ux, uy, uz );
+}
+
+
+inline void
+GlRecorder::gluOrtho2D( GLdouble left, GLdouble right, GLdouble bottom, GLdouble top )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_gluOrtho2D );
+		Put( left );	Put( right );	Put( bottom );	Put( top );
+	}
+	::gluOrtho2D( left, right, bottom, top );
+}
+
+
+inline void
+GlRecorder::gluPerspective( GLdouble fovy, GLdouble aspect, GLdouble zNear, GLdouble zFar )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_gluPerspective );
+		Put( fovy );	Put( aspect );	Put( zNear );	Put( zFar );
+	}
+	::gluPerspective( fovy, aspect, zNear, zFar );
+}
+
+
+inline void
+GlRecorder::Normal3fv( const GLfloat *v )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_Normal3f );
+		Put( v[0] );	Put( v[1] );	Put( v[2] );
+	}
+	glNormal3fv( v );
+}
+
+
+inline void
+GlRecorder::NormalPointer( GLenum type, GLsizei stride, const void *offset )
+{
+	Pointer( GLRECORD_NORMAL_ARRAY, 0, 3, type, GL_FALSE, stride, offset );
+	glNormalPointer( type, stride, offset );
+}
+
+
+#ifndef __APPLE__
+inline void
+GlRecorder::ProgramBinary( GLuint program, GLenum format, const void *binary, GLsizei length )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_ProgramBinary );
+		Put( program );
+		Put( format );
+		PutArray( binary, (size_t)length );
+	}
+	glProgramBinary( program, format, binary, length );
+}
+#endif
+
+
+inline void
+GlRecorder::ShaderSource( GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_ShaderSource );
+		Put( shader );
+		Put( count );
+		for( int i = 0; i < count; i++ )
+			PutArray( strings[i], lengths != NULL && lengths[i] >= 0 ? (size_t)lengths[i] : strlen( strings[i] ) );
+	}
+	glShaderSource( shader, count, strings, lengths );
+}
+
+
+inline void
+GlRecorder::TexCoordPointer( GLint size, GLenum type, GLsizei stride, const void *offset )
+{
+	Pointer( GLRECORD_TEXCOORD_ARRAY, 0, size, type, GL_FALSE, stride, offset );
+	glTexCoordPointer( size, type, stride, offset );
+}
+
+
+inline void
+GlRecorder::TexImage2D( GLenum target, GLint level, GLint internal, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_TexImage2D );
+		Put( target );	Put( level );	Put( internal );
+		Put( width );	Put( height );	Put( (GLsizei)1 );	Put( border );
+		Put( format );	Put( type );
+		Pixels( width, height, 1, format, type, pixels );
+	}
+	glTexImage2D( target, level, internal, width, height, border, format, type, pixels );
+}
+
+
+inline void
+GlRecorder::TexImage3D( GLenum target, GLint level, GLint internal, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *pixels )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_TexImage3D );
+		Put( target );	Put( level );	Put( internal );
+		Put( width );	Put( height );	Put( depth );	Put( border );
+		Put( format );	Put( type );
+		Pixels( width, height, depth, format, type, pixels );
+	}
+	glTexImage3D( target, level, internal, width, height, depth, border, format, type, pixels );
+}
+
+
+inline void
+GlRecorder::TexSubImage2D( GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_TexSubImage2D );
+		Put( target );	Put( level );
+		Put( x );	Put( y );	Put( (GLint)0 );
+		Put( width );	Put( height );	Put( (GLsizei)1 );
+		Put( format );	Put( type );
+		Pixels( width, height, 1, format, type, pixels );
+	}
+	glTexSubImage2D( target, level, x, y, width, height, format, type, pixels );
+}
+
+
+inline void
+GlRecorder::TexSubImage3D( GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_TexSubImage3D );
+		Put( target );	Put( level );
+		Put( x );	Put( y );	Put( z );
+		Put( width );	Put( height );	Put( depth );
+		Put( format );	Put( type );
+		Pixels( width, height, depth, format, type, pixels );
+	}
+	glTexSubImage3D( target, level, x, y, z, width, height, depth, format, type, pixels );
+}
+
+
+inline void
+GlRecorder::Vertex3fv( const GLfloat *v )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_Vertex3f );
+		Put( v[0] );	Put( v[1] );	Put( v[2] );
+	}
+	glVertex3fv( v );
+}
+
+
+inline void
+GlRecorder::VertexAttrib3fv( GLuint index, const GLfloat *v )
+{
+	if( Recording )
+	{
+		PutOp( GLRECORD_OP_VertexAttrib3f );
+		Put( index );
+		Put( v[0] );	Put( v[1] );	Put( v[2] );
+	}
+	glVertexAttrib3fv( index, v );
+}
+
+
+inline void
+GlRecorder::VertexAttribPointer( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *offset )
+{
+	Pointer( GLRECORD_ATTRIB_ARRAY, index, size, type, normalized, stride, offset );
+	glVertexAttribPointer( index, size, type, normalized, stride, offset );
+}
+
+
+inline void
+GlRecorder::VertexPointer( GLint size, GLenum type, GLsizei stride, const void *offset )
+{
+	Pointer( GLRECORD_VERTEX_ARRAY, 0, size, type, GL_FALSE, stride, offset );
+	glVertexPointer( size, type, stride, offset );
+}
+
+
+// From here on, the calls are recorded.
+// (glew makes most of these names macros already, glstats.h makes some, and the rest are functions.)
+
+#undef glActiveTexture
+#undef glAttachShader
+#undef glBegin
+#undef glBindBuffer
+#undef glBindFramebuffer
+#undef glBindRenderbuffer
+#undef glBindTexture
+#undef glBlendFunc
+#undef glBufferData
+#undef glBufferSubData
+#undef glCallList
+#undef glClear
+#undef glClearColor
+#undef glClientActiveTexture
+#undef glColor3f
+#undef glColor3fv
+#undef glColorMask
+#undef glColorPointer
+#undef glCompileShader
+#undef glCreateProgram
+#undef glCreateShader
+#undef glDeleteBuffers
+#undef glDeleteFramebuffers
+#undef glDeleteProgram
+#undef glDeleteRenderbuffers
+#undef glDeleteShader
+#undef glDepthFunc
+#undef glDepthMask
+#undef glDisable
+#undef glDisableClientState
+#undef glDisableVertexAttribArray
+#undef glDrawArrays
+#undef glDrawArraysInstanced
+#undef glDrawBuffer
+#undef glDrawElements
+#undef glDrawElementsInstanced
+#undef glEnable
+#undef glEnableClientState
+#undef glEnableVertexAttribArray
+#undef glEnd
+#undef glEndList
+#undef glFlush
+#undef glFogf
+#undef glFogfv
+#undef glFogi
+#undef glFramebufferRenderbuffer
+#undef glFramebufferTexture2D
+#undef glGenBuffers
+#undef glGenFramebuffers
+#undef glGenLists
+#undef glGenRenderbuffers
+#undef glGenTextures
+#undef glLightf
+#undef glLightfv
+#undef glLineWidth
+#undef glLinkProgram
+#undef glLoadIdentity
+#undef glMaterialf
+#undef glMaterialfv
+#undef glMatrixMode
+#undef glMultiTexCoord1f
+#undef glNewList
+#undef glNormal3f
+#undef glNormal3fv
+#undef glNormalPointer
+#undef glOrtho
+#undef glPixelStorei
+#undef glPointSize
+#undef glPolygonOffset
+#undef glPopAttrib
+#undef glPopClientAttrib
+#undef glPopMatrix
+#undef glPushAttrib
+#undef glPushClientAttrib
+#undef glPushMatrix
+#undef glRasterPos3f
+#undef glReadBuffer
+#undef glRenderbufferStorage
+#undef glRotatef
+#undef glScalef
+#undef glShadeModel
+#undef glShaderSource
+#undef glTexCoord2f
+#undef glTexCoordPointer
+#undef glTexEnvf
+#undef glTexEnvfv
+#undef glTexEnvi
+#undef glTexGenfv
+#undef glTexGeni
+#undef glTexImage2D
+#undef glTexImage3D
+#undef glTexParameterfv
+#undef glTexParameteri
+#undef glTexSubImage2D
+#undef glTexSubImage3D
+#undef glTranslatef
+#undef glUniform1fv
+#undef glUniform1iv
+#undef glUniform2fv
+#undef glUniform2iv
+#undef glUniform3fv
+#undef glUniform3iv
+#undef glUniform4fv
+#undef glUniform4iv
+#undef glUniformMatrix2fv
+#undef glUniformMatrix3fv
+#undef glUniformMatrix4fv
+#undef glUseProgram
+#undef glValidateProgram
+#undef glVertex3f
+#undef glVertex3fv
+#undef glVertexAttrib1d
+#undef glVertexAttrib1f
+#undef glVertexAttrib3f
+#undef glVertexAttrib3fv
+#undef glVertexAttribPointer
+#undef glVertexPointer
+#undef glViewport
+
+#define glActiveTexture( a )				GlRecorder::ActiveTexture( a )
+#define glAttachShader( a, b )				GlRecorder::AttachShader( a, b )
+#define glBegin( a )					GlRecorder::Begin( a )
+#define glBindBuffer( a, b )				GlRecorder::BindBuffer( a, b )
+#define glBindFramebuffer( a, b )			GlRecorder::BindFramebuffer( a, b )
+#define glBindRenderbuffer( a, b )			GlRecorder::BindRenderbuffer( a, b )
+#define glBindTexture( a, b )				GlRecorder::BindTexture( a, b )
+#define glBlendFunc( a, b )				GlRecorder::BlendFunc( a, b )
+#define glBufferData( a, b, c, d )			GlRecorder::BufferData( a, b, c, d )
+#define glBufferSubData( a, b, c, d )			GlRecorder::BufferSubData( a, b, c, d )
+#define glCallList( a )					GlRecorder::CallList( a )
+#define glClear( a )					GlRecorder::Clear( a )
+#define glClearColor( a, b, c, d )			GlRecorder::ClearColor( a, b, c, d )
+#define glClientActiveTexture( a )			GlRecorder::ClientActiveTexture( a )
+#define glColor3f( a, b, c )				GlRecorder::Color3f( a, b, c )
+#define glColor3fv( a )					GlRecorder::Color3fv( a )
+#define glColorMask( a, b, c, d )			GlRecorder::ColorMask( a, b, c, d )
+#define glColorPointer( a, b, c, d )			GlRecorder::ColorPointer( a, b, c, d )
+#define glCompileShader( a )				GlRecorder::CompileShader( a )
+#define glCreateProgram( )				GlRecorder::CreateProgram( )
+#define glCreateShader( a )				GlRecorder::CreateShader( a )
+#define glDeleteBuffers( a, b )				GlRecorder::DeleteBuffers( a, b )
+#define glDeleteFramebuffers( a, b )			GlRecorder::DeleteFramebuffers( a, b )
+#define glDeleteProgram( a )				GlRecorder::DeleteProgram( a )
+#define glDeleteRenderbuffers( a, b )			GlRecorder::DeleteRenderbuffers( a, b )
+#define glDeleteShader( a )				GlRecorder::DeleteShader( a )
+#define glDepthFunc( a )				GlRecorder::DepthFunc( a )
+#define glDepthMask( a )				GlRecorder::DepthMask( a )
+#define glDisable( a )					GlRecorder::Disable( a )
+#define glDisableClientState( a )			GlRecorder::DisableClientState( a )
+#define glDisableVertexAttribArray( a )			GlRecorder::DisableVertexAttribArray( a )
+#define glDrawArrays( a, b, c )				GlRecorder::DrawArrays( a, b, c )
+#define glDrawArraysInstanced( a, b, c, d )		GlRecorder::DrawArraysInstanced( a, b, c, d )
+#define glDrawBuffer( a )				GlRecorder::DrawBuffer( a )
+#define glDrawElements( a, b, c, d )			GlRecorder::DrawElements( a, b, c, d )
+#define glDrawElementsInstanced( a, b, c, d, e )	GlRecorder::DrawElementsInstanced( a, b, c, d, e )
+#define glEnable( a )					GlRecorder::Enable( a )
+#define glEnableClientState( a )			GlRecorder::EnableClientState( a )
+#define glEnableVertexAttribArray( a )			GlRecorder::EnableVertexAttribArray( a )
+#define glEnd( )					GlRecorder::End( )
+#define glEndList( )					GlRecorder::EndList( )
+#define glFlush( )					GlRecorder::Flush( )
+#define glFogf( a, b )					GlRecorder::Fogf( a, b )
+#define glFogfv( a, b )					GlRecorder::Fogfv( a, b )
+#define glFogi( a, b )					GlRecorder::Fogi( a, b )
+#define glFramebufferRenderbuffer( a, b, c, d )		GlRecorder::FramebufferRenderbuffer( a, b, c, d )
+#define glFramebufferTexture2D( a, b, c, d, e )		GlRecorder::FramebufferTexture2D( a, b, c, d, e )
+#define glGenBuffers( a, b )				GlRecorder::GenBuffers( a, b )
+#define glGenFramebuffers( a, b )			GlRecorder::GenFramebuffers( a, b )
+#define glGenLists( a )					GlRecorder::GenLists( a )
+#define glGenRenderbuffers( a, b )			GlRecorder::GenRenderbuffers( a, b )
+#define glGenTextures( a, b )				GlRecorder::GenTextures( a, b )
+#define glLightf( a, b, c )				GlRecorder::Lightf( a, b, c )
+#define glLightfv( a, b, c )				GlRecorder::Lightfv( a, b, c )
+#define glLineWidth( a )				GlRecorder::LineWidth( a )
+#define glLinkProgram( a )				GlRecorder::LinkProgram( a )
+#define glLoadIdentity( )				GlRecorder::LoadIdentity( )
+#define glMaterialf( a, b, c )				GlRecorder::Materialf( a, b, c )
+#define glMaterialfv( a, b, c )				GlRecorder::Materialfv( a, b, c )
+#define glMatrixMode( a )				GlRecorder::MatrixMode( a )
+#define glMultiTexCoord1f( a, b )			GlRecorder::MultiTexCoord1f( a, b )
+#define glNewList( a, b )				GlRecorder::NewList( a, b )
+#define glNormal3f( a, b, c )				GlRecorder::Normal3f( a, b, c )
+#define glNormal3fv( a )				GlRecorder::Normal3fv( a )
+#define glNormalPointer( a, b, c )			GlRecorder::NormalPointer( a, b, c )
+#define glOrtho( a, b, c, d, e, f )			GlRecorder::Ortho( a, b, c, d, e, f )
+#define glPixelStorei( a, b )				GlRecorder::PixelStorei( a, b )
+#define glPointSize( a )				GlRecorder::PointSize( a )
+#define glPolygonOffset( a, b )				GlRecorder::PolygonOffset( a, b )
+#define glPopAttrib( )					GlRecorder::PopAttrib( )
+#define glPopClientAttrib( )				GlRecorder::PopClientAttrib( )
+#define glPopMatrix( )					GlRecorder::PopMatrix( )
+#define glPushAttrib( a )				GlRecorder::PushAttrib( a )
+#define glPushClientAttrib( a )				GlRecorder::PushClientAttrib( a )
+#define glPushMatrix( )					GlRecorder::PushMatrix( )
+#define glRasterPos3f( a, b, c )			GlRecorder::RasterPos3f( a, b, c )
+#define glReadBuffer( a )				GlRecorder::ReadBuffer( a )
+#define glRenderbufferStorage( a, b, c, d )		GlRecorder::RenderbufferStorage( a, b, c, d )
+#define glRotatef( a, b, c, d )				GlRecorder::Rotatef( a, b, c, d )
+#define glScalef( a, b, c )				GlRecorder::Scalef( a, b, c )
+#define glShadeModel( a )				GlRecorder::ShadeModel( a )
+#define glShaderSource( a, b, c, d )			GlRecorder::ShaderSource( a, b, c, d )
+#define glTexCoord2f( a, b )				GlRecorder::TexCoord2f( a, b )
+#define glTexCoordPointer( a, b, c, d )			GlRecorder::TexCoordPointer( a, b, c, d )
+#define glTexEnvf( a, b, c )				GlRecorder::TexEnvf( a, b, c )
+#define glTexEnvfv( a, b, c )				GlRecorder::TexEnvfv( a, b, c )
+#define glTexEnvi( a, b, c )				GlRecorder::TexEnvi( a, b, c )
+#define glTexGenfv( a, b, c )				GlRecorder::TexGenfv( a, b, c )
+#define glTexGeni( a, b, c )				GlRecorder::TexGeni( a, b, c )
+#define glTexImage2D( a, b, c, d, e, f, g, h, i )	GlRecorder::TexImage2D( a, b, c, d, e, f, g, h, i )
+#define glTexImage3D( a, b, c, d, e, f, g, h, i, j )	GlRecorder::TexImage3D( a, b, c, d, e, f, g, h, i, j )
+#define glTexParameterfv( a, b, c )			GlRecorder::TexParameterfv( a, b, c )
+#define glTexParameteri( a, b, c )			GlRecorder::TexParameteri( a, b, c )
+#define glTexSubImage2D( a, b, c, d, e, f, g, h, i )	GlRecorder::TexSubImage2D( a, b, c, d, e, f, g, h, i )
+#define glTexSubImage3D( a, b, c, d, e, f, g, h, i, j, k )	GlRecorder::TexSubImage3D( a, b, c, d, e, f, g, h, i, j, k )
+#define glTranslatef( a, b, c )				GlRecorder::Translatef( a, b, c )
+#define glUniform1fv( a, b, c )				GlRecorder::Uniform1fv( a, b, c )
+#define glUniform1iv( a, b, c )				GlRecorder::Uniform1iv( a, b, c )
+#define glUniform2fv( a, b, c )				GlRecorder::Uniform2fv( a, b, c )
+#define glUniform2iv( a, b, c )				GlRecorder::Uniform2iv( a, b, c )
+#define glUniform3fv( a, b, c )				GlRecorder::Uniform3fv( a, b, c )
+#define glUniform3iv( a, b, c )				GlRecorder::Uniform3iv( a, b, c )
+#define glUniform4fv( a, b, c )				GlRecorder::Uniform4fv( a, b, c )
+#define glUniform4iv( a, b, c )				GlRecorder::Uniform4iv( a, b, c )
+#define glUniformMatrix2fv( a, b, c, d )		GlRecorder::UniformMatrix2fv( a, b, c, d )
+#define glUniformMatrix3fv( a, b, c, d )		GlRecorder::UniformMatrix3fv( a, b, c, d )
+#define glUniformMatrix4fv( a, b, c, d )		GlRecorder::UniformMatrix4fv( a, b, c, d )
+#define glUseProgram( a )				GlRecorder::UseProgram( a )
+#define glValidateProgram( a )				GlRecorder::ValidateProgram( a )
+#define glVertex3f( a, b, c )				GlRecorder::Vertex3f( a, b, c )
+#define glVertex3fv( a )				GlRecorder::Vertex3fv( a )
+#define glVertexAttrib1d( a, b )			GlRecorder::VertexAttrib1d( a, b )
+#define glVertexAttrib1f( a, b )			GlRecorder::VertexAttrib1f( a, b )
+#define glVertexAttrib3f( a, b, c, d )			GlRecorder::VertexAttrib3f( a, b, c, d )
+#define glVertexAttrib3fv( a, b )			GlRecorder::VertexAttrib3fv( a, b )
+#define glVertexAttribPointer( a, b, c, d, e, f )	GlRecorder::VertexAttribPointer( a, b, c, d, e, f )
+#define glVertexPointer( a, b, c, d )			GlRecorder::VertexPointer( a, b, c, d )
+#define glViewport( a, b, c, d )			GlRecorder::Viewport( a, b, c, d )
+
+#undef gluLookAt
+#undef gluOrtho2D
+#undef gluPerspective
+
+#define gluLookAt( a, b, c, d, e, f, g, h, i )		GlRecorder::gluLookAt( a, b, c, d, e, f, g, h, i )
+#define gluOrtho2D( a, b, c, d )			GlRecorder::gluOrtho2D( a, b, c, d )
+#define gluPerspective( a, b, c, d )			GlRecorder::gluPerspective( a, b, c, d )
+
+#ifndef __APPLE__
+#undef glDispatchCompute
+#undef glProgramBinary
+#undef glProgramParameteri
+#undef glProgramUniform1fv
+#undef glProgramUniform1iv
+#undef glProgramUniform2fv
+#undef glProgramUniform2iv
+#undef glProgramUniform3fv
+#undef glProgramUniform3iv
+#undef glProgramUniform4fv
+#undef glProgramUniform4iv
+#undef glProgramUniformMatrix2fv
+#undef glProgramUniformMatrix3fv
+#undef glProgramUniformMatrix4fv
+#undef glUniform1d
+
+#define glDispatchCompute( a, b, c )			GlRecorder::DispatchCompute( a, b, c )
+#define glProgramBinary( a, b, c, d )			GlRecorder::ProgramBinary( a, b, c, d )
+#define glProgramParameteri( a, b, c )			GlRecorder::ProgramParameteri( a, b, c )
+#define glProgramUniform1fv( a, b, c, d )		GlRecorder::ProgramUniform1fv( a, b, c, d )
+#define glProgramUniform1iv( a, b, c, d )		GlRecorder::ProgramUniform1iv( a, b, c, d )
+#define glProgramUniform2fv( a, b, c, d )		GlRecorder::ProgramUniform2fv( a, b, c, d )
+#define glProgramUniform2iv( a, b, c, d )		GlRecorder::ProgramUniform2iv( a, b, c, d )
+#define glProgramUniform3fv( a, b, c, d )		GlRecorder::ProgramUniform3fv( a, b, c, d )
+#define glProgramUniform3iv( a, b, c, d )		GlRecorder::ProgramUniform3iv( a, b, c, d )
+#define glProgramUniform4fv( a, b, c, d )		GlRecorder::ProgramUniform4fv( a, b, c, d )
+#define glProgramUniform4iv( a, b, c, d )		GlRecorder::ProgramUniform4iv( a, b, c, d )
+#define glProgramUniformMatrix2fv( a, b, c, d, e )	GlRecorder::ProgramUniformMatrix2fv( a, b, c, d, e )
+#define glProgramUniformMatrix3fv( a, b, c, d, e )	GlRecorder::ProgramUniformMatrix3fv( a, b, c, d, e )
+#define glProgramUniformMatrix4fv( a, b, c, d, e )	GlRecorder::ProgramUniformMatrix4fv( a, b, c, d, e )
+#define glUniform1d( a, b )				GlRecorder::Uniform1d( a, b )
+#endif
+
+#endif	// GLRECORD_H
@@ -0,0 +1,720 @@
+// Play back a recording of the forest's OpenGL calls (see glrecord.h) offscreen, as fast
+// as it will go -- so what the OpenGL calls cost can be measured, and changed, without
+// the rest of the forest: no simulation, no culling, no animal updates, just the calls.
+//
+//	forest_replay file.glrec [--loops n] [--output file.ppm]
+//
+// Everything before the first recorded frame (the uploads, the shaders, the display lists, ...)
+// is played once, then the frames are played over and over, --loops times. It draws into a
+// framebuffer object as big as what was recorded, on a headless context (see headless.h),
+// which is what "make forest_replay" builds it for. The recording has to come from the same
+// driver: the uniform and attribute locations in it are the ones that driver picked.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "headless.cpp"
+#include "glcommands.h"
+
+
+// how many times the frames are played unless --loops says otherwise:
+
+const int REPLAY_LOOPS = 100;
+
+// what it exits with when it cannot finish (the same as forest --headless, where they match):
+
+const int REPLAY_BAD_ARGUMENTS = 1;
+const int REPLAY_NO_CONTEXT = 2;
+const int REPLAY_GL_ERRORS = 3;
+const int REPLAY_NO_OUTPUT = 4;
+const int REPLAY_BAD_RECORDING = 5;
+
+
+class GlReplay
+{
+private:
+	bool	Bad;			// ran off the end, or into something that is not a command
+	std::vector<unsigned char>	Bytes;	// the whole recording
+	GLuint	DefaultFbo;		// what gets drawn into for framebuffer 0
+	const unsigned char *	End;
+	const unsigned char *	FirstFrame;
+	int	Height;
+	const unsigned char *	Pos;
+	std::vector<unsigned char>	Scratch;	// arrays that have to be aligned
+	std::vector<GLint>	SourceLengths;
+	std::vector<const GLchar *>	Sources;
+	int	Width;
+
+	// the names the recording used, and the ones they are here:
+	std::vector<GLuint>	Buffers;
+	std::vector<GLuint>	Framebuffers;
+	std::vector<GLuint>	Lists;
+	std::vector<GLuint>	Programs;
+	std::vector<GLuint>	Renderbuffers;
+	std::vector<GLuint>	Shaders;
+	std::vector<GLuint>	Textures;
+
+	GLenum	ColorBuffer( GLenum );
+	GLuint	Framebuffer( GLuint );
+	const void *	GetArray( bool );
+	void	GetNames( std::vector<GLuint> &, std::vector<GLuint> & );
+	const void *	GetPixels( );
+	GLuint	Name( const std::vector<GLuint> &, GLuint );
+	bool	Play( bool, int * );
+	void	SetName( std::vector<GLuint> &, GLuint, GLuint );
+
+	template<class T> T	Get( )
+	{
+		T value;
+		if( Pos + sizeof( value ) > End )
+		{
+			Bad = true;
+			memset( &value, 0, sizeof( value ) );
+			return value;
+		}
+		memcpy( &value, Pos, sizeof( value ) );
+		Pos += sizeof( value );
+		return value;
+	}
+
+public:
+	GlReplay( );
+
+	int	GetHeight( );
+	int	GetWidth( );
+	bool	Load( const char * );
+	bool	PlayFrames( int * );
+	bool	PlaySetup( );
+	void	SetDefaultFramebuffer( GLuint );
+};
+
+
+GlReplay::GlReplay( )
+{
+	Bad = false;
+	DefaultFbo = 0;
+	End = FirstFrame = Pos = NULL;
+	Width = Height = 0;
+}
+
+
+// the window's color buffers are the framebuffer object's one color attachment here:
+
+GLenum
+GlReplay::ColorBuffer( GLenum buffer )
+{
+	switch( buffer )
+	{
+		case GL_BACK:
+		case GL_BACK_LEFT:
+		case GL_FRONT:
+		case GL_FRONT_AND_BACK:
+		case GL_FRONT_LEFT:
+		case GL_LEFT:
+			return GL_COLOR_ATTACHMENT0;
+	}
+	return buffer;
+}
+
+
+GLuint
+GlReplay::Framebuffer( GLuint framebuffer )
+{
+	if( framebuffer == 0 )
+		return DefaultFbo;
+	return Name( Framebuffers, framebuffer );
+}
+
+
+// a 32-bit byte count, then the bytes -- returns NULL if there are none, and copies them
+// if they have to be aligned (the uniforms and parameters, which are small):
+
+const void *
+GlReplay::GetArray( bool aligned )
+{
+	unsigned int bytes = Get<unsigned int>( );
+	if( bytes == 0  ||  Bad )
+		return NULL;
+	if( Pos + bytes > End )
+	{
+		Bad = true;
+		return NULL;
+	}
+
+	const void *data = Pos;
+	Pos += bytes;
+	if( aligned )
+	{
+		Scratch.assign( (const unsigned char *)data, (const unsigned char *)data + bytes );
+		return &Scratch[0];
+	}
+	return data;
+}
+
+
+// n, then n recorded names, which become the names in mine:
+
+void
+GlReplay::GetNames( std::vector<GLuint> &mine, std::vector<GLuint> &recorded )
+{
+	GLsizei n = Get<GLsizei>( );
+	if( n < 0 )
+	{
+		Bad = true;
+		n = 0;
+	}
+	recorded.resize( n );
+	for( int i = 0; i < n; i++ )
+		recorded[i] = Get<GLuint>( );
+	mine.resize( n );
+}
+
+
+int
+GlReplay::GetHeight( )
+{
+	return Height;
+}
+
+
+// what goes in the pixels' place in a glTex*Image*( ):
+
+const void *
+GlReplay::GetPixels( )
+{
+	switch( Get<unsigned char>( ) )
+	{
+		case GLRECORD_NO_PIXELS:
+			return NULL;
+
+		case GLRECORD_PIXELS:
+			return GetArray( false );
+
+		case GLRECORD_UNPACK_BUFFER:
+			return (const void *)(uintptr_t)Get<uint64_t>( );
+	}
+	Bad = true;
+	return NULL;
+}
+
+
+int
+GlReplay::GetWidth( )
+{
+	return Width;
+}
+
+
+// read in the whole recording:
+
+bool
+GlReplay::Load( const char *filename )
+{
+	FILE *fp = fopen( filename, "rb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open OpenGL recording '%s'\n", filename );
+		return false;
+	}
+
+	unsigned char block[65536];
+	size_t n;
+	Bytes.clear( );
+	while( ( n = fread( block, 1, sizeof( block ), fp ) ) > 0 )
+		Bytes.insert( Bytes.end( ), block, block + n );
+	fclose( fp );
+
+	unsigned int header[3];
+	if( Bytes.size( ) < 4 + sizeof( header )  ||  memcmp( &Bytes[0], GLRECORD_MAGIC, 4 ) != 0 )
+	{
+		fprintf( stderr, "'%s' is not an OpenGL recording\n", filename );
+		return false;
+	}
+	memcpy( header, &Bytes[4], sizeof( header ) );
+	if( header[0] != GLRECORD_VERSION )
+	{
+		fprintf( stderr, "'%s' is a version %u OpenGL recording -- this plays version %d\n", filename, header[0], GLRECORD_VERSION );
+		return false;
+	}
+
+	Width = (int)header[1];
+	Height = (int)header[2];
+	Pos = &Bytes[0] + 4 + sizeof( header );
+	End = &Bytes[0] + Bytes.size( );
+	FirstFrame = NULL;
+	Bad = false;
+	return true;
+}
+
+
+GLuint
+GlReplay::Name( const std::vector<GLuint> &names, GLuint recorded )
+{
+	if( recorded < names.size( )  &&  names[recorded] != 0 )
+		return names[recorded];
+	return recorded;
+}
+
+
+// make the calls from Pos on -- up to the first frame if setup is true, or to the end
+// if not, counting the frames on the way; returns false if the recording is broken:
+
+#define GLREPLAY_GET_GLbitfield( )	Get<GLbitfield>( )
+#define GLREPLAY_GET_GLboolean( )	Get<GLboolean>( )
+#define GLREPLAY_GET_GLdouble( )	Get<GLdouble>( )
+#define GLREPLAY_GET_GLenum( )		Get<GLenum>( )
+#define GLREPLAY_GET_GLfloat( )		Get<GLfloat>( )
+#define GLREPLAY_GET_GLint( )		Get<GLint>( )
+#define GLREPLAY_GET_GLsizei( )		Get<GLsizei>( )
+#define GLREPLAY_GET_GLuint( )		Get<GLuint>( )
+#define GLREPLAY_GET_BUFFER( )		Name( Buffers, Get<GLuint>( ) )
+#define GLREPLAY_GET_COLORBUFFER( )	ColorBuffer( Get<GLenum>( ) )
+#define GLREPLAY_GET_FRAMEBUFFER( )	Framebuffer( Get<GLuint>( ) )
+#define GLREPLAY_GET_LIST( )		Name( Lists, Get<GLuint>( ) )
+#define GLREPLAY_GET_PROGRAM( )		Name( Programs, Get<GLuint>( ) )
+#define GLREPLAY_GET_RENDERBUFFER( )	Name( Renderbuffers, Get<GLuint>( ) )
+#define GLREPLAY_GET_SHADER( )		Name( Shaders, Get<GLuint>( ) )
+#define GLREPLAY_GET_TEXTURE( )		Name( Textures, Get<GLuint>( ) )
+
+// (each argument is read into its own variable, so they are read in order:)
+#define GLREPLAY_CALL0( name )	\
+	case GLRECORD_OP_##name:	gl##name( );	break;
+#define GLREPLAY_CALL1( name, a )	\
+	case GLRECORD_OP_##name:	{ GLRECORD_TYPE_##a x1 = GLREPLAY_GET_##a( );	gl##name( x1 ); }	break;
+#define GLREPLAY_CALL2( name, a, b )	\
+	case GLRECORD_OP_##name:	{ GLRECORD_TYPE_##a x1 = GLREPLAY_GET_##a( );	GLRECORD_TYPE_##b x2 = GLREPLAY_GET_##b( );	\
+		gl##name( x1, x2 ); }	break;
+#define GLREPLAY_CALL3( name, a, b, c )	\
+	case GLRECORD_OP_##name:	{ GLRECORD_TYPE_##a x1 = GLREPLAY_GET_##a( );	GLRECORD_TYPE_##b x2 = GLREPLAY_GET_##b( );	\
+		GLRECORD_TYPE_##c x3 = GLREPLAY_GET_##c( );	gl##name( x1, x2, x3 ); }	break;
+#define GLREPLAY_CALL4( name, a, b, c, d )	\
+	case GLRECORD_OP_##name:	{ GLRECORD_TYPE_##a x1 = GLREPLAY_GET_##a( );	GLRECORD_TYPE_##b x2 = GLREPLAY_GET_##b( );	\
+		GLRECORD_TYPE_##c x3 = GLREPLAY_GET_##c( );	GLRECORD_TYPE_##d x4 = GLREPLAY_GET_##d( );	gl##name( x1, x2, x3, x4 ); }	break;
+#define GLREPLAY_CALL5( name, a, b, c, d, e )	\
+	case GLRECORD_OP_##name:	{ GLRECORD_TYPE_##a x1 = GLREPLAY_GET_##a( );	GLRECORD_TYPE_##b x2 = GLREPLAY_GET_##b( );	\
+		GLRECORD_TYPE_##c x3 = GLREPLAY_GET_##c( );	GLRECORD_TYPE_##d x4 = GLREPLAY_GET_##d( );	\
+		GLRECORD_TYPE_##e x5 = GLREPLAY_GET_##e( );	gl##name( x1, x2, x3, x4, x5 ); }	break;
+#define GLREPLAY_CALL6( name, a, b, c, d, e, f )	\
+	case GLRECORD_OP_##name:	{ GLRECORD_TYPE_##a x1 = GLREPLAY_GET_##a( );	GLRECORD_TYPE_##b x2 = GLREPLAY_GET_##b( );	\
+		GLRECORD_TYPE_##c x3 = GLREPLAY_GET_##c( );	GLRECORD_TYPE_##d x4 = GLREPLAY_GET_##d( );	\
+		GLRECORD_TYPE_##e x5 = GLREPLAY_GET_##e( );	GLRECORD_TYPE_##f x6 = GLREPLAY_GET_##f( );	\
+		gl##name( x1, x2, x3, x4, x5, x6 ); }	break;
+
+#define GLREPLAY_PARAMS1( name )	\
+	case GLRECORD_OP_##name:	{ GLenum pname = Get<GLenum>( );	gl##name( pname, (const GLfloat *)GetArray( true ) ); }	break;
+#define GLREPLAY_PARAMS2( name )	\
+	case GLRECORD_OP_##name:	{ GLenum which = Get<GLenum>( );	GLenum pname = Get<GLenum>( );	\
+		gl##name( which, pname, (const GLfloat *)GetArray( true ) ); }	break;
+
+#define GLREPLAY_UNIFORM( name, type, n )	\
+	case GLRECORD_OP_##name:	{ GLint l = Get<GLint>( );	GLsizei c = Get<GLsizei>( );	\
+		gl##name( l, c, (const type *)GetArray( true ) ); }	break;
+#define GLREPLAY_MATRIX( name, n )	\
+	case GLRECORD_OP_##name:	{ GLint l = Get<GLint>( );	GLsizei c = Get<GLsizei>( );	GLboolean t = Get<GLboolean>( );	\
+		gl##name( l, c, t, (const GLfloat *)GetArray( true ) ); }	break;
+#define GLREPLAY_PROGRAM_UNIFORM( name, type, n )	\
+	case GLRECORD_OP_##name:	{ GLuint p = GLREPLAY_GET_PROGRAM( );	GLint l = Get<GLint>( );	GLsizei c = Get<GLsizei>( );	\
+		gl##name( p, l, c, (const type *)GetArray( true ) ); }	break;
+#define GLREPLAY_PROGRAM_MATRIX( name, n )	\
+	case GLRECORD_OP_##name:	{ GLuint p = GLREPLAY_GET_PROGRAM( );	GLint l = Get<GLint>( );	GLsizei c = Get<GLsizei>( );	\
+		GLboolean t = Get<GLboolean>( );	gl##name( p, l, c, t, (const GLfloat *)GetArray( true ) ); }	break;
+
+bool
+GlReplay::Play( bool setup, int *frames )
+{
+	std::vector<GLuint> mine, recorded;
+	while( Pos < End  &&  ! Bad )
+	{
+		const unsigned char *start = Pos;
+		unsigned char op = Get<unsigned char>( );
+		switch( op )
+		{
+			case GLRECORD_OP_FRAME:
+				if( setup )
+				{
+					Pos = start;
+					return true;
+				}
+				if( frames != NULL )
+					( *frames )++;
+				break;
+
+			GLRECORD_PLAIN_CALLS( GLREPLAY_CALL0, GLREPLAY_CALL1, GLREPLAY_CALL2, GLREPLAY_CALL3, GLREPLAY_CALL4, GLREPLAY_CALL5, GLREPLAY_CALL6 )
+			GLRECORD_PLAIN_CALLS_NOT_APPLE( GLREPLAY_CALL2, GLREPLAY_CALL3 )
+			GLRECORD_PARAM_CALLS( GLREPLAY_PARAMS1, GLREPLAY_PARAMS2 )
+			GLRECORD_UNIFORM_CALLS( GLREPLAY_UNIFORM, GLREPLAY_MATRIX )
+			GLRECORD_PROGRAM_UNIFORM_CALLS( GLREPLAY_PROGRAM_UNIFORM, GLREPLAY_PROGRAM_MATRIX )
+
+			case GLRECORD_OP_BufferData:
+			{
+				GLenum target = Get<GLenum>( );
+				GLsizeiptr size = (GLsizeiptr)Get<uint64_t>( );
+				GLenum usage = Get<GLenum>( );
+				glBufferData( target, size, GetArray( false ), usage );
+				break;
+			}
+
+			case GLRECORD_OP_BufferSubData:
+			{
+				GLenum target = Get<GLenum>( );
+				GLintptr offset = (GLintptr)Get<uint64_t>( );
+				GLsizeiptr size = (GLsizeiptr)( Pos + 4 <= End ? *(const unsigned int *)Pos : 0 );
+				glBufferSubData( target, offset, size, GetArray( false ) );
+				break;
+			}
+
+			case GLRECORD_OP_CreateProgram:
+				SetName( Programs, Get<GLuint>( ), glCreateProgram( ) );
+				break;
+
+			case GLRECORD_OP_CreateShader:
+			{
+				GLenum type = Get<GLenum>( );
+				SetName( Shaders, Get<GLuint>( ), glCreateShader( type ) );
+				break;
+			}
+
+			case GLRECORD_OP_DeleteBuffers:
+			case GLRECORD_OP_DeleteFramebuffers:
+			case GLRECORD_OP_DeleteRenderbuffers:
+			{
+				std::vector<GLuint> &names = op == GLRECORD_OP_DeleteBuffers ? Buffers :
+					op == GLRECORD_OP_DeleteFramebuffers ? Framebuffers : Renderbuffers;
+				GetNames( mine, recorded );
+				for( size_t i = 0; i < recorded.size( ); i++ )
+				{
+					mine[i] = Name( names, recorded[i] );
+					SetName( names, recorded[i], 0 );
+				}
+				if( mine.empty( ) )
+					break;
+				if( op == GLRECORD_OP_DeleteBuffers )
+					glDeleteBuffers( (GLsizei)mine.size( ), &mine[0] );
+				else if( op == GLRECORD_OP_DeleteFramebuffers )
+					glDeleteFramebuffers( (GLsizei)mine.size( ), &mine[0] );
+				else
+					glDeleteRenderbuffers( (GLsizei)mine.size( ), &mine[0] );
+				break;
+			}
+
+			case GLRECORD_OP_DrawElements:
+			case GLRECORD_OP_DrawElementsData:
+			{
+				GLenum mode = Get<GLenum>( );
+				GLsizei count = Get<GLsizei>( );
+				GLenum type = Get<GLenum>( );
+				GLsizei instances = Get<GLsizei>( );
+				const void *indices = op == GLRECORD_OP_DrawElements ? (const void *)(uintptr_t)Get<uint64_t>( ) : GetArray( false );
+				if( instances == 0 )
+					glDrawElements( mode, count, type, indices );
+				else
+					glDrawElementsInstanced( mode, count, type, indices, instances );
+				break;
+			}
+
+			case GLRECORD_OP_GenBuffers:
+			case GLRECORD_OP_GenFramebuffers:
+			case GLRECORD_OP_GenRenderbuffers:
+			case GLRECORD_OP_GenTextures:
+			{
+				GetNames( mine, recorded );
+				if( mine.empty( ) )
+					break;
+				std::vector<GLuint> *names;
+				if( op == GLRECORD_OP_GenBuffers )
+				{
+					glGenBuffers( (GLsizei)mine.size( ), &mine[0] );
+					names = &Buffers;
+				}
+				else if( op == GLRECORD_OP_GenFramebuffers )
+				{
+					glGenFramebuffers( (GLsizei)mine.size( ), &mine[0] );
+					names = &Framebuffers;
+				}
+				else if( op == GLRECORD_OP_GenRenderbuffers )
+				{
+					glGenRenderbuffers( (GLsizei)mine.size( ), &mine[0] );
+					names = &Renderbuffers;
+				}
+				else
+				{
+					glGenTextures( (GLsizei)mine.size( ), &mine[0] );
+					names = &Textures;
+				}
+				for( size_t i = 0; i < mine.size( ); i++ )
+					SetName( *names, recorded[i], mine[i] );
+				break;
+			}
+
+			case GLRECORD_OP_GenLists:
+			{
+				GLsizei range = Get<GLsizei>( );
+				GLuint first = Get<GLuint>( );
+				GLuint mineFirst = glGenLists( range );
+				for( GLsizei i = 0; i < range; i++ )
+					SetName( Lists, first + i, mineFirst + i );
+				break;
+			}
+
+			case GLRECORD_OP_gluLookAt:
+			{
+				GLdouble v[9];
+				for( int i = 0; i < 9; i++ )
+					v[i] = Get<GLdouble>( );
+				gluLookAt( v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8] );
+				break;
+			}
+
+			case GLRECORD_OP_gluOrtho2D:
+			case GLRECORD_OP_gluPerspective:
+			{
+				GLdouble v[4];
+				for( int i = 0; i < 4; i++ )
+					v[i] = Get<GLdouble>( );
+				if( op == GLRECORD_OP_gluOrtho2D )
+					gluOrtho2D( v[0], v[1], v[2], v[3] );
+				else
+					gluPerspective( v[0], v[1], v[2], v[3] );
+				break;
+			}
+
+			case GLRECORD_OP_Pointer:
+			{
+				unsigned char array = Get<unsigned char>( );
+				GLuint index = Get<GLuint>( );
+				GLint size = Get<GLint>( );
+				GLenum type = Get<GLenum>( );
+				GLboolean normalized = Get<GLboolean>( );
+				GLsizei stride = Get<GLsizei>( );
+				const void *offset = (const void *)(uintptr_t)Get<uint64_t>( );
+				switch( array )
+				{
+					case GLRECORD_COLOR_ARRAY:	glColorPointer( size, type, stride, offset );		break;
+					case GLRECORD_NORMAL_ARRAY:	glNormalPointer( type, stride, offset );		break;
+					case GLRECORD_TEXCOORD_ARRAY:	glTexCoordPointer( size, type, stride, offset );	break;
+					case GLRECORD_VERTEX_ARRAY:	glVertexPointer( size, type, stride, offset );		break;
+					case GLRECORD_ATTRIB_ARRAY:	glVertexAttribPointer( index, size, type, normalized, stride, offset );	break;
+					default:			Bad = true;
+				}
+				break;
+			}
+
+			case GLRECORD_OP_ProgramBinary:
+			{
+				GLuint program = GLREPLAY_GET_PROGRAM( );
+				GLenum format = Get<GLenum>( );
+				GLsizei length = (GLsizei)( Pos + 4 <= End ? *(const unsigned int *)Pos : 0 );
+				glProgramBinary( program, format, GetArray( false ), length );
+				break;
+			}
+
+			case GLRECORD_OP_ShaderSource:
+			{
+				GLuint shader = GLREPLAY_GET_SHADER( );
+				GLsizei count = Get<GLsizei>( );
+				Sources.clear( );
+				SourceLengths.clear( );
+				for( int i = 0; i < count  &&  ! Bad; i++ )
+				{
+					GLint length = (GLint)( Pos + 4 <= End ? *(const unsigned int *)Pos : 0 );
+					const GLchar *source = (const GLchar *)GetArray( false );
+					Sources.push_back( source != NULL ? source : "" );
+					SourceLengths.push_back( length );
+				}
+				if( ! Bad  &&  count > 0 )
+					glShaderSource( shader, count, &Sources[0], &SourceLengths[0] );
+				break;
+			}
+
+			case GLRECORD_OP_TexImage2D:
+			case GLRECORD_OP_TexImage3D:
+			{
+				GLenum target = Get<GLenum>( );
+				GLint level = Get<GLint>( );
+				GLint internal = Get<GLint>( );
+				GLsizei width = Get<GLsizei>( );
+				GLsizei height = Get<GLsizei>( );
+				GLsizei depth = Get<GLsizei>( );
+				GLint border = Get<GLint>( );
+				GLenum format = Get<GLenum>( );
+				GLenum type = Get<GLenum>( );
+				const void *pixels = GetPixels( );
+				if( op == GLRECORD_OP_TexImage2D )
+					glTexImage2D( target, level, internal, width, height, border, format, type, pixels );
+				else
+					glTexImage3D( target, level, internal, width, height, depth, border, format, type, pixels );
+				break;
+			}
+
+			case GLRECORD_OP_TexSubImage2D:
+			case GLRECORD_OP_TexSubImage3D:
+			{
+				GLenum target = Get<GLenum>( );
+				GLint level = Get<GLint>( );
+				GLint x = Get<GLint>( );
+				GLint y = Get<GLint>( );
+				GLint z = Get<GLint>( );
+				GLsizei width = Get<GLsizei>( );
+				GLsizei height = Get<GLsizei>( );
+				GLsizei depth = Get<GLsizei>( );
+				GLenum format = Get<GLenum>( );
+				GLenum type = Get<GLenum>( );
+				const void *pixels = GetPixels( );
+				if( op == GLRECORD_OP_TexSubImage2D )
+					glTexSubImage2D( target, level, x, y, width, height, format, type, pixels );
+				else
+					glTexSubImage3D( target, level, x, y, z, width, height, depth, format, type, pixels );
+				break;
+			}
+
+			default:
+				Bad = true;
+		}
+
+		if( Bad )
+		{
+			fprintf( stderr, "The recording is cut short or broken at byte %ld (command %d)\n", (long)( start - &Bytes[0] ), op );
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// play the frames, from the first one to the end -- frames gets how many there were:
+
+bool
+GlReplay::PlayFrames( int *frames )
+{
+	*frames = 0;
+	if( FirstFrame == NULL )
+		return true;
+
+	Pos = FirstFrame;
+	return Play( false, frames );
+}
+
+
+// play everything before the first frame:
+
+bool
+GlReplay::PlaySetup( )
+{
+	if( ! Play( true, NULL ) )
+		return false;
+	if( Pos < End )
+		FirstFrame = Pos;
+	return true;
+}
+
+
+void
+GlReplay::SetDefaultFramebuffer( GLuint fbo )
+{
+	DefaultFbo = fbo;
+}
+
+
+void
+GlReplay::SetName( std::vector<GLuint> &names, GLuint recorded, GLuint mine )
+{
+	if( recorded >= names.size( ) )
+		names.resize( recorded + 1, 0 );
+	names[recorded] = mine;
+}
+
+
+int
+main( int argc, char *argv[ ] )
+{
+	const char *recording = NULL;
+	const char *output = NULL;
+	int loops = REPLAY_LOOPS;
+	for( int i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[i], "--loops" ) == 0  &&  i+1 < argc )
+			loops = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--output" ) == 0  &&  i+1 < argc )
+			output = argv[++i];
+		else if( argv[i][0] != '-'  &&  recording == NULL )
+			recording = argv[i];
+		else
+		{
+			recording = NULL;
+			break;
+		}
+	}
+	if( recording == NULL  ||  loops <= 0 )
+	{
+		fprintf( stderr, "Usage: %s file.glrec [--loops n] [--output file.ppm]\n", argv[0] );
+		return REPLAY_BAD_ARGUMENTS;
+	}
+
+	GlReplay replay;
+	if( ! replay.Load( recording ) )
+		return REPLAY_BAD_RECORDING;
+
+	HeadlessContext offscreen;
+	if( ! offscreen.Create( replay.GetWidth( ), replay.GetHeight( ) ) )
+		return REPLAY_NO_CONTEXT;
+	replay.SetDefaultFramebuffer( offscreen.GetFramebuffer( ) );
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now( );
+	if( ! replay.PlaySetup( ) )
+	{
+		offscreen.Destroy( );
+		return REPLAY_BAD_RECORDING;
+	}
+	glFinish( );
+	double setupMs = std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( );
+
+	// each loop is timed twice -- once the calls are all made, and once OpenGL has done them:
+
+	int status = 0;
+	int errors = 0;
+	int frames = 0;
+	double submitMs = 0., finishMs = 0.;
+	for( int l = 0; l < loops; l++ )
+	{
+		start = Clock::now( );
+		if( ! replay.PlayFrames( &frames ) )
+		{
+			offscreen.Destroy( );
+			return REPLAY_BAD_RECORDING;
+		}
+		Clock::time_point submitted = Clock::now( );
+		glFinish( );
+		Clock::time_point finished = Clock::now( );
+		submitMs += std::chrono::duration<double, std::milli>( submitted - start ).count( );
+		finishMs += std::chrono::duration<double, std::milli>( finished - start ).count( );
+
+		GLenum err;
+		while( ( err = glGetError( ) ) != GL_NO_ERROR )
+		{
+			if( errors++ < 10 )
+				fprintf( stderr, "OpenGL error 0x%X in loop %d\n", err, l );
+			status = REPLAY_GL_ERRORS;
+		}
+		if( frames == 0 )
+			break;
+	}
+
+	if( frames == 0 )
+		fprintf( stderr, "Played the setup in %.1f ms -- the recording has no frames\n", setupMs );
+	else
+	{
+		double played = (double)frames * (double)loops;
+		fprintf( stderr, "Played the setup in %.1f ms, then %d frames %d times: %.3f ms/frame to make the calls, %.3f ms/frame to finish them, %d OpenGL errors\n",
+			setupMs, frames, loops, submitMs / played, finishMs / played, errors );
+	}
+
+	if( output != NULL  &&  ! offscreen.WritePPM( output ) )
+		status = REPLAY_NO_OUTPUT;
+
+	offscreen.Destroy( );
+	return status;
+}
@@ -1,4 +1,21 @@
 #include "glslprogram.h"
+#include "trace.h"
+
+#ifdef WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// a headless build may have no glut window (see headless.cpp), so it asks egl for extension functions instead:
+#ifdef HEADLESS
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#define GetGLProcAddress( name )	eglGetProcAddress( name )
+#elif !defined(__APPLE__)
+#include "freeglut_ext.h"	// for glutGetProcAddress( )
+#define GetGLProcAddress( name )	glutGetProcAddress( name )
+#endif
 
 
 struct GLshadertype
@@ -64,15 +81,100 @@ GLSLProgram::GLSLProgram( )
 bool
 GLSLProgram::Create( char *file0, char *file1, char *file2, char *file3, char * file4, char *file5 )
 {
+	Files[0] = file0;
+	Files[1] = file1;
+	Files[2] = file2;
+	Files[3] = file3;
+	Files[4] = file4;
+	Files[5] = file5;
 	return CreateHelper( file0, file1, file2, file3, file4, file5, NULL );
 }
 
 
+// FNV-1a, used to key the program binary cache:
+
+static
+unsigned long long
+HashBytes( unsigned long long hash, const char *bytes, int n )
+{
+	for( int i = 0; i < n; i++ )
+	{
+		hash ^= (unsigned char)bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+static
+unsigned long long
+HashString( unsigned long long hash, const char *str )
+{
+	if( str == NULL )
+		str = "";
+	return HashBytes( hash, str, (int)strlen( str ) + 1 );		// include the '\0' as a separator
+}
+
+
+// a stored binary is only good for the exact same sources, #defines, and driver:
+
+static
+unsigned long long
+ProgramKey( char **files, int numFiles, char *defines )
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = HashString( hash, (const char *)glGetString( GL_VENDOR ) );
+	hash = HashString( hash, (const char *)glGetString( GL_RENDERER ) );
+	hash = HashString( hash, (const char *)glGetString( GL_VERSION ) );
+	hash = HashString( hash, defines );
+
+	for( int f = 0; f < numFiles; f++ )
+	{
+		hash = HashString( hash, files[f] );
+
+		FILE *in = fopen( files[f], "rb" );
+		if( in == NULL )
+			continue;
+		char buf[4096];
+		int n;
+		while( ( n = (int)fread( buf, 1, sizeof(buf), in ) ) > 0 )
+			hash = HashBytes( hash, buf, n );
+		fclose( in );
+	}
+	return hash;
+}
+
+
+// give a newly-built variant the same uniform values that this program has,
+// so that things set once at startup (like the lighting coefficients) carry over
+// (this copies the shadow values, so even ones that have not been flushed yet come along):
+
+void
+GLSLProgram::CopyUniforms( GLSLProgram *from )
+{
+	for( int i = 0; i < from->NumActiveUniforms; i++ )
+	{
+		const GLSLVariable &u = from->Uniforms[i];
+		for( int j = 0; j < NumActiveUniforms; j++ )
+		{
+			const GLSLVariable &v = Uniforms[j];
+			if( v.Name != u.Name  ||  v.Type != u.Type )
+				continue;
+
+			int size = ( u.Size < v.Size ) ? u.Size : v.Size;
+			StoreUniform( j, &from->ShadowData[u.Offset], size * u.ElementBytes );
+			break;
+		}
+	}
+}
+
+
 // this is the varargs version of the Create method
 
 bool
 GLSLProgram::CreateHelper( char *file0, ... )
 {
+	TRACE_SCOPE( "GLSLProgram::CreateHelper" );
 	GLsizei n = 0;
 	GLchar *buf;
 
@@ -88,12 +190,48 @@ GLSLProgram::CreateHelper( char *file0, ... )
 	Cshader = 0;
 #endif
 
-	AttributeLocs.clear();
-	UniformLocs.clear();
+	Uniforms.clear( );
+	Attributes.clear( );
+	UniformIndex.clear( );
+	AttributeIndex.clear( );
+	NumActiveUniforms = 0;
+	ShadowData.clear( );
+	DirtyList.clear( );
 
 	Program = glCreateProgram( );
 	CheckGlErrors( "glCreateProgram" );
 
+	// see if there is already a linked binary of these sources in the cache:
+
+	Pending = false;
+	PendingShaders.clear( );
+	PendingFiles.clear( );
+	CacheKey = 0;
+	UseCache = CanDoProgramBinaries  &&  CacheDir != NULL;
+	if( UseCache )
+	{
+		char *files[16];
+		int numFiles = 0;
+
+		va_list args;
+		va_start( args, file0 );
+		for( char *file = file0; file != NULL  &&  numFiles < 16; file = va_arg( args, char * ) )
+			files[numFiles++] = file;
+		va_end( args );
+
+		CacheKey = ProgramKey( files, numFiles, Defines );
+		if( LoadBinary( CacheKey ) )
+			return Valid;
+
+		// the driver rejected it (or there was none) -- start over from source:
+
+		glDeleteProgram( Program );
+		Program = glCreateProgram( );
+#ifndef __APPLE__
+		glProgramParameteri( Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+#endif
+	}
+
 	va_list args;
 	va_start( args, file0 );
 
@@ -237,7 +375,6 @@ GLSLProgram::CreateHelper( char *file0, ... )
 		{
 			FILE * in;
 			int length;
-			FILE * logfile;
 
 			in = fopen( file, "rb" );
 			if( in == NULL )
@@ -258,202 +395,962 @@ GLSLProgram::CreateHelper( char *file0, ... )
 				buf[length] = '\0';
 				fclose( in ) ;
 
-				GLchar *strings[2];
+				GLchar *strings[3];
+				GLint lengths[3];
 				int n = 0;
-				strings[n] = buf;
-				n++;
+
+				// a variant's #defines have to go after the #version line:
+
+				char *eol = strchr( buf, '\n' );
+				if( Defines != NULL  &&  strncmp( buf, "#version", 8 ) == 0  &&  eol != NULL )
+				{
+					strings[n] = buf;
+					lengths[n] = (GLint)( eol - buf + 1 );
+					n++;
+					strings[n] = Defines;
+					lengths[n] = -1;
+					n++;
+					strings[n] = eol + 1;
+					lengths[n] = -1;
+					n++;
+				}
+				else
+				{
+					if( Defines != NULL )
+					{
+						strings[n] = Defines;
+						lengths[n] = -1;
+						n++;
+					}
+					strings[n] = buf;
+					lengths[n] = -1;
+					n++;
+				}
 
 				// Tell GL about the source:
 
-				glShaderSource( shader, n, (const GLchar **)strings, NULL );
+				glShaderSource( shader, n, (const GLchar **)strings, lengths );
 				delete [ ] buf;
 				CheckGlErrors( "Shader Source" );
 
-				// compile:
+				// compile:
+
+				glCompileShader( shader );
+				CheckGlErrors( "CompileShader:" );
+
+				// an async create leaves checking the compile to Finish( ),
+				// so that asking for the status does not make us wait for the driver:
+
+				if( Async )
+				{
+					glAttachShader( this->Program, shader );
+					PendingShaders.push_back( shader );
+					PendingFiles.push_back( file );
+				}
+				else if( CheckCompile( shader, file ) )
+				{
+					glAttachShader( this->Program, shader );
+				}
+				else
+				{
+					glDeleteShader( shader );
+					Valid = false;
+				}
+			}
+		}
+
+
+
+		// go to the next vararg file:
+
+		file = va_arg( args, char * );
+	}
+
+	va_end( args );
+
+	// link the entire shader program:
+
+	glLinkProgram( Program );
+	CheckGlErrors( "Link Shader 1");
+
+	if( Async )
+	{
+		Pending = true;
+		return Valid;
+	}
+
+	return CheckLink( );
+}
+
+
+// report a shader's compile errors:
+
+bool
+GLSLProgram::CheckCompile( GLuint shader, char *file )
+{
+	GLint infoLogLen;
+	GLint compileStatus;
+	FILE * logfile;
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &compileStatus );
+
+	if( compileStatus == 0 )
+	{
+		fprintf( stderr, "Shader '%s' did not compile.\n", file );
+		glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &infoLogLen );
+		if( infoLogLen > 0 )
+		{
+			GLchar *infoLog = new GLchar[infoLogLen+1];
+			glGetShaderInfoLog( shader, infoLogLen, NULL, infoLog);
+			infoLog[infoLogLen] = '\0';
+			logfile = fopen( "glsllog.txt", "w");
+			if( logfile != NULL )
+			{
+				fprintf( logfile, "\n%s\n", infoLog );
+				fclose( logfile );
+			}
+			fprintf( stderr, "\n%s\n", infoLog );
+			delete [ ] infoLog;
+		}
+		return false;
+	}
+
+	if( Verbose )
+		fprintf( stderr, "Shader '%s' compiled.\n", file );
+	return true;
+}
+
+
+// report link errors, validate, and save the binary if caching:
+
+bool
+GLSLProgram::CheckLink( )
+{
+	GLchar* infoLog;
+	GLint infoLogLen;
+	GLint linkStatus;
+	glGetProgramiv( this->Program, GL_LINK_STATUS, &linkStatus );
+	CheckGlErrors("Link Shader 2");
+
+	if( linkStatus == 0 )
+	{
+		glGetProgramiv( this->Program, GL_INFO_LOG_LENGTH, &infoLogLen );
+		fprintf( stderr, "Failed to link program -- Info Log Length = %d\n", infoLogLen );
+		if( infoLogLen > 0 )
+		{
+			infoLog = new GLchar[infoLogLen+1];
+			glGetProgramInfoLog( this->Program, infoLogLen, NULL, infoLog );
+			infoLog[infoLogLen] = '\0';
+			fprintf( stderr, "Info Log:\n%s\n", infoLog );
+			delete [ ] infoLog;
+
+		}
+		glDeleteProgram( Program );
+		Valid = false;
+	}
+	else
+	{
+		if( Verbose )
+			fprintf( stderr, "Shader Program linked.\n" );
+		// validate the program:
+
+		GLint status;
+		glValidateProgram( Program );
+		glGetProgramiv( Program, GL_VALIDATE_STATUS, &status );
+		if( status == GL_FALSE )
+		{
+			fprintf( stderr, "Program is invalid.\n" );
+			Valid = false;
+		}
+		else
+		{
+			if( Verbose )
+				fprintf( stderr, "Shader Program validated.\n" );
+		}
+	}
+
+	if( Valid )
+		Reflect( );
+
+	if( Valid  &&  UseCache )
+		SaveBinary( CacheKey );
+
+	return Valid;
+}
+
+
+// start compiling and linking, but don't wait for the driver to finish:
+// poll IsReady( ), then call Finish( ) before using the program
+
+bool
+GLSLProgram::CreateAsync( char *file0, char *file1, char *file2, char *file3, char * file4, char *file5 )
+{
+	Async = true;
+	bool ok = Create( file0, file1, file2, file3, file4, file5 );
+	Async = false;
+	return ok;
+}
+
+
+// check the compiles and link of an async create
+// (this waits for the driver if it is not ready yet):
+
+bool
+GLSLProgram::Finish( )
+{
+	if( ! Pending )
+		return Valid;
+	TRACE_SCOPE( "GLSLProgram::Finish" );
+	Pending = false;
+
+	for( int i = 0; i < (int)PendingShaders.size( ); i++ )
+	{
+		if( ! CheckCompile( PendingShaders[i], PendingFiles[i] ) )
+			Valid = false;
+	}
+	PendingShaders.clear( );
+	PendingFiles.clear( );
+
+	return CheckLink( );
+}
+
+
+bool
+GLSLProgram::IsPending( )
+{
+	return Pending;
+}
+
+
+// has the driver finished an async create?
+// (without GL_KHR_parallel_shader_compile there is no way to ask without waiting, so it always says yes)
+
+bool
+GLSLProgram::IsReady( )
+{
+	if( ! Pending )
+		return true;
+
+#ifndef __APPLE__
+	if( CanDoParallelCompile )
+	{
+		GLint done = GL_FALSE;
+		glGetProgramiv( Program, GL_COMPLETION_STATUS_KHR, &done );
+		return done != GL_FALSE;
+	}
+#endif
+	return true;
+}
+
+
+// where the binary for a given key lives:
+
+void
+GLSLProgram::GetCachePath( unsigned long long key, char *path, int size )
+{
+	snprintf( path, size, "%s/%016llx.bin", CacheDir, key );
+}
+
+
+// cache files are:  "GLSLBIN1", binary format (4 bytes), binary length (4 bytes), binary
+
+bool
+GLSLProgram::LoadBinary( unsigned long long key )
+{
+#ifdef __APPLE__
+	return false;
+#else
+	char path[512];
+	GetCachePath( key, path, sizeof(path) );
+
+	FILE *in = fopen( path, "rb" );
+	if( in == NULL )
+		return false;
+
+	char magic[8];
+	GLenum format;
+	GLint length;
+	if( fread( magic, 1, 8, in ) != 8  ||  strncmp( magic, "GLSLBIN1", 8 ) != 0  ||
+	    fread( &format, sizeof(format), 1, in ) != 1  ||  fread( &length, sizeof(length), 1, in ) != 1  ||  length <= 0 )
+	{
+		fprintf( stderr, "Program binary '%s' is not in the right format\n", path );
+		fclose( in );
+		return false;
+	}
+
+	char *binary = new char [length];
+	bool ok = (int)fread( binary, 1, length, in ) == length;
+	fclose( in );
+	if( ! ok )
+	{
+		fprintf( stderr, "Program binary '%s' is too short\n", path );
+		delete [ ] binary;
+		return false;
+	}
+
+	glProgramBinary( Program, format, binary, length );
+	delete [ ] binary;
+
+	GLint linkStatus;
+	glGetProgramiv( Program, GL_LINK_STATUS, &linkStatus );
+	if( linkStatus == 0 )
+	{
+		fprintf( stderr, "Program binary '%s' was rejected by the driver -- compiling from source\n", path );
+		return false;
+	}
+
+	if( Verbose )
+		fprintf( stderr, "Shader Program loaded from '%s'.\n", path );
+	Valid = true;
+	Reflect( );
+	return true;
+#endif
+}
+
+
+void
+GLSLProgram::SaveBinary( unsigned long long key )
+{
+#ifndef __APPLE__
+	GLint length = 0;
+	glGetProgramiv( Program, GL_PROGRAM_BINARY_LENGTH, &length );
+	if( length <= 0 )
+		return;
+
+	char *binary = new char [length];
+	GLenum format;
+	glGetProgramBinary( Program, length, NULL, &format, binary );
+
+#ifdef WIN32
+	_mkdir( CacheDir );
+#else
+	mkdir( CacheDir, 0755 );
+#endif
+
+	char path[512];
+	GetCachePath( key, path, sizeof(path) );
+	FILE *out = fopen( path, "wb" );
+	if( out == NULL )
+	{
+		fprintf( stderr, "Cannot write program binary '%s'\n", path );
+		delete [ ] binary;
+		return;
+	}
+	fwrite( "GLSLBIN1", 1, 8, out );
+	fwrite( &format, sizeof(format), 1, out );
+	fwrite( &length, sizeof(length), 1, out );
+	fwrite( binary, 1, length, out );
+	fclose( out );
+	delete [ ] binary;
+
+	if( Verbose )
+		fprintf( stderr, "Shader Program saved to '%s'.\n", path );
+#endif
+}
+
+
+// turn on the program binary cache by giving it a directory to keep the binaries in
+// (NULL turns it off):
+
+void
+GLSLProgram::SetCacheDir( char *dir )
+{
+	CacheDir = dir;
+}
+
+
+// name the #define that goes with a permutation feature bit:
+// e.g., DefineFeature( 1, "TURN" )
+
+void
+GLSLProgram::DefineFeature( unsigned int feature, char *name )
+{
+	for( int i = 0; i < MAX_PROGRAM_FEATURES; i++ )
+	{
+		if( feature == ( 1u << i ) )
+		{
+			FeatureNames[i] = name;
+			return;
+		}
+	}
+	fprintf( stderr, "Feature 0x%X must be a single bit below 0x%X\n", feature, 1u << MAX_PROGRAM_FEATURES );
+}
+
+
+void
+GLSLProgram::DisableVertexAttribArray( const char *name )
+{
+	int loc;
+	if( ( loc = GetAttributeLocation( (char *)name ) )  >= 0 )
+	{
+		this->Use();
+		glDisableVertexAttribArray( loc );
+	}
+}
+
+
+
+void
+GLSLProgram::EnableVertexAttribArray( const char *name )
+{
+	int loc;
+	if( ( loc = GetAttributeLocation( (char *)name ) )  >= 0 )
+	{
+		this->Use();
+		glEnableVertexAttribArray( loc );
+	}
+}
+
+
+// find a uniform variable in the reflection table, by name
+// (the index is remembered by name, so each name is only searched for once;
+//  a single element of an array, "x[2]", gets its own entry past the active uniforms).
+// this is what the char * SetUniformVariable( ) calls go through --
+// use a GLSLUniform<T> handle instead to skip the lookup altogether:
+
+int
+GLSLProgram::FindUniform( const char *name )
+{
+	std::map<std::string, int>::iterator pos = UniformIndex.find( name );
+	if( pos != UniformIndex.end( ) )
+		return pos->second;
+
+	int index = -1;
+	for( int i = 0; i < (int)Uniforms.size( ); i++ )
+	{
+		if( Uniforms[i].Name == name )
+		{
+			index = i;
+			break;
+		}
+	}
+
+	const char *bracket = strchr( name, '[' );
+	if( index < 0  &&  bracket != NULL )
+	{
+		std::string base( name, bracket - name );
+		for( int i = 0; i < NumActiveUniforms; i++ )
+		{
+			if( Uniforms[i].Name != base )
+				continue;
+
+			int element = atoi( bracket + 1 );
+			if( element == 0 )
+			{
+				index = i;
+				break;
+			}
+
+			GLint loc = glGetUniformLocation( Program, name );
+			if( loc >= 0  &&  element < Uniforms[i].Size )
+			{
+				GLSLVariable v;
+				v.Name = name;
+				v.Location = loc;
+				v.Type = Uniforms[i].Type;
+				v.Size = Uniforms[i].Size - element;
+				v.ElementBytes = Uniforms[i].ElementBytes;
+				v.Offset = Uniforms[i].Offset + element * v.ElementBytes;	// shares the array's shadow copy
+				v.Dirty = false;
+				v.DirtyCount = 0;
+				Uniforms.push_back( v );
+				index = (int)Uniforms.size( ) - 1;
+			}
+			break;
+		}
+	}
+
+	if( index < 0  &&  Verbose )
+		fprintf( stderr, "Uniform variable '%s' is not active in Program %d\n", name, Program );
+	UniformIndex[name] = index;
+	return index;
+}
+
+
+int
+GLSLProgram::FindAttribute( const char *name )
+{
+	std::map<std::string, int>::iterator pos = AttributeIndex.find( name );
+	if( pos != AttributeIndex.end( ) )
+		return pos->second;
+
+	int index = -1;
+	for( int i = 0; i < (int)Attributes.size( ); i++ )
+	{
+		if( Attributes[i].Name == name )
+		{
+			index = i;
+			break;
+		}
+	}
+
+	if( index < 0  &&  Verbose )
+		fprintf( stderr, "Attribute variable '%s' is not active in Program %d\n", name, Program );
+	AttributeIndex[name] = index;
+	return index;
+}
+
+
+int
+GLSLProgram::GetUniformTypeAndSize( GLchar *name, GLint *sizep, GLenum *typep )
+{
+	int index = FindUniform( name );
+	if( index < 0 )
+		return -1;
+
+	*sizep = Uniforms[index].Size;
+	*typep = Uniforms[index].Type;
+	return 0;
+}
+
+
+int
+GLSLProgram::GetAttributeTypeAndSize( GLchar *name, GLint *sizep, GLenum *typep )
+{
+	int index = FindAttribute( name );
+	if( index < 0 )
+		return -1;
+
+	*sizep = Attributes[index].Size;
+	*typep = Attributes[index].Type;
+	return 0;
+}
+
+
+// bytes in one element of a uniform of this type (0 for the types that are not shadowed):
+
+int
+GLSLProgram::GetElementBytes( GLenum type )
+{
+	switch( type )
+	{
+		case GL_FLOAT:
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+#ifdef GL_SAMPLER_2D_ARRAY_EXT
+		case GL_SAMPLER_2D_ARRAY_EXT:
+#endif
+			return 4;
+
+		case GL_FLOAT_VEC2:
+		case GL_INT_VEC2:
+			return 8;
+
+		case GL_FLOAT_VEC3:
+		case GL_INT_VEC3:
+			return 12;
+
+		case GL_FLOAT_VEC4:
+		case GL_INT_VEC4:
+		case GL_FLOAT_MAT2:
+			return 16;
+
+		case GL_FLOAT_MAT3:
+			return 36;
+
+		case GL_FLOAT_MAT4:
+			return 64;
+
+		default:
+			return 0;
+	}
+}
+
+
+// is this an int, bool, or sampler uniform (one that is set with glUniform*i*( ))?
+
+bool
+GLSLProgram::IsIntegerType( GLenum type )
+{
+	switch( type )
+	{
+		case GL_INT:
+		case GL_INT_VEC2:
+		case GL_INT_VEC3:
+		case GL_INT_VEC4:
+		case GL_BOOL:
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+#ifdef GL_SAMPLER_2D_ARRAY_EXT
+		case GL_SAMPLER_2D_ARRAY_EXT:
+#endif
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+
+// write a value into a uniform's shadow copy -- it is only marked dirty (and sent to the
+// driver at the next Flush( )) if it is different from what is already there:
+
+void
+GLSLProgram::StoreUniform( int index, const void *data, int bytes )
+{
+	GLSLVariable &u = Uniforms[index];
+	UniformWritesRequested++;
+
+	int maxbytes = u.Size * u.ElementBytes;
+	if( bytes > maxbytes )
+		bytes = maxbytes;
+	if( bytes <= 0 )
+		return;
+
+	unsigned char *shadow = &ShadowData[u.Offset];
+	if( memcmp( shadow, data, bytes ) == 0 )
+		return;
+	memcpy( shadow, data, bytes );
+
+	int count = ( bytes + u.ElementBytes - 1 ) / u.ElementBytes;
+	if( ! u.Dirty )
+	{
+		u.Dirty = true;
+		u.DirtyCount = 0;
+		DirtyList.push_back( index );
+	}
+	if( count > u.DirtyCount )
+		u.DirtyCount = count;
+}
+
+
+// send the first count elements of a uniform's shadow copy to the driver
+// (straight to the program with GL_ARB_separate_shader_objects, otherwise the program must be current):
+
+void
+GLSLProgram::UploadUniform( const GLSLVariable &u, int count )
+{
+	const GLfloat *f = (const GLfloat *)&ShadowData[u.Offset];
+	const GLint   *i = (const GLint   *)&ShadowData[u.Offset];
+	GLint loc = u.Location;
+
+#ifndef __APPLE__
+	if( CanDoDirectUniforms )
+	{
+		switch( u.Type )
+		{
+			case GL_FLOAT:		glProgramUniform1fv( Program, loc, count, f );				break;
+			case GL_FLOAT_VEC2:	glProgramUniform2fv( Program, loc, count, f );				break;
+			case GL_FLOAT_VEC3:	glProgramUniform3fv( Program, loc, count, f );				break;
+			case GL_FLOAT_VEC4:	glProgramUniform4fv( Program, loc, count, f );				break;
+			case GL_INT_VEC2:	glProgramUniform2iv( Program, loc, count, i );				break;
+			case GL_INT_VEC3:	glProgramUniform3iv( Program, loc, count, i );				break;
+			case GL_INT_VEC4:	glProgramUniform4iv( Program, loc, count, i );				break;
+			case GL_FLOAT_MAT2:	glProgramUniformMatrix2fv( Program, loc, count, GL_FALSE, f );		break;
+			case GL_FLOAT_MAT3:	glProgramUniformMatrix3fv( Program, loc, count, GL_FALSE, f );		break;
+			case GL_FLOAT_MAT4:	glProgramUniformMatrix4fv( Program, loc, count, GL_FALSE, f );		break;
+			default:		glProgramUniform1iv( Program, loc, count, i );				break;	// int, bool, samplers
+		}
+		return;
+	}
+#endif
+
+	switch( u.Type )
+	{
+		case GL_FLOAT:		glUniform1fv( loc, count, f );				break;
+		case GL_FLOAT_VEC2:	glUniform2fv( loc, count, f );				break;
+		case GL_FLOAT_VEC3:	glUniform3fv( loc, count, f );				break;
+		case GL_FLOAT_VEC4:	glUniform4fv( loc, count, f );				break;
+		case GL_INT_VEC2:	glUniform2iv( loc, count, i );				break;
+		case GL_INT_VEC3:	glUniform3iv( loc, count, i );				break;
+		case GL_INT_VEC4:	glUniform4iv( loc, count, i );				break;
+		case GL_FLOAT_MAT2:	glUniformMatrix2fv( loc, count, GL_FALSE, f );		break;
+		case GL_FLOAT_MAT3:	glUniformMatrix3fv( loc, count, GL_FALSE, f );		break;
+		case GL_FLOAT_MAT4:	glUniformMatrix4fv( loc, count, GL_FALSE, f );		break;
+		default:		glUniform1iv( loc, count, i );				break;	// int, bool, samplers
+	}
+}
+
+
+// send everything that has changed since the last Flush( ) -- call this before drawing:
+
+void
+GLSLProgram::Flush( )
+{
+	if( DirtyList.empty( ) )
+		return;
+
+	if( ! CanDoDirectUniforms )
+		this->Use( );
+
+	for( int d = 0; d < (int)DirtyList.size( ); d++ )
+	{
+		GLSLVariable &u = Uniforms[ DirtyList[d] ];
+		UploadUniform( u, u.DirtyCount );
+		u.Dirty = false;
+		u.DirtyCount = 0;
+		UniformWritesIssued++;
+	}
+	DirtyList.clear( );
+}
+
+
+// uniform writes asked for (through any program) and actually sent to the driver since the last reset
+// (call ResetUniformWriteCounts( ) once a frame to get per-frame numbers):
+
+void
+GLSLProgram::GetUniformWriteCounts( int *requested, int *issued )
+{
+	*requested = UniformWritesRequested;
+	*issued = UniformWritesIssued;
+}
+
+
+void
+GLSLProgram::ResetUniformWriteCounts( )
+{
+	UniformWritesRequested = 0;
+	UniformWritesIssued = 0;
+}
+
+
+// does a uniform of this GL type take a handle of this C++ type?
+
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const float * )
+{
+	return type == GL_FLOAT;
+}
+
+
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const int * )
+{
+	switch( type )
+	{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+#ifdef GL_SAMPLER_2D_ARRAY_EXT
+		case GL_SAMPLER_2D_ARRAY_EXT:
+#endif
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const glm::vec2 * )
+{
+	return type == GL_FLOAT_VEC2;
+}
+
+
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const glm::vec3 * )
+{
+	return type == GL_FLOAT_VEC3;
+}
 
-				glCompileShader( shader );
-				GLint infoLogLen;
-				GLint compileStatus;
-				CheckGlErrors( "CompileShader:" );
-				glGetShaderiv( shader, GL_COMPILE_STATUS, &compileStatus );
 
-				if( compileStatus == 0 )
-				{
-					fprintf( stderr, "Shader '%s' did not compile.\n", file );
-					glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &infoLogLen );
-					if( infoLogLen > 0 )
-					{
-						GLchar *infoLog = new GLchar[infoLogLen+1];
-						glGetShaderInfoLog( shader, infoLogLen, NULL, infoLog);
-						infoLog[infoLogLen] = '\0';
-						logfile = fopen( "glsllog.txt", "w");
-						if( logfile != NULL )
-						{
-							fprintf( logfile, "\n%s\n", infoLog );
-							fclose( logfile );
-						}
-						fprintf( stderr, "\n%s\n", infoLog );
-						delete [ ] infoLog;
-					}
-					glDeleteShader( shader );
-					Valid = false;
-				}
-				else
-				{
-					if( Verbose )
-						fprintf( stderr, "Shader '%s' compiled.\n", file );
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const glm::vec4 * )
+{
+	return type == GL_FLOAT_VEC4;
+}
 
-					glAttachShader( this->Program, shader );
-				}
-			}
-		}
 
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const glm::mat3 * )
+{
+	return type == GL_FLOAT_MAT3;
+}
 
 
-		// go to the next vararg file:
+bool
+GLSLProgram::UniformTypeMatches( GLenum type, const glm::mat4 * )
+{
+	return type == GL_FLOAT_MAT4;
+}
 
-		file = va_arg( args, char * );
-	}
 
-	va_end( args );
+// the program's interface, as the driver reported it after linking:
 
-	// link the entire shader program:
+int
+GLSLProgram::GetNumUniforms( )
+{
+	return NumActiveUniforms;
+}
 
-	glLinkProgram( Program );
-	CheckGlErrors( "Link Shader 1");
 
-	GLchar* infoLog;
-	GLint infoLogLen;
-	GLint linkStatus;
-	glGetProgramiv( this->Program, GL_LINK_STATUS, &linkStatus );
-	CheckGlErrors("Link Shader 2");
+const GLSLVariable *
+GLSLProgram::GetUniform( int i )
+{
+	if( i < 0  ||  i >= NumActiveUniforms )
+		return NULL;
+	return &Uniforms[i];
+}
 
-	if( linkStatus == 0 )
-	{
-		glGetProgramiv( this->Program, GL_INFO_LOG_LENGTH, &infoLogLen );
-		fprintf( stderr, "Failed to link program -- Info Log Length = %d\n", infoLogLen );
-		if( infoLogLen > 0 )
-		{
-			infoLog = new GLchar[infoLogLen+1];
-			glGetProgramInfoLog( this->Program, infoLogLen, NULL, infoLog );
-			infoLog[infoLogLen] = '\0';
-			fprintf( stderr, "Info Log:\n%s\n", infoLog );
-			delete [ ] infoLog;
 
-		}
-		glDeleteProgram( Program );
-		Valid = false;
-	}
-	else
-	{
-		if( Verbose )
-			fprintf( stderr, "Shader Program linked.\n" );
-		// validate the program:
+int
+GLSLProgram::GetNumAttributes( )
+{
+	return (int)Attributes.size( );
+}
 
-		GLint status;
-		glValidateProgram( Program );
-		glGetProgramiv( Program, GL_VALIDATE_STATUS, &status );
-		if( status == GL_FALSE )
-		{
-			fprintf( stderr, "Program is invalid.\n" );
-			Valid = false;
-		}
-		else
-		{
-			if( Verbose )
-				fprintf( stderr, "Shader Program validated.\n" );
-		}
-	}
 
-	return Valid;
+const GLSLVariable *
+GLSLProgram::GetAttribute( int i )
+{
+	if( i < 0  ||  i >= (int)Attributes.size( ) )
+		return NULL;
+	return &Attributes[i];
 }
 
 
-void
-GLSLProgram::DisableVertexAttribArray( const char *name )
+// a readable name for a uniform or attribute type:
+
+const char *
+GLSLProgram::GetTypeName( GLenum type )
 {
-	int loc;
-	if( ( loc = GetAttributeLocation( (char *)name ) )  >= 0 )
+	switch( type )
 	{
-		this->Use();
-		glDisableVertexAttribArray( loc );
+		case GL_FLOAT:		return "float";
+		case GL_FLOAT_VEC2:	return "vec2";
+		case GL_FLOAT_VEC3:	return "vec3";
+		case GL_FLOAT_VEC4:	return "vec4";
+		case GL_INT:		return "int";
+		case GL_INT_VEC2:	return "ivec2";
+		case GL_INT_VEC3:	return "ivec3";
+		case GL_INT_VEC4:	return "ivec4";
+		case GL_BOOL:		return "bool";
+		case GL_FLOAT_MAT2:	return "mat2";
+		case GL_FLOAT_MAT3:	return "mat3";
+		case GL_FLOAT_MAT4:	return "mat4";
+		case GL_SAMPLER_1D:	return "sampler1D";
+		case GL_SAMPLER_2D:	return "sampler2D";
+		case GL_SAMPLER_3D:	return "sampler3D";
+		case GL_SAMPLER_CUBE:	return "samplerCube";
+#ifdef GL_SAMPLER_2D_ARRAY_EXT
+		case GL_SAMPLER_2D_ARRAY_EXT:	return "sampler2DArray";
+#endif
+		default:		return "?";
 	}
 }
 
 
+// list the program's active uniforms and attributes:
 
 void
-GLSLProgram::EnableVertexAttribArray( const char *name )
+GLSLProgram::PrintInterface( FILE *fp )
 {
-	int loc;
-	if( ( loc = GetAttributeLocation( (char *)name ) )  >= 0 )
+	fprintf( fp, "Program %d:  %d uniforms, %d attributes\n", Program, NumActiveUniforms, (int)Attributes.size( ) );
+	for( int i = 0; i < NumActiveUniforms; i++ )
 	{
-		this->Use();
-		glEnableVertexAttribArray( loc );
+		const GLSLVariable &u = Uniforms[i];
+		fprintf( fp, "\tuniform   %-14s %s", GetTypeName( u.Type ), u.Name.c_str( ) );
+		if( u.Size > 1 )
+			fprintf( fp, "[%d]", u.Size );
+		fprintf( fp, "\t(location %d)\n", u.Location );
+	}
+	for( int i = 0; i < (int)Attributes.size( ); i++ )
+	{
+		const GLSLVariable &a = Attributes[i];
+		fprintf( fp, "\tattribute %-14s %s", GetTypeName( a.Type ), a.Name.c_str( ) );
+		if( a.Size > 1 )
+			fprintf( fp, "[%d]", a.Size );
+		fprintf( fp, "\t(location %d)\n", a.Location );
 	}
 }
 
 
-int
-GLSLProgram::GetUniformTypeAndSize( GLchar *name, GLint *sizep, GLenum *typep )
+// after a successful link, ask the driver once for every active uniform and attribute
+// (arrays are kept as one entry, without the "[0]" some drivers add to the name):
+
+void
+GLSLProgram::Reflect( )
 {
-	int numactiveuniforms;
+	Uniforms.clear( );
+	Attributes.clear( );
+	UniformIndex.clear( );
+	AttributeIndex.clear( );
+	NumActiveUniforms = 0;
+	ShadowData.clear( );
+	DirtyList.clear( );
+	int shadowbytes = 0;
+
+	int numactiveuniforms = 0;
 	glGetProgramiv( Program, GL_ACTIVE_UNIFORMS, &numactiveuniforms );
-	if( Verbose )
-		fprintf( stderr, "numactiveuniforms = %d\n", numactiveuniforms );
-
-	int bufsize;
+	int bufsize = 0;
 	glGetProgramiv( Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &bufsize );
+	int numactiveattribs = 0;
+	glGetProgramiv( Program, GL_ACTIVE_ATTRIBUTES, &numactiveattribs );
+	int attribbufsize = 0;
+	glGetProgramiv( Program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attribbufsize );
+	if( attribbufsize > bufsize )
+		bufsize = attribbufsize;
 	char *lname = new char [bufsize+1];
 
 	for( int i = 0; i < numactiveuniforms; i++ )
 	{
-		GLint lsize;
-		GLenum ltype;
-		glGetActiveUniform( Program, i, bufsize, NULL, &lsize, &ltype, lname );
-		if( strcmp( name, lname ) == 0 )
-		{
-			if( Verbose )
-				fprintf( stderr, "Uniform Variable #%2d, '%s' is size %d and type 0x%X\n", i, lname, lsize, ltype );
-			*sizep = lsize;
-			*typep = ltype;
-			return 0;
-		}
+		GLSLVariable v;
+		glGetActiveUniform( Program, i, bufsize+1, NULL, &v.Size, &v.Type, lname );
+		char *bracket = strchr( lname, '[' );
+		if( bracket != NULL )
+			*bracket = '\0';
+		v.Name = lname;
+		v.Location = glGetUniformLocation( Program, lname );
+		if( v.Location < 0 )
+			continue;		// uniform blocks and built-ins
+		v.ElementBytes = GetElementBytes( v.Type );
+		v.Offset = shadowbytes;
+		v.Dirty = false;
+		v.DirtyCount = 0;
+		shadowbytes += v.Size * v.ElementBytes;
+		Uniforms.push_back( v );
 	}
+	NumActiveUniforms = (int)Uniforms.size( );
 
-	return -1;
-}
-
+	// start the shadow copy off with what the driver has (the defaults, or the initializers in the shader):
 
-int
-GLSLProgram::GetAttributeTypeAndSize( GLchar *name, GLint *sizep, GLenum *typep )
-{
-	int numactiveattribs;
-	glGetProgramiv( Program, GL_ACTIVE_ATTRIBUTES, &numactiveattribs );
-	if( Verbose )
-		fprintf( stderr, "numactiveattribs = %d\n", numactiveattribs );
+	ShadowData.assign( shadowbytes, 0 );
+	for( int i = 0; i < NumActiveUniforms; i++ )
+	{
+		const GLSLVariable &u = Uniforms[i];
+		for( int e = 0; e < u.Size  &&  u.ElementBytes > 0; e++ )
+		{
+			GLint loc = u.Location;
+			if( e > 0 )
+			{
+				char ename[256];
+				snprintf( ename, sizeof(ename), "%s[%d]", u.Name.c_str( ), e );
+				loc = glGetUniformLocation( Program, ename );
+				if( loc < 0 )
+					continue;
+			}
 
-	//glGetProgramiv( Program, GL_ACTIVE_ATTRIB_MAX_LENGTH, &bufsize );
-	GLsizei bufsize = 256;
-	char *lname = new char [bufsize+1];
+			void *data = &ShadowData[ u.Offset + e * u.ElementBytes ];
+			if( IsIntegerType( u.Type ) )
+				glGetUniformiv( Program, loc, (GLint *)data );
+			else
+				glGetUniformfv( Program, loc, (GLfloat *)data );
+		}
+	}
 
 	for( int i = 0; i < numactiveattribs; i++ )
 	{
-		GLint lsize;
-		GLenum ltype;
-		GLsizei length;
-		glGetActiveAttrib( Program, i, bufsize, &length, &lsize, &ltype, lname );
-		if( strcmp( name, lname ) == 0 )
-		{
-			if( Verbose )
-				fprintf( stderr, "Attribute Variable #%2d, '%s' is size %d and type 0x%X\n", i, lname, lsize, ltype );
-			*sizep = lsize;
-			*typep = ltype;
-			return 0;
-		}
+		GLSLVariable v;
+		glGetActiveAttrib( Program, i, bufsize+1, NULL, &v.Size, &v.Type, lname );
+		v.Name = lname;
+		v.Location = glGetAttribLocation( Program, lname );	// -1 for the gl_ built-ins
+		Attributes.push_back( v );
 	}
 
-	return -1;
+	delete [ ] lname;
+
+	if( Verbose )
+		PrintInterface( stderr );
 }
 
 
@@ -461,6 +1358,15 @@ void
 GLSLProgram::Init( )
 {
 	Verbose = false;
+	Async = false;
+	Pending = false;
+	Defines = NULL;
+	NumActiveUniforms = 0;
+	for( int i = 0; i < MAX_PROGRAM_FEATURES; i++ )
+		FeatureNames[i] = NULL;
+	for( int i = 0; i < 6; i++ )
+		Files[i] = NULL;
+	Variants.clear( );
 
 #ifndef __APPLE__
 	const GLubyte* extensions = glGetString(GL_EXTENSIONS);
@@ -489,6 +1395,14 @@ GLSLProgram::Init( )
 		CanDoTessellationShaders = IsExtensionSupported( "GL_ARB_tessellation_shader" );
 		CanDoGeometryShaders     = IsExtensionSupported( "GL_ARB_geometry_shader4" )  ||  IsExtensionSupported( "GL_EXT_geometry_shader4" ) || IsExtensionSupported("GL_EXT_geometry_shader");
 		CanDoFragmentShaders     = IsExtensionSupported( "GL_ARB_fragment_shader" );
+#ifndef __APPLE__
+		CanDoProgramBinaries     = IsExtensionSupported( "GL_ARB_get_program_binary" )  &&  GetOSU( GL_NUM_PROGRAM_BINARY_FORMATS ) > 0;
+		CanDoParallelCompile     = IsExtensionSupported( "GL_KHR_parallel_shader_compile" )  ||  IsExtensionSupported( "GL_ARB_parallel_shader_compile" );
+		CanDoDirectUniforms      = IsExtensionSupported( "GL_ARB_separate_shader_objects" )  &&  GLEW_ARB_separate_shader_objects;	// (glew only sets this if it found the entry points)
+#else
+		CanDoProgramBinaries     = false;
+		CanDoParallelCompile     = false;
+#endif
 		fprintf( stderr, "This system can handle:\n" );
 	}
 	else
@@ -498,6 +1412,8 @@ GLSLProgram::Init( )
 		CanDoTessellationShaders = true;
 		CanDoGeometryShaders     = true;
 		CanDoFragmentShaders     = true;
+		CanDoProgramBinaries     = false;
+		CanDoParallelCompile     = false;
 		fprintf( stderr, "Your system's OpenGL is not telling me what extensions you have.\n" );
 		fprintf( stderr, "So, I am going to assume that your system can handle:\n" );
 	}
@@ -508,6 +1424,23 @@ GLSLProgram::Init( )
 	if( CanDoTessellationShaders )          fprintf( stderr, "\ttessellation control shaders \n" );
 	if( CanDoTessellationShaders )          fprintf( stderr, "\ttessellation evaluation shaders \n" );
 	if( CanDoComputeShaders )               fprintf( stderr, "\tcompute shaders \n");
+	if( CanDoProgramBinaries )              fprintf( stderr, "\tprogram binaries \n");
+	if( CanDoParallelCompile )              fprintf( stderr, "\tparallel shader compiles \n");
+	if( CanDoDirectUniforms )               fprintf( stderr, "\tdirect uniform updates \n");
+
+#ifndef __APPLE__
+	// let the driver use as many compiler threads as it wants:
+
+	if( CanDoParallelCompile )
+	{
+		typedef void (GLAPIENTRY *MaxThreadsProc)( GLuint );
+		MaxThreadsProc maxThreads = (MaxThreadsProc)GetGLProcAddress( "glMaxShaderCompilerThreadsKHR" );
+		if( maxThreads == NULL )
+			maxThreads = (MaxThreadsProc)GetGLProcAddress( "glMaxShaderCompilerThreadsARB" );
+		if( maxThreads != NULL )
+			( *maxThreads )( 0xFFFFFFFF );
+	}
+#endif
 
 	fprintf( stderr, "\n" );
 }
@@ -565,6 +1498,58 @@ GLSLProgram::UseFixedFunction( )
 };
 
 
+// get the permutation of this program that has a #define for each feature bit that is set
+// (each variant is compiled from the same files the first time it is asked for, then kept --
+//  if it fails to build, the base program is returned instead)
+
+GLSLProgram *
+GLSLProgram::Variant( unsigned int features )
+{
+	if( features == 0 )
+		return this;
+
+	std::map<unsigned int, GLSLProgram *>::iterator pos = Variants.find( features );
+	if( pos != Variants.end( ) )
+		return pos->second->Valid ? pos->second : this;
+
+	int length = (int)strlen( "#line 2\n" ) + 1;
+	for( int i = 0; i < MAX_PROGRAM_FEATURES; i++ )
+	{
+		if( ( features & ( 1u << i ) )  &&  FeatureNames[i] != NULL )
+			length += (int)strlen( "#define \n" ) + (int)strlen( FeatureNames[i] );
+	}
+
+	char *defines = new char [length];
+	defines[0] = '\0';
+	for( int i = 0; i < MAX_PROGRAM_FEATURES; i++ )
+	{
+		if( ( features & ( 1u << i ) ) == 0 )
+			continue;
+		if( FeatureNames[i] == NULL )
+		{
+			fprintf( stderr, "Feature 0x%X has no #define name\n", 1u << i );
+			continue;
+		}
+		strcat( defines, "#define " );
+		strcat( defines, FeatureNames[i] );
+		strcat( defines, "\n" );
+	}
+	strcat( defines, "#line 2\n" );		// keep the compiler's line numbers matching the file
+
+	GLSLProgram *variant = new GLSLProgram( *this );
+	variant->Variants.clear( );
+	variant->Defines = defines;
+	variant->CreateHelper( Files[0], Files[1], Files[2], Files[3], Files[4], Files[5], NULL );
+	if( variant->Valid )
+		variant->CopyUniforms( this );
+	else
+		fprintf( stderr, "Variant 0x%X did not build, using the base program\n", features );
+
+	Variants[features] = variant;
+	return variant->Valid ? variant : this;
+}
+
+
 #ifdef COMPUTE
 void
 GLSLProgram::DispatchCompute( int num_groups_x, int num_groups_y, int num_groups_z )
@@ -578,15 +1563,8 @@ GLSLProgram::DispatchCompute( int num_groups_x, int num_groups_y, int num_groups
 int
 GLSLProgram::GetAttributeLocation( char *name )
 {
-	std::map<char *, int>::iterator pos;
-
-	pos = AttributeLocs.find( name );
-	if( pos == AttributeLocs.end() )
-	{
-		AttributeLocs[name] = glGetAttribLocation( this->Program, name );
-	}
-
-	return AttributeLocs[name];
+	int index = FindAttribute( name );
+	return index < 0 ? -1 : Attributes[index].Location;
 };
 
 
@@ -765,61 +1743,47 @@ GLSLProgram::SetAttributeVariable( char* name, float vals[3] )
 int
 GLSLProgram::GetUniformLocation( char *name )
 {
-	std::map<char *, int>::iterator pos;
-
-	pos = UniformLocs.find( name );
-	//if( Verbose )
-		//fprintf( stderr, "Uniform: pos = 0x%016x ; size = %d ; end = 0x%016x\n", pos, UniformLocs.size(), UniformLocs.end() );
-	if( pos == UniformLocs.end() )
-	{
-		GLuint loc = glGetUniformLocation( this->Program, name );
-		UniformLocs[name] = loc;
-		if( Verbose )
-			fprintf( stderr, "Location of '%s' in Program %d = %d\n", name, this->Program, loc );
-	}
-	else
-	{
-		if( Verbose )
-		{
-			fprintf( stderr, "Location = %d\n", UniformLocs[name] );
-			if( UniformLocs[name] == -1 )
-				fprintf( stderr, "Location of uniform variable '%s' is -1\n", name );
-		}
-	}
-
-	return UniformLocs[name];
+	int index = FindUniform( name );
+	return index < 0 ? -1 : Uniforms[index].Location;
 };
 
 
 void
 GLSLProgram::SetUniformVariable( char* name, int val )
 {
-	int loc;
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	int index;
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
 #ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
+		GLenum type = Uniforms[index].Type;
 
 		switch( type )
 		{
 			case GL_INT:
+			case GL_BOOL:
 			case GL_SAMPLER_1D:
 			case GL_SAMPLER_2D:
 			case GL_SAMPLER_3D:
 			case GL_SAMPLER_CUBE:
-				glUniform1i( loc, val );
+#ifdef GL_SAMPLER_2D_ARRAY_EXT
+			case GL_SAMPLER_2D_ARRAY_EXT:
+#endif
+				StoreUniform( index, &val, sizeof(val) );
 				break;
 
 			case GL_FLOAT:
-				glUniform1f( loc, (float)val );
+			{
+				float f = (float)val;
+				StoreUniform( index, &f, sizeof(f) );
 				break;
+			}
 
 #ifndef __APPLE__
 			case GL_DOUBLE:
-				glUniform1d( loc, (double)val );
+				this->Use();
+				glUniform1d( Uniforms[index].Location, (double)val );
+				UniformWritesRequested++;
+				UniformWritesIssued++;
 				break;
 #endif
 
@@ -827,7 +1791,7 @@ GLSLProgram::SetUniformVariable( char* name, int val )
 				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
 		}
 #else
-		glUniform1i( loc, val );
+		StoreUniform( index, &val, sizeof(val) );
 #endif
 	}
 
@@ -837,28 +1801,31 @@ GLSLProgram::SetUniformVariable( char* name, int val )
 void
 GLSLProgram::SetUniformVariable( char* name, float val )
 {
-	int loc;
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	int index;
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
 #ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
+		GLenum type = Uniforms[index].Type;
 
 		switch( type )
 		{
 			case GL_INT:
-				glUniform1i( loc, (int)val );
+			{
+				int i = (int)val;
+				StoreUniform( index, &i, sizeof(i) );
 				break;
+			}
 
 			case GL_FLOAT:
-				glUniform1f( loc, val );
+				StoreUniform( index, &val, sizeof(val) );
 				break;
 
 #ifndef __APPLE__
 			case GL_DOUBLE:
-				glUniform1d( loc, (double)val );
+				this->Use();
+				glUniform1d( Uniforms[index].Location, (double)val );
+				UniformWritesRequested++;
+				UniformWritesIssued++;
 				break;
 #endif
 
@@ -866,7 +1833,7 @@ GLSLProgram::SetUniformVariable( char* name, float val )
 				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
 		}
 #else
-		glUniform1f( loc, val );
+		StoreUniform( index, &val, sizeof(val) );
 #endif
 	}
 };
@@ -875,27 +1842,33 @@ GLSLProgram::SetUniformVariable( char* name, float val )
 void
 GLSLProgram::SetUniformVariable( char* name, double val )
 {
-	int loc;
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	int index;
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
 #ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
+		GLenum type = Uniforms[index].Type;
 		switch( type )
 		{
 			case GL_INT:
-				glUniform1i( loc, (int)val );
+			{
+				int i = (int)val;
+				StoreUniform( index, &i, sizeof(i) );
 				break;
+			}
 
 			case GL_FLOAT:
-				glUniform1f( loc, (float)val );
+			{
+				float f = (float)val;
+				StoreUniform( index, &f, sizeof(f) );
 				break;
+			}
 
 #ifndef __APPLE__
 			case GL_DOUBLE:
-				glUniform1d( loc, val );
+				this->Use();
+				glUniform1d( Uniforms[index].Location, val );
+				UniformWritesRequested++;
+				UniformWritesIssued++;
 				break;
 #endif
 
@@ -903,9 +1876,8 @@ GLSLProgram::SetUniformVariable( char* name, double val )
 				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
 		}
 #else
-#ifndef __APPLE__
-		glUniform1d( loc, val );
-#endif
+		float f = (float)val;
+		StoreUniform( index, &f, sizeof(f) );
 #endif
 	}
 };
@@ -914,29 +1886,27 @@ GLSLProgram::SetUniformVariable( char* name, double val )
 void
 GLSLProgram::SetUniformVariable( char* name, float val0, float val1, float val2 )
 {
-	int loc;
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	int index;
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
+		float v[4] = { val0, val1, val2, 1.f };
 #ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
-		switch( size )
+		GLenum type = Uniforms[index].Type;
+		switch( type )
 		{
-			case 3:
-				glUniform3f( loc, val0, val1, val2 );
+			case GL_FLOAT_VEC3:
+				StoreUniform( index, v, 3*sizeof(float) );
 				break;
 
-			case 4:
-				glUniform4f( loc, val0, val1, val2, 1.f );
+			case GL_FLOAT_VEC4:
+				StoreUniform( index, v, 4*sizeof(float) );
 				break;
 
 			default:
 				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
 		}
 #else
-		glUniform3f( loc, val0, val1, val2 );
+		StoreUniform( index, v, 3*sizeof(float) );
 #endif
 	}
 };
@@ -945,44 +1915,66 @@ GLSLProgram::SetUniformVariable( char* name, float val0, float val1, float val2
 void
 GLSLProgram::SetUniformVariable( char* name, float val0, float val1, float val2, float val3 )
 {
-	int loc;
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	int index;
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
+		float v[4] = { val0, val1, val2, val3 };
 #ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
-		switch( size )
+		GLenum type = Uniforms[index].Type;
+		switch( type )
 		{
-			case 3:
-				glUniform3f( loc, val0, val1, val2 );
+			case GL_FLOAT_VEC3:
+				StoreUniform( index, v, 3*sizeof(float) );
 				break;
 
-			case 4:
-				glUniform4f( loc, val0, val1, val2, val3 );
+			case GL_FLOAT_VEC4:
+				StoreUniform( index, v, 4*sizeof(float) );
 				break;
 
 			default:
 				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
 		}
 #else
-		glUniform4f( loc, val0, val1, val2, val3 );
+		StoreUniform( index, v, 4*sizeof(float) );
 #endif
 	}
 };
 
 
+// set all of the elements of a float, vec2, vec3, or vec4 uniform array at once
+// (vals holds count elements, packed one after another):
+
+void
+GLSLProgram::SetUniformArray( char *name, int count, float *vals )
+{
+	int index;
+	if( ( index = FindUniform( name ) )  >= 0 )
+	{
+		switch( Uniforms[index].Type )
+		{
+			case GL_FLOAT:
+			case GL_FLOAT_VEC2:
+			case GL_FLOAT_VEC3:
+			case GL_FLOAT_VEC4:
+				StoreUniform( index, vals, count * Uniforms[index].ElementBytes );
+				break;
+
+			default:
+				fprintf( stderr, "Setting uniform array '%s': it is not a float or vector array\n", name );
+		}
+	}
+};
+
+
 void
 GLSLProgram::SetUniformVariable( char* name, float vals[3] )
 {
-	int loc;
+	int index;
 	//fprintf( stderr, "Found a 3-element array\n" );
 
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
-		glUniform3fv( loc, 1, vals );
+		StoreUniform( index, vals, 3*sizeof(float) );
 	}
 };
 
@@ -993,76 +1985,25 @@ GLSLProgram::SetUniformVariable( char* name, float vals[3] )
 void
 GLSLProgram::SetUniformVariable( char *name, glm::vec3 v3 )
 {
-	int loc;
-	//fprintf( stderr, "Found a vec3\n" );
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
-	{
-		this->Use();
-#ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
-		switch( size )
-		{
-			case 3:
-				glUniform3f( loc, v3.x, v3.y, v3.z );
-				break;
-
-			case 4:
-				glUniform4f( loc, v3.x, v3.y, v3.z, 1.f );
-				break;
-
-			default:
-				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
-		}
-#else
-		glUniform3f( loc, v3.x, v3.y, v3.z );
-#endif
-	}
+	SetUniformVariable( name, v3.x, v3.y, v3.z );
 };
 
 void
 GLSLProgram::SetUniformVariable( char *name, glm::vec4 v4 )
 {
-	int loc;
-	//fprintf( stderr, "Found a vec4\n" );
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
-	{
-		this->Use();
-#ifdef TYPE_CHECKS
-		GLint  size;
-		GLenum type;
-		GetUniformTypeAndSize( name, &size, &type );
-		switch( size )
-		{
-			case 3:
-				glUniform3f( loc, v4.x, v4.y, v4.z );
-				break;
-
-			case 4:
-				glUniform4f( loc, v4.x, v4.y, v4.z, v4.w );
-				break;
-
-			default:
-				fprintf( stderr, "Setting uniform variable '%s': please be more explicit with the variable type\n", name );
-		}
-#else
-		glUniform4f( loc, v4.x, v4.y, v4.z, v4.w );
-#endif
-	}
+	SetUniformVariable( name, v4.x, v4.y, v4.z, v4.w );
 };
 
 
 void
 GLSLProgram::SetUniformVariable( char *name, glm::mat3 m3 )
 {
-	int loc;
+	int index;
 	// fprintf( stderr, "Found a mat3\n" );
 
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
-		glUniformMatrix3fv( loc, 1, GL_FALSE, glm::value_ptr( m3 ) );
+		StoreUniform( index, glm::value_ptr( m3 ), 9*sizeof(float) );
 	}
 };
 
@@ -1070,13 +2011,12 @@ GLSLProgram::SetUniformVariable( char *name, glm::mat3 m3 )
 void
 GLSLProgram::SetUniformVariable( char *name, glm::mat4 m4 )
 {
-	int loc;
+	int index;
 	// fprintf( stderr, "Found a mat4\n" );
 
-	if( ( loc = GetUniformLocation( name ) )  >= 0 )
+	if( ( index = FindUniform( name ) )  >= 0 )
 	{
-		this->Use();
-		glUniformMatrix4fv( loc, 1, GL_FALSE, glm::value_ptr( m4 ) );
+		StoreUniform( index, glm::value_ptr( m4 ), 16*sizeof(float) );
 	}
 };
 
@@ -1119,7 +2059,11 @@ GLSLProgram::IsExtensionSupported( const char *extension )
 }
 
 
+char *GLSLProgram::CacheDir = NULL;
 int GLSLProgram::CurrentProgram = 0;
+bool GLSLProgram::CanDoDirectUniforms = false;
+int GLSLProgram::UniformWritesRequested = 0;
+int GLSLProgram::UniformWritesIssued = 0;
 
 
 
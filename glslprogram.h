@@ -67,6 +67,8 @@ inline int GetOSU(int flag)
 
 #include "glut.h"
 #include <map>
+#include <string>
+#include <vector>
 #include <stdarg.h>
 
 
@@ -88,6 +90,57 @@ inline int GetOSU(int flag)
 //
 //********************************************************************************
 
+// from GL_KHR_parallel_shader_compile, in case glew.h is too old to have it:
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR	0x91B1
+#endif
+
+
+// most permutation features a program can have (one #define per bit):
+#define MAX_PROGRAM_FEATURES	8
+
+
+// one active uniform or attribute variable, as the driver reports it after linking
+// (an array is one entry, with Size elements):
+struct GLSLVariable
+{
+	std::string	Name;
+	GLint		Location;
+	GLenum		Type;
+	GLint		Size;
+
+	// where its value lives in the program's shadow copy, and whether that needs to be sent:
+	int		Offset;
+	int		ElementBytes;
+	bool		Dirty;
+	int		DirtyCount;	// elements to send at the next Flush( )
+};
+
+
+class GLSLProgram;
+
+
+// a uniform variable that has been looked up once (see GLSLProgram::Uniform<T>( )):
+// setting it goes straight into the program's shadow copy, with no name lookup or type check.
+// a handle stays good for as long as its program is not re-created.
+
+template<typename T>
+class GLSLUniform
+{
+  private:
+	GLSLProgram *	Owner;
+	int		Index;		// into the owner's reflection table
+
+  public:
+		GLSLUniform( )				: Owner( NULL ), Index( -1 )  { }
+		GLSLUniform( GLSLProgram *p, int index )	: Owner( p ), Index( index )  { }
+
+	bool	IsValid( ) const	{ return Owner != NULL; }
+	void	Set( const T & ) const;
+	void	Set( const T *, int ) const;
+};
+
+
 // shader types:
 enum ShaderTypes
 {
@@ -100,11 +153,18 @@ enum ShaderTypes
 class GLSLProgram
 {
   private:
-	std::map<char *, int>	AttributeLocs;
+	std::map<std::string, int>	AttributeIndex;		// name -> index into Attributes
+	std::vector<GLSLVariable>	Attributes;
+	bool			Async;			// CreateHelper( ) should not wait on the driver
+	unsigned long long	CacheKey;
+	char *			Defines;		// added after the #version line of every shader
+	char *			FeatureNames[MAX_PROGRAM_FEATURES];
+	char *			Files[6];		// kept so that variants can be compiled later
 #ifdef COMPUTE
 	char *			Cfile;
 	unsigned int		Cshader;
 #endif
+	std::vector<int>	DirtyList;		// uniforms whose shadow values have not been sent yet
 	char *			Ffile;
 	unsigned int		Fshader;
 #ifdef GEOMETRY
@@ -112,51 +172,93 @@ class GLSLProgram
 	unsigned int		Gshader;
 #endif
 	bool			IncludeGstap;
+	int			NumActiveUniforms;	// Uniforms past this are single array elements asked for by name
+	bool			Pending;		// an async create has not been finished yet
+	std::vector<char *>	PendingFiles;
+	std::vector<GLuint>	PendingShaders;
 	GLuint			Program;
+	std::vector<unsigned char>	ShadowData;	// CPU copy of every uniform value
 #ifdef TESSELLATION
 	char *			TCfile;
 	unsigned int		TCshader;
 	char *			TEfile;
 	unsigned int		TEshader;
 #endif
-	std::map<char *, int>	UniformLocs;
+	std::map<std::string, int>	UniformIndex;		// name -> index into Uniforms
+	std::vector<GLSLVariable>	Uniforms;
+	bool			UseCache;
 	bool			Valid;
+	std::map<unsigned int, GLSLProgram *>	Variants;
 	char *			Vfile;
 	GLuint			Vshader;
 	bool			Verbose;
 
+	static char *		CacheDir;
 	static int		CurrentProgram;
+	static int		UniformWritesIssued;
+	static int		UniformWritesRequested;
 
 	void	AttachShader( GLuint );
 	bool	CanDoComputeShaders;
+	static bool	CanDoDirectUniforms;
+	bool	CanDoProgramBinaries;
 	bool	CanDoFragmentShaders;
+	bool	CanDoParallelCompile;
 	bool	CanDoGeometryShaders;
 	bool	CanDoTessellationShaders;
 	bool	CanDoVertexShaders;
+	bool	CheckCompile( GLuint, char * );
+	bool	CheckLink( );
 	int	CompileShader( GLuint );
+	void	CopyUniforms( GLSLProgram * );
 	bool	CreateHelper( char *, ... );
+	int	FindAttribute( const char * );
+	int	FindUniform( const char * );
 	int	GetAttributeLocation( char * );
+	static int	GetElementBytes( GLenum );
+	void	GetCachePath( unsigned long long, char *, int );
 	int	GetUniformLocation( char * );
+	static bool	IsIntegerType( GLenum );
+	bool	LoadBinary( unsigned long long );
+	void	Reflect( );
+	void	SaveBinary( unsigned long long );
+	void	UploadUniform( const GLSLVariable &, int );
 
 
   public:
 		GLSLProgram( );
 
 	bool	Create( char *, char * = NULL, char * = NULL, char * = NULL, char * = NULL, char * = NULL );
+	bool	CreateAsync( char *, char * = NULL, char * = NULL, char * = NULL, char * = NULL, char * = NULL );
+	void	DefineFeature( unsigned int, char * );
 	void	DisableVertexAttribArray( const char * );
 	void	EnableVertexAttribArray( const char * );
+	bool	Finish( );
+	void	Flush( );
+	const GLSLVariable *	GetAttribute( int );
 	int	GetAttributeTypeAndSize( GLchar *, GLint *, GLenum * );
+	int	GetNumAttributes( );
+	int	GetNumUniforms( );
+	static const char *	GetTypeName( GLenum );
+	const GLSLVariable *	GetUniform( int );
 	int	GetUniformTypeAndSize(   GLchar *, GLint *, GLenum * );
+	static void	GetUniformWriteCounts( int *, int * );
 	void	Init( );
 	bool	IsExtensionSupported( const char * );
 	bool	IsNotValid( );
+	bool	IsPending( );
+	bool	IsReady( );
 	bool	IsValid( );
+	void	PrintInterface( FILE * );
+	static void	ResetUniformWriteCounts( );
 	void	SetAttributePointer3fv( char *, float * );
 	void	SetAttributeVariable( char *, int );
 	void	SetAttributeVariable( char *, float );
 	void	SetAttributeVariable( char *, double );
 	void	SetAttributeVariable( char *, float, float, float );
 	void	SetAttributeVariable( char *, float[3] );
+	static void	SetCacheDir( char * );
+	void	SetUniformArray( char *, int, float * );
 	void	VertexAttrib3f( const char *, float, float, float );
 	void	SetUniformVariable( char *, int );
 	void	SetUniformVariable( char *, float );
@@ -164,6 +266,7 @@ class GLSLProgram
 	void	SetUniformVariable( char *, float, float, float );
 	void	SetUniformVariable( char *, float, float, float, float );
 	void	SetUniformVariable( char *, float[3] );
+	void	StoreUniform( int, const void *, int );
 
 #ifdef GLM
 	void	SetUniformVariable( char *, glm::vec3 );
@@ -173,10 +276,60 @@ class GLSLProgram
 #endif
 
 	void	SetVerbose( bool );
+	template<typename T>
+	GLSLUniform<T>	Uniform( const char * );
 	void	UnUse( );
 	void	Use( );
-	void	Use( GLuint );
+	static void	Use( GLuint );
 	void	UseFixedFunction( );
+	GLSLProgram *	Variant( unsigned int );
+
+	// for GLSLProgram::Uniform<T>( ):
+	static bool	UniformTypeMatches( GLenum, const float * );
+	static bool	UniformTypeMatches( GLenum, const int * );
+	static bool	UniformTypeMatches( GLenum, const glm::vec2 * );
+	static bool	UniformTypeMatches( GLenum, const glm::vec3 * );
+	static bool	UniformTypeMatches( GLenum, const glm::vec4 * );
+	static bool	UniformTypeMatches( GLenum, const glm::mat3 * );
+	static bool	UniformTypeMatches( GLenum, const glm::mat4 * );
 };
 
+
+// look up a uniform variable once, and check that it really is a T:
+
+template<typename T>
+GLSLUniform<T>
+GLSLProgram::Uniform( const char *name )
+{
+	int index = FindUniform( name );
+	if( index < 0 )
+		return GLSLUniform<T>( );
+
+	const GLSLVariable &u = Uniforms[index];
+	if( ! UniformTypeMatches( u.Type, (const T *)NULL ) )
+	{
+		fprintf( stderr, "Uniform variable '%s' is a %s, which does not match the type of its handle\n", name, GetTypeName( u.Type ) );
+		return GLSLUniform<T>( );
+	}
+	return GLSLUniform<T>( this, index );
+}
+
+
+template<typename T>
+void
+GLSLUniform<T>::Set( const T &val ) const
+{
+	if( Owner != NULL )
+		Owner->StoreUniform( Index, &val, (int)sizeof(T) );
+}
+
+
+template<typename T>
+void
+GLSLUniform<T>::Set( const T *vals, int count ) const
+{
+	if( Owner != NULL )
+		Owner->StoreUniform( Index, vals, count * (int)sizeof(T) );
+}
+
 #endif		// #ifndef GLSLPROGRAM_CPP
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "glstats.h"
+
+
+GLenum				GlStats::ActiveUnit = GL_TEXTURE0;
+GLenum				GlStats::BeginMode = GL_POINTS;
+long long			GlStats::BeginVertices = 0;
+std::map<GLenum, GLuint>	GlStats::BoundBuffers;
+std::map<std::pair<GLenum, GLenum>, GLuint>	GlStats::BoundTextures;
+std::map<GLuint, long long>	GlStats::BufferSizes;
+long long			GlStats::BufferTotal = 0;
+bool				GlStats::Compiling = false;
+bool				GlStats::CompileAndExecute = false;
+GLuint				GlStats::CompilingList = 0;
+struct GlCounts			GlStats::Current = GlCounts( );
+int				GlStats::Frames = 0;
+struct GlCounts			GlStats::Last = GlCounts( );
+std::map<GLuint, struct GlCounts>	GlStats::Lists;
+struct GlCounts			GlStats::Most = GlCounts( );
+std::map<GLuint, std::map<std::pair<GLenum, GLint>, long long> >	GlStats::TextureSizes;
+long long			GlStats::TextureTotal = 0;
+struct GlCounts			GlStats::Total = GlCounts( );
+
+
+void
+GlStats::Add( struct GlCounts *to, const struct GlCounts &from )
+{
+	to->bufferBinds        += from.bufferBinds;
+	to->bytesUploaded      += from.bytesUploaded;
+	to->clientStateToggles += from.clientStateToggles;
+	to->drawCalls          += from.drawCalls;
+	to->indices            += from.indices;
+	to->primitives         += from.primitives;
+	to->programSwitches    += from.programSwitches;
+	to->textureBinds       += from.textureBinds;
+	to->uniformUploads     += from.uniformUploads;
+}
+
+
+// where the calls are being counted -- the list being compiled, or the frame:
+
+struct GlCounts *
+GlStats::Counts( )
+{
+	if( Compiling )
+		return &Lists[CompilingList];
+	return &Current;
+}
+
+
+// one draw of vertices vertices (indices of them from an element array), instances times:
+
+void
+GlStats::Draw( GLenum mode, long long vertices, long long indices, int instances )
+{
+	long long primitives;
+	switch( mode )
+	{
+		case GL_POINTS:		primitives = vertices;				break;
+		case GL_LINES:		primitives = vertices / 2;			break;
+		case GL_LINE_LOOP:	primitives = vertices > 1 ? vertices : 0;	break;
+		case GL_LINE_STRIP:	primitives = vertices > 1 ? vertices - 1 : 0;	break;
+		case GL_TRIANGLES:	primitives = vertices / 3;			break;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:	primitives = vertices > 2 ? vertices - 2 : 0;	break;
+		case GL_QUADS:		primitives = vertices / 4;			break;
+		case GL_QUAD_STRIP:	primitives = vertices > 3 ? ( vertices - 2 ) / 2 : 0;	break;
+		case GL_POLYGON:	primitives = vertices > 2 ? 1 : 0;		break;
+		default:		primitives = 0;
+	}
+
+	struct GlCounts *c = Counts( );
+	c->drawCalls++;
+	c->indices += indices;
+	c->primitives += primitives * (long long)instances;
+}
+
+
+// buffers are going away -- take them out of the total, and out of wherever they were bound:
+
+void
+GlStats::DropBuffers( GLsizei n, const GLuint *buffers )
+{
+	for( int i = 0; i < n; i++ )
+	{
+		std::map<GLuint, long long>::iterator it = BufferSizes.find( buffers[i] );
+		if( it != BufferSizes.end( ) )
+		{
+			BufferTotal -= it->second;
+			BufferSizes.erase( it );
+		}
+
+		for( std::map<GLenum, GLuint>::iterator b = BoundBuffers.begin( ); b != BoundBuffers.end( ); ++b )
+		{
+			if( b->second == buffers[i] )
+				b->second = 0;
+		}
+	}
+}
+
+
+void
+GlStats::DropTextures( GLsizei n, const GLuint *textures )
+{
+	for( int i = 0; i < n; i++ )
+	{
+		std::map<GLuint, std::map<std::pair<GLenum, GLint>, long long> >::iterator it = TextureSizes.find( textures[i] );
+		if( it != TextureSizes.end( ) )
+		{
+			for( std::map<std::pair<GLenum, GLint>, long long>::iterator l = it->second.begin( ); l != it->second.end( ); ++l )
+				TextureTotal -= l->second;
+			TextureSizes.erase( it );
+		}
+
+		for( std::map<std::pair<GLenum, GLenum>, GLuint>::iterator b = BoundTextures.begin( ); b != BoundTextures.end( ); ++b )
+		{
+			if( b->second == textures[i] )
+				b->second = 0;
+		}
+	}
+}
+
+
+// whether a call that can go into a display list is being made now, and not only compiled
+// (a list that binds something does not change the bindings followed here when it is called --
+// nothing the forest puts in a list does):
+
+bool
+GlStats::Executing( )
+{
+	return ! Compiling  ||  CompileAndExecute;
+}
+
+
+// the last frame is done -- keep its counts, and start on the next one:
+
+void
+GlStats::FrameDone( )
+{
+	Last = Current;
+	Current = GlCounts( );
+
+	Add( &Total, Last );
+	Most.bufferBinds        = std::max( Most.bufferBinds, Last.bufferBinds );
+	Most.bytesUploaded      = std::max( Most.bytesUploaded, Last.bytesUploaded );
+	Most.clientStateToggles = std::max( Most.clientStateToggles, Last.clientStateToggles );
+	Most.drawCalls          = std::max( Most.drawCalls, Last.drawCalls );
+	Most.indices            = std::max( Most.indices, Last.indices );
+	Most.primitives         = std::max( Most.primitives, Last.primitives );
+	Most.programSwitches    = std::max( Most.programSwitches, Last.programSwitches );
+	Most.textureBinds       = std::max( Most.textureBinds, Last.textureBinds );
+	Most.uniformUploads     = std::max( Most.uniformUploads, Last.uniformUploads );
+	Frames++;
+}
+
+
+// the mean and the most per frame since ResetTotals( ), as a JSON object:
+
+std::string
+GlStats::FormatTotalsJSON( )
+{
+	const char *names[9] = { "draw_calls", "primitives", "indices", "buffer_binds", "texture_binds",
+		"program_switches", "uniform_uploads", "client_state_toggles", "bytes_uploaded" };
+	long long totals[9] = { Total.drawCalls, Total.primitives, Total.indices, Total.bufferBinds, Total.textureBinds,
+		Total.programSwitches, Total.uniformUploads, Total.clientStateToggles, Total.bytesUploaded };
+	long long most[9] = { Most.drawCalls, Most.primitives, Most.indices, Most.bufferBinds, Most.textureBinds,
+		Most.programSwitches, Most.uniformUploads, Most.clientStateToggles, Most.bytesUploaded };
+
+	std::string json = "{ \"frames\": " + std::to_string( Frames );
+	for( int i = 0; i < 9; i++ )
+	{
+		char member[128];
+		snprintf( member, sizeof( member ), ",\n    \"%s\": { \"mean\": %.1f, \"max\": %lld }",
+			names[i], Frames > 0 ? (double)totals[i] / (double)Frames : 0., most[i] );
+		json += member;
+	}
+	json += " }";
+	return json;
+}
+
+
+// the bytes in every buffer object there is now:
+
+long long
+GlStats::GetBufferBytes( )
+{
+	return BufferTotal;
+}
+
+
+const struct GlCounts &
+GlStats::GetLastFrame( )
+{
+	return Last;
+}
+
+
+// the bytes in every texture there is now, each face and mipmap level of it:
+
+long long
+GlStats::GetTextureBytes( )
+{
+	return TextureTotal;
+}
+
+
+// the sum and the most of each count over the frames since ResetTotals( ) (either can be NULL);
+// returns how many frames that was:
+
+int
+GlStats::GetTotals( struct GlCounts *total, struct GlCounts *most )
+{
+	if( total != NULL )
+		*total = Total;
+	if( most != NULL )
+		*most = Most;
+	return Frames;
+}
+
+
+// bytes in a block of pixels coming from memory (0 if there are no pixels, as for a texture
+// that is only being allocated):
+
+long long
+GlStats::PixelBytes( GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels )
+{
+	if( pixels == NULL )
+		return 0;
+
+	int components;
+	switch( format )
+	{
+		case GL_RGB:
+		case GL_BGR:		components = 3;		break;
+		case GL_RGBA:
+		case GL_BGRA:		components = 4;		break;
+		case GL_LUMINANCE_ALPHA:
+		case GL_RG:		components = 2;		break;
+		default:		components = 1;		break;	// alpha, luminance, red, depth, ...
+	}
+
+	int size;
+	switch( type )
+	{
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:	size = 2;	break;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:		size = 4;	break;
+		default:		size = 1;	break;	// bytes
+	}
+
+	return (long long)width * (long long)height * (long long)depth * components * size;
+}
+
+
+void
+GlStats::ResetTotals( )
+{
+	Frames = 0;
+	Most = GlCounts( );
+	Total = GlCounts( );
+}
+
+
+// glBufferData( ) gives the buffer bound to target its size, replacing whatever it had
+// (the size counts even if there is no data yet):
+
+void
+GlStats::SetBufferSize( GLenum target, GLsizeiptr size )
+{
+	std::map<GLenum, GLuint>::iterator bound = BoundBuffers.find( target );
+	if( bound == BoundBuffers.end( )  ||  bound->second == 0 )
+		return;
+
+	long long &bytes = BufferSizes[bound->second];
+	BufferTotal += (long long)size - bytes;
+	bytes = (long long)size;
+}
+
+
+// glTexImage*( ) gives one level of one face of the texture bound to target its size
+// (nothing counts for a proxy target or the default texture -- neither is bound to anything):
+
+void
+GlStats::SetTextureSize( GLenum target, GLint level, GLint internal, GLsizei width, GLsizei height, GLsizei depth )
+{
+	GLenum binding = target;
+	if( target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X  &&  target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z )
+		binding = GL_TEXTURE_CUBE_MAP;
+
+	std::map<std::pair<GLenum, GLenum>, GLuint>::iterator bound = BoundTextures.find( std::make_pair( ActiveUnit, binding ) );
+	if( bound == BoundTextures.end( )  ||  bound->second == 0 )
+		return;
+
+	long long size = (long long)width * (long long)height * (long long)depth * TexelBytes( internal );
+	long long &bytes = TextureSizes[bound->second][ std::make_pair( target, level ) ];
+	TextureTotal += size - bytes;
+	bytes = size;
+}
+
+
+// bytes in one texel of an internal format (4 for any the forest does not use):
+
+long long
+GlStats::TexelBytes( GLint internal )
+{
+	switch( internal )
+	{
+		case 1:
+		case GL_ALPHA:
+		case GL_ALPHA8:
+		case GL_INTENSITY:
+		case GL_INTENSITY8:
+		case GL_LUMINANCE:
+		case GL_LUMINANCE8:		return 1;
+
+		case 2:
+		case GL_DEPTH_COMPONENT16:
+		case GL_LUMINANCE_ALPHA:
+		case GL_LUMINANCE8_ALPHA8:	return 2;
+
+		case 3:
+		case GL_DEPTH_COMPONENT24:
+		case GL_RGB:
+		case GL_RGB8:			return 3;
+
+		case GL_RGB16F_ARB:		return 6;
+
+		case GL_LUMINANCE_ALPHA32F_ARB:
+		case GL_RGBA16F_ARB:		return 8;
+
+		case GL_RGB32F_ARB:		return 12;
+
+		case GL_RGBA32F_ARB:		return 16;
+
+		default:			return 4;	// RGBA8, 32-bit depth, LUMINANCE32F, ...
+	}
+}
@@ -0,0 +1,536 @@
+#ifndef GLSTATS_H
+#define GLSTATS_H
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// what one frame (or one display list) asked OpenGL to do:
+struct GlCounts
+{
+	int		bufferBinds;		// glBindBuffer( )
+	long long	bytesUploaded;		// buffer and texture data sent from memory
+	int		clientStateToggles;	// gl{En,Dis}ableClientState( ), gl{En,Dis}ableVertexAttribArray( )
+	int		drawCalls;		// glDraw*( ), and glBegin( )/glEnd( ) pairs
+	long long	indices;		// indices given to glDrawElements*( )
+	long long	primitives;		// points, lines, triangles, and quads, counting every instance
+	int		programSwitches;	// glUseProgram( )
+	int		textureBinds;		// glBindTexture( )
+	int		uniformUploads;		// glUniform*( ), glProgramUniform*( )
+};
+
+
+// Count what each frame asks OpenGL to do.
+//
+// Including this file puts a macro in front of each OpenGL call the forest makes
+// that is worth counting -- draws, binds, program changes, uniforms, client state,
+// and uploads -- which counts it and then makes the real call, so none of the code
+// that makes the calls has to change. Only the code that comes after the #include
+// is counted: forest.cpp includes glstats.cpp ahead of every other module.
+//
+// Display lists are counted as they are compiled, and those counts are added in
+// every time the list is called, so the draws inside a glCallList( ) are not lost.
+// Call FrameDone( ) once a frame: GetLastFrame( ) is then what that frame did, and
+// GetTotals( ) adds up every frame since ResetTotals( ) (say, a benchmark run).
+//
+// It also keeps running totals of the memory the textures and buffer objects take
+// (GetTextureBytes( ), GetBufferBytes( )): each glTexImage*( ) and glBufferData( )
+// sets the size of what is bound, and glDelete*( ) takes it away again, so the
+// totals cost nothing to look at every frame. For that it follows what is bound
+// where, and which texture unit is active. Sizes are what the internal format
+// says, not whatever padding the driver adds.
+// It is all for the thread that has the context.
+
+class GlStats
+{
+private:
+	static GLenum	ActiveUnit;		// glActiveTexture( )
+	static GLenum	BeginMode;		// what is being drawn between glBegin( ) and glEnd( )
+	static long long	BeginVertices;
+	static std::map<GLenum, GLuint>	BoundBuffers;		// by target
+	static std::map<std::pair<GLenum, GLenum>, GLuint>	BoundTextures;	// by texture unit and target
+	static std::map<GLuint, long long>	BufferSizes;
+	static long long	BufferTotal;
+	static bool	Compiling;		// between glNewList( ) and glEndList( )
+	static bool	CompileAndExecute;
+	static GLuint	CompilingList;
+	static struct GlCounts	Current;
+	static int	Frames;			// frames added into Total and Most
+	static struct GlCounts	Last;
+	static std::map<GLuint, struct GlCounts>	Lists;
+	static struct GlCounts	Most;		// the most of each count in any one frame
+	static std::map<GLuint, std::map<std::pair<GLenum, GLint>, long long> >	TextureSizes;	// each face and level
+	static long long	TextureTotal;
+	static struct GlCounts	Total;
+
+	static void	Add( struct GlCounts *, const struct GlCounts & );
+	static struct GlCounts *	Counts( );
+	static void	Draw( GLenum, long long, long long, int );
+	static void	DropBuffers( GLsizei, const GLuint * );
+	static void	DropTextures( GLsizei, const GLuint * );
+	static bool	Executing( );
+	static long long	PixelBytes( GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void * );
+	static void	SetBufferSize( GLenum, GLsizeiptr );
+	static void	SetTextureSize( GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei );
+	static long long	TexelBytes( GLint );
+
+public:
+	static void	FrameDone( );
+	static std::string	FormatTotalsJSON( );
+	static long long	GetBufferBytes( );
+	static const struct GlCounts &	GetLastFrame( );
+	static long long	GetTextureBytes( );
+	static int	GetTotals( struct GlCounts *, struct GlCounts * );
+	static void	ResetTotals( );
+
+	// the counted calls:
+	static void	ActiveTexture( GLenum );
+	static void	Begin( GLenum );
+	static void	BindBuffer( GLenum, GLuint );
+	static void	BindTexture( GLenum, GLuint );
+	static void	BufferData( GLenum, GLsizeiptr, const void *, GLenum );
+	static void	BufferSubData( GLenum, GLintptr, GLsizeiptr, const void * );
+	static void	CallList( GLuint );
+	static void	DeleteBuffers( GLsizei, const GLuint * );
+	static void	DeleteTextures( GLsizei, const GLuint * );
+	static void	DisableClientState( GLenum );
+	static void	DisableVertexAttribArray( GLuint );
+	static void	DrawArrays( GLenum, GLint, GLsizei );
+	static void	DrawArraysInstanced( GLenum, GLint, GLsizei, GLsizei );
+	static void	DrawElements( GLenum, GLsizei, GLenum, const void * );
+	static void	DrawElementsInstanced( GLenum, GLsizei, GLenum, const void *, GLsizei );
+	static void	EnableClientState( GLenum );
+	static void	EnableVertexAttribArray( GLuint );
+	static void	End( );
+	static void	EndList( );
+	static void	NewList( GLuint, GLenum );
+	static void	TexImage2D( GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void * );
+	static void	TexImage3D( GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei, GLint, GLenum, GLenum, const void * );
+	static void	TexSubImage2D( GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void * );
+	static void	TexSubImage3D( GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void * );
+	static void	Uniform1fv( GLint, GLsizei, const GLfloat * );
+	static void	Uniform2fv( GLint, GLsizei, const GLfloat * );
+	static void	Uniform3fv( GLint, GLsizei, const GLfloat * );
+	static void	Uniform4fv( GLint, GLsizei, const GLfloat * );
+	static void	Uniform1iv( GLint, GLsizei, const GLint * );
+	static void	Uniform2iv( GLint, GLsizei, const GLint * );
+	static void	Uniform3iv( GLint, GLsizei, const GLint * );
+	static void	Uniform4iv( GLint, GLsizei, const GLint * );
+	static void	UniformMatrix2fv( GLint, GLsizei, GLboolean, const GLfloat * );
+	static void	UniformMatrix3fv( GLint, GLsizei, GLboolean, const GLfloat * );
+	static void	UniformMatrix4fv( GLint, GLsizei, GLboolean, const GLfloat * );
+#ifndef __APPLE__
+	static void	ProgramUniform1fv( GLuint, GLint, GLsizei, const GLfloat * );
+	static void	ProgramUniform2fv( GLuint, GLint, GLsizei, const GLfloat * );
+	static void	ProgramUniform3fv( GLuint, GLint, GLsizei, const GLfloat * );
+	static void	ProgramUniform4fv( GLuint, GLint, GLsizei, const GLfloat * );
+	static void	ProgramUniform1iv( GLuint, GLint, GLsizei, const GLint * );
+	static void	ProgramUniform2iv( GLuint, GLint, GLsizei, const GLint * );
+	static void	ProgramUniform3iv( GLuint, GLint, GLsizei, const GLint * );
+	static void	ProgramUniform4iv( GLuint, GLint, GLsizei, const GLint * );
+	static void	ProgramUniformMatrix2fv( GLuint, GLint, GLsizei, GLboolean, const GLfloat * );
+	static void	ProgramUniformMatrix3fv( GLuint, GLint, GLsizei, GLboolean, const GLfloat * );
+	static void	ProgramUniformMatrix4fv( GLuint, GLint, GLsizei, GLboolean, const GLfloat * );
+	static void	Uniform1d( GLint, GLdouble );
+#endif
+	static void	UseProgram( GLuint );
+	static void	Vertex3f( GLfloat, GLfloat, GLfloat );
+	static void	Vertex3fv( const GLfloat * );
+};
+
+
+// The counted calls are defined here, ahead of the macros below, so the calls
+// inside them are still the real ones. They are inline to cost next to nothing.
+
+inline void
+GlStats::ActiveTexture( GLenum unit )
+{
+	if( Executing( ) )
+		ActiveUnit = unit;
+	glActiveTexture( unit );
+}
+
+
+inline void
+GlStats::Begin( GLenum mode )
+{
+	BeginMode = mode;
+	BeginVertices = 0;
+	glBegin( mode );
+}
+
+
+inline void
+GlStats::BindBuffer( GLenum target, GLuint buffer )
+{
+	Counts( )->bufferBinds++;
+	BoundBuffers[target] = buffer;
+	glBindBuffer( target, buffer );
+}
+
+
+inline void
+GlStats::BindTexture( GLenum target, GLuint texture )
+{
+	Counts( )->textureBinds++;
+	if( Executing( ) )
+		BoundTextures[ std::make_pair( ActiveUnit, target ) ] = texture;
+	glBindTexture( target, texture );
+}
+
+
+inline void
+GlStats::BufferData( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+	if( data != NULL )
+		Counts( )->bytesUploaded += (long long)size;
+	SetBufferSize( target, size );
+	glBufferData( target, size, data, usage );
+}
+
+
+inline void
+GlStats::BufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const void *data )
+{
+	Counts( )->bytesUploaded += (long long)size;
+	glBufferSubData( target, offset, size, data );
+}
+
+
+inline void
+GlStats::CallList( GLuint list )
+{
+	std::map<GLuint, struct GlCounts>::iterator it = Lists.find( list );
+	if( it != Lists.end( ) )
+		Add( Counts( ), it->second );
+	glCallList( list );
+}
+
+
+inline void
+GlStats::DeleteBuffers( GLsizei n, const GLuint *buffers )
+{
+	DropBuffers( n, buffers );
+	glDeleteBuffers( n, buffers );
+}
+
+
+inline void
+GlStats::DeleteTextures( GLsizei n, const GLuint *textures )
+{
+	DropTextures( n, textures );
+	glDeleteTextures( n, textures );
+}
+
+
+inline void
+GlStats::DisableClientState( GLenum array )
+{
+	Counts( )->clientStateToggles++;
+	glDisableClientState( array );
+}
+
+
+inline void
+GlStats::DisableVertexAttribArray( GLuint index )
+{
+	Counts( )->clientStateToggles++;
+	glDisableVertexAttribArray( index );
+}
+
+
+inline void
+GlStats::DrawArrays( GLenum mode, GLint first, GLsizei count )
+{
+	Draw( mode, count, 0, 1 );
+	glDrawArrays( mode, first, count );
+}
+
+
+inline void
+GlStats::DrawArraysInstanced( GLenum mode, GLint first, GLsizei count, GLsizei instances )
+{
+	Draw( mode, count, 0, instances );
+	glDrawArraysInstanced( mode, first, count, instances );
+}
+
+
+inline void
+GlStats::DrawElements( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+	Draw( mode, count, count, 1 );
+	glDrawElements( mode, count, type, indices );
+}
+
+
+inline void
+GlStats::DrawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances )
+{
+	Draw( mode, count, count, instances );
+	glDrawElementsInstanced( mode, count, type, indices, instances );
+}
+
+
+inline void
+GlStats::EnableClientState( GLenum array )
+{
+	Counts( )->clientStateToggles++;
+	glEnableClientState( array );
+}
+
+
+inline void
+GlStats::EnableVertexAttribArray( GLuint index )
+{
+	Counts( )->clientStateToggles++;
+	glEnableVertexAttribArray( index );
+}
+
+
+inline void
+GlStats::End( )
+{
+	glEnd( );
+	Draw( BeginMode, BeginVertices, 0, 1 );
+}
+
+
+// a frame that calls the list gets what went into it, and so does this one if it is being drawn now:
+
+inline void
+GlStats::EndList( )
+{
+	glEndList( );
+	Compiling = false;
+	if( CompileAndExecute )
+		Add( &Current, Lists[CompilingList] );
+}
+
+
+inline void
+GlStats::NewList( GLuint list, GLenum mode )
+{
+	glNewList( list, mode );
+	Lists[list] = GlCounts( );
+	Compiling = true;
+	CompileAndExecute = ( mode == GL_COMPILE_AND_EXECUTE );
+	CompilingList = list;
+}
+
+
+inline void
+GlStats::TexImage2D( GLenum target, GLint level, GLint internal, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels )
+{
+	Counts( )->bytesUploaded += PixelBytes( width, height, 1, format, type, pixels );
+	if( Executing( ) )
+		SetTextureSize( target, level, internal, width, height, 1 );
+	glTexImage2D( target, level, internal, width, height, border, format, type, pixels );
+}
+
+
+inline void
+GlStats::TexImage3D( GLenum target, GLint level, GLint internal, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *pixels )
+{
+	Counts( )->bytesUploaded += PixelBytes( width, height, depth, format, type, pixels );
+	if( Executing( ) )
+		SetTextureSize( target, level, internal, width, height, depth );
+	glTexImage3D( target, level, internal, width, height, depth, border, format, type, pixels );
+}
+
+
+inline void
+GlStats::TexSubImage2D( GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels )
+{
+	Counts( )->bytesUploaded += PixelBytes( width, height, 1, format, type, pixels );
+	glTexSubImage2D( target, level, x, y, width, height, format, type, pixels );
+}
+
+
+inline void
+GlStats::TexSubImage3D( GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels )
+{
+	Counts( )->bytesUploaded += PixelBytes( width, height, depth, format, type, pixels );
+	glTexSubImage3D( target, level, x, y, z, width, height, depth, format, type, pixels );
+}
+
+
+// the uniforms are all alike:
+
+#define GLSTATS_UNIFORM( name, params, args )	\
+	inline void GlStats::name params { Counts( )->uniformUploads++; gl##name args; }
+
+GLSTATS_UNIFORM( Uniform1fv, ( GLint l, GLsizei c, const GLfloat *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform2fv, ( GLint l, GLsizei c, const GLfloat *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform3fv, ( GLint l, GLsizei c, const GLfloat *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform4fv, ( GLint l, GLsizei c, const GLfloat *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform1iv, ( GLint l, GLsizei c, const GLint *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform2iv, ( GLint l, GLsizei c, const GLint *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform3iv, ( GLint l, GLsizei c, const GLint *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( Uniform4iv, ( GLint l, GLsizei c, const GLint *v ), ( l, c, v ) )
+GLSTATS_UNIFORM( UniformMatrix2fv, ( GLint l, GLsizei c, GLboolean t, const GLfloat *v ), ( l, c, t, v ) )
+GLSTATS_UNIFORM( UniformMatrix3fv, ( GLint l, GLsizei c, GLboolean t, const GLfloat *v ), ( l, c, t, v ) )
+GLSTATS_UNIFORM( UniformMatrix4fv, ( GLint l, GLsizei c, GLboolean t, const GLfloat *v ), ( l, c, t, v ) )
+#ifndef __APPLE__
+GLSTATS_UNIFORM( ProgramUniform1fv, ( GLuint p, GLint l, GLsizei c, const GLfloat *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform2fv, ( GLuint p, GLint l, GLsizei c, const GLfloat *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform3fv, ( GLuint p, GLint l, GLsizei c, const GLfloat *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform4fv, ( GLuint p, GLint l, GLsizei c, const GLfloat *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform1iv, ( GLuint p, GLint l, GLsizei c, const GLint *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform2iv, ( GLuint p, GLint l, GLsizei c, const GLint *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform3iv, ( GLuint p, GLint l, GLsizei c, const GLint *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniform4iv, ( GLuint p, GLint l, GLsizei c, const GLint *v ), ( p, l, c, v ) )
+GLSTATS_UNIFORM( ProgramUniformMatrix2fv, ( GLuint p, GLint l, GLsizei c, GLboolean t, const GLfloat *v ), ( p, l, c, t, v ) )
+GLSTATS_UNIFORM( ProgramUniformMatrix3fv, ( GLuint p, GLint l, GLsizei c, GLboolean t, const GLfloat *v ), ( p, l, c, t, v ) )
+GLSTATS_UNIFORM( ProgramUniformMatrix4fv, ( GLuint p, GLint l, GLsizei c, GLboolean t, const GLfloat *v ), ( p, l, c, t, v ) )
+GLSTATS_UNIFORM( Uniform1d, ( GLint l, GLdouble v ), ( l, v ) )
+#endif
+
+#undef GLSTATS_UNIFORM
+
+
+inline void
+GlStats::UseProgram( GLuint program )
+{
+	Counts( )->programSwitches++;
+	glUseProgram( program );
+}
+
+
+inline void
+GlStats::Vertex3f( GLfloat x, GLfloat y, GLfloat z )
+{
+	BeginVertices++;
+	glVertex3f( x, y, z );
+}
+
+
+inline void
+GlStats::Vertex3fv( const GLfloat *v )
+{
+	BeginVertices++;
+	glVertex3fv( v );
+}
+
+
+// From here on, the calls go through the counts.
+// (glew makes most of these names macros already, and the rest are functions.)
+
+#undef glActiveTexture
+#undef glBegin
+#undef glBindBuffer
+#undef glBindTexture
+#undef glBufferData
+#undef glBufferSubData
+#undef glCallList
+#undef glDeleteBuffers
+#undef glDeleteTextures
+#undef glDisableClientState
+#undef glDisableVertexAttribArray
+#undef glDrawArrays
+#undef glDrawArraysInstanced
+#undef glDrawElements
+#undef glDrawElementsInstanced
+#undef glEnableClientState
+#undef glEnableVertexAttribArray
+#undef glEnd
+#undef glEndList
+#undef glNewList
+#undef glTexImage2D
+#undef glTexImage3D
+#undef glTexSubImage2D
+#undef glTexSubImage3D
+#undef glUniform1fv
+#undef glUniform2fv
+#undef glUniform3fv
+#undef glUniform4fv
+#undef glUniform1iv
+#undef glUniform2iv
+#undef glUniform3iv
+#undef glUniform4iv
+#undef glUniformMatrix2fv
+#undef glUniformMatrix3fv
+#undef glUniformMatrix4fv
+#undef glUseProgram
+#undef glVertex3f
+#undef glVertex3fv
+
+#define glActiveTexture( u )				GlStats::ActiveTexture( u )
+#define glBegin( m )					GlStats::Begin( m )
+#define glBindBuffer( t, b )				GlStats::BindBuffer( t, b )
+#define glBindTexture( t, x )				GlStats::BindTexture( t, x )
+#define glBufferData( t, n, d, u )			GlStats::BufferData( t, n, d, u )
+#define glBufferSubData( t, o, n, d )			GlStats::BufferSubData( t, o, n, d )
+#define glCallList( l )					GlStats::CallList( l )
+#define glDeleteBuffers( n, b )				GlStats::DeleteBuffers( n, b )
+#define glDeleteTextures( n, t )			GlStats::DeleteTextures( n, t )
+#define glDisableClientState( a )			GlStats::DisableClientState( a )
+#define glDisableVertexAttribArray( i )			GlStats::DisableVertexAttribArray( i )
+#define glDrawArrays( m, f, c )				GlStats::DrawArrays( m, f, c )
+#define glDrawArraysInstanced( m, f, c, n )		GlStats::DrawArraysInstanced( m, f, c, n )
+#define glDrawElements( m, c, t, i )			GlStats::DrawElements( m, c, t, i )
+#define glDrawElementsInstanced( m, c, t, i, n )	GlStats::DrawElementsInstanced( m, c, t, i, n )
+#define glEnableClientState( a )			GlStats::EnableClientState( a )
+#define glEnableVertexAttribArray( i )			GlStats::EnableVertexAttribArray( i )
+#define glEnd( )					GlStats::End( )
+#define glEndList( )					GlStats::EndList( )
+#define glNewList( l, m )				GlStats::NewList( l, m )
+#define glTexImage2D( t, l, i, w, h, b, f, y, p )	GlStats::TexImage2D( t, l, i, w, h, b, f, y, p )
+#define glTexImage3D( t, l, i, w, h, d, b, f, y, p )	GlStats::TexImage3D( t, l, i, w, h, d, b, f, y, p )
+#define glTexSubImage2D( t, l, x, y, w, h, f, ty, p )	GlStats::TexSubImage2D( t, l, x, y, w, h, f, ty, p )
+#define glTexSubImage3D( t, l, x, y, z, w, h, d, f, ty, p )	GlStats::TexSubImage3D( t, l, x, y, z, w, h, d, f, ty, p )
+#define glUniform1fv( l, c, v )				GlStats::Uniform1fv( l, c, v )
+#define glUniform2fv( l, c, v )				GlStats::Uniform2fv( l, c, v )
+#define glUniform3fv( l, c, v )				GlStats::Uniform3fv( l, c, v )
+#define glUniform4fv( l, c, v )				GlStats::Uniform4fv( l, c, v )
+#define glUniform1iv( l, c, v )				GlStats::Uniform1iv( l, c, v )
+#define glUniform2iv( l, c, v )				GlStats::Uniform2iv( l, c, v )
+#define glUniform3iv( l, c, v )				GlStats::Uniform3iv( l, c, v )
+#define glUniform4iv( l, c, v )				GlStats::Uniform4iv( l, c, v )
+#define glUniformMatrix2fv( l, c, t, v )		GlStats::UniformMatrix2fv( l, c, t, v )
+#define glUniformMatrix3fv( l, c, t, v )		GlStats::UniformMatrix3fv( l, c, t, v )
+#define glUniformMatrix4fv( l, c, t, v )		GlStats::UniformMatrix4fv( l, c, t, v )
+#define glUseProgram( p )				GlStats::UseProgram( p )
+#define glVertex3f( x, y, z )				GlStats::Vertex3f( x, y, z )
+#define glVertex3fv( v )				GlStats::Vertex3fv( v )
+
+#ifndef __APPLE__
+#undef glProgramUniform1fv
+#undef glProgramUniform2fv
+#undef glProgramUniform3fv
+#undef glProgramUniform4fv
+#undef glProgramUniform1iv
+#undef glProgramUniform2iv
+#undef glProgramUniform3iv
+#undef glProgramUniform4iv
+#undef glProgramUniformMatrix2fv
+#undef glProgramUniformMatrix3fv
+#undef glProgramUniformMatrix4fv
+#undef glUniform1d
+
+#define glProgramUniform1fv( p, l, c, v )		GlStats::ProgramUniform1fv( p, l, c, v )
+#define glProgramUniform2fv( p, l, c, v )		GlStats::ProgramUniform2fv( p, l, c, v )
+#define glProgramUniform3fv( p, l, c, v )		GlStats::ProgramUniform3fv( p, l, c, v )
+#define glProgramUniform4fv( p, l, c, v )		GlStats::ProgramUniform4fv( p, l, c, v )
+#define glProgramUniform1iv( p, l, c, v )		GlStats::ProgramUniform1iv( p, l, c, v )
+#define glProgramUniform2iv( p, l, c, v )		GlStats::ProgramUniform2iv( p, l, c, v )
+#define glProgramUniform3iv( p, l, c, v )		GlStats::ProgramUniform3iv( p, l, c, v )
+#define glProgramUniform4iv( p, l, c, v )		GlStats::ProgramUniform4iv( p, l, c, v )
+#define glProgramUniformMatrix2fv( p, l, c, t, v )	GlStats::ProgramUniformMatrix2fv( p, l, c, t, v )
+#define glProgramUniformMatrix3fv( p, l, c, t, v )	GlStats::ProgramUniformMatrix3fv( p, l, c, t, v )
+#define glProgramUniformMatrix4fv( p, l, c, t, v )	GlStats::ProgramUniformMatrix4fv( p, l, c, t, v )
+#define glUniform1d( l, v )				GlStats::Uniform1d( l, v )
+#endif
+
+#endif	// GLSTATS_H
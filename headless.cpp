@@ -0,0 +1,281 @@
+#include "headless.h"
+
+#ifdef HEADLESS
+#define EGL_NO_X11			// keep the X11 typedefs (Display, Window, ...) out
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+
+HeadlessContext::HeadlessContext( )
+{
+	Init( );
+}
+
+
+// make the offscreen framebuffer the one that gets drawn into:
+
+void
+HeadlessContext::Bind( )
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, Fbo );
+	glDrawBuffer( GL_COLOR_ATTACHMENT0 );
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+}
+
+
+// create the context, make it current, and give it a width x height framebuffer:
+
+bool
+HeadlessContext::Create( int width, int height )
+{
+#ifndef HEADLESS
+	fprintf( stderr, "This program was not built with -DHEADLESS, so it cannot render offscreen\n" );
+	return false;
+#else
+	if( Valid )
+		return true;
+
+	Width = width;
+	Height = height;
+
+	EGLDisplay dpy = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if( getPlatformDisplay != NULL )
+		dpy = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+	if( dpy == EGL_NO_DISPLAY )
+		dpy = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint major, minor;
+	if( dpy == EGL_NO_DISPLAY  ||  ! eglInitialize( dpy, &major, &minor ) )
+	{
+		fprintf( stderr, "Cannot open an EGL display: 0x%X\n", eglGetError( ) );
+		return false;
+	}
+	Dpy = dpy;
+
+	if( ! eglBindAPI( EGL_OPENGL_API ) )
+	{
+		fprintf( stderr, "This EGL (%d.%d) cannot do desktop OpenGL\n", major, minor );
+		Destroy( );
+		return false;
+	}
+
+	// the pixels go into the framebuffer object, so the config only needs to be able to do OpenGL --
+	// a pbuffer-capable one is asked for first in case the driver cannot go surfaceless:
+
+	EGLint pbufferAttribs[ ] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLint anyAttribs[ ] =
+	{
+		EGL_SURFACE_TYPE, EGL_DONT_CARE,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	bool canPbuffer = eglChooseConfig( dpy, pbufferAttribs, &config, 1, &numConfigs )  &&  numConfigs > 0;
+	if( ! canPbuffer )
+	{
+		if( ! eglChooseConfig( dpy, anyAttribs, &config, 1, &numConfigs )  ||  numConfigs == 0 )
+		{
+			fprintf( stderr, "No EGL config can do OpenGL: 0x%X\n", eglGetError( ) );
+			Destroy( );
+			return false;
+		}
+	}
+
+	// no attributes means a compatibility-profile context, which the fixed-function drawing needs:
+
+	EGLContext context = eglCreateContext( dpy, config, EGL_NO_CONTEXT, NULL );
+	if( context == EGL_NO_CONTEXT )
+	{
+		fprintf( stderr, "Cannot create an EGL OpenGL context: 0x%X\n", eglGetError( ) );
+		Destroy( );
+		return false;
+	}
+	Context = context;
+
+	if( ! eglMakeCurrent( dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) )
+	{
+		// no EGL_KHR_surfaceless_context -- make current on a small pbuffer instead:
+		EGLint surfaceAttribs[ ] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		EGLSurface surface = canPbuffer ? eglCreatePbufferSurface( dpy, config, surfaceAttribs ) : EGL_NO_SURFACE;
+		if( surface == EGL_NO_SURFACE  ||  ! eglMakeCurrent( dpy, surface, surface, context ) )
+		{
+			fprintf( stderr, "Cannot make the EGL context current: 0x%X\n", eglGetError( ) );
+			if( surface != EGL_NO_SURFACE )
+				eglDestroySurface( dpy, surface );
+			Destroy( );
+			return false;
+		}
+		Surface = surface;
+	}
+
+#ifndef __APPLE__
+	// glew looks for GLX as well, which is not there, so only the entry points matter:
+	glewInit( );
+	if( ! GLEW_VERSION_3_0  &&  ! GLEW_ARB_framebuffer_object )
+	{
+		fprintf( stderr, "Cannot load the OpenGL framebuffer object functions\n" );
+		Destroy( );
+		return false;
+	}
+#endif
+
+	glGenRenderbuffers( 1, &ColorRb );
+	glBindRenderbuffer( GL_RENDERBUFFER, ColorRb );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, Width, Height );
+
+	glGenRenderbuffers( 1, &DepthRb );
+	glBindRenderbuffer( GL_RENDERBUFFER, DepthRb );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height );
+	glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+	glGenFramebuffers( 1, &Fbo );
+	glBindFramebuffer( GL_FRAMEBUFFER, Fbo );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorRb );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRb );
+
+	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	if( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		fprintf( stderr, "Offscreen framebuffer is not complete: 0x%X\n", status );
+		Destroy( );
+		return false;
+	}
+
+	Valid = true;
+	Bind( );
+
+	fprintf( stderr, "Rendering offscreen at %dx%d with %s (EGL %d.%d, OpenGL %s)\n",
+		Width, Height, (char *)glGetString( GL_RENDERER ), major, minor, (char *)glGetString( GL_VERSION ) );
+	return true;
+#endif
+}
+
+
+void
+HeadlessContext::Destroy( )
+{
+#ifdef HEADLESS
+	if( Context != NULL )
+	{
+		if( Fbo != 0 )
+			glDeleteFramebuffers( 1, &Fbo );
+		if( ColorRb != 0 )
+			glDeleteRenderbuffers( 1, &ColorRb );
+		if( DepthRb != 0 )
+			glDeleteRenderbuffers( 1, &DepthRb );
+		eglMakeCurrent( (EGLDisplay)Dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+		eglDestroyContext( (EGLDisplay)Dpy, (EGLContext)Context );
+	}
+	if( Surface != NULL )
+		eglDestroySurface( (EGLDisplay)Dpy, (EGLSurface)Surface );
+	if( Dpy != NULL )
+		eglTerminate( (EGLDisplay)Dpy );
+#endif
+	Init( );
+}
+
+
+// the framebuffer object that gets drawn into:
+
+GLuint
+HeadlessContext::GetFramebuffer( )
+{
+	return Fbo;
+}
+
+
+int
+HeadlessContext::GetHeight( )
+{
+	return Height;
+}
+
+
+int
+HeadlessContext::GetWidth( )
+{
+	return Width;
+}
+
+
+void
+HeadlessContext::Init( )
+{
+	ColorRb = DepthRb = Fbo = 0;
+	Context = Dpy = Surface = NULL;
+	Width = Height = 0;
+	Valid = false;
+}
+
+
+bool
+HeadlessContext::IsAvailable( )
+{
+#ifdef HEADLESS
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+bool
+HeadlessContext::IsValid( )
+{
+	return Valid;
+}
+
+
+// read back the framebuffer, RGB, top row first:
+
+bool
+HeadlessContext::ReadPixels( std::vector<unsigned char> &rgb )
+{
+	if( ! Valid )
+		return false;
+
+	std::vector<unsigned char> rows( 3 * Width * Height );
+	Bind( );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, &rows[0] );
+
+	// opengl's rows go bottom to top:
+	rgb.resize( rows.size( ) );
+	for( int y = 0; y < Height; y++ )
+		memcpy( &rgb[ 3 * Width * y ], &rows[ 3 * Width * ( Height - 1 - y ) ], 3 * Width );
+	return true;
+}
+
+
+// save the framebuffer as a binary ppm:
+
+bool
+HeadlessContext::WritePPM( const char *filename )
+{
+	std::vector<unsigned char> rgb;
+	if( ! ReadPixels( rgb ) )
+		return false;
+
+	FILE *fp = fopen( filename, "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open image file '%s'\n", filename );
+		return false;
+	}
+	fprintf( fp, "P6\n%d %d\n255\n", Width, Height );
+	bool ok = fwrite( &rgb[0], 1, rgb.size( ), fp ) == rgb.size( );
+	fclose( fp );
+	if( ! ok )
+		fprintf( stderr, "Cannot write image file '%s'\n", filename );
+	return ok;
+}
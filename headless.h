@@ -0,0 +1,57 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// An offscreen OpenGL context for machines with no display (and maybe no GPU).
+//
+// Built with -DHEADLESS (see "make forest_headless"), Create( ) opens an EGL
+// display -- Mesa's surfaceless platform if there is one, the default display if
+// not -- makes a compatibility-profile OpenGL context current on it with no
+// window, and gives it a framebuffer object with a color and a depth renderbuffer
+// to draw into. On a render node with no GPU, Mesa runs all of this on the CPU
+// (llvmpipe).
+// Without -DHEADLESS, IsAvailable( ) is false and Create( ) always fails.
+
+class HeadlessContext
+{
+private:
+	GLuint	ColorRb;
+	void *	Context;		// EGLContext
+	GLuint	DepthRb;
+	void *	Dpy;			// EGLDisplay
+	GLuint	Fbo;
+	int	Height;
+	void *	Surface;		// EGLSurface, if the driver could not go surfaceless
+	bool	Valid;
+	int	Width;
+
+public:
+	HeadlessContext( );
+
+	void	Bind( );
+	bool	Create( int, int );
+	void	Destroy( );
+	GLuint	GetFramebuffer( );
+	int	GetHeight( );
+	int	GetWidth( );
+	void	Init( );
+	static bool	IsAvailable( );
+	bool	IsValid( );
+	bool	ReadPixels( std::vector<unsigned char> & );
+	bool	WritePPM( const char * );
+};
+
+#endif	// HEADLESS_H
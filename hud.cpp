@@ -0,0 +1,354 @@
+#include "hud.h"
+
+
+// the font, for the characters ' ' through '_':
+// five columns per character, left to right, the low bit of each is the top row
+
+static const unsigned char HudFont[64][5] =
+{
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 },	// ' '
+	{ 0x00, 0x00, 0x5F, 0x00, 0x00 },	// !
+	{ 0x00, 0x07, 0x00, 0x07, 0x00 },	// "
+	{ 0x14, 0x7F, 0x14, 0x7F, 0x14 },	// #
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 },	// $
+	{ 0x23, 0x13, 0x08, 0x64, 0x62 },	// %
+	{ 0x36, 0x49, 0x56, 0x20, 0x50 },	// &
+	{ 0x00, 0x08, 0x07, 0x03, 0x00 },	// '
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 },	// (
+	{ 0x00, 0x41, 0x22, 0x1C, 0x00 },	// )
+	{ 0x2A, 0x1C, 0x7F, 0x1C, 0x2A },	// *
+	{ 0x08, 0x08, 0x3E, 0x08, 0x08 },	// +
+	{ 0x00, 0x80, 0x70, 0x30, 0x00 },	// ,
+	{ 0x08, 0x08, 0x08, 0x08, 0x08 },	// -
+	{ 0x00, 0x00, 0x60, 0x60, 0x00 },	// .
+	{ 0x20, 0x10, 0x08, 0x04, 0x02 },	// /
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E },	// 0
+	{ 0x00, 0x42, 0x7F, 0x40, 0x00 },	// 1
+	{ 0x72, 0x49, 0x49, 0x49, 0x46 },	// 2
+	{ 0x21, 0x41, 0x49, 0x4D, 0x33 },	// 3
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 },	// 4
+	{ 0x27, 0x45, 0x45, 0x45, 0x39 },	// 5
+	{ 0x3C, 0x4A, 0x49, 0x49, 0x31 },	// 6
+	{ 0x41, 0x21, 0x11, 0x09, 0x07 },	// 7
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 },	// 8
+	{ 0x46, 0x49, 0x49, 0x29, 0x1E },	// 9
+	{ 0x00, 0x00, 0x14, 0x00, 0x00 },	// :
+	{ 0x00, 0x40, 0x34, 0x00, 0x00 },	// ;
+	{ 0x00, 0x08, 0x14, 0x22, 0x41 },	// <
+	{ 0x14, 0x14, 0x14, 0x14, 0x14 },	// =
+	{ 0x00, 0x41, 0x22, 0x14, 0x08 },	// >
+	{ 0x02, 0x01, 0x59, 0x09, 0x06 },	// ?
+	{ 0x3E, 0x41, 0x5D, 0x59, 0x4E },	// @
+	{ 0x7C, 0x12, 0x11, 0x12, 0x7C },	// A
+	{ 0x7F, 0x49, 0x49, 0x49, 0x36 },	// B
+	{ 0x3E, 0x41, 0x41, 0x41, 0x22 },	// C
+	{ 0x7F, 0x41, 0x41, 0x41, 0x3E },	// D
+	{ 0x7F, 0x49, 0x49, 0x49, 0x41 },	// E
+	{ 0x7F, 0x09, 0x09, 0x09, 0x01 },	// F
+	{ 0x3E, 0x41, 0x41, 0x51, 0x73 },	// G
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F },	// H
+	{ 0x00, 0x41, 0x7F, 0x41, 0x00 },	// I
+	{ 0x20, 0x40, 0x41, 0x3F, 0x01 },	// J
+	{ 0x7F, 0x08, 0x14, 0x22, 0x41 },	// K
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 },	// L
+	{ 0x7F, 0x02, 0x1C, 0x02, 0x7F },	// M
+	{ 0x7F, 0x04, 0x08, 0x10, 0x7F },	// N
+	{ 0x3E, 0x41, 0x41, 0x41, 0x3E },	// O
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 },	// P
+	{ 0x3E, 0x41, 0x51, 0x21, 0x5E },	// Q
+	{ 0x7F, 0x09, 0x19, 0x29, 0x46 },	// R
+	{ 0x26, 0x49, 0x49, 0x49, 0x32 },	// S
+	{ 0x03, 0x01, 0x7F, 0x01, 0x03 },	// T
+	{ 0x3F, 0x40, 0x40, 0x40, 0x3F },	// U
+	{ 0x1F, 0x20, 0x40, 0x20, 0x1F },	// V
+	{ 0x3F, 0x40, 0x38, 0x40, 0x3F },	// W
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 },	// X
+	{ 0x03, 0x04, 0x78, 0x04, 0x03 },	// Y
+	{ 0x61, 0x59, 0x49, 0x4D, 0x43 },	// Z
+	{ 0x00, 0x7F, 0x41, 0x41, 0x41 },	// [
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 },	// '\'
+	{ 0x00, 0x41, 0x41, 0x41, 0x7F },	// ]
+	{ 0x04, 0x02, 0x01, 0x02, 0x04 },	// ^
+	{ 0x40, 0x40, 0x40, 0x40, 0x40 },	// _
+};
+
+// the font texture is one row of 6x8 cells -- the 64 characters, then a solid one:
+#define HUD_SOLID_CELL		64
+#define HUD_ATLAS_WIDTH		512
+#define HUD_ATLAS_HEIGHT	8
+
+
+Hud::Hud( )
+{
+	Init( );
+}
+
+
+// make the font texture and the vertex buffer (call this once there is a context):
+
+bool
+Hud::Create( )
+{
+	if( Valid )
+		return true;
+
+	std::vector<unsigned char> atlas( HUD_ATLAS_WIDTH * HUD_ATLAS_HEIGHT, 0 );
+	for( int c = 0; c < 64; c++ )
+	{
+		for( int col = 0; col < 5; col++ )
+		{
+			for( int row = 0; row < 7; row++ )
+			{
+				if( HudFont[c][col] & ( 1 << row ) )
+					atlas[ row * HUD_ATLAS_WIDTH + 6*c + col ] = 255;
+			}
+		}
+	}
+	for( int row = 0; row < HUD_ATLAS_HEIGHT; row++ )
+		for( int col = 0; col < 6; col++ )
+			atlas[ row * HUD_ATLAS_WIDTH + 6*HUD_SOLID_CELL + col ] = 255;
+
+	glGenTextures( 1, &FontTexture );
+	glBindTexture( GL_TEXTURE_2D, FontTexture );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_ALPHA8, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE, &atlas[0] );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	glGenBuffers( 1, &Vbo );
+
+
+	Valid = true;
+	return true;
+}
+
+
+// draw everything in the batch, on top of whatever is there, then empty the batch
+// (the fixed-function pipeline must be in use; all the state this changes is put back):
+
+void
+Hud::Draw( int width, int height )
+{
+	if( ! Valid  ||  Batch.empty( ) )
+	{
+		Batch.clear( );
+		return;
+	}
+
+	glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_DEPTH_BUFFER_BIT |
+		GL_LIGHTING_BIT | GL_TEXTURE_BIT | GL_TRANSFORM_BIT | GL_VIEWPORT_BIT );
+	glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT );
+
+	glViewport( 0, 0, width, height );
+	glMatrixMode( GL_PROJECTION );
+	glPushMatrix( );
+	glLoadIdentity( );
+	glOrtho( 0., (double)width, (double)height, 0., -1., 1. );
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix( );
+	glLoadIdentity( );
+
+	glDisable( GL_DEPTH_TEST );
+	glDisable( GL_LIGHTING );
+	glDisable( GL_FOG );
+	glDisable( GL_CULL_FACE );
+	glDisable( GL_ALPHA_TEST );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+	glActiveTexture( GL_TEXTURE0 );
+	glClientActiveTexture( GL_TEXTURE0 );
+	glDisable( GL_TEXTURE_GEN_S );
+	glDisable( GL_TEXTURE_GEN_T );
+	glEnable( GL_TEXTURE_2D );
+	glBindTexture( GL_TEXTURE_2D, FontTexture );
+	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+
+	// orphan last frame's storage, so this never waits for the gpu to be done with it:
+
+	int bytes = (int)( Batch.size( ) * sizeof( struct HudVertex ) );
+	if( bytes > VboBytes )
+		VboBytes = bytes;
+	glBindBuffer( GL_ARRAY_BUFFER, Vbo );
+	glBufferData( GL_ARRAY_BUFFER, VboBytes, NULL, GL_STREAM_DRAW );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, bytes, &Batch[0] );
+
+	GLsizei stride = sizeof( struct HudVertex );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, stride, (void *)offsetof( struct HudVertex, x ) );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glTexCoordPointer( 2, GL_FLOAT, stride, (void *)offsetof( struct HudVertex, s ) );
+	glEnableClientState( GL_COLOR_ARRAY );
+	glColorPointer( 4, GL_UNSIGNED_BYTE, stride, (void *)offsetof( struct HudVertex, rgba ) );
+	glDisableClientState( GL_NORMAL_ARRAY );
+
+	glDrawArrays( GL_QUADS, 0, (GLsizei)Batch.size( ) );
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	glMatrixMode( GL_PROJECTION );
+	glPopMatrix( );
+	glMatrixMode( GL_MODELVIEW );
+	glPopMatrix( );
+
+	glPopClientAttrib( );
+	glPopAttrib( );
+
+	Batch.clear( );
+}
+
+
+// add the time since the last call to the graph:
+
+void
+Hud::FrameDone( )
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	if( HaveLastFrame )
+	{
+		float ms = (float)( std::chrono::duration<double, std::milli>( now - LastFrame ).count( ) );
+		if( (int)FrameTimes.size( ) < HUD_GRAPH_SAMPLES )
+			FrameTimes.push_back( ms );
+		else
+			FrameTimes[NextFrameTime] = ms;
+		NextFrameTime = ( NextFrameTime + 1 ) % HUD_GRAPH_SAMPLES;
+	}
+	LastFrame = now;
+	HaveLastFrame = true;
+}
+
+
+// the mean of the frame times in the graph, in milliseconds (0. if there are none yet):
+
+float
+Hud::GetAverageFrameTime( )
+{
+	if( FrameTimes.empty( ) )
+		return 0.f;
+
+	double sum = 0.;
+	for( int i = 0; i < (int)FrameTimes.size( ); i++ )
+		sum += FrameTimes[i];
+	return (float)( sum / (double)FrameTimes.size( ) );
+}
+
+
+// the frame times as bars in a w x h box, maxMs at the top -- green up to 60 fps,
+// yellow up to 30, red below that, with lines across at 16.7 and 33.3 ms:
+
+void
+Hud::Graph( float x, float y, float w, float h, float maxMs )
+{
+	static const float background[4] = { 0.f,  0.f,  0.f,  0.5f };
+	static const float guide[4]      = { 1.f,  1.f,  1.f,  0.35f };
+	static const float fast[4]       = { 0.3f, 1.f,  0.3f, 0.9f };
+	static const float slow[4]       = { 1.f,  0.9f, 0.2f, 0.9f };
+	static const float slower[4]     = { 1.f,  0.3f, 0.2f, 0.9f };
+
+	Rect( x, y, x + w, y + h, background );
+
+	float barWidth = w / (float)HUD_GRAPH_SAMPLES;
+	int n = (int)FrameTimes.size( );
+	int oldest = n < HUD_GRAPH_SAMPLES ? 0 : NextFrameTime;
+	for( int i = 0; i < n; i++ )
+	{
+		float ms = FrameTimes[ ( oldest + i ) % n ];
+		float fraction = ms < maxMs ? ms / maxMs : 1.f;
+		const float *color = ms <= 1000.f/59.f ? fast : ( ms <= 1000.f/29.f ? slow : slower );
+		float x0 = x + barWidth * (float)( HUD_GRAPH_SAMPLES - n + i );
+		Rect( x0, y + h * ( 1.f - fraction ), x0 + barWidth, y + h, color );
+	}
+
+	float lines[2] = { 1000.f/60.f, 1000.f/30.f };
+	for( int k = 0; k < 2; k++ )
+	{
+		if( lines[k] >= maxMs )
+			continue;
+		float yl = y + h * ( 1.f - lines[k] / maxMs );
+		Rect( x, yl, x + w, yl + 1.f, guide );
+	}
+}
+
+
+void
+Hud::Init( )
+{
+	Batch.clear( );
+	FontTexture = 0;
+	FrameTimes.clear( );
+	HaveLastFrame = false;
+	NextFrameTime = 0;
+	Valid = false;
+	Vbo = 0;
+	VboBytes = 0;
+}
+
+
+bool
+Hud::IsValid( )
+{
+	return Valid;
+}
+
+
+// one quad -- screen corners, then font atlas corners:
+
+void
+Hud::Quad( float x0, float y0, float x1, float y1, float s0, float t0, float s1, float t1, const float color[4] )
+{
+	struct HudVertex v;
+	for( int k = 0; k < 4; k++ )
+	{
+		float c = color[k] < 0.f ? 0.f : ( color[k] > 1.f ? 1.f : color[k] );
+		v.rgba[k] = (unsigned char)( 255.f * c + 0.5f );
+	}
+
+	v.x = x0;	v.y = y0;	v.s = s0;	v.t = t0;	Batch.push_back( v );
+	v.x = x0;	v.y = y1;	v.s = s0;	v.t = t1;	Batch.push_back( v );
+	v.x = x1;	v.y = y1;	v.s = s1;	v.t = t1;	Batch.push_back( v );
+	v.x = x1;	v.y = y0;	v.s = s1;	v.t = t0;	Batch.push_back( v );
+}
+
+
+// a solid rectangle, from (x0,y0) to (x1,y1):
+
+void
+Hud::Rect( float x0, float y0, float x1, float y1, const float color[4] )
+{
+	// the middle of the solid cell, so nearest filtering can only ever find solid texels:
+	float s = ( 6.f * HUD_SOLID_CELL + 3.f ) / (float)HUD_ATLAS_WIDTH;
+	float t = 0.5f;
+	Quad( x0, y0, x1, y1, s, t, s, t, color );
+}
+
+
+// printf-style text with its top-left corner at (x,y) -- returns the x where the text ends:
+
+float
+Hud::Text( float x, float y, const float color[4], const char *format, ... )
+{
+	char text[256];
+	va_list args;
+	va_start( args, format );
+	vsnprintf( text, sizeof( text ), format, args );
+	va_end( args );
+
+	for( const char *cp = text; *cp != '\0'; cp++ )
+	{
+		int c = toupper( (unsigned char)*cp );
+		if( c < ' '  ||  c > '_' )
+			c = '?';
+		if( c != ' ' )
+		{
+			float s0 = (float)( 6 * ( c - ' ' ) ) / (float)HUD_ATLAS_WIDTH;
+			float s1 = (float)( 6 * ( c - ' ' + 1 ) ) / (float)HUD_ATLAS_WIDTH;
+			Quad( x, y, x + HUD_CHAR_WIDTH, y + HUD_CHAR_HEIGHT, s0, 0.f, s1, 1.f, color );
+		}
+		x += HUD_CHAR_WIDTH;
+	}
+	return x;
+}
@@ -0,0 +1,85 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+void	CheckGlErrors( const char* );
+
+
+// how many frame times the graph shows:
+#define HUD_GRAPH_SAMPLES	120
+
+// each font pixel is this many screen pixels:
+#define HUD_SCALE		2
+
+// the font is 5x7, in 6x8 cells:
+#define HUD_CHAR_WIDTH		( 6 * HUD_SCALE )
+#define HUD_CHAR_HEIGHT		( 8 * HUD_SCALE )
+
+
+// one corner of a quad -- screen position, font atlas position, and color:
+struct HudVertex
+{
+	float		x, y;
+	float		s, t;
+	unsigned char	rgba[4];
+};
+
+
+// An on-screen performance display.
+//
+// Text( ), Rect( ) and Graph( ) add quads to a batch, in pixels from the top-left
+// corner of the window; Draw( ) sends the whole batch to one streamed vertex buffer
+// and draws it with one glDrawArrays( ), instead of one glutBitmapCharacter( ) per
+// character. The characters come from a small built-in 5x7 font (upper case, digits
+// and some punctuation -- lower case is drawn as upper case), kept in an alpha
+// texture along with one solid cell for the rectangles.
+//
+// It also keeps the last HUD_GRAPH_SAMPLES frame times (FrameDone( )).
+
+class Hud
+{
+private:
+	std::vector<struct HudVertex>	Batch;
+	GLuint	FontTexture;
+	std::vector<float>	FrameTimes;		// milliseconds, a ring
+	bool	HaveLastFrame;
+	std::chrono::steady_clock::time_point	LastFrame;
+	int	NextFrameTime;
+	bool	Valid;
+	GLuint	Vbo;
+	int	VboBytes;
+
+	void	Quad( float, float, float, float, float, float, float, float, const float [4] );
+
+public:
+	Hud( );
+
+	bool	Create( );
+	void	Draw( int, int );
+	void	FrameDone( );
+	float	GetAverageFrameTime( );
+	void	Graph( float, float, float, float, float );
+	void	Init( );
+	bool	IsValid( );
+	void	Rect( float, float, float, float, const float [4] );
+	float	Text( float, float, const float [4], const char *, ... );
+};
+
+#endif	// HUD_H
@@ -1,71 +1,156 @@
 #include "keytime.h" 
+#include <algorithm>
+
 Keytimes::Keytimes( )
 {
 	Init( );
 }
 
-Keytimes::~Keytimes( )
+void
+Keytimes::AddTimeValue( float _time, float _value )
 {
-	for( std::vector<struct TimeValue *>::iterator tvi = tvs.begin( );  tvi < tvs.end( ); tvi++ )
+	// find where _time goes -- the first key that is not before it:
+
+	int lo = 0;
+	int hi = (int)tvs.size( );
+	while( lo < hi )
 	{
-		delete (*tvi);
+		int mid = ( lo + hi ) / 2;
+		if( tvs[mid].time < _time )
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-}
+	int k = lo;
 
-void
-Keytimes::AddTimeValue( float _time, float _value )
-{
 	// if _time matches a previous time, just replace the value:
 
-	for( std::vector<struct TimeValue *>::iterator tvi = tvs.begin( );  tvi < tvs.end( ); tvi++ )
+	if( k < (int)tvs.size( )  &&  tvs[k].time == _time )
 	{
-		if( _time == (*tvi)->time )
-		{
-			(*tvi)->value = _value;
-			return;
-		}
+		tvs[k].value = _value;
+		ComputeSegments( k-2, k+1 );
+		return;
 	}
 
-	// create the new struct to hold the time-value pair:
+	// otherwise, insert the new time-value pair there:
 
-	struct TimeValue * tv = new struct TimeValue;
-	tv->time  = _time;
-	tv->value = _value;
+	struct TimeValue tv = { _time, _value };
+	tvs.insert( tvs.begin( ) + k, tv );
 
-	// if the list is empty, just do a push_back():
+	// there is one more segment now -- the new key changes the curve of the two segments
+	// on either side of it (their end slopes reach one key further):
 
-	if( tvs.empty( ) )
+	if( tvs.size( ) >= 2 )
 	{
-		tvs.push_back( tv );
-		return;
+		int s = k < (int)segs.size( ) ? k : (int)segs.size( );
+		segs.insert( segs.begin( ) + s, KeySegment( ) );
 	}
+	ComputeSegments( k-2, k+1 );
+	cursor = 0;
+}
+
 
-	// otherwise, insert the new time-value pair right before the next biggest time:
+// replace all of the keys with count time-value pairs, in any order:
+// they get sorted once (if a time is there more than once, the last one wins, as with AddTimeValue( ))
 
-	for( std::vector<struct TimeValue *>::iterator tvi = tvs.begin( );  tvi < tvs.end( ); tvi++ )
+void
+Keytimes::Build( const struct TimeValue *pairs, int count )
+{
+	tvs.assign( pairs, pairs + count );
+	SortKeys( );
+}
+
+
+// work out the cubics of segments first through last:
+// (each uses the keys on either side of it for its end slopes)
+
+void
+Keytimes::ComputeSegments( int first, int last )
+{
+	if( first < 0 )
+		first = 0;
+	if( last > (int)segs.size( ) - 1 )
+		last = (int)segs.size( ) - 1;
+
+	for( int i0 = first; i0 <= last; i0++ )
 	{
-		if( _time < (*tvi)->time )
-		{
-			tvs.insert( tvi, tv );
-			return;
-		}
+		int i1 = i0 + 1;
+		float t0 = tvs[i0].time;
+		float t1 = tvs[i1].time;
+		float v0 = tvs[i0].value;
+		float v1 = tvs[i1].value;
+
+		// get beginning and ending slopes:
+
+		float dvaluedtime0;
+		float dvaluedtime1;
+
+		if( i0 == 0 )
+			dvaluedtime0 = 0.;
+		else
+			dvaluedtime0 = ( v1 - tvs[i0-1].value ) / ( t1 - tvs[i0-1].time );
+
+		if( i1 == (int)tvs.size( ) - 1 )
+			dvaluedtime1 = 0.;
+		else
+			dvaluedtime1 = ( tvs[i1+1].value - v0 ) / ( tvs[i1+1].time - t0 );
+
+		float dtimedt     = ( t1 - t0 ) / ( 1.f - 0.f );
+		float dvaluedt0 = dvaluedtime0 * dtimedt;
+		float dvaluedt1 = dvaluedtime1 * dtimedt;
+
+		// get curve coefficients:
+
+		struct KeySegment &seg = segs[i0];
+		seg.t0 = t0;
+		seg.t1 = t1;
+		seg.oneOverDt = 1.f / ( t1 - t0 );
+		seg.a = 2.f*v0 - 2.f*v1 + dvaluedt0 + dvaluedt1;
+		seg.b = -3.f*v0 + 3.f*v1 -2.f*dvaluedt0 - dvaluedt1;
+		seg.c = dvaluedt0;
+		seg.d = v0;
 	}
+}
+
+
+// find which segment _time is in:
+// playing forward, that is almost always the segment it was in last time, or the next one,
+// otherwise it is a binary search
+
+int
+Keytimes::FindSegment( float _time )
+{
+	int n = (int)segs.size( );
+	if( cursor < n  &&  segs[cursor].t0 <= _time  &&  _time <= segs[cursor].t1 )
+		return cursor;
 
-	// if it's not < any times in the vector, put it at the back:
+	if( cursor+1 < n  &&  segs[cursor+1].t0 <= _time  &&  _time <= segs[cursor+1].t1 )
+		return ++cursor;
 
-	tvs.push_back( tv );
+	int lo = 0;
+	int hi = n - 1;
+	while( lo < hi )
+	{
+		int mid = ( lo + hi + 1 ) / 2;
+		if( segs[mid].t0 <= _time )
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	cursor = lo;
+	return lo;
 }
 
 float
 Keytimes::GetFirstTime( )
 {
-	 return tvs.front( )->time;
+	 return tvs.front( ).time;
 }
 
 float
 Keytimes::GetLastTime( )
 {
-	 return tvs.back( )->time;
+	 return tvs.back( ).time;
 }
 
 int
@@ -84,85 +169,129 @@ Keytimes::GetValue( float _time )
 
 	// if _time is outside the existing range, clamp to the existing range:
 
-	if( _time <= tvs.front( )->time )
-		return tvs.front( )->value;
+	if( _time <= tvs.front( ).time )
+		return tvs.front( ).value;
 
-	if( _time >= tvs.back( )->time )
-		return tvs.back( )->value;
+	if( _time >= tvs.back( ).time )
+		return tvs.back( ).value;
 
-	// find which pair of key-times we are between:
-	// (this is guaranteed to succeed)
+	// evaluate the curve of the segment we are in:
 
-	int i0, i1;
-	float t0, t1;
-	float v0, v1;
-	for( int i = 0; i < (int) tvs.size()-1; i++ )
-	{
-		if( tvs[i]->time <= _time  &&  _time <= tvs[i+1]->time )
-		{
-			i0 = i+0;
-			i1 = i+1;
-			t0 = tvs[i+0]->time;
-			t1 = tvs[i+1]->time;
-			v0 = tvs[i+0]->value;
-			v1 = tvs[i+1]->value;
-			break;
-		}
-	}
+	const struct KeySegment &seg = segs[ FindSegment( _time ) ];
+	float ttt = ( _time - seg.t0 ) * seg.oneOverDt;	// 0. <= ttt <= 1.
 
-	// fprintf( stderr, "_time = %8.3f: i0 = %3d, i1 = %3d, t0 = %8.2f, t1 = %8.3f\n", _time, i0, i1, t0, t1 );
+	float value = seg.d + ttt * ( seg.c + ttt * ( seg.b + ttt*seg.a ) );
+	return value;
+}
 
-	// get beginning and ending slopes:
 
-	float dvaluedtime0;
-	float dvaluedtime1;
+void
+Keytimes::Init( )
+{
+	tvs.clear( );
+	segs.clear( );
+	cursor = 0;
+}
 
-	if( i0 == 0 )
-		dvaluedtime0 = 0.;
-	else
-		dvaluedtime0 = ( v1 - tvs[i0-1]->value ) / ( t1 - tvs[i0-1]->time );
 
-	if( i1 == (int)tvs.size( ) - 1 )
-		dvaluedtime1 = 0.;
-	else
-		dvaluedtime1 = ( tvs[i1+1]->value - v0 ) / ( tvs[i1+1]->time - t0 );
+// read keys written by Save( ) -- the pairs come in with one read:
 
-	float dtimedt     = ( t1 - t0 ) / ( 1.f - 0.f );
-	float dvaluedt0 = dvaluedtime0 * dtimedt;
-	float dvaluedt1 = dvaluedtime1 * dtimedt;
+bool
+Keytimes::Load( const char *filename )
+{
+	FILE *fp = fopen( filename, "rb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open keytime file '%s'\n", filename );
+		return false;
+	}
 
-	// get curve coefficients:
+	char magic[4];
+	int count = 0;
+	if( fread( magic, 1, 4, fp ) != 4  ||  memcmp( magic, KEYTIME_FILE_MAGIC, 4 ) != 0
+	 ||  fread( &count, sizeof(int), 1, fp ) != 1  ||  count < 0 )
+	{
+		fprintf( stderr, "'%s' is not a keytime file\n", filename );
+		fclose( fp );
+		return false;
+	}
 
-	float a = 2.f*v0 - 2.f*v1 + dvaluedt0 + dvaluedt1;
-	float b = -3.f*v0 + 3.f*v1 -2.f*dvaluedt0 - dvaluedt1;
-	float c = dvaluedt0;
-	float d = v0;
+	std::vector<struct TimeValue> pairs( count );
+	if( count > 0  &&  fread( &pairs[0], sizeof(struct TimeValue), count, fp ) != (size_t)count )
+	{
+		fprintf( stderr, "Keytime file '%s' is cut short\n", filename );
+		fclose( fp );
+		return false;
+	}
+	fclose( fp );
 
-	// evaluate the curve:
+	tvs.swap( pairs );
+	SortKeys( );
+	return true;
+}
 
-	float ttt = ( _time - t0 ) / ( t1 - t0 );	// 0. <= ttt <= 1.
-	// fprintf( stderr, "ttt = %8.3f\n", ttt );
 
-	float value = d + ttt * ( c + ttt * ( b + ttt*a ) );
-	return value;
+void
+Keytimes::PrintTimeValues( )
+{
+	for( std::vector<struct TimeValue>::iterator tvi = tvs.begin( );  tvi < tvs.end( ); tvi++ )
+	{
+		fprintf( stderr, "(%6.2f,%8.3f)   ", tvi->time, tvi->value );
+	}
+	fprintf( stderr, "\n" );
 }
 
 
-void
-Keytimes::Init( )
+// write the keys in binary: "KEYT", the number of keys, then the time-value pairs
+// (in this machine's byte order)
+
+bool
+Keytimes::Save( const char *filename )
 {
-	tvs.clear( );
+	FILE *fp = fopen( filename, "wb" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot create keytime file '%s'\n", filename );
+		return false;
+	}
+
+	int count = (int)tvs.size( );
+	bool ok = fwrite( KEYTIME_FILE_MAGIC, 1, 4, fp ) == 4
+	       &&  fwrite( &count, sizeof(int), 1, fp ) == 1
+	       &&  ( count == 0  ||  fwrite( &tvs[0], sizeof(struct TimeValue), count, fp ) == (size_t)count );
+	fclose( fp );
+	if( ! ok )
+		fprintf( stderr, "Could not write keytime file '%s'\n", filename );
+	return ok;
 }
 
 
+// sort the keys by time, keep only the last of any with the same time, and work out every segment:
+
+static bool
+EarlierTime( const struct TimeValue &a, const struct TimeValue &b )
+{
+	return a.time < b.time;
+}
+
 void
-Keytimes::PrintTimeValues( )
+Keytimes::SortKeys( )
 {
-	for( std::vector<struct TimeValue *>::iterator tvi = tvs.begin( );  tvi < tvs.end( ); tvi++ )
+	std::stable_sort( tvs.begin( ), tvs.end( ), EarlierTime );
+
+	int n = 0;
+	for( int i = 0; i < (int)tvs.size( ); i++ )
 	{
-		fprintf( stderr, "(%6.2f,%8.3f)   ", (*tvi)->time, (*tvi)->value );
+		if( n > 0  &&  tvs[n-1].time == tvs[i].time )
+			tvs[n-1] = tvs[i];
+		else
+			tvs[n++] = tvs[i];
 	}
-	fprintf( stderr, "\n" );
+	tvs.resize( n );
+
+	segs.resize( n >= 2 ? n-1 : 0 );
+	ComputeSegments( 0, (int)segs.size( ) - 1 );
+	cursor = 0;
 }
 
 //#define TEST
@@ -196,6 +325,138 @@ main( int argc, char *argv[ ] )
 	}
 }
 #endif
+// micro-benchmark: 10 tracks of 10,000 keys each, played forward like Display( ) does,
+// then looked up at random times, against the old linear scan that redid the cubic every call
+// g++ -DBENCHMARK -O2 -std=c++11 keytime.cpp -o keytimebench
+
+//#define BENCHMARK
+#ifdef BENCHMARK
+#include <stdlib.h>
+#include <chrono>
+
+#define NUMTRACKS	10
+#define NUMKEYS		10000
+#define NUMFRAMES	100000
+
+	Keytimes tracks[NUMTRACKS];
+	std::vector<struct TimeValue> keys[NUMTRACKS];
+
+float
+LinearGetValue( const std::vector<struct TimeValue> &k, float _time )
+{
+	if( _time <= k.front( ).time )
+		return k.front( ).value;
+	if( _time >= k.back( ).time )
+		return k.back( ).value;
+
+	int i0 = 0;
+	for( int i = 0; i < (int)k.size( )-1; i++ )
+	{
+		if( k[i].time <= _time  &&  _time <= k[i+1].time )
+		{
+			i0 = i;
+			break;
+		}
+	}
+	int i1 = i0 + 1;
+	float t0 = k[i0].time,  t1 = k[i1].time;
+	float v0 = k[i0].value, v1 = k[i1].value;
+	float dvaluedtime0 = i0 == 0                 ? 0.f : ( v1 - k[i0-1].value ) / ( t1 - k[i0-1].time );
+	float dvaluedtime1 = i1 == (int)k.size( ) - 1 ? 0.f : ( k[i1+1].value - v0 ) / ( k[i1+1].time - t0 );
+	float dvaluedt0 = dvaluedtime0 * ( t1 - t0 );
+	float dvaluedt1 = dvaluedtime1 * ( t1 - t0 );
+	float a = 2.f*v0 - 2.f*v1 + dvaluedt0 + dvaluedt1;
+	float b = -3.f*v0 + 3.f*v1 -2.f*dvaluedt0 - dvaluedt1;
+	float ttt = ( _time - t0 ) / ( t1 - t0 );
+	return v0 + ttt * ( dvaluedt0 + ttt * ( b + ttt*a ) );
+}
+
+double
+NanosecondsSince( std::chrono::steady_clock::time_point start, int calls )
+{
+	std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now( ) - start;
+	return ns.count( ) / (double)calls;
+}
+
+int
+main( int argc, char *argv[ ] )
+{
+	srand( 12345 );
+	const float lastTime = 40.f;
+	for( int t = 0; t < NUMTRACKS; t++ )
+	{
+		for( int i = 0; i < NUMKEYS; i++ )
+		{
+			struct TimeValue tv = { lastTime * (float)i / (float)(NUMKEYS-1),  (float)rand( ) / (float)RAND_MAX };
+			keys[t].push_back( tv );
+		}
+
+	}
+
+	// add one track's keys out of order, so the insertion gets exercised too,
+	// and bulk build the rest:
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+	for( int i = 0; i < NUMKEYS; i += 2 )
+		tracks[0].AddTimeValue( keys[0][i].time, keys[0][i].value );
+	for( int i = 1; i < NUMKEYS; i += 2 )
+		tracks[0].AddTimeValue( keys[0][i].time, keys[0][i].value );
+	fprintf( stderr, "AddTimeValue( ):  %8.2f ns per key\n", NanosecondsSince( start, NUMKEYS ) );
+
+	start = std::chrono::steady_clock::now( );
+	for( int t = 1; t < NUMTRACKS; t++ )
+		tracks[t].Build( &keys[t][0], NUMKEYS );
+	fprintf( stderr, "Build( ):         %8.2f ns per key\n", NanosecondsSince( start, (NUMTRACKS-1)*NUMKEYS ) );
+
+	// round trip one track through a file:
+	start = std::chrono::steady_clock::now( );
+	if( ! tracks[1].Save( "keytimebench.keys" )  ||  ! tracks[1].Load( "keytimebench.keys" ) )
+		return 1;
+	fprintf( stderr, "Save( ) + Load( ): %7.2f ns per key\n", NanosecondsSince( start, NUMKEYS ) );
+	remove( "keytimebench.keys" );
+
+	// check against the linear scan:
+	float maxError = 0.;
+	for( int i = 0; i < 10000; i++ )
+	{
+		float time = lastTime * (float)rand( ) / (float)RAND_MAX;
+		for( int t = 0; t < NUMTRACKS; t++ )
+			maxError = fmaxf( maxError, fabsf( tracks[t].GetValue( time ) - LinearGetValue( keys[t], time ) ) );
+	}
+	fprintf( stderr, "%d tracks of %d keys, largest difference from the linear scan = %g\n", NUMTRACKS, NUMKEYS, maxError );
+
+	std::vector<float> randomTimes( NUMFRAMES );
+	for( int f = 0; f < NUMFRAMES; f++ )
+		randomTimes[f] = lastTime * (float)rand( ) / (float)RAND_MAX;
+
+	volatile float sink = 0.;
+	start = std::chrono::steady_clock::now( );
+	for( int f = 0; f < NUMFRAMES; f++ )
+	{
+		float time = lastTime * (float)f / (float)NUMFRAMES;
+		for( int t = 0; t < NUMTRACKS; t++ )
+			sink = sink + tracks[t].GetValue( time );
+	}
+	fprintf( stderr, "Playing forward:  %8.2f ns per GetValue( )\n", NanosecondsSince( start, NUMFRAMES*NUMTRACKS ) );
+
+	start = std::chrono::steady_clock::now( );
+	for( int f = 0; f < NUMFRAMES; f++ )
+	{
+		for( int t = 0; t < NUMTRACKS; t++ )
+			sink = sink + tracks[t].GetValue( randomTimes[f] );
+	}
+	fprintf( stderr, "Random times:     %8.2f ns per GetValue( )\n", NanosecondsSince( start, NUMFRAMES*NUMTRACKS ) );
+
+	int linearFrames = NUMFRAMES / 100;		// it is too slow for all of them
+	start = std::chrono::steady_clock::now( );
+	for( int f = 0; f < linearFrames; f++ )
+	{
+		for( int t = 0; t < NUMTRACKS; t++ )
+			sink = sink + LinearGetValue( keys[t], randomTimes[f] );
+	}
+	fprintf( stderr, "Linear scan:      %8.2f ns per lookup\n", NanosecondsSince( start, linearFrames*NUMTRACKS ) );
+	return 0;
+}
+#endif
 #ifdef EXPECTED_RESULTS
 (  0.00,   0.000)   
 (  0.00,   0.000)   (  2.00,   0.333)   
@@ -3,8 +3,13 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 #include <vector>
 
+
+// first 4 bytes of a file written by Keytimes::Save( ):
+#define KEYTIME_FILE_MAGIC	"KEYT"
+
 struct TimeValue
 {
 	float time;
@@ -12,21 +17,42 @@ struct TimeValue
 };
 
 
+// the cubic between two neighboring keys, worked out when the keys are added:
+// value = d + u*( c + u*( b + u*a ) ),  where u = ( time - t0 ) * oneOverDt
+
+struct KeySegment
+{
+	float t0, t1;
+	float oneOverDt;
+	float a, b, c, d;
+};
+
+
 class Keytimes
 {
+	friend class KeytimeBatch;
+
 private:
-	std::vector<struct TimeValue *> tvs;
+	std::vector<struct TimeValue> tvs;	// sorted by time
+	std::vector<struct KeySegment> segs;	// segs[i] runs from tvs[i] to tvs[i+1]
+	int cursor;				// the segment the last GetValue( ) was in
+
+	void	ComputeSegments( int, int );
+	int	FindSegment( float );
+	void	SortKeys( );
 
 public:
 	Keytimes( );
-	~Keytimes( );
 	void	AddTimeValue( float, float );
+	void	Build( const struct TimeValue *, int );
 	float	GetFirstTime( );
 	float	GetLastTime( );
 	int	GetNumKeytimes( );
 	float	GetValue( float );
 	void	Init( );
+	bool	Load( const char * );
 	void	PrintTimeValues( );
+	bool	Save( const char * );
 };
 
 #endif	// KEYTIME_H
@@ -0,0 +1,395 @@
+#include "keytimebatch.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)  ||  defined(_M_X64)
+#include <emmintrin.h>
+#define KEYTIMEBATCH_SSE2
+#endif
+
+
+KeytimeBatch::KeytimeBatch( )
+{
+	Generation = 0;
+	JobPerThread = JobThreads = 0;
+	JobTime = 0.f;
+	JobValues = NULL;
+	NumThreads = 1;
+	Quit = false;
+	Remaining = 0;
+	Init( );
+}
+
+
+KeytimeBatch::~KeytimeBatch( )
+{
+	StopWorkers( );
+}
+
+
+void
+KeytimeBatch::AddSegment( float t0, float t1, float oneOverDt, float a, float b, float c, float d )
+{
+	float seg[KEYTIMEBATCH_SEG_FLOATS] = { t0, t1, oneOverDt, a, b, c, d, 0.f };
+	Segs.insert( Segs.end( ), seg, seg + KEYTIMEBATCH_SEG_FLOATS );
+}
+
+
+// copy a track's segments into the batch:
+// returns where its value goes in the array Evaluate( ) fills
+
+int
+KeytimeBatch::AddTrack( const Keytimes &track )
+{
+	First.push_back( (int)Segs.size( ) / KEYTIMEBATCH_SEG_FLOATS );
+
+	if( track.segs.empty( ) )
+	{
+		// no keys, or just one -- a flat segment at that value
+		// (with 1/dt = 0, it always evaluates at its start):
+
+		float t = track.tvs.empty( ) ? 0.f : track.tvs[0].time;
+		float v = track.tvs.empty( ) ? 0.f : track.tvs[0].value;
+		AddSegment( t, t, 0.f, 0.f, 0.f, 0.f, v );
+	}
+	else
+	{
+		for( int s = 0; s < (int)track.segs.size( ); s++ )
+		{
+			const struct KeySegment &seg = track.segs[s];
+			AddSegment( seg.t0, seg.t1, seg.oneOverDt, seg.a, seg.b, seg.c, seg.d );
+		}
+	}
+
+	Last.push_back( (int)Segs.size( ) / KEYTIMEBATCH_SEG_FLOATS - 1 );
+	Cursor.push_back( First.back( ) );
+	return (int)First.size( ) - 1;
+}
+
+
+// fill values[0..GetNumTracks( )-1] with every track's value at time
+// (outside a track's keys, its value is clamped to its first or last key, as with Keytimes::GetValue( ))
+
+void
+KeytimeBatch::Evaluate( float time, float *values )
+{
+	int numTracks = GetNumTracks( );
+	int numThreads = NumThreads;
+	if( numThreads > numTracks / KEYTIMEBATCH_MIN_PER_THREAD )
+		numThreads = numTracks / KEYTIMEBATCH_MIN_PER_THREAD;
+
+	if( numThreads <= 1 )
+	{
+		EvaluateRange( time, values, 0, numTracks );
+		return;
+	}
+
+	// each thread gets its own range of tracks (a multiple of 8 long, so the vector loops line up),
+	// and this one does the first range while the workers do the rest:
+
+	int perThread = ( ( numTracks + numThreads - 1 ) / numThreads + 7 ) & ~7;
+	numThreads = ( numTracks + perThread - 1 ) / perThread;
+	{
+		std::lock_guard<std::mutex> lock( Lock );
+		JobPerThread = perThread;
+		JobThreads = numThreads;
+		JobTime = time;
+		JobValues = values;
+		Remaining = numThreads - 1;
+		Generation++;
+	}
+	Wake.notify_all( );
+
+	EvaluateRange( time, values, 0, perThread );
+
+	std::unique_lock<std::mutex> lock( Lock );
+	Done.wait( lock, [this] { return Remaining == 0; } );
+}
+
+
+// tracks [first,last):
+
+void
+KeytimeBatch::EvaluateRange( float time, float *values, int first, int last )
+{
+	FindSegments( time, first, last );
+
+	const float *segs = &Segs[0];
+	int i = first;
+	if( Vectorized )
+	{
+#if defined(__AVX2__)
+		__m256 t    = _mm256_set1_ps( time );
+		__m256 zero = _mm256_setzero_ps( );
+		__m256 one  = _mm256_set1_ps( 1.f );
+		for( ; i + 8 <= last; i += 8 )
+		{
+			__m256i seg = _mm256_slli_epi32( _mm256_loadu_si256( (const __m256i *)&Cursor[i] ), 3 );	// * KEYTIMEBATCH_SEG_FLOATS
+			__m256 u = _mm256_mul_ps( _mm256_sub_ps( t, _mm256_i32gather_ps( segs + KB_T0, seg, 4 ) ),
+			                                            _mm256_i32gather_ps( segs + KB_ONEOVERDT, seg, 4 ) );
+			u = _mm256_min_ps( _mm256_max_ps( u, zero ), one );
+			__m256 v = _mm256_i32gather_ps( segs + KB_A, seg, 4 );
+			v = _mm256_add_ps( _mm256_mul_ps( v, u ), _mm256_i32gather_ps( segs + KB_B, seg, 4 ) );
+			v = _mm256_add_ps( _mm256_mul_ps( v, u ), _mm256_i32gather_ps( segs + KB_C, seg, 4 ) );
+			v = _mm256_add_ps( _mm256_mul_ps( v, u ), _mm256_i32gather_ps( segs + KB_D, seg, 4 ) );
+			_mm256_storeu_ps( &values[i], v );
+		}
+#elif defined(KEYTIMEBATCH_SSE2)
+		// no gathers -- the loads are scalar, the arithmetic is not:
+		__m128 t    = _mm_set1_ps( time );
+		__m128 zero = _mm_setzero_ps( );
+		__m128 one  = _mm_set1_ps( 1.f );
+		for( ; i + 4 <= last; i += 4 )
+		{
+			const float *s0 = segs + KEYTIMEBATCH_SEG_FLOATS * Cursor[i+0];
+			const float *s1 = segs + KEYTIMEBATCH_SEG_FLOATS * Cursor[i+1];
+			const float *s2 = segs + KEYTIMEBATCH_SEG_FLOATS * Cursor[i+2];
+			const float *s3 = segs + KEYTIMEBATCH_SEG_FLOATS * Cursor[i+3];
+			__m128 u = _mm_mul_ps( _mm_sub_ps( t, _mm_setr_ps( s0[KB_T0], s1[KB_T0], s2[KB_T0], s3[KB_T0] ) ),
+			          _mm_setr_ps( s0[KB_ONEOVERDT], s1[KB_ONEOVERDT], s2[KB_ONEOVERDT], s3[KB_ONEOVERDT] ) );
+			u = _mm_min_ps( _mm_max_ps( u, zero ), one );
+			__m128 v = _mm_setr_ps( s0[KB_A], s1[KB_A], s2[KB_A], s3[KB_A] );
+			v = _mm_add_ps( _mm_mul_ps( v, u ), _mm_setr_ps( s0[KB_B], s1[KB_B], s2[KB_B], s3[KB_B] ) );
+			v = _mm_add_ps( _mm_mul_ps( v, u ), _mm_setr_ps( s0[KB_C], s1[KB_C], s2[KB_C], s3[KB_C] ) );
+			v = _mm_add_ps( _mm_mul_ps( v, u ), _mm_setr_ps( s0[KB_D], s1[KB_D], s2[KB_D], s3[KB_D] ) );
+			_mm_storeu_ps( &values[i], v );
+		}
+#endif
+	}
+
+	// scalar fallback, and whatever is left over from the vector loops:
+
+	for( ; i < last; i++ )
+	{
+		const float *s = segs + KEYTIMEBATCH_SEG_FLOATS * Cursor[i];
+		float u = ( time - s[KB_T0] ) * s[KB_ONEOVERDT];
+		u = u < 0.f ? 0.f : ( u > 1.f ? 1.f : u );
+		values[i] = s[KB_D] + u * ( s[KB_C] + u * ( s[KB_B] + u*s[KB_A] ) );
+	}
+}
+
+
+// move each track's cursor to the segment holding time:
+// playing forward, that is the segment it was in or the next one, otherwise it is a binary search
+// (before the first segment, it stays on the first one, after the last, on the last one)
+
+void
+KeytimeBatch::FindSegments( float time, int first, int last )
+{
+	const float *segs = &Segs[0];
+	for( int i = first; i < last; i++ )
+	{
+		int s = Cursor[i];
+		const float *seg = segs + KEYTIMEBATCH_SEG_FLOATS * s;
+		if( ( time >= seg[KB_T0]  ||  s == First[i] )  &&  ( time <= seg[KB_T1]  ||  s == Last[i] ) )
+			continue;
+		const float *next = seg + KEYTIMEBATCH_SEG_FLOATS;
+		if( s < Last[i]  &&  time >= next[KB_T0]  &&  ( time <= next[KB_T1]  ||  s+1 == Last[i] ) )
+		{
+			Cursor[i] = s + 1;
+			continue;
+		}
+
+		int lo = First[i];
+		int hi = Last[i];
+		while( lo < hi )
+		{
+			int mid = ( lo + hi + 1 ) / 2;
+			if( segs[ KEYTIMEBATCH_SEG_FLOATS * mid + KB_T0 ] <= time )
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		Cursor[i] = lo;
+	}
+}
+
+
+int
+KeytimeBatch::GetNumTracks( )
+{
+	return (int)First.size( );
+}
+
+
+// which vector code this was compiled with:
+
+const char *
+KeytimeBatch::GetInstructionSet( )
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(KEYTIMEBATCH_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+
+void
+KeytimeBatch::Init( )
+{
+	First.clear( );
+	Last.clear( );
+	Cursor.clear( );
+	Segs.clear( );
+	SetThreads( 1 );
+	Vectorized = true;
+}
+
+
+// start (or stop) worker threads so that n threads share each Evaluate( ) with enough tracks --
+// they are kept, waiting, until the thread count changes or the batch goes away:
+
+void
+KeytimeBatch::SetThreads( int n )
+{
+	if( n < 1 )
+		n = 1;
+	if( n == NumThreads  &&  (int)Workers.size( ) == n - 1 )
+		return;
+
+	StopWorkers( );
+	NumThreads = n;
+	Quit = false;
+	for( int t = 1; t < n; t++ )
+		Workers.push_back( std::thread( &KeytimeBatch::Work, this, t, Generation ) );
+}
+
+
+// false forces the scalar loop (for comparing against it):
+
+void
+KeytimeBatch::SetVectorized( bool vectorized )
+{
+	Vectorized = vectorized;
+}
+
+
+void
+KeytimeBatch::StopWorkers( )
+{
+	if( Workers.empty( ) )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( Lock );
+		Quit = true;
+	}
+	Wake.notify_all( );
+	for( size_t t = 0; t < Workers.size( ); t++ )
+		Workers[t].join( );
+	Workers.clear( );
+}
+
+
+// a worker thread: evaluate its range of tracks each time Evaluate( ) bumps the generation,
+// until told to quit (a worker with no range this time just waits for the next one)
+
+void
+KeytimeBatch::Work( int t, int generation )
+{
+	for( ; ; )
+	{
+		int first, last;
+		float time;
+		float *values;
+		{
+			std::unique_lock<std::mutex> lock( Lock );
+			Wake.wait( lock, [this, generation] { return Quit  ||  Generation != generation; } );
+			if( Quit )
+				return;
+			generation = Generation;
+			if( t >= JobThreads )
+				continue;
+			first = t * JobPerThread;
+			last = first + JobPerThread < GetNumTracks( ) ? first + JobPerThread : GetNumTracks( );
+			time = JobTime;
+			values = JobValues;
+		}
+
+		EvaluateRange( time, values, first, last );
+
+		bool done;
+		{
+			std::lock_guard<std::mutex> lock( Lock );
+			done = --Remaining == 0;
+		}
+		if( done )
+			Done.notify_one( );
+	}
+}
+
+
+// throughput benchmark: 100,000 channels of 32 keys each, played forward,
+// scalar against vector, and on more and more threads
+// g++ -DBATCH_BENCHMARK -O2 -std=c++11 -mavx2 keytime.cpp keytimebatch.cpp -o keytimebatchbench -lpthread
+// (leave off -mavx2 for the SSE2 version)
+
+//#define BATCH_BENCHMARK
+#ifdef BATCH_BENCHMARK
+#include <stdlib.h>
+#include <chrono>
+
+#define NUMCHANNELS	100000
+#define NUMKEYS		32
+#define NUMFRAMES	200
+
+double
+ChannelsPerMillisecond( KeytimeBatch &batch, float *values )
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+	for( int f = 0; f < NUMFRAMES; f++ )
+		batch.Evaluate( 40.f * (float)f / (float)NUMFRAMES, values );
+	std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now( ) - start;
+	return (double)NUMFRAMES * (double)batch.GetNumTracks( ) / ms.count( );
+}
+
+int
+main( int argc, char *argv[ ] )
+{
+	srand( 12345 );
+	KeytimeBatch batch;
+	std::vector<Keytimes> tracks( 1000 );		// the channels cycle through these
+	for( int t = 0; t < (int)tracks.size( ); t++ )
+	{
+		std::vector<struct TimeValue> keys;
+		float time = 0.f;
+		for( int k = 0; k < NUMKEYS; k++ )
+		{
+			struct TimeValue tv = { time, (float)rand( ) / (float)RAND_MAX };
+			keys.push_back( tv );
+			time += 0.5f + 2.f * (float)rand( ) / (float)RAND_MAX;
+		}
+		tracks[t].Build( &keys[0], NUMKEYS );
+	}
+	for( int c = 0; c < NUMCHANNELS; c++ )
+		batch.AddTrack( tracks[ c % tracks.size( ) ] );
+
+	// check against Keytimes::GetValue( ):
+	std::vector<float> values( NUMCHANNELS );
+	float maxError = 0.;
+	for( int i = 0; i < 100; i++ )
+	{
+		float time = 50.f * (float)rand( ) / (float)RAND_MAX - 5.f;
+		batch.Evaluate( time, &values[0] );
+		for( int c = 0; c < NUMCHANNELS; c += 97 )
+			maxError = fmaxf( maxError, fabsf( values[c] - tracks[ c % tracks.size( ) ].GetValue( time ) ) );
+	}
+	fprintf( stderr, "%d channels of %d keys, largest difference from Keytimes::GetValue( ) = %g\n", NUMCHANNELS, NUMKEYS, maxError );
+
+	batch.SetVectorized( false );
+	fprintf( stderr, "%-6s %2d thread:  %10.0f channels/ms\n", "scalar", 1, ChannelsPerMillisecond( batch, &values[0] ) );
+	batch.SetVectorized( true );
+	int maxThreads = (int)std::thread::hardware_concurrency( );
+	if( maxThreads < 4 )
+		maxThreads = 4;
+	for( int n = 1; n <= maxThreads; n *= 2 )
+	{
+		batch.SetThreads( n );
+		fprintf( stderr, "%-6s %2d thread%s %10.0f channels/ms\n", KeytimeBatch::GetInstructionSet( ), n, n == 1 ? ": " : "s:", ChannelsPerMillisecond( batch, &values[0] ) );
+	}
+	return 0;
+}
+#endif
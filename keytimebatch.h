@@ -0,0 +1,80 @@
+#ifndef KEYTIMEBATCH_H
+#define KEYTIMEBATCH_H
+
+#include <stdio.h>
+#include <math.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "keytime.h"
+
+
+// below this many tracks, Evaluate( ) does not bother starting threads:
+#define KEYTIMEBATCH_MIN_PER_THREAD	4096
+
+// each segment is 8 floats -- one 32-byte block, so all of a segment's gathers hit the same cache line:
+#define KEYTIMEBATCH_SEG_FLOATS		8
+enum KeytimeBatchFields
+{
+	KB_T0, KB_T1, KB_ONEOVERDT, KB_A, KB_B, KB_C, KB_D, KB_PAD
+};
+
+
+// Many keytime tracks ("channels") evaluated together at one time.
+//
+// The per-track state is in structure-of-arrays form (an array each of first
+// segment, last segment, and cursor, and the flat output array), and each track's
+// segment cubics are copied out of a Keytimes into one shared array of 32-byte
+// segment records (t0, t1, 1/dt, a, b, c, d), which the cursors index.
+// Evaluate( ) first walks each track's cursor to the segment holding the time
+// (one step at most while playing forward), then evaluates the cubics 8 tracks
+// at a time with AVX2 gathers, 4 at a time with SSE2, or one at a time, depending
+// on what the compiler was allowed to use.
+// The tracks can be split over several threads, each writing its own part of
+// the output array: SetThreads( ) starts the worker threads once, and each
+// Evaluate( ) with enough tracks wakes them, does the first part itself, and
+// waits for the rest.
+
+class KeytimeBatch
+{
+private:
+	std::vector<int>	First;		// per track: its first segment
+	std::vector<int>	Last;		// per track: its last segment
+	std::vector<int>	Cursor;		// per track: the segment it was in last time
+	std::vector<float>	Segs;		// KEYTIMEBATCH_SEG_FLOATS per segment
+	std::condition_variable	Done;		// the last worker has finished its tracks
+	int	Generation;			// bumped for every Evaluate( ) the workers are to help with
+	std::mutex	Lock;			// Generation, the Job values, Quit, and Remaining
+	int	JobPerThread;			// this Evaluate( )'s tracks per thread,
+	int	JobThreads;			// ... how many threads share them,
+	float	JobTime;			// ... the time,
+	float	*JobValues;			// ... and where the values go
+	int	NumThreads;
+	bool	Quit;
+	int	Remaining;			// workers still evaluating
+	bool	Vectorized;
+	std::condition_variable	Wake;		// there is work, or the workers should stop
+	std::vector<std::thread>	Workers;
+
+	void	AddSegment( float, float, float, float, float, float, float );
+	void	EvaluateRange( float, float *, int, int );
+	void	FindSegments( float, int, int );
+	void	StopWorkers( );
+	void	Work( int, int );
+
+public:
+	KeytimeBatch( );
+	~KeytimeBatch( );
+
+	int	AddTrack( const Keytimes & );
+	void	Evaluate( float, float * );
+	int	GetNumTracks( );
+	static const char *GetInstructionSet( );
+	void	Init( );
+	void	SetThreads( int );
+	void	SetVectorized( bool );
+};
+
+#endif	// KEYTIMEBATCH_H
@@ -0,0 +1,523 @@
+#include "lightclusters.h"
+#include "glslprogram.h"
+
+
+LightClusters::LightClusters( )
+{
+	Generation = 0;
+	Quit = false;
+	Remaining = 0;
+	WorkThreads = 1;
+	Init( );
+}
+
+
+LightClusters::~LightClusters( )
+{
+	StopWorkers( );
+}
+
+
+void
+LightClusters::AddPointLight( float x, float y, float z,  float radius,  float r, float g, float b )
+{
+	if( (int)Lights.size( ) >= MaxLights )
+		return;
+
+	struct ClusterLight light = { x, y, z,  radius,  r, g, b,  CLUSTER_POINT_LIGHT,  0., -1., 0.,  -1. };
+	Lights.push_back( light );
+}
+
+
+// same arguments as SetSpotLight( ), plus the radius of influence:
+// (the cutoff angle is in degrees)
+
+void
+LightClusters::AddSpotLight( float x, float y, float z,  float xdir, float ydir, float zdir,  float cutoff, float radius,  float r, float g, float b )
+{
+	if( (int)Lights.size( ) >= MaxLights )
+		return;
+
+	float len = sqrtf( xdir*xdir + ydir*ydir + zdir*zdir );
+	if( len > 0. )
+	{
+		xdir /= len;
+		ydir /= len;
+		zdir /= len;
+	}
+
+	float cosCutoff = cosf( cutoff * (float)M_PI / 180.f );
+	struct ClusterLight light = { x, y, z,  radius,  r, g, b,  CLUSTER_SPOT_LIGHT,  xdir, ydir, zdir,  cosCutoff };
+	Lights.push_back( light );
+}
+
+
+// bin the lights into the clusters in slices [z0,z1):
+// each cluster's light indices are appended to *list, and its count goes into counts[cluster]
+
+void
+LightClusters::BinSlices( int z0, int z1, std::vector<unsigned short> *list, int *counts )
+{
+	float logRatio = logf( Far / Near );
+	int numLights = (int)EyeLights.size( );
+
+	for( int iz = z0; iz < z1; iz++ )
+	{
+		for( int i = 0; i < CLUSTER_X*CLUSTER_Y; i++ )
+		{
+			int cluster = i + iz*CLUSTER_X*CLUSTER_Y;
+			int count = 0;
+			for( int l = 0; l < numLights  &&  count < CLUSTER_MAX_LIGHTS; l++ )
+			{
+				const struct ClusterLight &light = EyeLights[l];
+
+				// quick reject on depth before the full box test:
+
+				float dmin = -light.z - light.radius;
+				float dmax = -light.z + light.radius;
+				if( dmax < 0. )
+					continue;
+				int s0 = dmin <= Near ? 0 : (int)( logf( dmin / Near ) / logRatio * (float)CLUSTER_Z );
+				int s1 = dmax <= Near ? 0 : (int)( logf( dmax / Near ) / logRatio * (float)CLUSTER_Z );
+
+				// the last slice goes all the way out, so anything past Far is in it:
+
+				if( s0 > CLUSTER_Z-1 )
+					s0 = CLUSTER_Z-1;
+				if( s1 > CLUSTER_Z-1 )
+					s1 = CLUSTER_Z-1;
+				if( iz < s0  ||  iz > s1 )
+					continue;
+
+				if( SphereTouchesCluster( cluster, light ) )
+				{
+					list->push_back( (unsigned short)l );
+					count++;
+				}
+			}
+			counts[cluster] = count;
+		}
+	}
+}
+
+
+void
+LightClusters::Bind( )
+{
+	glActiveTexture( GL_TEXTURE0 + CLUSTER_FIRST_UNIT + 0 );
+	glBindTexture( GL_TEXTURE_2D, LightTex );
+	glActiveTexture( GL_TEXTURE0 + CLUSTER_FIRST_UNIT + 1 );
+	glBindTexture( GL_TEXTURE_2D, ClusterTex );
+	glActiveTexture( GL_TEXTURE0 + CLUSTER_FIRST_UNIT + 2 );
+	glBindTexture( GL_TEXTURE_2D, IndexTex );
+	glActiveTexture( GL_TEXTURE0 );
+}
+
+
+void
+LightClusters::Clear( )
+{
+	Lights.clear( );
+}
+
+
+// find the eye-space bounding box of each cluster:
+// (this only needs to happen when the projection changes)
+
+void
+LightClusters::ComputeClusterBounds( )
+{
+	float t = Ortho ? ProjSize : tanf( ProjSize * (float)M_PI / 180.f / 2.f );
+
+	for( int iz = 0; iz < CLUSTER_Z; iz++ )
+	{
+		// the first slice goes all the way to the eye, the last one all the way out:
+
+		float dn = iz == 0           ? 0.   : Near * powf( Far / Near, (float)(iz+0) / (float)CLUSTER_Z );
+		float df = iz == CLUSTER_Z-1 ? 1.e6f : Near * powf( Far / Near, (float)(iz+1) / (float)CLUSTER_Z );
+
+		for( int iy = 0; iy < CLUSTER_Y; iy++ )
+		{
+			float y0 = -1.f + 2.f * (float)(iy+0) / (float)CLUSTER_Y;
+			float y1 = -1.f + 2.f * (float)(iy+1) / (float)CLUSTER_Y;
+
+			for( int ix = 0; ix < CLUSTER_X; ix++ )
+			{
+				float x0 = -1.f + 2.f * (float)(ix+0) / (float)CLUSTER_X;
+				float x1 = -1.f + 2.f * (float)(ix+1) / (float)CLUSTER_X;
+
+				int cluster = ix + iy*CLUSTER_X + iz*CLUSTER_X*CLUSTER_Y;
+				if( Ortho )
+				{
+					ClusterMin[cluster][0] = x0 * t;
+					ClusterMax[cluster][0] = x1 * t;
+					ClusterMin[cluster][1] = y0 * t;
+					ClusterMax[cluster][1] = y1 * t;
+				}
+				else
+				{
+					// the frustum widens with depth, so check both ends of the slice:
+
+					float xa = x0*dn*t, xb = x0*df*t, xc = x1*dn*t, xd = x1*df*t;
+					float ya = y0*dn*t, yb = y0*df*t, yc = y1*dn*t, yd = y1*df*t;
+					ClusterMin[cluster][0] = fminf( fminf( xa, xb ), fminf( xc, xd ) );
+					ClusterMax[cluster][0] = fmaxf( fmaxf( xa, xb ), fmaxf( xc, xd ) );
+					ClusterMin[cluster][1] = fminf( fminf( ya, yb ), fminf( yc, yd ) );
+					ClusterMax[cluster][1] = fmaxf( fmaxf( ya, yb ), fmaxf( yc, yd ) );
+				}
+				ClusterMin[cluster][2] = -df;
+				ClusterMax[cluster][2] = -dn;
+			}
+		}
+	}
+}
+
+
+// create the float textures that hold the lights and the cluster lists:
+
+bool
+LightClusters::Create( int maxLights )
+{
+	MaxLights = maxLights;
+	IndexRows = ( MaxLights * CLUSTER_MAX_LIGHTS + CLUSTER_INDEX_WIDTH - 1 ) / CLUSTER_INDEX_WIDTH;
+
+	// light data: row 0 = eye position and radius, row 1 = color and type, row 2 = spot direction and cos(cutoff)
+
+	glGenTextures( 1, &LightTex );
+	glBindTexture( GL_TEXTURE_2D, LightTex );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F_ARB, MaxLights, 3, 0, GL_RGBA, GL_FLOAT, NULL );
+
+	// cluster data: one texel per cluster, luminance = offset into the index list, alpha = number of lights
+
+	glGenTextures( 1, &ClusterTex );
+	glBindTexture( GL_TEXTURE_2D, ClusterTex );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA32F_ARB, CLUSTER_X*CLUSTER_Y, CLUSTER_Z, 0, GL_LUMINANCE_ALPHA, GL_FLOAT, NULL );
+
+	// index list:
+
+	glGenTextures( 1, &IndexTex );
+	glBindTexture( GL_TEXTURE_2D, IndexTex );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_LUMINANCE32F_ARB, CLUSTER_INDEX_WIDTH, IndexRows, 0, GL_LUMINANCE, GL_FLOAT, NULL );
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	Lights.reserve( MaxLights );
+	EyeLights.reserve( MaxLights );
+	ClusterData.resize( 2 * CLUSTER_X*CLUSTER_Y*CLUSTER_Z );
+	Indices.resize( CLUSTER_INDEX_WIDTH * IndexRows );
+
+	ComputeClusterBounds( );
+
+	Valid = glGetError( ) == GL_NO_ERROR;
+	if( ! Valid )
+		fprintf( stderr, "Could not create the light cluster textures\n" );
+	return Valid;
+}
+
+
+int
+LightClusters::GetMaxLightsInCluster( )
+{
+	return MaxPerCluster;
+}
+
+
+int
+LightClusters::GetNumLights( )
+{
+	return (int)Lights.size( );
+}
+
+
+void
+LightClusters::Init( )
+{
+	Lights.clear( );
+	EyeLights.clear( );
+	ClusterTex = IndexTex = LightTex = 0;
+	IndexRows = 0;
+	MaxLights = 0;
+	MaxPerCluster = 0;
+	NumIndices = 0;
+	NumThreads = (int)std::thread::hardware_concurrency( );
+	if( NumThreads < 1 )
+		NumThreads = 1;
+	if( NumThreads > CLUSTER_Z )
+		NumThreads = CLUSTER_Z;
+	Ortho = false;
+	ProjSize = 70.;
+	Near = 1.;
+	Far = 100.;
+	Valid = false;
+	Viewport[0] = Viewport[1] = 0;
+	Viewport[2] = Viewport[3] = 1;
+}
+
+
+bool
+LightClusters::IsValid( )
+{
+	return Valid;
+}
+
+
+// fovy is in degrees for a perspective projection, or is the half-height of an orthographic one
+// near and far are the depth range that gets sliced -- anything outside goes into the first or last slice
+
+void
+LightClusters::SetProjection( bool ortho, float size, float near, float far )
+{
+	if( ortho != Ortho  ||  size != ProjSize  ||  near != Near  ||  far != Far )
+	{
+		Ortho = ortho;
+		ProjSize = size;
+		Near = near;
+		Far = far;
+		ComputeClusterBounds( );
+	}
+}
+
+
+void
+LightClusters::SetThreads( int n )
+{
+	if( n < 1 )
+		n = 1;
+	if( n > CLUSTER_Z )
+		n = CLUSTER_Z;
+	if( n != NumThreads )
+		StopWorkers( );		// the next Update( ) starts as many as it needs
+	NumThreads = n;
+}
+
+
+// give a program what it needs to find its cluster's lights:
+
+void
+LightClusters::SetUniforms( GLSLProgram &program )
+{
+	float logRatio = logf( Far / Near );
+	float dims[3] = { (float)CLUSTER_X, (float)CLUSTER_Y, (float)CLUSTER_Z };
+
+	program.SetUniformVariable( (char *)"uLightData",    CLUSTER_FIRST_UNIT + 0 );
+	program.SetUniformVariable( (char *)"uClusterData",  CLUSTER_FIRST_UNIT + 1 );
+	program.SetUniformVariable( (char *)"uLightIndices", CLUSTER_FIRST_UNIT + 2 );
+	program.SetUniformVariable( (char *)"uClusterViewport", (float)Viewport[0], (float)Viewport[1], (float)Viewport[2], (float)Viewport[3] );
+	program.SetUniformVariable( (char *)"uClusterDims", dims );
+	program.SetUniformVariable( (char *)"uClusterScale", (float)CLUSTER_Z / logRatio );
+	program.SetUniformVariable( (char *)"uClusterBias", -(float)CLUSTER_Z * logf( Near ) / logRatio );
+	program.SetUniformVariable( (char *)"uMaxLights", (float)MaxLights );
+	program.SetUniformVariable( (char *)"uIndexWidth", (float)CLUSTER_INDEX_WIDTH );
+	program.SetUniformVariable( (char *)"uIndexRows", (float)IndexRows );
+}
+
+
+bool
+LightClusters::SphereTouchesCluster( int cluster, const struct ClusterLight &light )
+{
+	float p[3] = { light.x, light.y, light.z };
+	float dist2 = 0.;
+	for( int i = 0; i < 3; i++ )
+	{
+		float d = 0.;
+		if( p[i] < ClusterMin[cluster][i] )
+			d = ClusterMin[cluster][i] - p[i];
+		else if( p[i] > ClusterMax[cluster][i] )
+			d = p[i] - ClusterMax[cluster][i];
+		dist2 += d*d;
+	}
+	return dist2 <= light.radius * light.radius;
+}
+
+
+// start the worker threads, if they aren't already, so that n threads bin each frame
+// (the one calling Update( ) is the other):
+
+void
+LightClusters::StartWorkers( int n )
+{
+	if( (int)Workers.size( ) == n - 1 )
+		return;
+
+	StopWorkers( );
+	Quit = false;
+	for( int t = 1; t < n; t++ )
+		Workers.push_back( std::thread( &LightClusters::Work, this, t, Generation ) );
+}
+
+
+void
+LightClusters::StopWorkers( )
+{
+	if( Workers.empty( ) )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( Lock );
+		Quit = true;
+	}
+	Wake.notify_all( );
+	for( size_t t = 0; t < Workers.size( ); t++ )
+		Workers[t].join( );
+	Workers.clear( );
+}
+
+
+// transform the lights into eye coordinates, bin them, and upload the results:
+// (call this with the viewing transformation on the modelview stack)
+
+void
+LightClusters::Update( int x, int y, int width, int height )
+{
+	if( ! Valid )
+		return;
+
+	Viewport[0] = x;
+	Viewport[1] = y;
+	Viewport[2] = width;
+	Viewport[3] = height;
+
+	float m[16];
+	glGetFloatv( GL_MODELVIEW_MATRIX, m );
+	float scale = sqrtf( m[0]*m[0] + m[1]*m[1] + m[2]*m[2] );	// the scene is scaled uniformly
+
+	int numLights = (int)Lights.size( );
+	EyeLights.resize( numLights );
+	for( int l = 0; l < numLights; l++ )
+	{
+		const struct ClusterLight &w = Lights[l];
+		struct ClusterLight &e = EyeLights[l];
+		e = w;
+		e.x = m[0]*w.x + m[4]*w.y + m[8]*w.z  + m[12];
+		e.y = m[1]*w.x + m[5]*w.y + m[9]*w.z  + m[13];
+		e.z = m[2]*w.x + m[6]*w.y + m[10]*w.z + m[14];
+		e.dx = ( m[0]*w.dx + m[4]*w.dy + m[8]*w.dz  ) / scale;
+		e.dy = ( m[1]*w.dx + m[5]*w.dy + m[9]*w.dz  ) / scale;
+		e.dz = ( m[2]*w.dx + m[6]*w.dy + m[10]*w.dz ) / scale;
+		e.radius = w.radius * scale;
+	}
+
+	// bin the lights -- each thread gets its own range of z slices,
+	// and this one does the first range while the workers do the rest:
+
+	int numThreads = numLights >= CLUSTER_THREAD_LIGHTS ? NumThreads : 1;
+	for( int t = 0; t < numThreads; t++ )
+		Lists[t].clear( );
+	if( numThreads > 1 )
+	{
+		StartWorkers( numThreads );
+		{
+			std::lock_guard<std::mutex> lock( Lock );
+			WorkThreads = numThreads;
+			Remaining = numThreads - 1;
+			Generation++;
+		}
+		Wake.notify_all( );
+
+		BinSlices( 0, CLUSTER_Z / numThreads, &Lists[0], Counts );
+
+		std::unique_lock<std::mutex> lock( Lock );
+		Done.wait( lock, [this] { return Remaining == 0; } );
+	}
+	else
+	{
+		BinSlices( 0, CLUSTER_Z, &Lists[0], Counts );
+	}
+
+	// the threads' lists are in cluster order, so they just get concatenated:
+
+	int capacity = (int)Indices.size( );
+	NumIndices = 0;
+	MaxPerCluster = 0;
+	int cluster = 0;
+	for( int t = 0; t < numThreads; t++ )
+	{
+		int z1 = ( t + 1 ) * CLUSTER_Z / numThreads;
+		int next = 0;
+		for( ; cluster < z1*CLUSTER_X*CLUSTER_Y; cluster++ )
+		{
+			int count = Counts[cluster];
+			if( NumIndices + count > capacity )
+				count = capacity - NumIndices;
+
+			ClusterData[2*cluster+0] = (float)NumIndices;
+			ClusterData[2*cluster+1] = (float)count;
+			for( int i = 0; i < count; i++ )
+				Indices[NumIndices++] = (float)Lists[t][next+i];
+			next += Counts[cluster];
+
+			if( count > MaxPerCluster )
+				MaxPerCluster = count;
+		}
+	}
+
+	// upload:
+
+	if( numLights > 0 )
+	{
+		std::vector<float> lightData( 3 * 4 * numLights );
+		for( int l = 0; l < numLights; l++ )
+		{
+			const struct ClusterLight &e = EyeLights[l];
+			float *row0 = &lightData[ 4*( 0*numLights + l ) ];
+			float *row1 = &lightData[ 4*( 1*numLights + l ) ];
+			float *row2 = &lightData[ 4*( 2*numLights + l ) ];
+			row0[0] = e.x;   row0[1] = e.y;   row0[2] = e.z;   row0[3] = e.radius;
+			row1[0] = e.r;   row1[1] = e.g;   row1[2] = e.b;   row1[3] = (float)e.type;
+			row2[0] = e.dx;  row2[1] = e.dy;  row2[2] = e.dz;  row2[3] = e.cosCutoff;
+		}
+		glBindTexture( GL_TEXTURE_2D, LightTex );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, numLights, 3, GL_RGBA, GL_FLOAT, &lightData[0] );
+	}
+
+	glBindTexture( GL_TEXTURE_2D, ClusterTex );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, CLUSTER_X*CLUSTER_Y, CLUSTER_Z, GL_LUMINANCE_ALPHA, GL_FLOAT, &ClusterData[0] );
+
+	int rows = ( NumIndices + CLUSTER_INDEX_WIDTH - 1 ) / CLUSTER_INDEX_WIDTH;
+	if( rows > 0 )
+	{
+		glBindTexture( GL_TEXTURE_2D, IndexTex );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, CLUSTER_INDEX_WIDTH, rows, GL_LUMINANCE, GL_FLOAT, &Indices[0] );
+	}
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+
+// a worker thread: bin its range of slices each time Update( ) bumps the generation,
+// until told to quit
+
+void
+LightClusters::Work( int t, int generation )
+{
+	for( ; ; )
+	{
+		int numThreads;
+		{
+			std::unique_lock<std::mutex> lock( Lock );
+			Wake.wait( lock, [this, generation] { return Quit  ||  Generation != generation; } );
+			if( Quit )
+				return;
+			generation = Generation;
+			numThreads = WorkThreads;
+		}
+
+		int z0 = ( t + 0 ) * CLUSTER_Z / numThreads;
+		int z1 = ( t + 1 ) * CLUSTER_Z / numThreads;
+		BinSlices( z0, z1, &Lists[t], Counts );
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock( Lock );
+			last = --Remaining == 0;
+		}
+		if( last )
+			Done.notify_one( );
+	}
+}
@@ -0,0 +1,133 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <stdio.h>
+#include <math.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// the cluster grid -- x and y tiles across the viewport, z slices in depth:
+#define CLUSTER_X		16
+#define CLUSTER_Y		16
+#define CLUSTER_Z		16
+
+// the most lights one cluster can hold
+// (this must match MAX_CLUSTER_LIGHTS in clusteredlights.frag):
+#define CLUSTER_MAX_LIGHTS	64
+
+// how many lights there must be before the binning is shared with the worker threads
+// (below this, waking them costs more than it saves):
+#define CLUSTER_THREAD_LIGHTS	32
+
+// width of the light index texture:
+#define CLUSTER_INDEX_WIDTH	1024
+
+// first texture unit used for the light textures
+// (above the diffuse, specular, and shadow map units):
+#define CLUSTER_FIRST_UNIT	7
+
+
+enum ClusterLightTypes
+{
+	CLUSTER_POINT_LIGHT, CLUSTER_SPOT_LIGHT
+};
+
+
+struct ClusterLight
+{
+	float	x, y, z;		// position
+	float	radius;			// distance at which the light has no more influence
+	float	r, g, b;
+	int	type;			// CLUSTER_POINT_LIGHT or CLUSTER_SPOT_LIGHT
+	float	dx, dy, dz;		// spot direction
+	float	cosCutoff;		// cosine of the spot cutoff angle
+};
+
+
+class GLSLProgram;
+
+
+// Clustered forward lighting for many point and spot lights.
+//
+// The view frustum is split into a CLUSTER_X x CLUSTER_Y x CLUSTER_Z grid,
+// with the z slices spaced exponentially in depth.
+// Each frame, the lights are transformed into eye coordinates and binned into
+// every cluster their sphere of influence touches (on several threads once
+// there are CLUSTER_THREAD_LIGHTS of them -- the worker threads are started the
+// first time they are needed and then kept, waiting, for every frame after), and
+// the per-cluster light lists are uploaded as float textures.
+// A fragment shader then finds its cluster from gl_FragCoord and its depth, and
+// loops over only that cluster's lights (see clusteredlights.frag).
+
+class LightClusters
+{
+private:
+	std::vector<struct ClusterLight>	Lights;
+	std::vector<struct ClusterLight>	EyeLights;
+	std::vector<float>			ClusterData;	// offset, count per cluster
+	std::vector<float>			Indices;
+	float	ClusterMin[CLUSTER_X*CLUSTER_Y*CLUSTER_Z][3];	// eye-space bounding box of each cluster
+	float	ClusterMax[CLUSTER_X*CLUSTER_Y*CLUSTER_Z][3];
+	GLuint	ClusterTex;
+	int	Counts[CLUSTER_X*CLUSTER_Y*CLUSTER_Z];		// lights in each cluster, this frame
+	std::condition_variable	Done;		// the last worker has finished its slices
+	int	Generation;			// bumped for every frame the workers are to bin
+	GLuint	IndexTex;
+	int	IndexRows;
+	std::vector<unsigned short>	Lists[CLUSTER_Z];	// each thread's light indices, in cluster order
+	GLuint	LightTex;
+	std::mutex	Lock;			// Generation, Quit, Remaining, and WorkThreads
+	int	MaxLights;
+	int	MaxPerCluster;
+	float	Near, Far;
+	int	NumIndices;
+	int	NumThreads;
+	bool	Ortho;
+	float	ProjSize;
+	bool	Quit;
+	int	Remaining;			// workers still binning this frame
+	bool	Valid;
+	int	Viewport[4];
+	std::condition_variable	Wake;		// there is a frame to bin, or the workers should stop
+	std::vector<std::thread>	Workers;
+	int	WorkThreads;			// how many threads (the caller's included) share this frame
+
+	void	BinSlices( int, int, std::vector<unsigned short> *, int * );
+	void	ComputeClusterBounds( );
+	bool	SphereTouchesCluster( int, const struct ClusterLight & );
+	void	StartWorkers( int );
+	void	StopWorkers( );
+	void	Work( int, int );
+
+public:
+	LightClusters( );
+	~LightClusters( );
+
+	void	AddPointLight( float, float, float,  float,  float, float, float );
+	void	AddSpotLight( float, float, float,  float, float, float,  float, float,  float, float, float );
+	void	Bind( );
+	void	Clear( );
+	bool	Create( int );
+	int	GetMaxLightsInCluster( );
+	int	GetNumLights( );
+	void	Init( );
+	bool	IsValid( );
+	void	SetProjection( bool, float, float, float );
+	void	SetThreads( int );
+	void	SetUniforms( GLSLProgram & );
+	void	Update( int, int, int, int );
+};
+
+#endif	// LIGHTCLUSTERS_H
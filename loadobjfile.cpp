@@ -53,8 +53,12 @@ void	ReadObjVTN( char *, int *, int *, int * );
 
 
 
+// if positions is not NULL, it gets every "v" of the file (x, y, z),
+// and each vertex is also given its index into it as texture coordinate 1
+// (for looking the vertex up in a vertex animation texture)
+
 int
-LoadObjFile( char *name )
+LoadObjFile( char *name, std::vector<float> *positions = NULL )
 {
 	char *cmd;		// the command string
 	char *str;		// argument string
@@ -142,6 +146,12 @@ LoadObjFile( char *name )
 			sv.z = (float)atof(str);
 
 			Vertices.push_back( sv );
+			if( positions != NULL )
+			{
+				positions->push_back( sv.x );
+				positions->push_back( sv.y );
+				positions->push_back( sv.z );
+			}
 
 			if( sv.x < xmin )	xmin = sv.x;
 			if( sv.x > xmax )	xmax = sv.x;
@@ -314,6 +324,9 @@ LoadObjFile( char *name )
 						glNormal3f( np->nx, np->ny, np->nz );
 					}
 
+					if( positions != NULL )
+						glMultiTexCoord1f( GL_TEXTURE1, (float)( vertices[ vv[vtx] ].v - 1 ) );
+
 					struct Vertex *vp = &Vertices[ vertices[ vv[vtx] ].v - 1 ];
 					glVertex3f( vp->x, vp->y, vp->z );
 				}
@@ -413,8 +426,11 @@ ReadObjVTN( char *str, int *v, int *t, int *n )
 
 // Uses LoadObjFile function as a base
 // Loads specific geometry from a multi-object .obj file and prepares it for use in vertex buffers.
+// If positions is given, it also gets a tightly packed copy of just the vertex positions
+// (3 floats per vertex instead of 8) for depth-only passes.
 int LoadTreeGeometry(const char *filename, const std::string &objectName, 
-                     std::vector<float> &vertices, std::vector<unsigned int> &indices) {
+                     std::vector<float> &vertices, std::vector<unsigned int> &indices,
+                     std::vector<float> *positions = NULL) {
     char *cmd;
     char *str;
 
@@ -541,6 +557,12 @@ int LoadTreeGeometry(const char *filename, const std::string &objectName,
 
                 vertices.push_back(tex.s);
                 vertices.push_back(tex.t);
+
+                if (positions != NULL) {
+                    positions->push_back(vert.x);
+                    positions->push_back(vert.y);
+                    positions->push_back(vert.z);
+                }
             }
 
             // Triangulate the face and populate indices
@@ -561,7 +583,8 @@ int LoadTreeGeometry(const char *filename, const std::string &objectName,
 // Same as LoadTreeGeometry function, but does not deal with mutliple object .obj files
 int LoadGeometry(const char *filename, 
                  std::vector<float> &vertices, 
-                 std::vector<unsigned int> &indices) {
+                 std::vector<unsigned int> &indices,
+                 std::vector<float> *positions = NULL) {
     char *cmd;
     char *str;
 
@@ -680,6 +703,12 @@ int LoadGeometry(const char *filename,
 
                 vertices.push_back(tex.s);
                 vertices.push_back(tex.t);
+
+                if (positions != NULL) {
+                    positions->push_back(vert.x);
+                    positions->push_back(vert.y);
+                    positions->push_back(vert.z);
+                }
             }
 
             // Triangulate the face and populate indices
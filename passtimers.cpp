@@ -0,0 +1,396 @@
+#include "passtimers.h"
+#include <algorithm>
+
+
+PassTimers::PassTimers( )
+{
+	Init( );
+}
+
+
+// add a pass to be timed -- returns its number, for Begin( ) and End( ):
+
+int
+PassTimers::AddPass( const char *name )
+{
+	struct PassSamples p;
+	p.name = name;
+	Passes.push_back( p );
+	FrameCpu.push_back( 0.f );
+	FrameRan.push_back( false );
+	LastCpu.push_back( -1.f );
+	LastGpu.push_back( -1.f );
+	return (int)Passes.size( ) - 1;
+}
+
+
+void
+PassTimers::Begin( int pass )
+{
+	if( ! Enabled  ||  pass < 0  ||  pass >= (int)Passes.size( ) )
+		return;
+
+	if( Open >= 0 )
+	{
+		Depth++;
+		return;
+	}
+
+	Open = pass;
+	OpenStart = std::chrono::steady_clock::now( );
+#ifndef __APPLE__
+	if( GpuTiming )
+	{
+		OpenQuery = NewQuery( );
+		glQueryCounter( OpenQuery, GL_TIMESTAMP );
+	}
+#endif
+}
+
+
+// start a frame: read back the gpu times of the frame that last used this ring slot
+
+void
+PassTimers::BeginFrame( )
+{
+	if( ! Enabled )
+		return;
+
+	Collect( Frame % PASSTIMER_FRAMES, false );
+	for( int p = 0; p < (int)Passes.size( ); p++ )
+	{
+		FrameCpu[p] = 0.f;
+		FrameRan[p] = false;
+	}
+}
+
+
+// turn one ring slot's queries into gpu samples
+// (if wait is false and they are not done yet, they are thrown away instead)
+
+void
+PassTimers::Collect( int slot, bool wait )
+{
+	std::vector<struct PassInterval> &intervals = Ring[slot];
+	if( intervals.empty( ) )
+		return;
+
+#ifndef __APPLE__
+	// the queries finish in order, so if the last one is done they all are:
+	GLint available = 1;
+	if( ! wait )
+		glGetQueryObjectiv( intervals.back( ).end, GL_QUERY_RESULT_AVAILABLE, &available );
+
+	if( available )
+	{
+		std::vector<double> totals( Passes.size( ), -1. );
+		for( int i = 0; i < (int)intervals.size( ); i++ )
+		{
+			GLuint64 t0 = 0, t1 = 0;
+			glGetQueryObjectui64v( intervals[i].begin, GL_QUERY_RESULT, &t0 );
+			glGetQueryObjectui64v( intervals[i].end,   GL_QUERY_RESULT, &t1 );
+			double ms = t1 > t0 ? (double)( t1 - t0 ) * 1.e-6 : 0.;
+			int p = intervals[i].pass;
+			totals[p] = ( totals[p] < 0. ? 0. : totals[p] ) + ms;
+		}
+		for( int p = 0; p < (int)Passes.size( ); p++ )
+		{
+			LastGpu[p] = (float)totals[p];
+			if( totals[p] >= 0.  &&  KeepSamples )
+				Passes[p].gpu.push_back( (float)totals[p] );
+		}
+	}
+	else
+	{
+		GpuDropped++;
+	}
+#endif
+
+	for( int i = 0; i < (int)intervals.size( ); i++ )
+	{
+		FreeQueries.push_back( intervals[i].begin );
+		FreeQueries.push_back( intervals[i].end );
+	}
+	intervals.clear( );
+}
+
+
+// find out if the gpu can be timed (call this once there is a context):
+
+void
+PassTimers::Create( )
+{
+	GpuTiming = false;
+#ifndef __APPLE__
+	const char *extensions = (const char *)glGetString( GL_EXTENSIONS );
+	GpuTiming = extensions != NULL  &&  strstr( extensions, "GL_ARB_timer_query" ) != NULL
+		&&  glQueryCounter != NULL  &&  glGetQueryObjectui64v != NULL;
+#endif
+	if( ! GpuTiming )
+		fprintf( stderr, "GL_ARB_timer_query is not available, so only the CPU side of each pass will be timed\n" );
+}
+
+
+void
+PassTimers::End( int pass )
+{
+	if( ! Enabled )
+		return;
+
+	if( Depth > 0 )
+	{
+		Depth--;
+		return;
+	}
+	if( pass != Open )
+		return;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+	FrameCpu[pass] += (float)( std::chrono::duration<double, std::milli>( now - OpenStart ).count( ) );
+	FrameRan[pass] = true;
+
+#ifndef __APPLE__
+	if( GpuTiming )
+	{
+		struct PassInterval interval;
+		interval.pass = pass;
+		interval.begin = OpenQuery;
+		interval.end = NewQuery( );
+		glQueryCounter( interval.end, GL_TIMESTAMP );
+		Ring[ Frame % PASSTIMER_FRAMES ].push_back( interval );
+	}
+#endif
+	Open = -1;
+}
+
+
+// end a frame: every pass that ran gets one cpu sample
+
+void
+PassTimers::EndFrame( )
+{
+	if( ! Enabled )
+		return;
+
+	for( int p = 0; p < (int)Passes.size( ); p++ )
+	{
+		LastCpu[p] = FrameRan[p] ? FrameCpu[p] : -1.f;
+		if( FrameRan[p]  &&  KeepSamples )
+			Passes[p].cpu.push_back( FrameCpu[p] );
+	}
+	Frame++;
+}
+
+
+// read back every query still in flight, waiting for them if need be
+// (call this after the last frame, before writing the results):
+
+void
+PassTimers::Finish( )
+{
+	for( int k = 0; k < PASSTIMER_FRAMES; k++ )
+		Collect( ( Frame + k ) % PASSTIMER_FRAMES, true );
+}
+
+
+// the latest cpu and gpu milliseconds of a pass (-1. if it did not run, or is not known yet):
+
+void
+PassTimers::GetLastTimes( int pass, float *cpu, float *gpu )
+{
+	*cpu = *gpu = -1.f;
+	if( pass < 0  ||  pass >= (int)Passes.size( ) )
+		return;
+	*cpu = LastCpu[pass];
+	*gpu = LastGpu[pass];
+}
+
+
+int
+PassTimers::GetNumPasses( )
+{
+	return (int)Passes.size( );
+}
+
+
+const char *
+PassTimers::GetPassName( int pass )
+{
+	if( pass < 0  ||  pass >= (int)Passes.size( ) )
+		return "";
+	return Passes[pass].name.c_str( );
+}
+
+
+void
+PassTimers::Init( )
+{
+	Depth = 0;
+	Enabled = false;
+	Frame = 0;
+	FrameCpu.clear( );
+	FrameRan.clear( );
+	FreeQueries.clear( );
+	GpuTiming = false;
+	GpuDropped = 0;
+	KeepSamples = true;
+	LastCpu.clear( );
+	LastGpu.clear( );
+	Open = -1;
+	OpenQuery = 0;
+	Passes.clear( );
+	for( int k = 0; k < PASSTIMER_FRAMES; k++ )
+		Ring[k].clear( );
+}
+
+
+bool
+PassTimers::IsEnabled( )
+{
+	return Enabled;
+}
+
+
+GLuint
+PassTimers::NewQuery( )
+{
+	GLuint q = 0;
+	if( ! FreeQueries.empty( ) )
+	{
+		q = FreeQueries.back( );
+		FreeQueries.pop_back( );
+	}
+	else
+	{
+		glGenQueries( 1, &q );
+	}
+	return q;
+}
+
+
+// mean and nearest-rank percentiles of some samples:
+
+void
+PassTimers::Percentiles( std::vector<float> samples, float *mean, float *p50, float *p95, float *p99 )
+{
+	*mean = *p50 = *p95 = *p99 = 0.f;
+	int n = (int)samples.size( );
+	if( n == 0 )
+		return;
+
+	std::sort( samples.begin( ), samples.end( ) );
+	double sum = 0.;
+	for( int i = 0; i < n; i++ )
+		sum += samples[i];
+	*mean = (float)( sum / (double)n );
+
+	float *out[3] = { p50, p95, p99 };
+	double pct[3] = { 0.50, 0.95, 0.99 };
+	for( int k = 0; k < 3; k++ )
+	{
+		int rank = (int)ceil( pct[k] * (double)n );
+		*out[k] = samples[ rank < 1 ? 0 : rank - 1 ];
+	}
+}
+
+
+void
+PassTimers::SetEnabled( bool enabled )
+{
+	Enabled = enabled;
+	Open = -1;
+	Depth = 0;
+}
+
+
+void
+PassTimers::SetKeepSamples( bool keep )
+{
+	KeepSamples = keep;
+}
+
+
+// one row per pass and clock (cpu or gpu), times in milliseconds:
+
+bool
+PassTimers::WriteCSV( const char *filename )
+{
+	FILE *fp = fopen( filename, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open '%s' to write the timings\n", filename );
+		return false;
+	}
+
+	fprintf( fp, "pass,clock,samples,mean_ms,p50_ms,p95_ms,p99_ms\n" );
+	for( int p = 0; p < (int)Passes.size( ); p++ )
+	{
+		const char *clocks[2] = { "cpu", "gpu" };
+		std::vector<float> *samples[2] = { &Passes[p].cpu, &Passes[p].gpu };
+		for( int c = 0; c < 2; c++ )
+		{
+			if( samples[c]->empty( ) )
+				continue;
+			float mean, p50, p95, p99;
+			Percentiles( *samples[c], &mean, &p50, &p95, &p99 );
+			fprintf( fp, "%s,%s,%d,%.4f,%.4f,%.4f,%.4f\n", Passes[p].name.c_str( ), clocks[c],
+				(int)samples[c]->size( ), mean, p50, p95, p99 );
+		}
+	}
+
+	fclose( fp );
+	return true;
+}
+
+
+// the same numbers as WriteCSV( ), plus what they were measured on
+// (and extra, if it is not NULL -- more "name": value members to add):
+
+bool
+PassTimers::WriteJSON( const char *filename, const char *renderer, const char *extra )
+{
+	FILE *fp = fopen( filename, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open '%s' to write the timings\n", filename );
+		return false;
+	}
+
+	fprintf( fp, "{\n" );
+	fprintf( fp, "  \"renderer\": \"" );
+	for( const char *cp = renderer != NULL ? renderer : ""; *cp != '\0'; cp++ )
+	{
+		if( *cp == '"'  ||  *cp == '\\' )
+			fputc( '\\', fp );
+		fputc( *cp, fp );
+	}
+	fprintf( fp, "\",\n" );
+	fprintf( fp, "  \"frames\": %d,\n", Frame );
+	fprintf( fp, "  \"gpu_timing\": %s,\n", GpuTiming ? "true" : "false" );
+	fprintf( fp, "  \"gpu_frames_dropped\": %d,\n", GpuDropped );
+	if( extra != NULL )
+		fprintf( fp, "  %s,\n", extra );
+	fprintf( fp, "  \"passes\": [\n" );
+	for( int p = 0; p < (int)Passes.size( ); p++ )
+	{
+		fprintf( fp, "    { \"name\": \"%s\"", Passes[p].name.c_str( ) );
+
+		const char *clocks[2] = { "cpu_ms", "gpu_ms" };
+		std::vector<float> *samples[2] = { &Passes[p].cpu, &Passes[p].gpu };
+		for( int c = 0; c < 2; c++ )
+		{
+			if( samples[c]->empty( ) )
+				continue;
+			float mean, p50, p95, p99;
+			Percentiles( *samples[c], &mean, &p50, &p95, &p99 );
+			fprintf( fp, ",\n      \"%s\": { \"samples\": %d, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f }",
+				clocks[c], (int)samples[c]->size( ), mean, p50, p95, p99 );
+		}
+		fprintf( fp, " }%s\n", p+1 < (int)Passes.size( ) ? "," : "" );
+	}
+	fprintf( fp, "  ]\n" );
+	fprintf( fp, "}\n" );
+
+	fclose( fp );
+	return true;
+}
@@ -0,0 +1,101 @@
+#ifndef PASSTIMERS_H
+#define PASSTIMERS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// how many frames of gpu queries can be in flight before their results are read:
+#define PASSTIMER_FRAMES		4
+
+
+// one timed stretch of one frame, and the two GL_TIMESTAMP queries around it:
+struct PassInterval
+{
+	int	pass;
+	GLuint	begin, end;
+};
+
+
+// the per-frame times of one pass, in milliseconds:
+struct PassSamples
+{
+	std::string		name;
+	std::vector<float>	cpu;
+	std::vector<float>	gpu;
+};
+
+
+// Per-pass CPU and GPU timers, for finding out where frame time goes.
+//
+// Begin( pass ) / End( pass ) bracket a stretch of drawing. The CPU time is read
+// from std::chrono::steady_clock; the GPU time comes from a pair of GL_TIMESTAMP
+// queries. A pass may be begun and ended several times in one frame -- its times
+// are added up into one sample per frame. A Begin( ) while another pass is open is
+// ignored, so the time goes to the outermost pass that is open.
+//
+// The queries of the last PASSTIMER_FRAMES frames are kept in a ring, and a
+// frame's results are only read when its slot comes around again; if they are
+// still not ready, that frame's gpu samples are dropped rather than waiting.
+// Without GL_ARB_timer_query only the CPU is timed.
+// With SetKeepSamples( false ) only each pass's latest times are kept (for the HUD),
+// instead of every sample (for the bench report).
+
+class PassTimers
+{
+private:
+	int	Depth;					// Begin( )s ignored inside the open pass
+	bool	Enabled;
+	int	Frame;
+	std::vector<float>	FrameCpu;		// this frame's totals, per pass
+	std::vector<bool>	FrameRan;
+	std::vector<GLuint>	FreeQueries;
+	bool	GpuTiming;
+	int	GpuDropped;
+	bool	KeepSamples;
+	std::vector<float>	LastCpu;		// latest sample per pass, or -1.
+	std::vector<float>	LastGpu;
+	int	Open;					// the pass being timed, or -1
+	std::chrono::steady_clock::time_point	OpenStart;
+	GLuint	OpenQuery;
+	std::vector<struct PassSamples>	Passes;
+	std::vector<struct PassInterval>	Ring[PASSTIMER_FRAMES];
+
+	void	Collect( int, bool );
+	GLuint	NewQuery( );
+	void	Percentiles( std::vector<float>, float *, float *, float *, float * );
+
+public:
+	PassTimers( );
+
+	int	AddPass( const char * );
+	void	Begin( int );
+	void	BeginFrame( );
+	void	Create( );
+	void	End( int );
+	void	EndFrame( );
+	void	Finish( );
+	void	GetLastTimes( int, float *, float * );
+	int	GetNumPasses( );
+	const char *	GetPassName( int );
+	void	Init( );
+	bool	IsEnabled( );
+	void	SetEnabled( bool );
+	void	SetKeepSamples( bool );
+	bool	WriteCSV( const char * );
+	bool	WriteJSON( const char *, const char *, const char * );
+};
+
+#endif	// PASSTIMERS_H
@@ -0,0 +1,397 @@
+#include "shadowmap.h"
+
+
+// the texture matrix planes for the s, t, r, q coordinates:
+
+static GLenum TexGenCoords[4]  = { GL_S, GL_T, GL_R, GL_Q };
+static GLenum TexGenEnables[4] = { GL_TEXTURE_GEN_S, GL_TEXTURE_GEN_T, GL_TEXTURE_GEN_R, GL_TEXTURE_GEN_Q };
+
+
+ShadowMap::ShadowMap( )
+{
+	Init( );
+}
+
+
+// create the cascaded static maps, the dynamic map, and the framebuffer used to render into them:
+
+bool
+ShadowMap::Create( int staticSize, int dynamicSize, int numCascades )
+{
+	// be sure we have enough fixed-function texture units for every map:
+
+	// (one unit each, then one for the dynamic map, and one to apply them):
+
+	GLint maxUnits;
+	glGetIntegerv( GL_MAX_TEXTURE_UNITS, &maxUnits );
+	int availCascades = maxUnits - SHADOW_FIRST_UNIT - 2;
+	if( numCascades > availCascades )
+	{
+		fprintf( stderr, "Only have texture units for %d shadow cascades, not %d\n", availCascades, numCascades );
+		numCascades = availCascades;
+	}
+	if( numCascades > SHADOW_MAX_CASCADES )
+		numCascades = SHADOW_MAX_CASCADES;
+	if( numCascades < 1 )
+	{
+		fprintf( stderr, "Not enough texture units to do shadows\n" );
+		Valid = false;
+		return Valid;
+	}
+
+	NumCascades = numCascades;
+	StaticSize  = staticSize;
+	DynamicSize = dynamicSize;
+
+	for( int c = 0; c < NumCascades; c++ )
+		StaticTex[c] = CreateDepthTexture( StaticSize );
+	DynamicTex = CreateDepthTexture( DynamicSize );
+
+	// a depth-only framebuffer -- the map being rendered is attached in BeginPass( ):
+
+	glGenFramebuffers( 1, &Fbo );
+	glBindFramebuffer( GL_FRAMEBUFFER, Fbo );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, DynamicTex, 0 );
+	glDrawBuffer( GL_NONE );
+	glReadBuffer( GL_NONE );
+
+	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	if( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		fprintf( stderr, "Shadow map framebuffer is not complete: 0x%X\n", status );
+		Valid = false;
+		return Valid;
+	}
+
+	StaticValid = false;
+	Valid = true;
+	return Valid;
+}
+
+
+GLuint
+ShadowMap::CreateDepthTexture( int size )
+{
+	// anything outside the map reads as depth 1., i.e., not in shadow:
+
+	static float border[4] = { 1., 1., 1., 1. };
+
+	GLuint tex;
+	glGenTextures( 1, &tex );
+	glBindTexture( GL_TEXTURE_2D, tex );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL );
+	glTexParameteri( GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_INTENSITY );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	return tex;
+}
+
+
+// the light's view looks from the light position at the origin (the center of the camera orbit)
+// and is an orthographic box that holds a sphere of the given radius:
+
+void
+ShadowMap::GetLightMatrix( float radius, float m[16] )
+{
+	float dist = sqrtf( LightPos[0]*LightPos[0] + LightPos[1]*LightPos[1] + LightPos[2]*LightPos[2] );
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix( );
+		glLoadIdentity( );
+		glTranslatef( 0.5f, 0.5f, 0.5f );		// [-1,1] -> [0,1]
+		glScalef( 0.5f, 0.5f, 0.5f );
+		glOrtho( -radius, radius,  -radius, radius,  0.1f, dist + 2.f*radius );
+		gluLookAt( LightPos[0], LightPos[1], LightPos[2],  0., 0., 0.,  0., 1., 0. );
+		glGetFloatv( GL_MODELVIEW_MATRIX, m );
+	glPopMatrix( );
+}
+
+
+void
+ShadowMap::BeginPass( GLuint tex, int size, float radius )
+{
+	float dist = sqrtf( LightPos[0]*LightPos[0] + LightPos[1]*LightPos[1] + LightPos[2]*LightPos[2] );
+
+	glPushAttrib( GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_BIT | GL_TEXTURE_BIT );
+
+	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &PrevFbo );
+	glBindFramebuffer( GL_FRAMEBUFFER, Fbo );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex, 0 );
+	glViewport( 0, 0, size, size );
+	glClear( GL_DEPTH_BUFFER_BIT );
+
+	// only depth is needed -- push it back a little to keep the receivers from shadowing themselves:
+
+	glEnable( GL_DEPTH_TEST );
+	glDisable( GL_LIGHTING );
+	glDisable( GL_TEXTURE_2D );
+	glDisable( GL_FOG );
+	glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+	glEnable( GL_POLYGON_OFFSET_FILL );
+	glPolygonOffset( 2.f, 4.f );
+
+	glMatrixMode( GL_PROJECTION );
+	glPushMatrix( );
+	glLoadIdentity( );
+	glOrtho( -radius, radius,  -radius, radius,  0.1f, dist + 2.f*radius );
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix( );
+	glLoadIdentity( );
+	gluLookAt( LightPos[0], LightPos[1], LightPos[2],  0., 0., 0.,  0., 1., 0. );
+}
+
+
+// render the static casters into cascade #c:
+// (only needs to happen when NeedsStaticUpdate( ) says so)
+
+void
+ShadowMap::BeginStatic( int c )
+{
+	GetLightMatrix( StaticRadius[c], StaticMatrix[c] );
+	BeginPass( StaticTex[c], StaticSize, StaticRadius[c] );
+
+	// the cache is good once the last cascade has been drawn:
+
+	if( c == NumCascades - 1 )
+		StaticValid = true;
+}
+
+
+// render the animated casters into the dynamic map:
+// (this happens every frame)
+
+void
+ShadowMap::BeginDynamic( )
+{
+	GetLightMatrix( DynamicRadius, DynamicMatrix );
+	BeginPass( DynamicTex, DynamicSize, DynamicRadius );
+}
+
+
+void
+ShadowMap::EndPass( )
+{
+	glMatrixMode( GL_PROJECTION );
+	glPopMatrix( );
+	glMatrixMode( GL_MODELVIEW );
+	glPopMatrix( );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, (GLuint)PrevFbo );
+	glPopAttrib( );
+}
+
+
+// look up one map on one texture unit:
+// the color goes through untouched, and the alpha becomes how much light gets through so far --
+// for the first map, its own lookup raised to Ambient, after that, the last unit's alpha where
+// this map says lit and Ambient where it says shadowed
+
+void
+ShadowMap::SetTexGen( int unit, GLuint tex, float m[16], bool first )
+{
+	glActiveTexture( GL_TEXTURE0 + unit );
+	glBindTexture( GL_TEXTURE_2D, tex );
+	glEnable( GL_TEXTURE_2D );
+
+	// the eye planes get transformed by the inverse of the current modelview matrix,
+	// so with the viewing transformation loaded, texgen produces world-space shadow coordinates:
+
+	for( int i = 0; i < 4; i++ )
+	{
+		float plane[4] = { m[0+i], m[4+i], m[8+i], m[12+i] };		// row i
+		glTexGeni( TexGenCoords[i], GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR );
+		glTexGenfv( TexGenCoords[i], GL_EYE_PLANE, plane );
+		glEnable( TexGenEnables[i] );
+	}
+
+	float ambient[4] = { 0., 0., 0., Ambient };
+	glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE );
+	glTexEnvi( GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE );
+	glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS );
+	glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR );
+	if( first )
+	{
+		// lit (1.) stays 1., shadowed (0.) becomes Ambient:
+		glTexEnvi( GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_ADD );
+		glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_TEXTURE );
+		glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA );
+		glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_CONSTANT );
+		glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA );
+	}
+	else
+	{
+		glTexEnvi( GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_INTERPOLATE );
+		glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PREVIOUS );
+		glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA );
+		glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_CONSTANT );
+		glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA );
+		glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE2_ALPHA, GL_TEXTURE );
+		glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND2_ALPHA, GL_SRC_ALPHA );
+	}
+	glTexEnvfv( GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, ambient );
+}
+
+
+// the unit after the maps: multiply the lit color by the light that got through,
+// and put back the alpha the diffuse texture unit made (the maps used it up)
+
+void
+ShadowMap::SetApply( int unit )
+{
+	glActiveTexture( GL_TEXTURE0 + unit );
+	glBindTexture( GL_TEXTURE_2D, DynamicTex );		// never looked at, but the unit needs a texture to run
+	glEnable( GL_TEXTURE_2D );
+
+	glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE );
+	glTexEnvi( GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_MODULATE );
+	glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS );
+	glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR );
+	glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_PREVIOUS );
+	glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_ALPHA );
+	glTexEnvi( GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE );
+	glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PRIMARY_COLOR );
+	glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA );
+	glTexEnvi( GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_TEXTURE0 );
+	glTexEnvi( GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA );
+}
+
+
+// turn on the shadow lookups for everything drawn without a shader:
+// (call this with the viewing transformation on the modelview stack)
+
+void
+ShadowMap::Enable( )
+{
+	if( ! Valid )
+		return;
+
+	int unit = SHADOW_FIRST_UNIT;
+	for( int c = 0; c < NumCascades; c++ )
+		SetTexGen( unit++, StaticTex[c], StaticMatrix[c], c == 0 );
+	SetTexGen( unit++, DynamicTex, DynamicMatrix, false );
+	SetApply( unit );
+
+	glActiveTexture( GL_TEXTURE0 );
+}
+
+
+void
+ShadowMap::Disable( )
+{
+	if( ! Valid )
+		return;
+
+	for( int unit = SHADOW_FIRST_UNIT; unit <= SHADOW_FIRST_UNIT + NumCascades + 1; unit++ )
+	{
+		glActiveTexture( GL_TEXTURE0 + unit );
+		for( int i = 0; i < 4; i++ )
+			glDisable( TexGenEnables[i] );
+		glDisable( GL_TEXTURE_2D );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+	}
+
+	glActiveTexture( GL_TEXTURE0 );
+}
+
+
+int
+ShadowMap::GetNumCascades( )
+{
+	return NumCascades;
+}
+
+
+void
+ShadowMap::Init( )
+{
+	Fbo = 0;
+	PrevFbo = 0;
+	NumCascades = 0;
+	StaticSize = DynamicSize = 0;
+	DynamicTex = 0;
+	DynamicRadius = 0.;
+	for( int c = 0; c < SHADOW_MAX_CASCADES; c++ )
+	{
+		StaticTex[c] = 0;
+		StaticRadius[c] = 0.;
+	}
+	LightPos[0] = 0.;
+	LightPos[1] = 1.;
+	LightPos[2] = 0.;
+	StaticValid = false;
+	Valid = false;
+	SetAmbient( 0.35f );
+}
+
+
+// force the static casters to be re-rendered the next frame:
+
+void
+ShadowMap::Invalidate( )
+{
+	StaticValid = false;
+}
+
+
+bool
+ShadowMap::IsValid( )
+{
+	return Valid;
+}
+
+
+bool
+ShadowMap::NeedsStaticUpdate( )
+{
+	return Valid  &&  ! StaticValid;
+}
+
+
+// size the cascades from the radius of the camera orbit:
+// cascade 0 just holds the orbit, and each one after that is twice as big
+// the dynamic map only needs to hold the orbit, since that is where the animals are
+
+// how much of the lit color is left in shadow, 0. (black) to 1. (no shadows):
+
+void
+ShadowMap::SetAmbient( float ambient )
+{
+	Ambient = ambient < 0.f ? 0.f : ( ambient > 1.f ? 1.f : ambient );
+}
+
+
+void
+ShadowMap::SetCascades( float orbitRadius )
+{
+	if( fabs( orbitRadius - StaticRadius[0] ) > 0.001f )
+	{
+		for( int c = 0; c < SHADOW_MAX_CASCADES; c++ )
+			StaticRadius[c] = orbitRadius * (float)( 1 << c );
+		StaticValid = false;
+	}
+	DynamicRadius = orbitRadius;
+}
+
+
+
+
+void
+ShadowMap::SetLight( float x, float y, float z )
+{
+	if( x != LightPos[0]  ||  y != LightPos[1]  ||  z != LightPos[2] )
+	{
+		LightPos[0] = x;
+		LightPos[1] = y;
+		LightPos[2] = z;
+		StaticValid = false;
+	}
+}
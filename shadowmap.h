@@ -0,0 +1,84 @@
+#ifndef SHADOWMAP_H
+#define SHADOWMAP_H
+
+#include <stdio.h>
+#include <math.h>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// most cascades a ShadowMap will manage:
+#define SHADOW_MAX_CASCADES	4
+
+// first texture unit used to look up the shadow maps
+// (unit 0 holds the diffuse texture, unit 1 the bush specular texture):
+#define SHADOW_FIRST_UNIT	2
+
+
+// Shadow mapping from a single (sun) light for the fixed-function pipeline.
+//
+// The static casters (trees, bushes, rocks) never move, so they are rendered
+// once into a set of cached depth maps ("cascades") and only re-rendered when
+// the light or the cascade sizes change.
+// The animated casters (the animals) are rendered each frame into one small
+// dynamic depth map, which is composited with the static maps at lookup time.
+//
+// Each map is looked up on its own texture unit with eye-linear texgen and
+// ARB_shadow depth compares, so the lookup works for anything drawn without
+// a shader. The lookups build up, in the alpha channel, how much of the light
+// gets through -- 1 where every map says lit, the ambient factor where any of them
+// says shadowed -- and one more unit multiplies the lit color by that, so a shadow
+// darkens what is under it instead of painting over it.
+
+class ShadowMap
+{
+private:
+	GLuint	Fbo;
+	GLint	PrevFbo;		// the framebuffer to go back to after a pass
+	int	NumCascades;
+	int	StaticSize;
+	GLuint	StaticTex[SHADOW_MAX_CASCADES];
+	float	StaticRadius[SHADOW_MAX_CASCADES];
+	float	StaticMatrix[SHADOW_MAX_CASCADES][16];
+	bool	StaticValid;
+	int	DynamicSize;
+	GLuint	DynamicTex;
+	float	DynamicRadius;
+	float	DynamicMatrix[16];
+	float	Ambient;		// how much of the color is left in shadow
+	float	LightPos[3];
+	bool	Valid;
+
+	GLuint	CreateDepthTexture( int );
+	void	GetLightMatrix( float, float [16] );
+	void	BeginPass( GLuint, int, float );
+	void	SetApply( int );
+	void	SetTexGen( int, GLuint, float [16], bool );
+
+public:
+	ShadowMap( );
+
+	bool	Create( int, int, int );
+	void	BeginDynamic( );
+	void	BeginStatic( int );
+	void	Disable( );
+	void	Enable( );
+	void	EndPass( );
+	int	GetNumCascades( );
+	void	Init( );
+	void	Invalidate( );
+	bool	IsValid( );
+	bool	NeedsStaticUpdate( );
+	void	SetAmbient( float );
+	void	SetCascades( float );
+	void	SetLight( float, float, float );
+};
+
+#endif	// SHADOWMAP_H
@@ -0,0 +1,124 @@
+#include "trace.h"
+
+#ifdef TRACE
+
+std::vector<struct TraceRing *>	Trace::Rings;
+std::mutex	Trace::RingsLock;
+const std::chrono::steady_clock::time_point	Trace::Start = std::chrono::steady_clock::now( );
+
+
+// nanoseconds since the program started:
+
+long long
+Trace::Now( )
+{
+	return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ) - Start ).count( );
+}
+
+
+// add one event to the calling thread's ring:
+// the first TRACE_KEEP_EVENTS stay where they are, the rest go around the remainder of the ring
+
+void
+Trace::Record( const char *name, long long start, long long end )
+{
+	struct TraceRing *ring = ThisRing( );
+	unsigned int n = ring->count.load( std::memory_order_relaxed );
+	unsigned int slot = n < TRACE_KEEP_EVENTS ? n : TRACE_KEEP_EVENTS + ( n - TRACE_KEEP_EVENTS ) % ( TRACE_RING_EVENTS - TRACE_KEEP_EVENTS );
+
+	struct TraceEvent &e = ring->events[slot];
+	e.name = name;
+	e.start = start;
+	e.duration = end - start;
+	ring->count.store( n + 1, std::memory_order_release );
+}
+
+
+void
+Trace::SetThreadName( const char *name )
+{
+	ThisRing( )->threadName = name;
+}
+
+
+// the calling thread's ring, made the first time the thread records anything:
+
+struct TraceRing *
+Trace::ThisRing( )
+{
+	static thread_local struct TraceRing *ring = NULL;
+	if( ring == NULL )
+	{
+		ring = new struct TraceRing;
+		ring->count.store( 0 );
+		ring->threadName = NULL;
+
+		std::lock_guard<std::mutex> lock( RingsLock );
+		ring->tid = (int)Rings.size( ) + 1;
+		Rings.push_back( ring );
+	}
+	return ring;
+}
+
+
+// write every thread's events as a Chrome trace -- "complete" (ph X) events,
+// in microseconds, plus a name for each thread:
+
+bool
+Trace::Write( const char *filename )
+{
+	FILE *fp = fopen( filename, "w" );
+	if( fp == NULL )
+	{
+		fprintf( stderr, "Cannot open '%s' to write the trace\n", filename );
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( RingsLock );
+	fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	fprintf( fp, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"forest\"}}" );
+
+	long long written = 0, lost = 0;
+	for( int r = 0; r < (int)Rings.size( ); r++ )
+	{
+		struct TraceRing *ring = Rings[r];
+		unsigned int n = ring->count.load( std::memory_order_acquire );
+		char defaultName[32];
+		snprintf( defaultName, sizeof( defaultName ), "thread %d", ring->tid );
+		fprintf( fp, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			ring->tid, ring->threadName != NULL ? ring->threadName : ( r == 0 ? "main" : defaultName ) );
+
+		// the kept events, then what is left of the rest, oldest first:
+
+		unsigned int kept = n < TRACE_KEEP_EVENTS ? n : TRACE_KEEP_EVENTS;
+		unsigned int wrapped = n - kept;
+		unsigned int room = TRACE_RING_EVENTS - TRACE_KEEP_EVENTS;
+		unsigned int first = wrapped > room ? wrapped - room : 0;
+		lost += first;
+
+		std::vector<unsigned int> slots;
+		for( unsigned int i = 0; i < kept; i++ )
+			slots.push_back( i );
+		for( unsigned int i = first; i < wrapped; i++ )
+			slots.push_back( TRACE_KEEP_EVENTS + i % room );
+
+		for( int i = 0; i < (int)slots.size( ); i++ )
+		{
+			const struct TraceEvent &e = ring->events[ slots[i] ];
+			fprintf( fp, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				e.name, ring->tid, (double)e.start * 1.e-3, (double)e.duration * 1.e-3 );
+		}
+		written += (long long)slots.size( );
+	}
+	fprintf( fp, "\n]}\n" );
+
+	bool ok = ferror( fp ) == 0;
+	fclose( fp );
+	if( ok )
+		fprintf( stderr, "Wrote %lld trace events to %s (%lld older ones had been overwritten)\n", written, filename, lost );
+	else
+		fprintf( stderr, "Cannot write the trace to '%s'\n", filename );
+	return ok;
+}
+
+#endif	// TRACE
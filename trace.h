@@ -0,0 +1,107 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped tracing, written out as Chrome trace-event JSON
+// (open it in https://ui.perfetto.dev or chrome://tracing).
+//
+//	TRACE_FUNCTION( );			times the rest of the function, named after it
+//	TRACE_SCOPE( "name" );			times the rest of the enclosing block
+//	x = TRACED( "name", f( ... ) );		times one call (or any expression)
+//	TRACE_THREAD_NAME( "name" );		names the calling thread in the trace
+//	TRACE_WRITE( "trace.json" );		writes out everything recorded so far
+//
+// Names must be string literals (or otherwise outlive the program) -- only the
+// pointer is kept.
+//
+// Each thread records into its own ring of events, so recording takes no locks:
+// only the owning thread writes to a ring, and it publishes each event with one
+// atomic store. The first TRACE_KEEP_EVENTS events of every thread are never
+// overwritten, so the startup is always in the trace along with the most recent
+// frames. A ring lives as long as the program, so don't trace short-lived threads.
+//
+// All of this is only compiled in with -DTRACE; without it the macros are empty
+// (TRACED( ) is just the expression) and trace.cpp compiles to nothing.
+
+#ifdef TRACE
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+
+// events per thread, and how many of the first ones are kept for good:
+#define TRACE_RING_EVENTS	131072
+#define TRACE_KEEP_EVENTS	16384
+
+
+// one timed stretch, in nanoseconds since the program started:
+struct TraceEvent
+{
+	const char *	name;
+	long long	start;
+	long long	duration;
+};
+
+
+// one thread's events:
+struct TraceRing
+{
+	std::atomic<unsigned int>	count;		// events ever recorded
+	const char *	threadName;
+	int		tid;
+	struct TraceEvent	events[TRACE_RING_EVENTS];
+};
+
+
+class Trace
+{
+private:
+	static std::vector<struct TraceRing *>	Rings;
+	static std::mutex	RingsLock;		// only for adding rings, and for Write( )
+	static const std::chrono::steady_clock::time_point	Start;
+
+	static struct TraceRing *	ThisRing( );
+
+public:
+	static long long	Now( );
+	static void	Record( const char *, long long, long long );
+	static void	SetThreadName( const char * );
+	static bool	Write( const char * );
+};
+
+
+// times its own lifetime:
+class TraceScope
+{
+private:
+	const char *	Name;
+	long long	StartTime;
+
+public:
+	TraceScope( const char *name ) : Name( name ), StartTime( Trace::Now( ) )	{ }
+	~TraceScope( )	{ Trace::Record( Name, StartTime, Trace::Now( ) ); }
+};
+
+
+#define TRACE_CONCAT2( a, b )		a##b
+#define TRACE_CONCAT( a, b )		TRACE_CONCAT2( a, b )
+
+#define TRACE_SCOPE( name )		TraceScope TRACE_CONCAT( traceScope, __LINE__ )( name )
+#define TRACE_FUNCTION( )		TRACE_SCOPE( __func__ )
+#define TRACED( name, expr )		( TraceScope( name ), ( expr ) )		// the scope lasts to the end of the full expression
+#define TRACE_THREAD_NAME( name )	Trace::SetThreadName( name )
+#define TRACE_WRITE( filename )		Trace::Write( filename )
+
+#else
+
+#define TRACE_SCOPE( name )
+#define TRACE_FUNCTION( )
+#define TRACED( name, expr )		( expr )
+#define TRACE_THREAD_NAME( name )
+#define TRACE_WRITE( filename )		( (void)( filename ), true )
+
+#endif	// TRACE
+
+#endif	// TRACE_H
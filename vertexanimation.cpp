@@ -0,0 +1,166 @@
+#include "vertexanimation.h"
+#include "glslprogram.h"
+
+
+VertexAnimation::VertexAnimation( )
+{
+	Init( );
+}
+
+
+// bake one clip: the deformer is evaluated for every vertex at samples evenly spaced times over [0,length)
+// returns the clip number to hand to SetUniforms( ), or -1 if the clip could not be added
+
+int
+VertexAnimation::AddClip( float length, int samples, VertexDeformer deform, const void *data )
+{
+	if( Valid  ||  NumVertices <= 0  ||  samples < 1  ||  length <= 0.  ||  deform == NULL )
+		return -1;
+
+	struct VertexAnimationClip clip;
+	clip.FirstRow = (int)Clips.size( ) == 0 ? 0 : Clips.back( ).FirstRow + Clips.back( ).Samples * RowsPerSample;
+	clip.Samples = samples;
+	clip.Length = length;
+
+	Offsets.resize( 3 * VAT_WIDTH * ( clip.FirstRow + samples * RowsPerSample ), 0.f );
+
+	for( int k = 0; k < samples; k++ )
+	{
+		float t = length * (float)k / (float)samples;
+		float *row = &Offsets[ 3 * VAT_WIDTH * ( clip.FirstRow + k * RowsPerSample ) ];
+		for( int v = 0; v < NumVertices; v++ )
+		{
+			const float *in = &Positions[ 3*v ];
+			float out[3];
+			deform( t, in, out, data );
+			row[ 3*v + 0 ] = out[0] - in[0];
+			row[ 3*v + 1 ] = out[1] - in[1];
+			row[ 3*v + 2 ] = out[2] - in[2];
+		}
+	}
+
+	Clips.push_back( clip );
+	return (int)Clips.size( ) - 1;
+}
+
+
+void
+VertexAnimation::Bind( )
+{
+	glActiveTexture( GL_TEXTURE0 + VAT_UNIT );
+	glBindTexture( GL_TEXTURE_2D, Tex );
+	glActiveTexture( GL_TEXTURE0 );
+}
+
+
+// upload all of the clips baked so far into the float texture:
+// (this fails if the vertex shader cannot look up textures, or the clips do not fit)
+// the CPU copy of the offsets is let go afterwards, so bake every clip before calling this
+
+bool
+VertexAnimation::Create( )
+{
+	Valid = false;
+	if( Clips.size( ) == 0 )
+		return false;
+
+	GLint vertexUnits = 0, combinedUnits = 0, maxSize = 0;
+	glGetIntegerv( GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &vertexUnits );
+	glGetIntegerv( GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &combinedUnits );
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxSize );
+	if( vertexUnits < 1  ||  combinedUnits <= VAT_UNIT )
+	{
+		fprintf( stderr, "Vertex shaders cannot look up the vertex animation texture\n" );
+		return false;
+	}
+
+	Height = (int)Offsets.size( ) / ( 3 * VAT_WIDTH );
+	if( Height > maxSize )
+	{
+		fprintf( stderr, "The vertex animation texture would be %d rows, but the most allowed is %d\n", Height, maxSize );
+		return false;
+	}
+
+	if( Tex == 0 )
+		glGenTextures( 1, &Tex );
+	glBindTexture( GL_TEXTURE_2D, Tex );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB32F_ARB, VAT_WIDTH, Height, 0, GL_RGB, GL_FLOAT, &Offsets[0] );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	std::vector<float>( ).swap( Offsets );
+
+	Valid = glGetError( ) == GL_NO_ERROR;
+	if( ! Valid )
+		fprintf( stderr, "Could not create the vertex animation texture\n" );
+	return Valid;
+}
+
+
+int
+VertexAnimation::GetNumClips( )
+{
+	return (int)Clips.size( );
+}
+
+
+int
+VertexAnimation::GetNumVertices( )
+{
+	return NumVertices;
+}
+
+
+void
+VertexAnimation::Init( )
+{
+	Clips.clear( );
+	Offsets.clear( );
+	Positions.clear( );
+	Height = 0;
+	NumVertices = 0;
+	RowsPerSample = 0;
+	Tex = 0;
+	Valid = false;
+}
+
+
+bool
+VertexAnimation::IsValid( )
+{
+	return Valid;
+}
+
+
+// the rest positions, in the order of the vertex indices the mesh hands the shader
+// (this throws away any clips already baked):
+
+void
+VertexAnimation::SetPositions( const std::vector<float> &positions )
+{
+	Positions = positions;
+	Valid = false;
+	NumVertices = (int)Positions.size( ) / 3;
+	RowsPerSample = ( NumVertices + VAT_WIDTH - 1 ) / VAT_WIDTH;
+	Clips.clear( );
+	Offsets.clear( );
+}
+
+
+// give a program what it needs to play back one clip:
+
+void
+VertexAnimation::SetUniforms( GLSLProgram &program, int clip )
+{
+	if( clip < 0  ||  clip >= (int)Clips.size( ) )
+		return;
+
+	const struct VertexAnimationClip &c = Clips[clip];
+
+	program.SetUniformVariable( (char *)"uVAT", VAT_UNIT );
+	program.SetUniformVariable( (char *)"uVATClip", (float)c.FirstRow, (float)c.Samples, c.Length, (float)RowsPerSample );
+	program.SetUniformVariable( (char *)"uVATWidth", (float)VAT_WIDTH );
+	program.SetUniformVariable( (char *)"uVATHeight", (float)Height );
+}
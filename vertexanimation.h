@@ -0,0 +1,81 @@
+#ifndef VERTEXANIMATION_H
+#define VERTEXANIMATION_H
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include "glew.h"
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+
+// width of the vertex animation texture -- a mesh with more vertices than this
+// wraps onto several rows per sample:
+#define VAT_WIDTH		1024
+
+// texture unit the vertex shader looks the offsets up on
+// (above the diffuse, specular, shadow map, and light cluster units):
+#define VAT_UNIT		10
+
+
+// where one rest-pose vertex is at time t of a clip
+// (data is whatever was handed to AddClip( )):
+
+typedef void (*VertexDeformer)( float t, const float in[3], float out[3], const void *data );
+
+
+struct VertexAnimationClip
+{
+	int	FirstRow;		// first texture row of the clip's samples
+	int	Samples;		// samples over one cycle
+	float	Length;			// cycle length, in the same units as the shader's uTime
+};
+
+
+class GLSLProgram;
+
+
+// Vertex animation textures ("VATs").
+//
+// A procedural deformation is evaluated on the CPU at evenly spaced samples over
+// one cycle, and each vertex's offset from its rest position is stored in a float
+// texture: one texel per vertex, VAT_WIDTH vertices to a row, the samples stacked
+// one below the other, and the clips stacked below that.
+// At runtime the vertex shader finds its texel from the vertex's index (handed in
+// as gl_MultiTexCoord1.s), fetches the two samples around uTime, and mixes them
+// (see the BAKED permutation of animal.vert), so every clip costs the same two
+// texture fetches no matter how complicated the deformation was.
+
+class VertexAnimation
+{
+private:
+	std::vector<struct VertexAnimationClip>	Clips;
+	std::vector<float>			Offsets;	// xyz per texel
+	std::vector<float>			Positions;	// rest positions, xyz per vertex
+	int	Height;				// texture rows
+	int	NumVertices;
+	int	RowsPerSample;
+	GLuint	Tex;
+	bool	Valid;
+
+public:
+	VertexAnimation( );
+
+	int	AddClip( float, int, VertexDeformer, const void * );
+	void	Bind( );
+	bool	Create( );
+	int	GetNumClips( );
+	int	GetNumVertices( );
+	void	Init( );
+	bool	IsValid( );
+	void	SetPositions( const std::vector<float> & );
+	void	SetUniforms( GLSLProgram &, int );
+};
+
+#endif	// VERTEXANIMATION_H